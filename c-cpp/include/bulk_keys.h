@@ -0,0 +1,61 @@
+/*
+ * bulk_keys.h: sorted random keys for the bulk loads of the benchmarks
+ */
+#ifndef BULK_KEYS_H_
+#define BULK_KEYS_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* the ranges sparser than this are drawn at random, see bulk_keys() */
+#define BULK_KEYS_SPARSE                16
+
+static inline int bulk_keys_cmp(const void *a, const void *b)
+{
+  unsigned long x = *(const unsigned long *)a, y = *(const unsigned long *)b;
+
+  return (x > y) - (x < y);
+}
+
+/*
+ * Returns n distinct keys drawn uniformly at random in [1;range], in
+ * increasing order, or exits if there are less than n keys in the range.
+ *
+ * The keys of a dense range are selected in a single pass over the range
+ * (selection sampling, Knuth's Algorithm S): key k is selected with
+ * probability (n - selected) / (range - k + 1). A range more than
+ * BULK_KEYS_SPARSE times larger than n would take too long to traverse
+ * (seconds for the default range), its keys are drawn at random instead,
+ * the few duplicates being redrawn.
+ */
+static inline unsigned long *bulk_keys(int n, long range, unsigned int *seed)
+{
+  unsigned long *keys, k;
+  int i, m = 0;
+
+  if (n < 0 || n > range) {
+    fprintf(stderr, "Error: cannot draw %d distinct keys in [1;%ld]\n", n, range);
+    exit(1);
+  }
+  if ((keys = (unsigned long *)malloc((n > 0 ? n : 1) * sizeof(unsigned long))) == NULL) {
+    perror("malloc");
+    exit(1);
+  }
+  if (range / BULK_KEYS_SPARSE <= n) {
+    for (k = 1; m < n; k++)
+      if ((range - k + 1) * (rand_r(seed) / (RAND_MAX + 1.0)) < n - m)
+        keys[m++] = k;
+    return keys;
+  }
+  while (m < n) {
+    for (i = m; i < n; i++)
+      keys[i] = 1 + (unsigned long)(range * (rand_r(seed) / (RAND_MAX + 1.0)));
+    qsort(keys, n, sizeof(unsigned long), bulk_keys_cmp);
+    for (i = 1, m = 1; i < n; i++)
+      if (keys[i] != keys[m - 1])
+        keys[m++] = keys[i];
+  }
+  return keys;
+}
+
+#endif /* BULK_KEYS_H_ */
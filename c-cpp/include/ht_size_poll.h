@@ -0,0 +1,94 @@
+/*
+ * ht_size_poll.h: size poller of the hash table benchmarks
+ *
+ * The poller repeatedly reads the size of the hash table while the other
+ * threads update it (-z: 1 = approximate, 2 = exact). The harnesses
+ * include this file once ht_intset_t, ht_size_approx(), ht_size_exact(),
+ * DEFAULT_SIZE_RETRIES, barrier_t and the stop flag are declared.
+ */
+#ifndef HT_SIZE_POLL_H_
+#define HT_SIZE_POLL_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#define SIZE_POLL_MAX                   2
+
+/* usage of -z, note is appended to its description */
+#define SIZE_POLL_HELP(note)                                            \
+  "  -z, --size-poll <int>\n"                                           \
+  "        Poll the size from an extra thread" note "\n"                \
+  "        0 = no polling,\n"                                           \
+  "        1 = approximate size,\n"                                     \
+  "        2 = exact size (default=" XSTR(DEFAULT_SIZE_POLL) ")\n"
+
+typedef struct poll_data {
+  int mode;
+  unsigned long nb_polls;
+  int min_size;
+  int max_size;
+  ht_intset_t *set;
+  barrier_t *barrier;
+  pthread_t thread;
+} poll_data_t;
+
+static void *poll_size(void *data)
+{
+  int size;
+  poll_data_t *d = (poll_data_t *)data;
+
+  barrier_cross(d->barrier);
+
+  while (AO_load_full(&stop) == 0) {
+    if (d->mode == 1)
+      size = ht_size_approx(d->set);
+    else
+      size = ht_size_exact(d->set, DEFAULT_SIZE_RETRIES);
+    if (d->nb_polls == 0 || size < d->min_size) d->min_size = size;
+    if (d->nb_polls == 0 || size > d->max_size) d->max_size = size;
+    d->nb_polls++;
+  }
+  return NULL;
+}
+
+/*
+ * Starts the poller of set if mode is not 0. The poller crosses barrier
+ * with the other threads, whose count must include it.
+ */
+static inline void poll_start(poll_data_t *d, int mode, ht_intset_t *set,
+                              barrier_t *barrier, pthread_attr_t *attr)
+{
+  d->mode = mode;
+  d->nb_polls = 0;
+  d->min_size = 0;
+  d->max_size = 0;
+  d->set = set;
+  d->barrier = barrier;
+  if (mode && pthread_create(&d->thread, attr, poll_size, (void *)d) != 0) {
+    fprintf(stderr, "Error creating thread\n");
+    exit(1);
+  }
+}
+
+/* Waits for the poller, once the stop flag is set */
+static inline void poll_join(poll_data_t *d)
+{
+  if (d->mode && pthread_join(d->thread, NULL) != 0) {
+    fprintf(stderr, "Error waiting for thread completion\n");
+    exit(1);
+  }
+}
+
+/* Prints the final sizes of set and the polls done in duration ms */
+static inline void poll_print(poll_data_t *d, ht_intset_t *set, int duration)
+{
+  printf("  #approx     : %d\n", ht_size_approx(set));
+  printf("  #exact      : %d\n", ht_size_exact(set, DEFAULT_SIZE_RETRIES));
+  if (d->mode) {
+    printf("  #polls      : %lu (%f / s)\n", d->nb_polls, d->nb_polls * 1000.0 / duration);
+    printf("  #min/max    : %d / %d\n", d->min_size, d->max_size);
+  }
+}
+
+#endif /* HT_SIZE_POLL_H_ */
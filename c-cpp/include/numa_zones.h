@@ -0,0 +1,38 @@
+/*
+ * numa_zones.h: memory nodes of the NUMA zones of the benchmarks
+ */
+#ifndef NUMA_ZONES_H_
+#define NUMA_ZONES_H_
+
+#include <numa.h>
+
+/*
+ * Writes the ids of the memory nodes with CPUs that the process may
+ * allocate on to nodes, at most max of them, and returns their number.
+ * The ids need not be 0..n-1: nodes can be offline, without CPUs or out
+ * of the cpuset, and are skipped as by the topology of NUMASK. Without
+ * libnuma, or if no node qualifies, node 0 is the only node.
+ */
+static inline int numa_zone_nodes(int *nodes, int max)
+{
+  struct bitmask *mems, *cpus;
+  int node, n = 0;
+
+  if (numa_available() != -1) {
+    mems = numa_get_mems_allowed();
+    cpus = numa_allocate_cpumask();
+    for (node = 0; node <= numa_max_node() && n < max; node++) {
+      if (!numa_bitmask_isbitset(mems, node))
+        continue;
+      if (numa_node_to_cpus(node, cpus) == 0 && numa_bitmask_weight(cpus) > 0)
+        nodes[n++] = node;
+    }
+    numa_free_cpumask(cpus);
+    numa_bitmask_free(mems);
+  }
+  if (n == 0)
+    nodes[n++] = 0;
+  return n;
+}
+
+#endif /* NUMA_ZONES_H_ */
@@ -19,3 +19,70 @@
 #  define TM_SHUTDOWN()                  /* nothing */
 #  define TM_THREAD_ENTER()              /* nothing */
 #  define TM_THREAD_EXIT()               /* nothing */
+
+/*
+ * Coarse-grained builds (STM=RWLOCK|SEQLOCK) run the sequential code under
+ * a single lock of src/utils/locks. The operations that only read take it
+ * in read mode or, with the sequence lock, read optimistically and retry
+ * if a writer wrote meanwhile. In that case the removed nodes are not
+ * freed (see SEQLOCK), as optimistic readers may still traverse them.
+ * The lock is zero initialized, each translation unit has its own.
+ */
+#if defined RWLOCK
+#  include "../src/utils/locks/locks.h"
+static lock_rw_t coarse_lock __attribute__((unused));
+#  define COARSE_NAME                    "reader-writer lock (BRAVO)"
+#  define COARSE_PRINT_STATS()           lock_print_stats()
+#  define COARSE_READ_BEGIN()            lock_rw_read_acquire(&coarse_lock)
+#  define COARSE_READ_END()              lock_rw_read_release(&coarse_lock)
+#  define COARSE_WRITE_BEGIN()           lock_rw_write_acquire(&coarse_lock)
+#  define COARSE_WRITE_END()             lock_rw_write_release(&coarse_lock)
+#elif defined SEQLOCK
+#  include "../src/utils/locks/locks.h"
+static lock_seq_t coarse_lock __attribute__((unused));
+#  define COARSE_NAME                    "sequence lock"
+#  define COARSE_PRINT_STATS()           lock_print_stats()
+#  define COARSE_READ_BEGIN()            { AO_t coarse_seq; do { coarse_seq = lock_seq_read_begin(&coarse_lock)
+#  define COARSE_READ_END()              } while (lock_seq_read_retry(&coarse_lock, coarse_seq)); }
+#  define COARSE_WRITE_BEGIN()           lock_seq_write_acquire(&coarse_lock)
+#  define COARSE_WRITE_END()             lock_seq_write_release(&coarse_lock)
+#else
+#  define COARSE_READ_BEGIN()            /* nothing */
+#  define COARSE_READ_END()              /* nothing */
+#  define COARSE_WRITE_BEGIN()           /* nothing */
+#  define COARSE_WRITE_END()             /* nothing */
+#endif
+
+/*
+ * Combining builds (STM=FLATCOMB|CCSYNCH|NODEREP) hand the sequential
+ * operations over to a combiner thread (see src/utils/locks/combining.h),
+ * the operation fn is a comb_fn_t applied to obj and arg. COMBINE_READ
+ * is for the operations that do not modify obj. With node replication
+ * (src/utils/locks/replication.h), fn is applied to the replica of the
+ * zone of the calling thread instead of obj.
+ */
+#if defined FLATCOMB
+#  include "../src/utils/locks/combining.h"
+static comb_fc_t coarse_comb __attribute__((unused));
+#  define COMBINING
+#  define COARSE_NAME                    "flat combining"
+#  define COARSE_PRINT_STATS()           comb_print_stats()
+#  define COMBINE(fn, obj, arg)          comb_fc_apply(&coarse_comb, fn, (void *) (obj), (intptr_t) (arg))
+#  define COMBINE_READ(fn, obj, arg)     COMBINE(fn, obj, arg)
+#elif defined CCSYNCH
+#  include "../src/utils/locks/combining.h"
+static comb_cc_t coarse_comb __attribute__((unused));
+#  define COMBINING
+#  define COARSE_NAME                    "CC-Synch"
+#  define COARSE_PRINT_STATS()           comb_print_stats()
+#  define COMBINE(fn, obj, arg)          comb_cc_apply(&coarse_comb, fn, (void *) (obj), (intptr_t) (arg))
+#  define COMBINE_READ(fn, obj, arg)     COMBINE(fn, obj, arg)
+#elif defined NODEREP
+#  include "../src/utils/locks/replication.h"
+static nr_t coarse_nr __attribute__((unused));
+#  define COMBINING
+#  define COARSE_NAME                    "node replication"
+#  define COARSE_PRINT_STATS()           nr_print_stats()
+#  define COMBINE(fn, obj, arg)          nr_update(&coarse_nr, fn, (intptr_t) (arg))
+#  define COMBINE_READ(fn, obj, arg)     nr_read(&coarse_nr, fn, (intptr_t) (arg))
+#endif
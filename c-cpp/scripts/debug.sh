@@ -0,0 +1,41 @@
+#!/bin/bash
+
+###
+# This script builds the no hot spot and rotating skip lists with
+# assertions enabled (VERSION=DEBUG) and runs them with several
+# maintenance threads 'helpers', so that the partitioned passes and
+# the stitching of their boundaries are checked. It exits with the
+# status of the first failed run. The DEBUG binaries replace the
+# optimized ones in '../bin', rebuild them before benchmarking.
+#
+# Select appropriate parameters below
+#
+benchs="nohotspot rotating"
+helpers="2 4"
+threads="4"
+iterations="1 2 3"
+###
+
+# path to binaries
+bin=../bin
+
+for bench in ${benchs}
+do
+ # the benchmarks share the object files of ../build
+ make -C .. clean-build > /dev/null
+ make -C ../src/skiplists/${bench} "STM=LOCKFREE" "VERSION=DEBUG" > /dev/null || exit 1
+ for k in ${helpers}
+ do
+  for thread in ${threads}
+  do
+   for iter in ${iterations}
+   do
+     if ! ${bin}/lockfree-${bench}-skiplist -u 100 -i 100 -r 1000 -d 1500 -t ${thread} -K ${k} > /dev/null; then
+       echo "lockfree-${bench}-skiplist failed with -t ${thread} -K ${k}"
+       exit 1
+     fi
+   done
+  done
+ done
+ echo "Done checking lockfree-${bench}-skiplist"
+done
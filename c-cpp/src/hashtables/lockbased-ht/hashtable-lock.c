@@ -28,6 +28,24 @@
 
 extern unsigned int maxhtlength;
 
+#ifdef HT_UNROLLED
+void ht_delete(ht_intset_t *set) {
+	int i;
+	
+	for (i=0; i < maxhtlength; i++)
+		set_delete_u(set->buckets[i]);
+	free(set);
+}
+
+int ht_size(ht_intset_t *set) {
+	int size = 0;
+	int i;
+	
+	for (i=0; i < maxhtlength; i++)
+		size += set_size_u(set->buckets[i]);
+	return size;
+}
+#else
 void ht_delete(ht_intset_t *set) {
 	node_l_t *node, *next;
 	int i;
@@ -58,6 +76,7 @@ int ht_size(ht_intset_t *set) {
 	}
 	return size;
 }
+#endif
 
 int floor_log_2(unsigned int n) {
 	int pos = 0;
@@ -80,17 +99,106 @@ ht_intset_t *ht_new() {
 		exit(1);
 	}   
 	for (i=0; i < maxhtlength; i++) {
-		set->buckets[i] = set_new_l();
+		set->buckets[i] = ht_set_new();
+		set->versions[i] = 0;
 	}
+	for (i=0; i < HT_STRIPES; i++)
+		set->stripes[i].word = 0;
+	set->size_gate = 0;
 	return set;
 }
 
+/*
+ * An update announces itself on the versions of its buckets (one or two)
+ * and on their stripes before locking them and, upon completion, 
+ * withdraws its announcements, increments the versions if it effectively 
+ * modified the buckets and adds its contribution to the stripe count.
+ * An update does not start while an exact size is being computed.
+ */
+static inline void ht_announce(ht_intset_t *set, int addr, AO_t pending) {
+	AO_fetch_and_add_full(&set->versions[addr], pending * HT_VERSION_PENDING);
+	AO_fetch_and_add_full(&set->stripes[addr % HT_STRIPES].word, 
+						  pending * HT_STRIPE_PENDING);
+}
+
+static inline void ht_update_begin(ht_intset_t *set, int addr1, int addr2) {
+	while (1) {
+		ht_announce(set, addr1, 1);
+		if (addr2 != addr1) ht_announce(set, addr2, 1);
+		if (!AO_load_full(&set->size_gate))
+			return;
+		ht_announce(set, addr1, (AO_t) -1);
+		if (addr2 != addr1) ht_announce(set, addr2, (AO_t) -1);
+		while (AO_load_full(&set->size_gate))
+			;
+	}
+}
+
+static inline void ht_update_end(ht_intset_t *set, int addr, int delta, 
+								 int modified) {
+	if (modified)
+		AO_fetch_and_add_full(&set->versions[addr], 
+							  HT_VERSION_INC - HT_VERSION_PENDING);
+	else 
+		AO_fetch_and_add_full(&set->versions[addr], -HT_VERSION_PENDING);
+	AO_fetch_and_add_full(&set->stripes[addr % HT_STRIPES].word, 
+						  (modified ? HT_STRIPE_VERSION_INC : 0) + 
+						  (AO_t) delta * HT_STRIPE_COUNT_INC - HT_STRIPE_PENDING);
+}
+
+int ht_size_approx(ht_intset_t *set) {
+	long size = 0;
+	int i;
+
+	for (i=0; i < HT_STRIPES; i++)
+		size += HT_STRIPE_COUNT(AO_load(&set->stripes[i].word));
+	return (int) size;
+}
+
+/*
+ * The exact size first double-collects the stripes, it is linearized 
+ * between the two collects if no stripe was updated in between. After 
+ * "retries" unsuccessful double-collects, it prevents new updates from 
+ * starting and waits for the updates in progress to complete.
+ */
+int ht_size_exact(ht_intset_t *set, int retries) {
+	AO_t words[HT_STRIPES], w;
+	long size;
+	int i, attempt, valid;
+
+	for (attempt=0; attempt < retries; attempt++) {
+		valid = 1;
+		for (i=0; i < HT_STRIPES && valid; i++) {
+			words[i] = AO_load_full(&set->stripes[i].word);
+			valid = !(words[i] & HT_STRIPE_MASK);
+		}
+		size = 0;
+		for (i=0; i < HT_STRIPES && valid; i++) {
+			valid = (AO_load_full(&set->stripes[i].word) == words[i]);
+			size += HT_STRIPE_COUNT(words[i]);
+		}
+		if (valid) 
+			return (int) size;
+	}
+
+	while (!AO_compare_and_swap_full(&set->size_gate, 0, 1))
+		;
+	size = 0;
+	for (i=0; i < HT_STRIPES; i++) {
+		while ((w = AO_load_full(&set->stripes[i].word)) & HT_STRIPE_MASK)
+			;
+		size += HT_STRIPE_COUNT(w);
+	}
+	AO_store_full(&set->size_gate, 0);
+	return (int) size;
+}
+
 int ht_contains(ht_intset_t *set, int val, int transactional) {
 	int addr;
 	
 	/* Get key */
 	addr = val % maxhtlength;
-	return set_contains_l(set->buckets[addr], val, transactional);
+	return ht_set_contains(set->buckets[addr], val, transactional);
 }
 
 int ht_add(ht_intset_t *set, int val, int transactional) {
@@ -98,7 +206,9 @@ int ht_add(ht_intset_t *set, int val, int transactional) {
 	
 	/* Get key */
 	addr = val % maxhtlength;
-	result = set_add_l(set->buckets[addr], val, transactional);
+	ht_update_begin(set, addr, addr);
+	result = ht_set_add(set->buckets[addr], val, transactional);
+	ht_update_end(set, addr, result, result);
 	return result;
 }
 
@@ -107,12 +217,253 @@ int ht_remove(ht_intset_t *set, int val, int transactional) {
 	
 	/* Get key */
 	addr = val % maxhtlength;
-	result = set_remove_l(set->buckets[addr], val, transactional);
+	ht_update_begin(set, addr, addr);
+	result = ht_set_remove(set->buckets[addr], val, transactional);
+	ht_update_end(set, addr, -result, result);
 	
 	return result;
 }
 
 
+/* 
+ * ht_prefetch_slots hashes the keys and prefetches their bucket slots.
+ */
+static inline void ht_prefetch_slots(ht_intset_t *set, int *keys, int n) {
+	int i;
+	
+	for (i=0; i < n; i++)
+		HT_PREFETCH(&set->buckets[keys[i] % maxhtlength]);
+}
+
+#ifndef HT_UNROLLED
+/* 
+ * State of a lookup in flight: the bucket is dereferenced at the first 
+ * step, then one node is visited per step.
+ */
+typedef struct ht_batch_state {
+	int idx;              /* index of the key, -1 if the slot is free */
+	int val;
+	intset_l_t *bucket;
+	node_l_t *node;
+} ht_batch_state_t;
+
+static inline void ht_batch_start(ht_intset_t *set, ht_batch_state_t *s, 
+								  int *keys, int idx) {
+	s->idx = idx;
+	s->val = keys[idx];
+	s->bucket = set->buckets[s->val % maxhtlength];
+	s->node = NULL;
+	HT_PREFETCH(s->bucket);
+}
+
+/*
+ * ht_batch_step makes a lookup progress by one dependent load and 
+ * prefetches the target of the next one, it returns 1 once the lookup 
+ * has completed (with the result in found), as in parse_find.
+ */
+static inline int ht_batch_step(ht_batch_state_t *s, int *found) {
+	node_l_t *curr;
+	
+	if (s->node == NULL) {
+		s->node = s->bucket->head;
+		HT_PREFETCH(s->node);
+		return 0;
+	}
+	curr = s->node;
+	if (curr->val >= s->val) {
+		*found = ((curr->val == s->val) && !is_marked_ref((long) curr->next));
+		return 1;
+	}
+	s->node = get_unmarked_ref(curr->next);
+	HT_PREFETCH(s->node);
+	return 0;
+}
+
+/*
+ * ht_contains_interleaved keeps up to HT_BATCH_GROUP lazy lookups in 
+ * flight and switches from one to the next after each step (asynchronous
+ * memory access chaining), a completed lookup is replaced by the next key.
+ */
+static int ht_contains_interleaved(ht_intset_t *set, int *keys, int n, 
+								   int *results) {
+	ht_batch_state_t group[HT_BATCH_GROUP];
+	int i, next = 0, active = 0, found, count = 0;
+	
+	for (i=0; i < HT_BATCH_GROUP; i++) {
+		if (next < n) {
+			ht_batch_start(set, &group[i], keys, next++);
+			active++;
+		} else group[i].idx = -1;
+	}
+	while (active > 0) {
+		for (i=0; i < HT_BATCH_GROUP; i++) {
+			if (group[i].idx < 0 || !ht_batch_step(&group[i], &found))
+				continue;
+			results[group[i].idx] = found;
+			count += found;
+			if (next < n) 
+				ht_batch_start(set, &group[i], keys, next++);
+			else {
+				group[i].idx = -1;
+				active--;
+			}
+		}
+	}
+	return count;
+}
+#endif /* ! HT_UNROLLED */
+
+/*
+ * ht_contains_batch interleaves the lookups of the lazy list, the 
+ * lock-coupling and unrolled lookups are not interleaved.
+ */
+int ht_contains_batch(ht_intset_t *set, int *keys, int n, int *results, 
+					  int transactional) {
+	int i, count = 0;
+	
+	ht_prefetch_slots(set, keys, n);
+#ifndef HT_UNROLLED
+	if (transactional == 2)
+		return ht_contains_interleaved(set, keys, n, results);
+#endif
+	for (i=0; i < n; i++) {
+		results[i] = ht_contains(set, keys[i], transactional);
+		count += results[i];
+	}
+	return count;
+}
+
+/*
+ * ht_add_batch prefetches the bucket and the head of the key that is 
+ * HT_BATCH_GROUP positions ahead before inserting each key.
+ */
+int ht_add_batch(ht_intset_t *set, int *keys, int n, int *results, 
+				 int transactional) {
+	int i, count = 0;
+	
+	ht_prefetch_slots(set, keys, n);
+	for (i=0; i < n && i < HT_BATCH_GROUP; i++)
+		HT_PREFETCH(set->buckets[keys[i] % maxhtlength]);
+	for (i=0; i < n; i++) {
+		if (i + HT_BATCH_GROUP < n)
+			HT_PREFETCH(set->buckets[keys[i + HT_BATCH_GROUP] % maxhtlength]);
+		if (i + HT_BATCH_GROUP / 2 < n)
+			HT_PREFETCH(set->buckets[keys[i + HT_BATCH_GROUP / 2] % maxhtlength]->head);
+		results[i] = ht_add(set, keys[i], transactional);
+		count += results[i];
+	}
+	return count;
+}
+
+#ifdef HT_UNROLLED
+/*
+ * The nodes of unrolled buckets are locked in (bucket, min key, address)
+ * order, which extends the list order followed by the merges.
+ */
+static inline int ht_node_before(int addr1, node_u_t *n1, 
+								 int addr2, node_u_t *n2) {
+	if (addr1 != addr2) return addr1 < addr2;
+	if (n1->min != n2->min) return n1->min < n2->min;
+	return n1 < n2;
+}
+
+/* 
+ * Move an element in the hashtable (from one unrolled list to another),
+ * both nodes are locked and validated before modifying them.
+ */
+int ht_move(ht_intset_t *set, int val1, int val2, int transactional) {
+	node_u_t *n1, *n2, *first, *second;
+	int addr1, addr2, i1, i2, result = 0;
+	
+	if (val1 == val2) return 0;
+	
+	addr1 = val1 % maxhtlength;
+	addr2 = val2 % maxhtlength;
+	ht_update_begin(set, addr1, addr2);
+	
+	while (1) {
+		n1 = unrolled_locate(set->buckets[addr1], val1);
+		n2 = unrolled_locate(set->buckets[addr2], val2);
+		if (ht_node_before(addr1, n1, addr2, n2)) {
+			first = n1;
+			second = n2;
+		} else {
+			first = n2;
+			second = n1;
+		}
+		LOCK(&first->lock);
+		if (second != first)
+			LOCK(&second->lock);
+		if (unrolled_validate(n1, val1) && unrolled_validate(n2, val2))
+			break;
+		if (second != first)
+			UNLOCK(&second->lock);
+		UNLOCK(&first->lock);
+	}
+	
+	i1 = unrolled_index(n1, val1);
+	i2 = unrolled_index(n2, val2);
+	unrolled_stat.keys += i1 + i2 + 2;
+	result = ((i1 < n1->count && n1->keys[i1] == val1) &&
+			  !(i2 < n2->count && n2->keys[i2] == val2));
+	if (result) {
+		unrolled_write_begin(n1);
+		if (n2 != n1)
+			unrolled_write_begin(n2);
+		unrolled_take(n1, i1);
+		if (n2 == n1)
+			i2 = unrolled_index(n2, val2);
+		unrolled_put(n2, i2, val2);
+		if (n2 != n1)
+			unrolled_write_end(n2);
+		unrolled_write_end(n1);
+	}
+	if (second != first)
+		UNLOCK(&second->lock);
+	UNLOCK(&first->lock);
+	
+	if (addr2 != addr1) {
+		ht_update_end(set, addr1, -result, result);
+		ht_update_end(set, addr2, result, result);
+	} else ht_update_end(set, addr1, 0, result);
+	
+	return result;
+}
+
+/* 
+ * Read all elements of the hashtable: all the nodes are locked in order
+ * before being released. The successor of a locked node cannot be 
+ * unlinked, so the nodes locked are the nodes of the buckets.
+ */
+int ht_snapshot(ht_intset_t *set, int transactional) {
+	node_u_t *curr, *next;
+	int i, j;
+	long sum = 0;
+	
+	for (i=0; i < maxhtlength; i++) {
+		curr = set->buckets[i]->head;
+		LOCK(&curr->lock);
+		while (curr->next) {
+			for (j=0; j < curr->count; j++)
+				sum += curr->keys[j];
+			curr = curr->next;
+			LOCK(&curr->lock);
+		}
+	}
+	
+	for (i=0; i < maxhtlength; i++) {
+		curr = set->buckets[i]->head;
+		while (curr) {
+			/* the successor stays locked, hence linked */
+			next = curr->next;
+			UNLOCK(&curr->lock);
+			curr = next;
+		}
+	}
+	
+	return 1;
+}
+#else
 /* 
  * Move an element in the hashtable (from one linked-list to another)
  */
@@ -126,8 +477,11 @@ int ht_move(ht_intset_t *set, int val1, int val2, int transactional) {
 	
 	if (val1 == val2) return 0;
 	
-	// records pred and succ of val1
 	addr1 = val1 % maxhtlength;
+	addr2 = val2 % maxhtlength;
+	ht_update_begin(set, addr1, addr2);
+	
+	// records pred and succ of val1
 	pred1 = set->buckets[addr1]->head;
 	curr1 = pred1->next;
 	while (curr1->val < val1) {
@@ -135,7 +489,6 @@ int ht_move(ht_intset_t *set, int val1, int val2, int transactional) {
 		curr1 = curr1->next;
 	}
 	// records pred and succ of val2 
-	addr2 = val2 % maxhtlength;
 	pred2 = set->buckets[addr2]->head;
 	curr2 = pred2->next;
 	while (curr2->val < val2) {
@@ -145,7 +498,7 @@ int ht_move(ht_intset_t *set, int val1, int val2, int transactional) {
 	// unnecessary move
 	if (pred1->val == pred2->val || curr1->val == pred2->val || 
 		curr2->val == pred1->val || curr1->val == curr2->val) 
-		return 0;
+		goto end_move;
 	// acquire locks in order
 	if (addr1 < addr2 || (addr1 == addr2 && val1 < val2)) {
 		LOCK(&pred1->lock);
@@ -172,7 +525,13 @@ int ht_move(ht_intset_t *set, int val1, int val2, int transactional) {
 	UNLOCK(&pred1->lock);
 	UNLOCK(&curr2->lock);
 	UNLOCK(&curr1->lock);
-		
+	
+ end_move:
+	if (addr2 != addr1) {
+		ht_update_end(set, addr1, -result, result);
+		ht_update_end(set, addr2, result, result);
+	} else ht_update_end(set, addr1, 0, result);
+	
 	return result;
 }
 
@@ -254,3 +613,115 @@ int ht_snapshot(ht_intset_t *set, int transactional) {
 	
 	return 1;
 }
+#endif /* ! HT_UNROLLED */
+
+
+/*
+ * Collect the elements of a bucket without locking and record the version 
+ * observed before the collect. The lazy and unrolled lists never free 
+ * removed nodes so the bucket can be parsed concurrently with updates.
+ */
+typedef struct ht_collect {
+	AO_t version;
+	long sum;
+	long keys;
+} ht_collect_t;
+
+static __thread ht_collect_t *ht_collect_buf = NULL;
+static __thread unsigned int ht_collect_len = 0;
+
+#ifdef HT_UNROLLED
+static inline void ht_collect_bucket(ht_intset_t *set, int i, ht_collect_t *c) {
+	node_u_t *curr;
+	int j, n;
+	
+	c->version = AO_load_full(&set->versions[i]);
+	c->sum = 0;
+	c->keys = 0;
+	curr = set->buckets[i]->head;
+	while (curr->next) {
+		n = curr->count;
+		if (n > UNROLLED_KEYS) n = UNROLLED_KEYS;
+		for (j=0; j < n; j++)
+			c->sum += curr->keys[j];
+		c->keys += n;
+		curr = curr->next;
+	}
+}
+#else
+static inline void ht_collect_bucket(ht_intset_t *set, int i, ht_collect_t *c) {
+	node_l_t *next;
+	
+	c->version = AO_load_full(&set->versions[i]);
+	c->sum = 0;
+	c->keys = 0;
+	next = get_unmarked_ref(set->buckets[i]->head->next);
+	while (next->next) {
+		if (!is_marked_ref((long) next->next)) {
+			c->sum += next->val;
+			c->keys++;
+		}
+		next = get_unmarked_ref(next->next);
+	}
+}
+#endif
+
+/* 
+ * A bucket is valid if its version has not changed since it was collected
+ * and no update was in progress on it at that time.
+ */
+static inline int ht_collect_valid(ht_intset_t *set, int i, ht_collect_t *c) {
+	AO_t v = AO_load_full(&set->versions[i]);
+	return (v == c->version && !(v & HT_VERSION_MASK));
+}
+
+/*
+ * Read all elements of the hashtable without locking (versioned collect).
+ * The snapshot is linearized at the beginning of the last validation pass:
+ * each bucket was then in the state it had when it was collected.
+ */
+int ht_snapshot_versioned(ht_intset_t *set, int transactional, 
+						  int retries, ht_snapshot_stat_t *stat) {
+	int i, m = maxhtlength, attempt, dirty;
+	long sum = 0, keys = 0;
+	
+#ifndef HT_UNROLLED
+	/* the lock-coupling list frees its nodes upon removal */
+	if (transactional != 2) goto fallback;
+#endif
+	
+	if (ht_collect_len < m) {
+		free(ht_collect_buf);
+		if ((ht_collect_buf = (ht_collect_t *)malloc(m * sizeof(ht_collect_t))) == NULL) {
+			perror("malloc");
+			exit(1);
+		}
+		ht_collect_len = m;
+	}
+	
+	for (i=0; i < m; i++)
+		ht_collect_bucket(set, i, &ht_collect_buf[i]);
+	
+	for (attempt=0; attempt <= retries; attempt++) {
+		dirty = 0;
+		for (i=0; i < m; i++) {
+			if (!ht_collect_valid(set, i, &ht_collect_buf[i])) {
+				ht_collect_bucket(set, i, &ht_collect_buf[i]);
+				dirty++;
+			}
+		}
+		if (!dirty) {
+			for (i=0; i < m; i++) {
+				sum += ht_collect_buf[i].sum;
+				keys += ht_collect_buf[i].keys;
+			}
+			stat->keys += keys;
+			return 1;
+		}
+		stat->retries++;
+	}
+	
+ fallback:
+	stat->fallbacks++;
+	return ht_snapshot(set, transactional);
+}
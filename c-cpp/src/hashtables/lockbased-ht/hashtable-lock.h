@@ -24,7 +24,22 @@
  * GNU General Public License for more details.
  */
 
+#ifdef HT_UNROLLED
+/* Buckets are unrolled linked lists (make BUCKET=UNROLLED) */
+#include "../../linkedlists/unrolled-list/intset.h"
+typedef intset_u_t ht_bucket_t;
+#define ht_set_new                      set_new_u
+#define ht_set_contains                 set_contains_u
+#define ht_set_add                      set_add_u
+#define ht_set_remove                   set_remove_u
+#else
 #include "../linkedlists/lazy-list/intset.h"
+typedef intset_l_t ht_bucket_t;
+#define ht_set_new                      set_new_l
+#define ht_set_contains                 set_contains_l
+#define ht_set_add                      set_add_l
+#define ht_set_remove                   set_remove_l
+#endif
 
 #define DEFAULT_MOVE                    0
 #define DEFAULT_SNAPSHOT                0
@@ -32,6 +47,12 @@
 #define DEFAULT_ELASTICITY              2
 #define DEFAULT_ALTERNATE               0
 #define DEFAULT_EFFECTIVE               1
+#define DEFAULT_SNAPSHOT_ALG            0
+#define DEFAULT_SNAPSHOT_RETRIES        16
+#define DEFAULT_SIZE_POLL               0
+#define DEFAULT_SIZE_RETRIES            16
+#define DEFAULT_BATCH                   1
+#define MAX_BATCH                       1024
 
 #define MAXHTLENGTH                     65536
 
@@ -42,26 +63,100 @@ extern unsigned int maxhtlength;
  * HASH TABLE
  * ################################################################### */
 
+/*
+ * Each bucket has a version word: the low-order bits count the updates 
+ * in progress on the bucket, the high-order bits count the updates that 
+ * effectively modified it.
+ */
+#define HT_VERSION_PENDING              1
+#define HT_VERSION_INC                  (1 << 16)
+#define HT_VERSION_MASK                 (HT_VERSION_INC - 1)
+
+/*
+ * The size is distributed over padded stripes of buckets. The word of a
+ * stripe counts the updates in progress (bits 0-15), the elements of its
+ * buckets as a signed integer (bits 16-39) and the updates that 
+ * effectively modified it (bits 40-63).
+ */
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE                 64
+#endif
+#define HT_STRIPES                      64
+#define HT_STRIPE_PENDING               1UL
+#define HT_STRIPE_COUNT_INC             (1UL << 16)
+#define HT_STRIPE_VERSION_INC           (1UL << 40)
+#define HT_STRIPE_MASK                  (HT_STRIPE_COUNT_INC - 1)
+#define HT_STRIPE_COUNT(w)              (((long) ((w) << 24)) >> 40)
+
+/* Number of lookups in flight in a batch */
+#define HT_BATCH_GROUP                  8
+#define HT_PREFETCH(addr)               __builtin_prefetch((const void *) (addr))
+
+typedef struct ht_stripe {
+	AO_t word;
+	char padding[CACHE_LINE_SIZE - sizeof(AO_t)];
+} ht_stripe_t;
+
 typedef struct ht_intset {
-	intset_l_t *buckets[MAXHTLENGTH];
+	ht_bucket_t *buckets[MAXHTLENGTH];
+	AO_t versions[MAXHTLENGTH];
+	ht_stripe_t stripes[HT_STRIPES];
+	volatile AO_t size_gate;
 } ht_intset_t;
 
+/* Statistics of the versioned snapshot */
+typedef struct ht_snapshot_stat {
+	unsigned long keys;
+	unsigned long retries;
+	unsigned long fallbacks;
+} ht_snapshot_stat_t;
+
 void ht_delete(ht_intset_t *set);
 int ht_size(ht_intset_t *set);
+/* 
+ * Size of the hashtable from the stripe counters: the approximate size 
+ * ignores the updates in progress, the exact size is linearizable. The 
+ * exact size blocks the updates that start after its "retries" failed 
+ * double-collects until the updates in progress complete.
+ */
+int ht_size_approx(ht_intset_t *set);
+int ht_size_exact(ht_intset_t *set, int retries);
 int floor_log_2(unsigned int n);
 ht_intset_t *ht_new();
 int ht_contains(ht_intset_t *set, int val, int transactional);
 int ht_add(ht_intset_t *set, int val, int transactional);
 int ht_remove(ht_intset_t *set, int val, int transactional);
 
+/*
+ * Batched operations: results[i] is the result of the operation on keys[i]
+ * and the number of successful operations is returned. The keys are hashed
+ * and their bucket slots prefetched first, then the lookups of the lazy 
+ * list (transactional = 2) are interleaved so that the cache misses of 
+ * distinct keys overlap (the lookups in unrolled buckets are not). Each 
+ * individual operation is linearizable, not the batch.
+ */
+int ht_contains_batch(ht_intset_t *set, int *keys, int n, int *results, 
+					  int transactional);
+int ht_add_batch(ht_intset_t *set, int *keys, int n, int *results, 
+				 int transactional);
+
 /* 
  * Move an element in the hashtable (from one linked-list to another)
  */
 int ht_move(ht_intset_t *set, int val1, int val2, int transactional);
 /* 
  * Read all elements of the hashtable (parses all linked-lists)
- * This cannot be consistent when used with move operation.
- * TODO: make a coarse-grain version of the snapshot.
+ * This is a coarse-grain snapshot that locks all nodes before releasing 
+ * them, hence it blocks concurrent updates.
  */
 int ht_snapshot(ht_intset_t *set, int transactional);
+/*
+ * Read all elements of the hashtable without locking (versioned collect).
+ * Buckets are collected and then re-validated against their version until 
+ * a validation pass finds no bucket modified, which makes it consistent 
+ * with move operations. It falls back to ht_snapshot after "retries" 
+ * unsuccessful validation passes.
+ */
+int ht_snapshot_versioned(ht_intset_t *set, int transactional, 
+						  int retries, ht_snapshot_stat_t *stat);
 
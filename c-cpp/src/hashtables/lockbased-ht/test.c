@@ -99,9 +99,15 @@ typedef struct thread_data {
 	int update;
 	int move;
 	int snapshot;
+	int snapshot_alg;
+	int snapshot_retries;
 	int unit_tx;
 	int alternate;
 	int effective;
+	int batch;
+	int *keys;
+	int *results;
+	unsigned long nb_batches;
 	unsigned long nb_add;
 	unsigned long nb_added;
 	unsigned long nb_remove;
@@ -113,6 +119,7 @@ typedef struct thread_data {
 	unsigned long nb_moved;
 	unsigned long nb_snapshot;
 	unsigned long nb_snapshoted;
+	ht_snapshot_stat_t snapshot_stat;
 	/* end: added for HashTables */
 	unsigned long nb_found;
 	unsigned long nb_aborts;
@@ -123,6 +130,10 @@ typedef struct thread_data {
 	unsigned long nb_aborts_validate_commit;
 	unsigned long nb_aborts_invalid_memory;
 	unsigned long max_retries;
+#ifdef HT_UNROLLED
+	unsigned long nb_nodes;
+	unsigned long nb_keys;
+#endif
 	unsigned int seed;
 	ht_intset_t *set;
 	barrier_t *barrier;
@@ -131,11 +142,19 @@ typedef struct thread_data {
 
 void *test(void *data) {
 	val_t val = 0;
-	int val2, numtx, r, last = -1; 
+	int val2, numtx, r, i, last = -1; 
 	int unext, mnext, cnext;
 	
 	thread_data_t *d = (thread_data_t *)data;
 	
+	if (d->batch > 1) {
+		if ((d->keys = (int *)malloc(d->batch * sizeof(int))) == NULL ||
+			(d->results = (int *)malloc(d->batch * sizeof(int))) == NULL) {
+			perror("malloc");
+			exit(1);
+		}
+	}
+	
 	/* Wait on barrier */
 	barrier_cross(d->barrier);
 	
@@ -225,13 +244,29 @@ void *test(void *data) {
 					}
 				}	else val = rand_range_re(&d->seed, d->range);
 				
-				if (ht_contains(d->set, val, TRANSACTIONAL)) 
-					d->nb_found++;
-				d->nb_contains++;
+				if (d->batch > 1 && !d->alternate) {
+					/* Look up a batch of random values */
+					d->keys[0] = val;
+					for (i = 1; i < d->batch; i++)
+						d->keys[i] = rand_range_re(&d->seed, d->range);
+					d->nb_found += ht_contains_batch(d->set, d->keys, d->batch, 
+													 d->results, TRANSACTIONAL);
+					d->nb_contains += d->batch;
+					d->nb_batches++;
+				} else {
+					if (ht_contains(d->set, val, TRANSACTIONAL)) 
+						d->nb_found++;
+					d->nb_contains++;
+				}
 				
 			} else { // snapshot
 				
-				if (ht_snapshot(d->set, TRANSACTIONAL))
+				if (d->snapshot_alg) {
+					if (ht_snapshot_versioned(d->set, TRANSACTIONAL, 
+											  d->snapshot_retries, 
+											  &d->snapshot_stat))
+						d->nb_snapshoted++;
+				} else if (ht_snapshot(d->set, TRANSACTIONAL))
 					d->nb_snapshoted++;
 				d->nb_snapshot++;
 				
@@ -257,9 +292,20 @@ void *test(void *data) {
 	}
 #endif /* ICC */
 	
+	if (d->batch > 1) {
+		free(d->keys);
+		free(d->results);
+	}
+#ifdef HT_UNROLLED
+	d->nb_nodes = unrolled_stat.nodes;
+	d->nb_keys = unrolled_stat.keys;
+#endif
+	
 	return NULL;
 }
 
+#include "ht_size_poll.h"
+
 int main(int argc, char **argv)
 {
 	struct option long_options[] = {
@@ -275,7 +321,11 @@ int main(int argc, char **argv)
 		{"update-rate",               required_argument, NULL, 'u'},
 		{"move-rate",                 required_argument, NULL, 'a'},
 		{"snapshot-rate",             required_argument, NULL, 's'},
+		{"snapshot-versioned",        no_argument,       NULL, 'V'},
+		{"snapshot-retries",          required_argument, NULL, 'k'},
 		{"lock-alg",                  required_argument, NULL, 'x'},
+		{"size-poll",                 required_argument, NULL, 'z'},
+		{"batch-size",                required_argument, NULL, 'b'},
 		{NULL, 0, NULL, 0}
 	};
 	
@@ -283,13 +333,17 @@ int main(int argc, char **argv)
 	int i, c, size;
 	val_t last = 0; 
 	val_t val = 0;
-	unsigned long reads, effreads, updates, effupds, moves, moved, snapshots, 
-	snapshoted, aborts, aborts_locked_read, aborts_locked_write,
+	unsigned long reads, batches, effreads, updates, effupds, moves, moved, snapshots, 
+	snapshoted, snapshot_keys, snapshot_retries, snapshot_fallbacks, aborts, aborts_locked_read, aborts_locked_write,
 	aborts_validate_read, aborts_validate_write, aborts_validate_commit,
 	aborts_invalid_memory, max_retries;
+#ifdef HT_UNROLLED
+	unsigned long visited, visited_1key;
+#endif
 	thread_data_t *data;
 	pthread_t *threads;
 	pthread_attr_t attr;
+	poll_data_t poll;
 	barrier_t barrier;
 	struct timeval start, end;
 	struct timespec timeout;
@@ -302,14 +356,19 @@ int main(int argc, char **argv)
 	int load_factor = DEFAULT_LOAD;
 	int move = DEFAULT_MOVE;
 	int snapshot = DEFAULT_SNAPSHOT;
+	int snapshot_alg = DEFAULT_SNAPSHOT_ALG;
+	int snapshot_bound = DEFAULT_SNAPSHOT_RETRIES;
 	int unit_tx = DEFAULT_ELASTICITY;
 	int alternate = DEFAULT_ALTERNATE;
 	int effective = DEFAULT_EFFECTIVE;
+	int size_poll = DEFAULT_SIZE_POLL;
+	int batch = DEFAULT_BATCH;
+	int keys[MAX_BATCH], results[MAX_BATCH], n;
 	sigset_t block_set;
 	
 	while(1) {
 		i = 0;
-		c = getopt_long(argc, argv, "hAf:d:i:t:r:S:u:a:s:l:x:", long_options, &i);
+		c = getopt_long(argc, argv, "hAVf:d:i:t:r:S:u:a:s:k:l:x:z:b:", long_options, &i);
 		
 		if(c == -1)
 			break;
@@ -351,6 +410,10 @@ int main(int argc, char **argv)
 								 "        Percentage of move transactions (default=" XSTR(DEFAULT_MOVE) ")\n"
 								 "  -s , --snapshot-rate <int>\n"
 								 "        Percentage of snapshot transactions (default=" XSTR(DEFAULT_SNAPSHOT) ")\n"
+								 "  -V , --snapshot-versioned\n"
+								 "        Take the snapshots by versioned collect instead of coarse-grained locking\n"
+								 "  -k , --snapshot-retries <int>\n"
+								 "        Failed versioned collects before locking (default=" XSTR(DEFAULT_SNAPSHOT_RETRIES) ")\n"
 								 "  -l , --load-factor <int>\n"
 								 "        Ratio of keys over buckets (default=" XSTR(DEFAULT_LOAD) ")\n"
 								 "  -x, --unit-tx (default=1)\n"
@@ -362,11 +425,17 @@ int main(int argc, char **argv)
 								 "        4 = read/add/rem unit-tx,\n"
 								 "        5 = all recursive unit-tx,\n"
 								 "        6 = harris lock-free\n"
+								 SIZE_POLL_HELP("")
+								 "  -b, --batch-size <int>\n"
+								 "        Keys per batched lookup, 1 = single lookups (default=" XSTR(DEFAULT_BATCH) ")\n"
 								 );
 					exit(0);
 				case 'A':
 					alternate = 1;
 					break;
+				case 'V':
+					snapshot_alg = 1;
+					break;
 				case 'f':
 					effective = atoi(optarg);
 					break;
@@ -394,12 +463,21 @@ int main(int argc, char **argv)
 				case 's':
 					snapshot = atoi(optarg);
 					break;
+				case 'k':
+					snapshot_bound = atoi(optarg);
+					break;
 				case 'l':
 					load_factor = atoi(optarg);
 					break;
 				case 'x':
 					unit_tx = atoi(optarg);
 					break;
+				case 'z':
+					size_poll = atoi(optarg);
+					break;
+				case 'b':
+					batch = atoi(optarg);
+					break;
 				case '?':
 					printf("Use -h or --help for help\n");
 					exit(0);
@@ -415,9 +493,18 @@ int main(int argc, char **argv)
 	assert(update >= 0 && update <= 100);
 	assert(move >= 0 && move <= update);
 	assert(snapshot >= 0 && snapshot <= (100-update));
+	assert(snapshot_bound >= 0);
 	assert(load_factor >= 1);
+	assert(size_poll >= 0 && size_poll <= SIZE_POLL_MAX);
+	assert(batch >= 1 && batch <= MAX_BATCH);
 	
 	printf("Set type     : hash table\n");
+#ifdef HT_UNROLLED
+	printf("Bucket type  : unrolled linked list (%d keys / node)\n", UNROLLED_KEYS);
+#endif
+#ifdef LOCKLIB
+	printf("Lock type    : %s\n", LOCK_NAME);
+#endif
 	printf("Duration     : %d\n", duration);
 	printf("Initial size : %d\n", initial);
 	printf("Nb threads   : %d\n", nb_threads);
@@ -427,9 +514,13 @@ int main(int argc, char **argv)
 	printf("Load factor  : %d\n", load_factor);
 	printf("Move rate    : %d\n", move);
 	printf("Snapshot rate: %d\n", snapshot);
+	printf("Snapshot alg.: %d\n", snapshot_alg);
+	printf("Snap. retries: %d\n", snapshot_bound);
 	printf("Lock alg.    : %d\n", unit_tx);
 	printf("Alternate    : %d\n", alternate);
 	printf("Effective    : %d\n", effective);
+	printf("Size poll    : %d\n", size_poll);
+	printf("Batch size   : %d\n", batch);
 	printf("Type sizes   : int=%d/long=%d/ptr=%d/word=%d\n",
 				 (int)sizeof(int),
 				 (int)sizeof(long),
@@ -463,6 +554,15 @@ int main(int argc, char **argv)
 	i = 0;
 	//maxhtlength = (int) (initial / load_factor);
 	while (i < initial) {
+		if (batch > 1) {
+			n = (initial - i < batch) ? initial - i : batch;
+			for (c = 0; c < n; c++)
+				keys[c] = (rand() % range) + 1;
+			i += ht_add_batch(set, keys, n, results, 0);
+			for (c = 0; c < n; c++)
+				if (results[c]) last = keys[c];
+			continue;
+		}
 		val = (rand() % range) + 1;
 		if (ht_add(set, val, 0)) {
 		  last = val;
@@ -475,7 +575,7 @@ int main(int argc, char **argv)
 	printf("Load         : %d\n", load_factor);
 	
 	/* Access set from all threads */
-	barrier_init(&barrier, nb_threads + 1);
+	barrier_init(&barrier, nb_threads + 1 + (size_poll ? 1 : 0));
 	pthread_attr_init(&attr);
 	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
 	for (i = 0; i < nb_threads; i++) {
@@ -486,6 +586,8 @@ int main(int argc, char **argv)
 		data[i].load_factor = load_factor;
 		data[i].move = move;
 		data[i].snapshot = snapshot;
+		data[i].snapshot_alg = snapshot_alg;
+		data[i].snapshot_retries = snapshot_bound;
 		data[i].unit_tx = unit_tx;
 		data[i].alternate = alternate;
 		data[i].effective = effective;
@@ -497,7 +599,12 @@ int main(int argc, char **argv)
 		data[i].nb_moved = 0;
 		data[i].nb_snapshot = 0;
 		data[i].nb_snapshoted = 0;
+		data[i].snapshot_stat.keys = 0;
+		data[i].snapshot_stat.retries = 0;
+		data[i].snapshot_stat.fallbacks = 0;
 		data[i].nb_contains = 0;
+		data[i].batch = batch;
+		data[i].nb_batches = 0;
 		data[i].nb_found = 0;
 		data[i].nb_aborts = 0;
 		data[i].nb_aborts_locked_read = 0;
@@ -507,6 +614,10 @@ int main(int argc, char **argv)
 		data[i].nb_aborts_validate_commit = 0;
 		data[i].nb_aborts_invalid_memory = 0;
 		data[i].max_retries = 0;
+#ifdef HT_UNROLLED
+		data[i].nb_nodes = 0;
+		data[i].nb_keys = 0;
+#endif
 		data[i].seed = rand();
 		data[i].set = set;
 		data[i].barrier = &barrier;
@@ -515,6 +626,7 @@ int main(int argc, char **argv)
 			exit(1);
 		}
 	}
+	poll_start(&poll, size_poll, set, &barrier, &attr);
 	pthread_attr_destroy(&attr);
 	
 	/* Start threads */
@@ -539,6 +651,7 @@ int main(int argc, char **argv)
 			exit(1);
 		}
 	}
+	poll_join(&poll);
 	
 	duration = (end.tv_sec * 1000 + end.tv_usec / 1000) - (start.tv_sec * 1000 + start.tv_usec / 1000);
 	aborts = 0;
@@ -549,6 +662,7 @@ int main(int argc, char **argv)
 	aborts_validate_commit = 0;
 	aborts_invalid_memory = 0;
 	reads = 0;
+	batches = 0;
 	effreads = 0;
 	updates = 0;
 	effupds = 0;
@@ -556,7 +670,14 @@ int main(int argc, char **argv)
 	moved = 0;
 	snapshots = 0;
 	snapshoted = 0;
+	snapshot_keys = 0;
+	snapshot_retries = 0;
+	snapshot_fallbacks = 0;
 	max_retries = 0;
+#ifdef HT_UNROLLED
+	visited = 0;
+	visited_1key = 0;
+#endif
 	for (i = 0; i < nb_threads; i++) {
 		printf("Thread %d\n", i);
 		printf("  #add        : %lu\n", data[i].nb_add);
@@ -569,6 +690,8 @@ int main(int argc, char **argv)
 		printf("  #moved      : %lu\n", data[i].nb_moved);
 		printf("  #snapshot   : %lu\n", data[i].nb_snapshot);
 		printf("  #snapshoted : %lu\n", data[i].nb_snapshoted);
+		printf("    #retries  : %lu\n", data[i].snapshot_stat.retries);
+		printf("    #fallbacks: %lu\n", data[i].snapshot_stat.fallbacks);
 		printf("  #aborts     : %lu\n", data[i].nb_aborts);
 		printf("    #lock-r   : %lu\n", data[i].nb_aborts_locked_read);
 		printf("    #lock-w   : %lu\n", data[i].nb_aborts_locked_write);
@@ -585,6 +708,7 @@ int main(int argc, char **argv)
 		aborts_validate_commit += data[i].nb_aborts_validate_commit;
 		aborts_invalid_memory += data[i].nb_aborts_invalid_memory;
 		reads += data[i].nb_contains;
+		batches += data[i].nb_batches;
 		effreads += data[i].nb_contains + 
 		(data[i].nb_add - data[i].nb_added) + 
 		(data[i].nb_remove - data[i].nb_removed) + 
@@ -596,11 +720,19 @@ int main(int argc, char **argv)
 		moved += data[i].nb_moved;
 		snapshots += data[i].nb_snapshot;
 		snapshoted += data[i].nb_snapshoted;
+		snapshot_keys += data[i].snapshot_stat.keys;
+		snapshot_retries += data[i].snapshot_stat.retries;
+		snapshot_fallbacks += data[i].snapshot_stat.fallbacks;
 		size += data[i].nb_added - data[i].nb_removed;
 		if (max_retries < data[i].max_retries)
 			max_retries = data[i].max_retries;
+#ifdef HT_UNROLLED
+		visited += data[i].nb_nodes;
+		visited_1key += data[i].nb_keys;
+#endif
 	}
 	printf("Set size      : %d (expected: %d)\n", ht_size(set), size);
+	poll_print(&poll, set, duration);
 	printf("Duration      : %d (ms)\n", duration);
 	printf("#txs          : %lu (%f / s)\n", reads + updates + moves + snapshots , (reads + updates + moves + snapshots) * 1000.0 / duration);
 	
@@ -609,6 +741,8 @@ int main(int argc, char **argv)
 		printf("%lu (%f / s)\n", effreads, effreads * 1000.0 / duration);
 		printf("  #contains   : %lu (%f / s)\n", reads, reads * 1000.0 / duration);
 	} else printf("%lu (%f / s)\n", reads, reads * 1000.0 / duration);
+	if (batch > 1)
+		printf("  #batches    : %lu (%f / s)\n", batches, batches * 1000.0 / duration);
 	
 	printf("#eff. upd rate: %f \n", 100.0 * effupds / (effupds + effreads));
 	
@@ -623,6 +757,11 @@ int main(int argc, char **argv)
 	printf("  #moved      : %lu (%f / s)\n", moved, moved * 1000.0 / duration);
 	printf("#snapshot txs : %lu (%f / s)\n", snapshots, snapshots * 1000.0 / duration);
 	printf("  #snapshoted : %lu (%f / s)\n", snapshoted, snapshoted * 1000.0 / duration);
+	if (snapshot_alg) {
+		printf("  #scanned    : %lu (%f keys / s)\n", snapshot_keys, snapshot_keys * 1000.0 / duration);
+		printf("  #retries    : %lu (%f / snapshot)\n", snapshot_retries, snapshots ? (double) snapshot_retries / snapshots : 0.0);
+		printf("  #fallbacks  : %lu\n", snapshot_fallbacks);
+	}
 	printf("#aborts       : %lu (%f / s)\n", aborts, aborts * 1000.0 / duration);
 	printf("  #lock-r     : %lu (%f / s)\n", aborts_locked_read, aborts_locked_read * 1000.0 / duration);
 	printf("  #lock-w     : %lu (%f / s)\n", aborts_locked_write, aborts_locked_write * 1000.0 / duration);
@@ -631,6 +770,15 @@ int main(int argc, char **argv)
 	printf("  #val-c      : %lu (%f / s)\n", aborts_validate_commit, aborts_validate_commit * 1000.0 / duration);
 	printf("  #inv-mem    : %lu (%f / s)\n", aborts_invalid_memory, aborts_invalid_memory * 1000.0 / duration);
 	printf("Max retries   : %lu\n", max_retries);
+#ifdef HT_UNROLLED
+	/* a list with one key per node visits one node per key passed */
+	printf("Visited/op    : %f nodes (1-key list: %f nodes)\n", 
+		   (double) visited / (reads + updates + moves), 
+		   (double) visited_1key / (reads + updates + moves));
+#endif
+#ifdef LOCKLIB
+	lock_print_stats();
+#endif
 	
 	/* Delete set */
 	ht_delete(set);
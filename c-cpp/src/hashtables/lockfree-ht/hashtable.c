@@ -26,6 +26,10 @@
 
 #include "hashtable.h"
 
+#ifdef HT_NUMA
+__thread int ht_zone = 0;
+#endif
+
 void ht_delete(ht_intset_t *set) {
   node_t *node, *next;
   int i;
@@ -40,6 +44,15 @@ void ht_delete(ht_intset_t *set) {
     free(set->buckets[i]);
   }
   free(set->buckets);
+  free(set->versions);
+#ifdef HT_NUMA
+  for (i=0; i < set->nb_zones; i++) {
+    if (set->emulated)
+      free(set->replicas[i]);
+    else
+      numa_free(set->replicas[i], maxhtlength * sizeof(intset_t));
+  }
+#endif
   free(set);
 }
 
@@ -83,9 +96,130 @@ ht_intset_t *ht_new() {
 	perror("malloc");
 	exit(1);
 	}  
+	if ((set->versions = (AO_t *)malloc(maxhtlength * sizeof(AO_t))) == NULL) {
+		perror("malloc");
+		exit(1);
+	}
 
 	for (i=0; i < maxhtlength; i++) {
 		set->buckets[i] = set_new();
+		set->versions[i] = 0;
 	}
+	for (i=0; i < HT_STRIPES; i++)
+		set->stripes[i].word = 0;
+#ifdef HT_NUMA
+	set->nb_zones = 0;
+	set->emulated = 1;
+#endif
 	return set;
 }
+
+#ifdef HT_NUMA
+void ht_replicate(ht_intset_t *set, int nb_zones) {
+	int i, z, nb_nodes;
+	
+	nb_nodes = numa_zone_nodes(set->nodes, MAX_NUMA_ZONES);
+	if (nb_zones <= 0) 
+		nb_zones = nb_nodes;
+	if (nb_zones > MAX_NUMA_ZONES)
+		nb_zones = MAX_NUMA_ZONES;
+	set->nb_zones = nb_zones;
+	set->emulated = (nb_zones > nb_nodes || nb_nodes == 1);
+	
+	for (z=0; z < nb_zones; z++) {
+		if (set->emulated)
+			set->replicas[z] = (intset_t *)malloc(maxhtlength * sizeof(intset_t));
+		else
+			set->replicas[z] = (intset_t *)numa_alloc_onnode(maxhtlength * sizeof(intset_t), 
+											   set->nodes[z]);
+		if (set->replicas[z] == NULL) {
+			perror("malloc");
+			exit(1);
+		}
+		for (i=0; i < maxhtlength; i++)
+			set->replicas[z][i].head = set->buckets[i]->head;
+	}
+}
+
+void ht_thread_zone(ht_intset_t *set, int id) {
+	if (set->nb_zones == 0) 
+		return;
+	ht_zone = id % set->nb_zones;
+	if (!set->emulated)
+		numa_run_on_node(set->nodes[ht_zone]);
+}
+#endif
+
+/*
+ * An update announces itself on the versions of its buckets (one or two)
+ * and on their stripes before modifying them and, upon completion, 
+ * withdraws its announcements, increments the versions if it effectively 
+ * modified the buckets and adds its contribution to the stripe count.
+ * An update never waits for the exact size, which keeps the table lock-free.
+ */
+static inline void ht_announce(ht_intset_t *set, int addr, AO_t pending) {
+	AO_fetch_and_add_full(&set->versions[addr], pending * HT_VERSION_PENDING);
+	AO_fetch_and_add_full(&set->stripes[addr % HT_STRIPES].word, 
+						  pending * HT_STRIPE_PENDING);
+}
+
+void ht_update_begin(ht_intset_t *set, int addr1, int addr2) {
+	ht_announce(set, addr1, 1);
+	if (addr2 != addr1) ht_announce(set, addr2, 1);
+}
+
+void ht_update_end(ht_intset_t *set, int addr, int delta, int modified) {
+	if (modified)
+		AO_fetch_and_add_full(&set->versions[addr], 
+							  HT_VERSION_INC - HT_VERSION_PENDING);
+	else 
+		AO_fetch_and_add_full(&set->versions[addr], -HT_VERSION_PENDING);
+	AO_fetch_and_add_full(&set->stripes[addr % HT_STRIPES].word, 
+						  (modified ? HT_STRIPE_VERSION_INC : 0) + 
+						  (AO_t) delta * HT_STRIPE_COUNT_INC - HT_STRIPE_PENDING);
+}
+
+int ht_size_approx(ht_intset_t *set) {
+	long size = 0;
+	int i;
+
+	for (i=0; i < HT_STRIPES; i++)
+		size += HT_STRIPE_COUNT(AO_load(&set->stripes[i].word));
+	return (int) size;
+}
+
+/*
+ * The exact size double-collects the stripes, it is linearized between 
+ * the two collects if no stripe was updated in between. After "retries" 
+ * unsuccessful double-collects, it backs off for a bounded exponential 
+ * delay before each new one, giving the updates in progress the time to 
+ * complete. Updates are never stopped, so the size may retry as long as 
+ * they keep modifying the table.
+ */
+int ht_size_exact(ht_intset_t *set, int retries) {
+	AO_t words[HT_STRIPES];
+	long size;
+	int i, attempt, valid;
+	unsigned int backoff = HT_SIZE_BACKOFF_MIN, j;
+
+	for (attempt=0; ; attempt++) {
+		if (attempt >= retries) {
+			for (j=0; j < backoff; j++)
+				HT_PAUSE();
+			if (backoff < HT_SIZE_BACKOFF_MAX)
+				backoff <<= 1;
+		}
+		valid = 1;
+		for (i=0; i < HT_STRIPES && valid; i++) {
+			words[i] = AO_load_full(&set->stripes[i].word);
+			valid = !(words[i] & HT_STRIPE_MASK);
+		}
+		size = 0;
+		for (i=0; i < HT_STRIPES && valid; i++) {
+			valid = (AO_load_full(&set->stripes[i].word) == words[i]);
+			size += HT_STRIPE_COUNT(words[i]);
+		}
+		if (valid) 
+			return (int) size;
+	}
+}
@@ -23,12 +23,23 @@
 
 #include "../../linkedlists/lockfree-list/intset.h"
 
+#ifdef HT_NUMA
+#include "numa_zones.h"
+#endif
+
 #define DEFAULT_MOVE                    0
 #define DEFAULT_SNAPSHOT                0
 #define DEFAULT_LOAD                    1
 #define DEFAULT_ELASTICITY              4
 #define DEFAULT_ALTERNATE               0
 #define DEFAULT_EFFECTIVE               1
+#define DEFAULT_SNAPSHOT_RETRIES        16
+#define DEFAULT_SIZE_POLL               0
+#define DEFAULT_SIZE_RETRIES            16
+#define DEFAULT_NUMA_ZONES              0
+#define DEFAULT_BATCH                   1
+#define MAX_BATCH                       1024
+#define MAX_NUMA_ZONES                  64
 
 #define MAXHTLENGTH                     65536
 
@@ -42,11 +53,106 @@ extern __thread unsigned int *rng_seed;
 extern pthread_key_t rng_seed_key;
 #endif /* ! TLS */
 
+/*
+ * Each bucket has a version word: the low-order bits count the updates 
+ * in progress on the bucket, the high-order bits count the updates that 
+ * effectively modified it.
+ */
+#define HT_VERSION_PENDING              1
+#define HT_VERSION_INC                  (1 << 16)
+#define HT_VERSION_MASK                 (HT_VERSION_INC - 1)
+
+/*
+ * The size is distributed over padded stripes of buckets. The word of a
+ * stripe counts the updates in progress (bits 0-15), the elements of its
+ * buckets as a signed integer (bits 16-39) and the updates that 
+ * effectively modified it (bits 40-63).
+ */
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE                 64
+#endif
+#define HT_STRIPES                      64
+#define HT_STRIPE_PENDING               1UL
+#define HT_STRIPE_COUNT_INC             (1UL << 16)
+#define HT_STRIPE_VERSION_INC           (1UL << 40)
+#define HT_STRIPE_MASK                  (HT_STRIPE_COUNT_INC - 1)
+#define HT_STRIPE_COUNT(w)              (((long) ((w) << 24)) >> 40)
+/* Spins between the double-collects of the exact size, after its retries */
+#define HT_SIZE_BACKOFF_MIN             4
+#define HT_SIZE_BACKOFF_MAX             4096
+#if defined(__x86_64__) || defined(__i386__)
+#define HT_PAUSE()                      __asm__ __volatile__("pause" ::: "memory")
+#else
+#define HT_PAUSE()                      __asm__ __volatile__("" ::: "memory")
+#endif
+
+typedef struct ht_stripe {
+  AO_t word;
+  char padding[CACHE_LINE_SIZE - sizeof(AO_t)];
+} ht_stripe_t;
+
 typedef struct ht_intset {
   intset_t **buckets;
+  AO_t *versions;
+  ht_stripe_t stripes[HT_STRIPES];
+#ifdef HT_NUMA
+  /* 
+   * Per-zone replicas of the bucket directory, replicas[z][i] refers to
+   * the same (shared) sentinel nodes as buckets[i]. The directory is never
+   * modified after ht_replicate so the replicas stay consistent, updates
+   * only modify the shared chained nodes. The sentinels are not replicated:
+   * an insert at the front of a bucket CASes the next pointer of its head.
+   */
+  int nb_zones;
+  int emulated;
+  int nodes[MAX_NUMA_ZONES];      /* memory node of each zone */
+  intset_t *replicas[MAX_NUMA_ZONES];
+#endif
 } ht_intset_t;
 
+#ifdef HT_NUMA
+/* NUMA zone of the calling thread, it selects its directory replica */
+extern __thread int ht_zone;
+#define HT_BUCKET(set, addr)            (&(set)->replicas[ht_zone][addr])
+#define HT_BUCKET_SLOT(set, addr)       (&(set)->replicas[ht_zone][addr])
+#else
+#define HT_BUCKET(set, addr)            ((set)->buckets[addr])
+#define HT_BUCKET_SLOT(set, addr)       (&(set)->buckets[addr])
+#endif
+
+/* Number of lookups in flight in a batch */
+#define HT_BATCH_GROUP                  8
+#define HT_PREFETCH(addr)               __builtin_prefetch((const void *) (addr))
+
+/* Statistics of the versioned snapshot */
+typedef struct ht_snapshot_stat {
+  unsigned long keys;      /* elements collected by successful snapshots */
+  unsigned long retries;   /* unsuccessful validation passes */
+  unsigned long fallbacks; /* snapshots that gave up validating */
+} ht_snapshot_stat_t;
+
 void ht_delete(ht_intset_t *set);
 int ht_size(ht_intset_t *set);
 int floor_log_2(unsigned int n);
 ht_intset_t *ht_new();
+#ifdef HT_NUMA
+/*
+ * Replicate the bucket directory on nb_zones zones (0 = one per NUMA node).
+ * When the machine has fewer NUMA nodes than requested, the zones are
+ * emulated: the replicas are allocated on the local node.
+ */
+void ht_replicate(ht_intset_t *set, int nb_zones);
+/* Assign the calling thread to the zone of thread id (round-robin) */
+void ht_thread_zone(ht_intset_t *set, int id);
+#endif
+void ht_update_begin(ht_intset_t *set, int addr1, int addr2);
+void ht_update_end(ht_intset_t *set, int addr, int delta, int modified);
+
+/* 
+ * Size of the hash table from the stripe counters: the approximate size 
+ * ignores the updates in progress, the exact size is linearizable. The 
+ * exact size does not delay the updates, it retries until it collects 
+ * the stripes between two updates (see ht_size_exact).
+ */
+int ht_size_approx(ht_intset_t *set);
+int ht_size_exact(ht_intset_t *set, int retries);
@@ -27,6 +27,9 @@ int ht_contains(ht_intset_t *set, int val, int transactional) {
 	int addr;
 	
 	addr = val % maxhtlength;
+#ifdef LOCKFREE
+	return mv_contains(HT_BUCKET(set, addr), val);
+#endif
 	if (transactional == 5)
 	  return set_contains(set->buckets[addr], val, 4);
 	else
@@ -37,6 +40,16 @@ int ht_add(ht_intset_t *set, int val, int transactional) {
 	int addr;
 	
 	addr = val % maxhtlength;
+#ifdef LOCKFREE
+	{
+		int result;
+		
+		ht_update_begin(set, addr, addr);
+		result = mv_insert(HT_BUCKET(set, addr), val);
+		ht_update_end(set, addr, result, result);
+		return result;
+	}
+#endif
 	if (transactional == 5)
 		return set_add(set->buckets[addr], val, 4);
 	else 
@@ -47,12 +60,149 @@ int ht_remove(ht_intset_t *set, int val, int transactional) {
 	int addr;
     
 	addr = val % maxhtlength;
+#ifdef LOCKFREE
+	{
+		int result;
+		
+		ht_update_begin(set, addr, addr);
+		result = mv_delete(HT_BUCKET(set, addr), val);
+		ht_update_end(set, addr, -result, result);
+		return result;
+	}
+#endif
 	if (transactional == 5)
 		return set_remove(set->buckets[addr], val, 4);
 	else
 		return set_remove(set->buckets[addr], val, transactional);
 }
 
+/* 
+ * ht_prefetch_slots hashes the keys and prefetches their bucket slots.
+ */
+static inline void ht_prefetch_slots(ht_intset_t *set, int *keys, int n) {
+	int i;
+	
+	for (i=0; i < n; i++)
+		HT_PREFETCH(HT_BUCKET_SLOT(set, keys[i] % maxhtlength));
+}
+
+#ifdef LOCKFREE
+/* 
+ * State of a lookup in flight: the bucket is dereferenced at the first 
+ * step, its head at the second, then one node is visited per step.
+ */
+typedef struct ht_batch_state {
+	int idx;              /* index of the key, -1 if the slot is free */
+	int val;
+	intset_t *bucket;
+	node_t *node;
+} ht_batch_state_t;
+
+static inline void ht_batch_start(ht_intset_t *set, ht_batch_state_t *s, 
+								  int *keys, int idx) {
+	s->idx = idx;
+	s->val = keys[idx];
+	s->bucket = HT_BUCKET(set, s->val % maxhtlength);
+	s->node = NULL;
+	HT_PREFETCH(s->bucket);
+}
+
+/*
+ * ht_batch_step makes a lookup progress by one dependent load and 
+ * prefetches the target of the next one, it returns 1 once the lookup 
+ * has completed (with the result in found). Like mv_contains, it neither
+ * helps nor unlinks, marked nodes are traversed and nodes owning the key 
+ * are skipped until a logically present one is found.
+ */
+static inline int ht_batch_step(ht_batch_state_t *s, int *found) {
+	node_t *curr;
+	
+	if (s->node == NULL) {
+		s->node = s->bucket->head;
+		HT_PREFETCH(s->node);
+		return 0;
+	}
+	curr = s->node;
+	if (curr->next == NULL || curr->val > s->val) {
+		*found = 0;
+		return 1;
+	}
+	if (curr->val == s->val && mv_present((mv_node_t *) curr)) {
+		*found = 1;
+		return 1;
+	}
+	s->node = (node_t *) get_unmarked_ref((long) curr->next);
+	HT_PREFETCH(s->node);
+	return 0;
+}
+#endif /* LOCKFREE */
+
+/*
+ * ht_contains_batch keeps up to HT_BATCH_GROUP lookups in flight and 
+ * switches from one to the next after each step (asynchronous memory 
+ * access chaining), a completed lookup is replaced by the next key.
+ */
+int ht_contains_batch(ht_intset_t *set, int *keys, int n, int *results, 
+					  int transactional) {
+	int i, count = 0;
+#ifdef LOCKFREE
+	ht_batch_state_t group[HT_BATCH_GROUP];
+	int next = 0, active = 0, found;
+#endif
+	
+	ht_prefetch_slots(set, keys, n);
+#ifdef LOCKFREE
+	for (i=0; i < HT_BATCH_GROUP; i++) {
+		if (next < n) {
+			ht_batch_start(set, &group[i], keys, next++);
+			active++;
+		} else group[i].idx = -1;
+	}
+	while (active > 0) {
+		for (i=0; i < HT_BATCH_GROUP; i++) {
+			if (group[i].idx < 0 || !ht_batch_step(&group[i], &found))
+				continue;
+			results[group[i].idx] = found;
+			count += found;
+			if (next < n) 
+				ht_batch_start(set, &group[i], keys, next++);
+			else {
+				group[i].idx = -1;
+				active--;
+			}
+		}
+	}
+#else
+	for (i=0; i < n; i++) {
+		results[i] = ht_contains(set, keys[i], transactional);
+		count += results[i];
+	}
+#endif
+	return count;
+}
+
+/*
+ * ht_add_batch prefetches the bucket and the head of the key that is 
+ * HT_BATCH_GROUP positions ahead before inserting each key.
+ */
+int ht_add_batch(ht_intset_t *set, int *keys, int n, int *results, 
+				 int transactional) {
+	int i, count = 0;
+	
+	ht_prefetch_slots(set, keys, n);
+	for (i=0; i < n && i < HT_BATCH_GROUP; i++)
+		HT_PREFETCH(HT_BUCKET(set, keys[i] % maxhtlength));
+	for (i=0; i < n; i++) {
+		if (i + HT_BATCH_GROUP < n)
+			HT_PREFETCH(HT_BUCKET(set, keys[i + HT_BATCH_GROUP] % maxhtlength));
+		if (i + HT_BATCH_GROUP / 2 < n)
+			HT_PREFETCH(HT_BUCKET(set, keys[i + HT_BATCH_GROUP / 2] % maxhtlength)->head);
+		results[i] = ht_add(set, keys[i], transactional);
+		count += results[i];
+	}
+	return count;
+}
+
 /* 
  * Move an element from one bucket to another.
  * It is equivalent to changing the key associated with some value.
@@ -150,10 +300,10 @@ int ht_move_naive(ht_intset_t *set, int val1, int val2, int transactional) {
 
 	}
 
-#elif defined LOCKFREE /* No CAS-based implementation is provided */
+#elif defined LOCKFREE /* Not atomic: the removal and the insertion are distinct */
 
-	printf("ht_snapshot: No other implementation of atomic snapshot is available\n");
-	exit(1);
+	result = (ht_remove(set, val1, transactional) && 
+			  ht_add(set, val2, transactional));
 
 #endif
 	
@@ -265,10 +415,18 @@ int ht_move(ht_intset_t *set, int val1, int val2, int transactional) {
 	
 	}
 
-#elif defined LOCKFREE /* No CAS-based implementation is provided */
+#elif defined LOCKFREE /* see movable.c */
 	
-	printf("ht_snapshot: No other implementation of atomic snapshot is available\n");
-	exit(1);
+	int addr1, addr2;
+
+	addr1 = val1 % maxhtlength;
+	addr2 = val2 % maxhtlength;
+	ht_update_begin(set, addr1, addr2);
+	result = mv_move(HT_BUCKET(set, addr1), HT_BUCKET(set, addr2), val1, val2);
+	if (addr2 != addr1) {
+		ht_update_end(set, addr1, -result, result);
+		ht_update_end(set, addr2, result, result);
+	} else ht_update_end(set, addr1, 0, result);
 
 #endif
 	
@@ -379,10 +537,9 @@ int ht_move_orrollback(ht_intset_t *set, int val1, int val2, int transactional)
 	  
 	}
 	
-#elif defined LOCKFREE /* No CAS-based implementation is provided */
+#elif defined LOCKFREE /* The move never needs to roll back */
 
-	printf("ht_snapshot: No other implementation of atomic snapshot is available\n");
-	exit(1);
+	result = ht_move(set, val1, val2, transactional);
 
 #endif
 	
@@ -433,12 +590,103 @@ int ht_snapshot(ht_intset_t *set, int transactional) {
 	TX_END;
 	result = 1;
 
-#elif defined LOCKFREE /* No CAS-based implementation is provided */
+#elif defined LOCKFREE
 
-	printf("ht_snapshot: No other implementation of atomic snapshot is available\n");
-	exit(1);
+	ht_snapshot_stat_t stat;
+	
+	stat.keys = stat.retries = stat.fallbacks = 0;
+	result = ht_snapshot_versioned(set, transactional, 
+				       DEFAULT_SNAPSHOT_RETRIES, &stat);
 			
 #endif
 	
 	return result;
 }
+
+#ifdef LOCKFREE
+
+/*
+ * Collect the elements of a bucket and record the version observed 
+ * before the collect. Nodes are never freed upon removal so the bucket 
+ * can be parsed concurrently with updates, absent nodes are skipped.
+ */
+typedef struct ht_collect {
+	AO_t version;
+	long sum;
+	long keys;
+} ht_collect_t;
+
+static __thread ht_collect_t *ht_collect_buf = NULL;
+static __thread unsigned int ht_collect_len = 0;
+
+static inline void ht_collect_bucket(ht_intset_t *set, int i, ht_collect_t *c) {
+	node_t *next;
+	
+	c->version = AO_load_full(&set->versions[i]);
+	c->sum = 0;
+	c->keys = 0;
+	next = (node_t *) get_unmarked_ref((long) set->buckets[i]->head->next);
+	while (next->next) {
+		if (!is_marked_ref((long) next->next) && mv_present((mv_node_t *) next)) {
+			c->sum += next->val;
+			c->keys++;
+		}
+		next = (node_t *) get_unmarked_ref((long) next->next);
+	}
+}
+
+/* 
+ * A bucket is valid if its version has not changed since it was collected
+ * and no update was in progress on it at that time.
+ */
+static inline int ht_collect_valid(ht_intset_t *set, int i, ht_collect_t *c) {
+	AO_t v = AO_load_full(&set->versions[i]);
+	return (v == c->version && !(v & HT_VERSION_MASK));
+}
+
+/*
+ * The snapshot is linearized at the beginning of the last validation pass:
+ * each bucket was then in the state it had when it was collected.
+ */
+int ht_snapshot_versioned(ht_intset_t *set, int transactional, 
+			  int retries, ht_snapshot_stat_t *stat) {
+	int i, m = maxhtlength, attempt, dirty;
+	long sum = 0, keys = 0;
+	
+	if (ht_collect_len < m) {
+		free(ht_collect_buf);
+		if ((ht_collect_buf = (ht_collect_t *)malloc(m * sizeof(ht_collect_t))) == NULL) {
+			perror("malloc");
+			exit(1);
+		}
+		ht_collect_len = m;
+	}
+	
+	for (i=0; i < m; i++)
+		ht_collect_bucket(set, i, &ht_collect_buf[i]);
+	
+	for (attempt=0; attempt <= retries; attempt++) {
+		dirty = 0;
+		for (i=0; i < m; i++) {
+			if (!ht_collect_valid(set, i, &ht_collect_buf[i])) {
+				ht_collect_bucket(set, i, &ht_collect_buf[i]);
+				dirty++;
+			}
+		}
+		if (!dirty) {
+			for (i=0; i < m; i++) {
+				sum += ht_collect_buf[i].sum;
+				keys += ht_collect_buf[i].keys;
+			}
+			stat->keys += keys;
+			return 1;
+		}
+		stat->retries++;
+	}
+	
+	/* No blocking fallback: the snapshot fails */
+	stat->fallbacks++;
+	return 0;
+}
+
+#endif /* LOCKFREE */
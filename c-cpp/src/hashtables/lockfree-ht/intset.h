@@ -22,12 +22,24 @@
  */
 
 
-#include "hashtable.h"
+#include "movable.h"
 
 int ht_contains(ht_intset_t *set, int val, int transactional);
 int ht_add(ht_intset_t *set, int val, int transactional);
 int ht_remove(ht_intset_t *set, int val, int transactional);
 
+/*
+ * Batched operations: results[i] is the result of the operation on keys[i]
+ * and the number of successful operations is returned. The keys are hashed
+ * and their bucket slots prefetched first, then the lock-free lookups are 
+ * interleaved so that the cache misses of distinct keys overlap. Each 
+ * individual operation is linearizable, not the batch.
+ */
+int ht_contains_batch(ht_intset_t *set, int *keys, int n, int *results, 
+		      int transactional);
+int ht_add_batch(ht_intset_t *set, int *keys, int n, int *results, 
+		 int transactional);
+
 /* 
  * Move an element from one bucket to another.
  * It is equivalent to changing the key associated with some value.
@@ -43,3 +55,15 @@ int ht_move(ht_intset_t *set, int val1, int val2, int transactional);
  * compose with elastic transactions.
  */
 int ht_snapshot(ht_intset_t *set, int transactional);
+
+#ifdef LOCKFREE
+/*
+ * Lock-free snapshot of the hash table (versioned collect).
+ * Buckets are collected without synchronization and then re-validated 
+ * against their version until a validation pass finds no bucket modified,
+ * hence the snapshot is consistent with concurrent moves. It gives up 
+ * (and returns 0) after "retries" unsuccessful validation passes.
+ */
+int ht_snapshot_versioned(ht_intset_t *set, int transactional, 
+			  int retries, ht_snapshot_stat_t *stat);
+#endif
@@ -0,0 +1,260 @@
+/*
+ * File:
+ *   movable.c
+ * Description:
+ *   Lock-free move of an element between buckets of the hashtable.
+ *   The buckets are Harris linked lists (harris_search is reused to
+ *   traverse them and to unlink marked nodes) whose logical content is
+ *   given by the move descriptors of their nodes.
+ *   As in the Harris list, nothing is reclaimed: a move frees its
+ *   descriptor and dst node only when it fails before linking dst.
+ *   Once linked, they remain reachable by concurrent searches and
+ *   helpers, so the descriptors and the dst nodes of the moves that
+ *   fail afterwards, like the unlinked nodes, are intentionally leaked.
+ *
+ * Copyright (c) 2009-2010.
+ *
+ * movable.c is part of Synchrobench
+ *
+ * Synchrobench is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, version 2
+ * of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "movable.h"
+
+/*
+ * The descriptor of removals: a removal is a move that succeeded
+ * without destination, it is shared by all removed nodes.
+ */
+static mv_desc_t mv_removed = { NULL, NULL, MV_SUCCEEDED };
+
+mv_node_t *mv_new_node(val_t val, node_t *next, mv_desc_t *move) {
+	mv_node_t *node;
+
+	if ((node = (mv_node_t *)malloc(sizeof(mv_node_t))) == NULL) {
+		perror("malloc");
+		exit(1);
+	}
+	node->val = val;
+	node->next = next;
+	node->move = move;
+
+	return node;
+}
+
+static mv_desc_t *mv_new_desc(mv_node_t *src) {
+	mv_desc_t *desc;
+
+	if ((desc = (mv_desc_t *)malloc(sizeof(mv_desc_t))) == NULL) {
+		perror("malloc");
+		exit(1);
+	}
+	desc->src = src;
+	desc->dst = NULL;
+	desc->status = MV_UNDECIDED;
+
+	return desc;
+}
+
+/*
+ * mv_present returns whether the node is logically present. The
+ * descriptor is read before its status so that a node cannot be
+ * reported present after it was claimed by a subsequent move.
+ */
+int mv_present(mv_node_t *node) {
+	mv_desc_t *desc;
+	AO_t status;
+
+	desc = node->move;
+	if (desc == NULL)
+		return !is_marked_ref((long) node->next);
+	status = AO_load_full(&desc->status);
+	if (desc->dst == node)
+		return (status == MV_SUCCEEDED);
+	return (status != MV_SUCCEEDED);
+}
+
+/*
+ * mv_mark sets the mark bit of a logically absent node so that
+ * subsequent searches unlink it.
+ */
+static void mv_mark(mv_node_t *node) {
+	node_t *next;
+
+	do {
+		next = node->next;
+		if (is_marked_ref((long) next))
+			return;
+	} while (!ATOMIC_CAS_MB(&node->next, next, get_marked_ref((long) next)));
+}
+
+/*
+ * mv_help decides an undecided move: it succeeds iff its src node
+ * has been claimed, i.e., the src node still refers to it. It then
+ * marks whichever of src or dst has become absent.
+ */
+void mv_help(mv_desc_t *desc) {
+	if (AO_load_full(&desc->status) == MV_UNDECIDED) {
+		if (desc->src->move == desc)
+			ATOMIC_CAS_MB(&desc->status, MV_UNDECIDED, MV_SUCCEEDED);
+		else
+			ATOMIC_CAS_MB(&desc->status, MV_UNDECIDED, MV_FAILED);
+	}
+	if (AO_load_full(&desc->status) == MV_SUCCEEDED)
+		mv_mark(desc->src);
+	else
+		mv_mark(desc->dst);
+}
+
+/*
+ * mv_locate looks for a node owning val that is logically present and
+ * returns it, or returns NULL with left_node and right_node delimiting
+ * the position of val. Undecided moves involving a node owning val are
+ * helped, and such nodes found logically absent are marked before
+ * searching again.
+ */
+static mv_node_t *mv_locate(intset_t *set, val_t val, 
+							node_t **left_node, node_t **right_node) {
+	mv_node_t *node;
+	mv_desc_t *desc;
+
+	while (1) {
+		node = (mv_node_t *) harris_search(set, val, left_node);
+		*right_node = (node_t *) node;
+		if (!node->next || node->val != val)
+			return NULL;
+		desc = node->move;
+		if (desc != NULL && AO_load_full(&desc->status) == MV_UNDECIDED) {
+			mv_help(desc);
+			continue;
+		}
+		if (mv_present(node))
+			return node;
+		mv_mark(node);
+	}
+}
+
+/*
+ * mv_contains does not help: an undecided move is linearized after it.
+ * With harris_read_only set, it does not unlink the marked nodes either,
+ * it traverses them as harris_contains does and skips the nodes owning
+ * val that are logically absent.
+ */
+int mv_contains(intset_t *set, val_t val) {
+	node_t *left_node, *t;
+	mv_node_t *right_node;
+
+	if (harris_read_only) {
+		t = (node_t *) get_unmarked_ref((long) set->head->next);
+		while (t->next && t->val <= val) {
+			if (t->val == val && mv_present((mv_node_t *) t))
+				return 1;
+			t = (node_t *) get_unmarked_ref((long) t->next);
+		}
+		return 0;
+	}
+	right_node = (mv_node_t *) harris_search(set, val, &left_node);
+	if (!right_node->next || right_node->val != val)
+		return 0;
+	return mv_present(right_node);
+}
+
+int mv_insert(intset_t *set, val_t val) {
+	node_t *left_node, *right_node;
+	mv_node_t *newnode;
+
+	newnode = mv_new_node(val, NULL, NULL);
+	while (1) {
+		if (mv_locate(set, val, &left_node, &right_node) != NULL) {
+			free(newnode);
+			return 0;
+		}
+		newnode->next = right_node;
+		/* mem-bar between node creation and insertion */
+		AO_nop_full();
+		if (ATOMIC_CAS_MB(&left_node->next, right_node, newnode))
+			return 1;
+	}
+}
+
+/*
+ * mv_delete logically removes the node by installing the removal
+ * descriptor in place of its last (decided) descriptor.
+ */
+int mv_delete(intset_t *set, val_t val) {
+	node_t *left_node, *right_node;
+	mv_node_t *node;
+	mv_desc_t *desc;
+
+	while (1) {
+		if ((node = mv_locate(set, val, &left_node, &right_node)) == NULL)
+			return 0;
+		desc = node->move;
+		if (desc != NULL && 
+			(AO_load_full(&desc->status) == MV_UNDECIDED || !mv_present(node)))
+			continue;
+		if (ATOMIC_CAS_MB(&node->move, desc, &mv_removed))
+			break;
+	}
+	mv_mark(node);
+	harris_search(set, val, &left_node);
+	return 1;
+}
+
+/*
+ * mv_move removes val1 from set1 and inserts val2 in set2 atomically,
+ * it fails if val1 is absent or val2 is present. The pending dst node
+ * is inserted before claiming the src node so that the move can only
+ * be decided successfully once both nodes are linked.
+ */
+int mv_move(intset_t *set1, intset_t *set2, val_t val1, val_t val2) {
+	node_t *left_node, *right_node;
+	mv_node_t *src, *dst;
+	mv_desc_t *desc, *old;
+
+	if (val1 == val2)
+		return 0;
+
+	while (1) {
+		/* Find the node to remove */
+		if ((src = mv_locate(set1, val1, &left_node, &right_node)) == NULL)
+			return 0;
+		old = src->move;
+		if (old != NULL &&
+			(AO_load_full(&old->status) == MV_UNDECIDED || !mv_present(src)))
+			continue;
+
+		desc = mv_new_desc(src);
+		dst = mv_new_node(val2, NULL, desc);
+		desc->dst = dst;
+
+		/* Insert the pending node */
+		while (1) {
+			if (mv_locate(set2, val2, &left_node, &right_node) != NULL) {
+				free(dst);
+				free(desc);
+				return 0;
+			}
+			dst->next = right_node;
+			AO_nop_full();
+			if (ATOMIC_CAS_MB(&left_node->next, right_node, dst))
+				break;
+		}
+
+		/* Claim the node to remove and decide */
+		ATOMIC_CAS_MB(&src->move, old, desc);
+		mv_help(desc);
+		if (AO_load_full(&desc->status) == MV_SUCCEEDED) {
+			harris_search(set1, val1, &left_node);
+			return 1;
+		}
+		harris_search(set2, val2, &left_node);
+	}
+}
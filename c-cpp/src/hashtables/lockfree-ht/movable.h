@@ -0,0 +1,66 @@
+/*
+ * File:
+ *   movable.h
+ * Description:
+ *   Lock-free move of an element between buckets of the hashtable.
+ *   Each bucket is a Harris linked list whose nodes carry a move
+ *   descriptor word that determines whether the node is logically
+ *   present. A move inserts a pending node for the new value, claims the
+ *   node of the old value and then decides the outcome of the move with
+ *   a single CAS on the descriptor status, so that the removal of the old
+ *   value and the insertion of the new value take effect atomically.
+ *   Concurrent operations encountering an undecided move help it.
+ *
+ * Copyright (c) 2009-2010.
+ *
+ * movable.h is part of Synchrobench
+ *
+ * Synchrobench is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, version 2
+ * of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "hashtable.h"
+
+#define MV_UNDECIDED                    0
+#define MV_SUCCEEDED                    1
+#define MV_FAILED                       2
+
+/*
+ * A move descriptor: src is the node of the removed value, dst is
+ * the (pending) node of the inserted value.
+ */
+typedef struct mv_desc {
+	struct mv_node *src;
+	struct mv_node *dst;
+	volatile AO_t status;
+} mv_desc_t;
+
+/*
+ * A node of the movable hash table, it extends node_t with the
+ * descriptor of the last move (or removal) that involved it.
+ * A node without descriptor is present, a node that is the dst
+ * (resp. src) of a descriptor is present iff the descriptor has
+ * (resp. has not) succeeded. The mark bit of next is only set
+ * once the node is logically absent, for it to be unlinked.
+ */
+typedef struct mv_node {
+	val_t val;
+	struct node *next;
+	mv_desc_t *volatile move;
+} mv_node_t;
+
+mv_node_t *mv_new_node(val_t val, node_t *next, mv_desc_t *move);
+int mv_present(mv_node_t *node);
+void mv_help(mv_desc_t *desc);
+
+int mv_contains(intset_t *set, val_t val);
+int mv_insert(intset_t *set, val_t val);
+int mv_delete(intset_t *set, val_t val);
+int mv_move(intset_t *set1, intset_t *set2, val_t val1, val_t val2);
@@ -106,9 +106,14 @@ typedef struct thread_data {
 	int update;
 	int move;
 	int snapshot;
+	int snapshot_retries;
 	int unit_tx;
 	int alternate;
 	int effective;
+	int batch;
+	int *keys;
+	int *results;
+	unsigned long nb_batches;
 	unsigned long nb_add;
 	unsigned long nb_added;
 	unsigned long nb_remove;
@@ -120,6 +125,7 @@ typedef struct thread_data {
 	unsigned long nb_moved;
 	unsigned long nb_snapshot;
 	unsigned long nb_snapshoted;
+	ht_snapshot_stat_t snapshot_stat;
 	/* end: added for HashTables */
 	unsigned long nb_found;
 	unsigned long nb_aborts;
@@ -135,11 +141,14 @@ typedef struct thread_data {
 	ht_intset_t *set;
 	barrier_t *barrier;
 	unsigned long failures_because_contention;
+#ifdef HT_NUMA
+	int id;
+#endif
 } thread_data_t;
 
 
 void *test(void *data) {
-	int val2, numtx, r, last = -1;
+	int val2, numtx, r, i, last = -1;
 	val_t val = 0;
 	int unext, mnext, cnext;
 	
@@ -147,6 +156,16 @@ void *test(void *data) {
 	
 	/* Create transaction */
 	TM_THREAD_ENTER();
+#ifdef HT_NUMA
+	ht_thread_zone(d->set, d->id);
+#endif
+	if (d->batch > 1) {
+		if ((d->keys = (int *)malloc(d->batch * sizeof(int))) == NULL ||
+			(d->results = (int *)malloc(d->batch * sizeof(int))) == NULL) {
+			perror("malloc");
+			exit(1);
+		}
+	}
 	/* Wait on barrier */
 	barrier_cross(d->barrier);
 	
@@ -227,14 +246,31 @@ void *test(void *data) {
 					}
 	      }	else val = rand_range_re(&d->seed, d->range);
 				
-	      if (ht_contains(d->set, val, TRANSACTIONAL)) 
-					d->nb_found++;
-	      d->nb_contains++;
+	      if (d->batch > 1 && !d->alternate) {
+					/* Look up a batch of random values */
+					d->keys[0] = val;
+					for (i = 1; i < d->batch; i++)
+						d->keys[i] = rand_range_re(&d->seed, d->range);
+					d->nb_found += ht_contains_batch(d->set, d->keys, d->batch, 
+													 d->results, TRANSACTIONAL);
+					d->nb_contains += d->batch;
+					d->nb_batches++;
+	      } else {
+					if (ht_contains(d->set, val, TRANSACTIONAL)) 
+						d->nb_found++;
+					d->nb_contains++;
+	      }
 	      
 	    } else { // snapshot
 	      
+#ifdef LOCKFREE
+	      if (ht_snapshot_versioned(d->set, TRANSACTIONAL, 
+					d->snapshot_retries, &d->snapshot_stat))
+		d->nb_snapshoted++;
+#else
 	      if (ht_snapshot(d->set, TRANSACTIONAL))
 		d->nb_snapshoted++;
+#endif
 	      d->nb_snapshot++;
 	      
 	    }
@@ -259,6 +295,11 @@ void *test(void *data) {
 	}
 #endif /* ICC */
 	
+	if (d->batch > 1) {
+		free(d->keys);
+		free(d->results);
+	}
+	
 	/* Free transaction */
 	TM_THREAD_EXIT();
 	
@@ -273,6 +314,9 @@ void *test2(void *data)
 	
 	/* Create transaction */
 	TM_THREAD_ENTER();
+#ifdef HT_NUMA
+	ht_thread_zone(d->set, d->id);
+#endif
 	/* Wait on barrier */
 	barrier_cross(d->barrier);
 	
@@ -326,8 +370,14 @@ void *test2(void *data)
 					d->nb_found++;
 				d->nb_contains++;
 	    } else { /* snapshot */
+#ifdef LOCKFREE
+	      if (ht_snapshot_versioned(d->set, TRANSACTIONAL, 
+					d->snapshot_retries, &d->snapshot_stat))
+					d->nb_snapshoted++;
+#else
 	      if (ht_snapshot(d->set, TRANSACTIONAL))
 					d->nb_snapshoted++;
+#endif
 	      d->nb_snapshot++;
 	    }
 	  }
@@ -338,6 +388,8 @@ void *test2(void *data)
 	return NULL;
 }
 
+#include "ht_size_poll.h"
+
 void print_set(intset_t *set) {
 	node_t *curr, *tmp;
 	
@@ -372,7 +424,12 @@ int main(int argc, char **argv)
 		{"update-rate",               required_argument, NULL, 'u'},
 		{"move-rate",                 required_argument, NULL, 'a'},
 		{"snapshot-rate",             required_argument, NULL, 's'},
+		{"snapshot-retries",          required_argument, NULL, 'k'},
 		{"elasticity",                required_argument, NULL, 'x'},
+		{"size-poll",                 required_argument, NULL, 'z'},
+		{"numa-zones",                required_argument, NULL, 'n'},
+		{"batch-size",                required_argument, NULL, 'b'},
+		{"read-only",                 no_argument,       NULL, 'R'},
 		{NULL, 0, NULL, 0}
 	};
 	
@@ -380,14 +437,17 @@ int main(int argc, char **argv)
 	int i, c, size;
 	val_t last = 0; 
 	val_t val = 0;
-	unsigned long reads, effreads, updates, effupds, moves, moved, snapshots, 
-	snapshoted, aborts, aborts_locked_read, aborts_locked_write, 
+	unsigned long reads, batches, effreads, updates, effupds, moves, moved, snapshots, 
+	snapshoted, snapshot_keys, snapshot_retries, snapshot_fallbacks, aborts, aborts_locked_read, aborts_locked_write, 
 	aborts_validate_read, aborts_validate_write, aborts_validate_commit, 
 	aborts_invalid_memory, aborts_double_write,
 	max_retries, failures_because_contention;
 	thread_data_t *data;
 	pthread_t *threads;
 	pthread_attr_t attr;
+#ifdef LOCKFREE
+	poll_data_t poll;
+#endif
 	barrier_t barrier;
 	struct timeval start, end;
 	struct timespec timeout;
@@ -400,14 +460,19 @@ int main(int argc, char **argv)
 	int load_factor = DEFAULT_LOAD;
 	int move = DEFAULT_MOVE;
 	int snapshot = DEFAULT_SNAPSHOT;
+	int snapshot_bound = DEFAULT_SNAPSHOT_RETRIES;
 	int unit_tx = DEFAULT_ELASTICITY;
 	int alternate = DEFAULT_ALTERNATE;
 	int effective = DEFAULT_EFFECTIVE;
+	int size_poll = DEFAULT_SIZE_POLL;
+	int numa_zones = DEFAULT_NUMA_ZONES;
+	int batch = DEFAULT_BATCH;
+	int keys[MAX_BATCH], results[MAX_BATCH], n;
 	sigset_t block_set;
 	
 	while(1) {
 		i = 0;
-		c = getopt_long(argc, argv, "hAf:d:i:t:r:S:u:a:s:l:x:", long_options, &i);
+		c = getopt_long(argc, argv, "hARf:d:i:t:r:S:u:a:s:k:l:x:z:n:b:", long_options, &i);
 		
 		if(c == -1)
 			break;
@@ -449,6 +514,8 @@ int main(int argc, char **argv)
 								 "        Percentage of move transactions (default=" XSTR(DEFAULT_MOVE) ")\n"
 								 "  -s , --snapshot-rate <int>\n"
 								 "        Percentage of snapshot transactions (default=" XSTR(DEFAULT_SNAPSHOT) ")\n"
+								 "  -k , --snapshot-retries <int>\n"
+								 "        Validation passes before a snapshot gives up (lock-free only, default=" XSTR(DEFAULT_SNAPSHOT_RETRIES) ")\n"
 								 "  -l , --load-factor <int>\n"
 								 "        Ratio of keys over buckets (default=" XSTR(DEFAULT_LOAD) ")\n"
 								 "  -x, --elasticity (default=4)\n"
@@ -459,6 +526,14 @@ int main(int argc, char **argv)
 								 "        3 = read/add elastic-tx,\n"
 								 "        4 = read/add/rem elastic-tx,\n"
 								 "        5 = elastic-tx w/ optimized move.\n"
+								 SIZE_POLL_HELP(" (lock-free only)")
+								 "  -n, --numa-zones <int>\n"
+								 "        Zones replicating the bucket directory (numa build only)\n"
+								 "        0 = one per NUMA node, more are emulated (default=" XSTR(DEFAULT_NUMA_ZONES) ")\n"
+								 "  -b, --batch-size <int>\n"
+								 "        Keys per batched lookup, 1 = single lookups (default=" XSTR(DEFAULT_BATCH) ")\n"
+								 "  -R, --read-only\n"
+								 "        Lookups traverse the marked nodes of the buckets instead of unlinking them\n"
 								 );
 					exit(0);
 				case 'A':
@@ -491,12 +566,27 @@ int main(int argc, char **argv)
 				case 's':
 					snapshot = atoi(optarg);
 					break;
+				case 'k':
+					snapshot_bound = atoi(optarg);
+					break;
 				case 'l':
 					load_factor = atoi(optarg);
 					break;
 				case 'x':
 					unit_tx = atoi(optarg);
 					break;
+				case 'z':
+					size_poll = atoi(optarg);
+					break;
+				case 'n':
+					numa_zones = atoi(optarg);
+					break;
+				case 'b':
+					batch = atoi(optarg);
+					break;
+				case 'R':
+					harris_read_only = 1;
+					break;
 				case '?':
 					printf("Use -h or --help for help\n");
 					exit(0);
@@ -512,8 +602,16 @@ int main(int argc, char **argv)
 	assert(update >= 0 && update <= 100);
 	assert(move >= 0 && move <= update);
 	assert(snapshot >= 0 && snapshot <= (100-update));
+	assert(snapshot_bound >= 0);
 	assert(initial < MAXHTLENGTH);
 	assert(initial >= load_factor);
+#ifdef LOCKFREE
+	assert(size_poll >= 0 && size_poll <= SIZE_POLL_MAX);
+#else
+	assert(size_poll == 0);
+#endif
+	assert(numa_zones >= 0 && numa_zones <= MAX_NUMA_ZONES);
+	assert(batch >= 1 && batch <= MAX_BATCH);
 	
 	printf("Set type     : lock-free hash table\n");
 	printf("Duration     : %d\n", duration);
@@ -525,9 +623,13 @@ int main(int argc, char **argv)
 	printf("Load factor  : %d\n", load_factor);
 	printf("Move rate    : %d\n", move);
 	printf("Snapshot rate: %d\n", snapshot);
+	printf("Snap. retries: %d\n", snapshot_bound);
 	printf("Elasticity   : %d\n", unit_tx);
 	printf("Alternate    : %d\n", alternate);	
 	printf("Effective    : %d\n", effective);
+	printf("Size poll    : %d\n", size_poll);
+	printf("Batch size   : %d\n", batch);
+	printf("Read-only    : %d\n", harris_read_only);
 	printf("Type sizes   : int=%d/long=%d/ptr=%d/word=%d\n",
 				 (int)sizeof(int),
 				 (int)sizeof(long),
@@ -553,6 +655,11 @@ int main(int argc, char **argv)
 	
 	maxhtlength = (unsigned int) initial / load_factor;
 	set = ht_new();
+#ifdef HT_NUMA
+	ht_replicate(set, numa_zones);
+	printf("NUMA zones   : %d (%s)\n", set->nb_zones, 
+		   set->emulated ? "emulated" : "topology");
+#endif
 	
 	stop = 0;
 	
@@ -566,6 +673,15 @@ int main(int argc, char **argv)
 	i = 0;
 	maxhtlength = (int) (initial / load_factor);
 	while (i < initial) {
+		if (batch > 1) {
+			n = (initial - i < batch) ? initial - i : batch;
+			for (c = 0; c < n; c++)
+				keys[c] = rand_range(range);
+			i += ht_add_batch(set, keys, n, results, 0);
+			for (c = 0; c < n; c++)
+				if (results[c]) last = keys[c];
+			continue;
+		}
 		val = rand_range(range);
 		if (ht_add(set, val, 0)) {
 		  last = val;
@@ -578,7 +694,7 @@ int main(int argc, char **argv)
 	printf("Load         : %d\n", load_factor);
 	
 	// Access set from all threads 
-	barrier_init(&barrier, nb_threads + 1);
+	barrier_init(&barrier, nb_threads + 1 + (size_poll ? 1 : 0));
 	pthread_attr_init(&attr);
 	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
 	for (i = 0; i < nb_threads; i++) {
@@ -589,6 +705,7 @@ int main(int argc, char **argv)
 		data[i].load_factor = load_factor;
 		data[i].move = move;
 		data[i].snapshot = snapshot;
+		data[i].snapshot_retries = snapshot_bound;
 		data[i].unit_tx = unit_tx;
 		data[i].alternate = alternate;
 		data[i].effective = effective;
@@ -600,7 +717,12 @@ int main(int argc, char **argv)
 		data[i].nb_moved = 0;
 		data[i].nb_snapshot = 0;
 		data[i].nb_snapshoted = 0;
+		data[i].snapshot_stat.keys = 0;
+		data[i].snapshot_stat.retries = 0;
+		data[i].snapshot_stat.fallbacks = 0;
 		data[i].nb_contains = 0;
+		data[i].batch = batch;
+		data[i].nb_batches = 0;
 		data[i].nb_found = 0;
 		data[i].nb_aborts = 0;
 		data[i].nb_aborts_locked_read = 0;
@@ -612,6 +734,9 @@ int main(int argc, char **argv)
 		data[i].nb_aborts_double_write = 0;
 		data[i].max_retries = 0;
 		data[i].seed = rand();
+#ifdef HT_NUMA
+		data[i].id = i;
+#endif
 		data[i].set = set;
 		data[i].barrier = &barrier;
 		data[i].failures_because_contention = 0;
@@ -620,6 +745,9 @@ int main(int argc, char **argv)
 			exit(1);
 		}
 	}
+#ifdef LOCKFREE
+	poll_start(&poll, size_poll, set, &barrier, &attr);
+#endif
 	pthread_attr_destroy(&attr);
 	
 	// Start threads 
@@ -646,6 +774,9 @@ int main(int argc, char **argv)
 			exit(1);
 		}
 	}
+#ifdef LOCKFREE
+	poll_join(&poll);
+#endif
 	duration = (end.tv_sec * 1000 + end.tv_usec / 1000) - (start.tv_sec * 1000 + start.tv_usec / 1000);
 	aborts = 0;
 	aborts_locked_read = 0;
@@ -657,6 +788,7 @@ int main(int argc, char **argv)
 	aborts_double_write = 0;
 	failures_because_contention = 0;
 	reads = 0;
+	batches = 0;
 	effreads = 0;
 	updates = 0;
 	effupds = 0;
@@ -664,6 +796,9 @@ int main(int argc, char **argv)
 	moved = 0;
 	snapshots = 0;
 	snapshoted = 0;
+	snapshot_keys = 0;
+	snapshot_retries = 0;
+	snapshot_fallbacks = 0;
 	max_retries = 0;
 	for (i = 0; i < nb_threads; i++) {
 		printf("Thread %d\n", i);
@@ -677,6 +812,10 @@ int main(int argc, char **argv)
 		printf("  #moved      : %lu\n", data[i].nb_moved);
 		printf("  #snapshot   : %lu\n", data[i].nb_snapshot);
 		printf("  #snapshoted : %lu\n", data[i].nb_snapshoted);
+#ifdef LOCKFREE
+		printf("    #retries  : %lu\n", data[i].snapshot_stat.retries);
+		printf("    #gave up  : %lu\n", data[i].snapshot_stat.fallbacks);
+#endif
 		printf("  #aborts     : %lu\n", data[i].nb_aborts);
 		printf("    #lock-r   : %lu\n", data[i].nb_aborts_locked_read);
 		printf("    #lock-w   : %lu\n", data[i].nb_aborts_locked_write);
@@ -697,6 +836,7 @@ int main(int argc, char **argv)
 		aborts_double_write += data[i].nb_aborts_double_write;
 		failures_because_contention += data[i].failures_because_contention;
 		reads += data[i].nb_contains;
+		batches += data[i].nb_batches;
 		effreads += data[i].nb_contains + 
 		(data[i].nb_add - data[i].nb_added) + 
 		(data[i].nb_remove - data[i].nb_removed) + 
@@ -708,11 +848,17 @@ int main(int argc, char **argv)
 		moved += data[i].nb_moved;
 		snapshots += data[i].nb_snapshot;
 		snapshoted += data[i].nb_snapshoted;
+		snapshot_keys += data[i].snapshot_stat.keys;
+		snapshot_retries += data[i].snapshot_stat.retries;
+		snapshot_fallbacks += data[i].snapshot_stat.fallbacks;
 		size += data[i].nb_added - data[i].nb_removed;
 		if (max_retries < data[i].max_retries)
 			max_retries = data[i].max_retries;
 	}
 	printf("Set size      : %d (expected: %d)\n", ht_size(set), size);
+#ifdef LOCKFREE
+	poll_print(&poll, set, duration);
+#endif
 	printf("Duration      : %d (ms)\n", duration);
 	printf("#txs          : %lu (%f / s)\n", reads + updates + snapshots, (reads + updates + snapshots) * 1000.0 / duration);
 	
@@ -721,6 +867,8 @@ int main(int argc, char **argv)
 		printf("%lu (%f / s)\n", effreads, effreads * 1000.0 / duration);
 		printf("  #cont/snpsht: %lu (%f / s)\n", reads, reads * 1000.0 / duration);
 	} else printf("%lu (%f / s)\n", reads, reads * 1000.0 / duration);
+	if (batch > 1)
+		printf("  #batches    : %lu (%f / s)\n", batches, batches * 1000.0 / duration);
 	
 	printf("#eff. upd rate: %f \n", 100.0 * effupds / (effupds + effreads));
 	
@@ -735,6 +883,11 @@ int main(int argc, char **argv)
 	printf("  #moved      : %lu (%f / s)\n", moved, moved * 1000.0 / duration);
 	printf("#snapshot txs : %lu (%f / s)\n", snapshots, snapshots * 1000.0 / duration);
 	printf("  #snapshoted : %lu (%f / s)\n", snapshoted, snapshoted * 1000.0 / duration);
+#ifdef LOCKFREE
+	printf("  #scanned    : %lu (%f keys / s)\n", snapshot_keys, snapshot_keys * 1000.0 / duration);
+	printf("  #retries    : %lu (%f / snapshot)\n", snapshot_retries, snapshots ? (double) snapshot_retries / snapshots : 0.0);
+	printf("  #gave up    : %lu\n", snapshot_fallbacks);
+#endif
 	printf("#aborts       : %lu (%f / s)\n", aborts, aborts * 1000.0 / duration);
 	printf("  #lock-r     : %lu (%f / s)\n", aborts_locked_read, aborts_locked_read * 1000.0 / duration);
 	printf("  #lock-w     : %lu (%f / s)\n", aborts_locked_write, aborts_locked_write * 1000.0 / duration);
@@ -40,3 +40,35 @@ int set_remove_l(intset_l_t *set, val_t val, int transactional)
 	if (transactional == 2) return parse_delete(set, val);
 	else return lockc_delete(set, val);
 }
+
+int set_insert_many_l(intset_l_t *set, val_t *vals, int n, int transactional)
+{
+	int i, added = 0;
+
+	if (transactional == 2) return parse_insert_many(set, vals, n);
+	for (i = 0; i < n; i++)
+		added += lockc_insert(set, vals[i]);
+	return added;
+}
+
+int set_remove_range_l(intset_l_t *set, val_t lo, val_t hi, int transactional)
+{
+	val_t val;
+	int removed = 0;
+
+	if (transactional == 2) return parse_delete_range(set, lo, hi);
+	for (val = lo; val <= hi; val++)
+		removed += lockc_delete(set, val);
+	return removed;
+}
+
+int set_count_range_l(intset_l_t *set, val_t lo, val_t hi, int transactional)
+{
+	val_t val;
+	int count = 0;
+
+	if (transactional == 2) return parse_count_range(set, lo, hi);
+	for (val = lo; val <= hi; val++)
+		count += lockc_find(set, val);
+	return count;
+}
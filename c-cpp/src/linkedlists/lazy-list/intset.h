@@ -26,3 +26,12 @@
 int set_contains_l(intset_l_t *set, val_t val, int transactional);
 int set_add_l(intset_l_t *set, val_t val, int transactional);
 int set_remove_l(intset_l_t *set, val_t val, int transactional);
+
+/*
+ * Bulk and range operations of the lazy list (see lazy.h), the values of
+ * insert_many are sorted. The lock-coupling list runs them as one
+ * operation per value.
+ */
+int set_insert_many_l(intset_l_t *set, val_t *vals, int n, int transactional);
+int set_remove_range_l(intset_l_t *set, val_t lo, val_t hi, int transactional);
+int set_count_range_l(intset_l_t *set, val_t lo, val_t hi, int transactional);
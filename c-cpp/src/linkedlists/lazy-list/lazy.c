@@ -126,3 +126,105 @@ int parse_delete(intset_l_t *set, val_t val) {
 			return result;
 	}
 }
+
+int parse_insert_many(intset_l_t *set, val_t *vals, int n) {
+	node_l_t *pred, *curr, *first, *last;
+	int i = 0, j, added = 0;
+
+	pred = set->head;
+	while (i < n) {
+		/* Resume the traversal from the last node spliced in */
+		curr = get_unmarked_ref(pred->next);
+		while (curr->val < vals[i]) {
+			pred = curr;
+			curr = get_unmarked_ref(curr->next);
+		}
+		LOCK(&pred->lock);
+		LOCK(&curr->lock);
+		if (!parse_validate(pred, curr)) {
+			UNLOCK(&curr->lock);
+			UNLOCK(&pred->lock);
+			pred = set->head;
+			continue;
+		}
+		/* Link the run of values lower than curr, then splice it in */
+		first = last = NULL;
+		for (j = i; j < n && vals[j] < curr->val; j++) {
+			if (last != NULL && last->val == vals[j])
+				continue;
+			if (last == NULL)
+				first = last = new_node_l(vals[j], curr, 0);
+			else
+				last = last->next = new_node_l(vals[j], curr, 0);
+			added++;
+		}
+		if (first != NULL)
+			pred->next = first;
+		UNLOCK(&curr->lock);
+		UNLOCK(&pred->lock);
+		/* The values of curr are already present */
+		while (j < n && vals[j] == curr->val)
+			j++;
+		i = j;
+		if (last != NULL)
+			pred = last;
+	}
+	return added;
+}
+
+int parse_delete_range(intset_l_t *set, val_t lo, val_t hi) {
+	node_l_t *pred, *curr, *range[LAZY_RANGE_LOCKS];
+	int i, k, removed = 0;
+
+	while (lo <= hi) {
+		pred = set->head;
+		curr = get_unmarked_ref(pred->next);
+		while (curr->val < lo) {
+			pred = curr;
+			curr = get_unmarked_ref(curr->next);
+		}
+		LOCK(&pred->lock);
+		LOCK(&curr->lock);
+		if (!parse_validate(pred, curr)) {
+			UNLOCK(&curr->lock);
+			UNLOCK(&pred->lock);
+			continue;
+		}
+		/* Lock the nodes of the range, the locked curr cannot be removed */
+		k = 0;
+		while (curr->next != NULL && curr->val <= hi && k < LAZY_RANGE_LOCKS) {
+			range[k++] = curr;
+			curr = get_unmarked_ref(curr->next);
+			LOCK(&curr->lock);
+		}
+		for (i = 0; i < k; i++)
+			range[i]->next = get_marked_ref(range[i]->next);
+		if (k > 0)
+			pred->next = curr;
+		removed += k;
+		UNLOCK(&curr->lock);
+		for (i = k - 1; i >= 0; i--)
+			UNLOCK(&range[i]->lock);
+		UNLOCK(&pred->lock);
+		if (k < LAZY_RANGE_LOCKS)
+			break;
+		/* Remove the rest of the range from the first node left */
+		lo = curr->val;
+	}
+	return removed;
+}
+
+int parse_count_range(intset_l_t *set, val_t lo, val_t hi) {
+	node_l_t *curr, *next;
+	int count = 0;
+
+	curr = set->head;
+	while (curr->val < lo)
+		curr = get_unmarked_ref(curr->next);
+	while ((next = curr->next) != NULL && curr->val <= hi) {
+		if (!is_marked_ref((long) next))
+			count++;
+		curr = get_unmarked_ref(next);
+	}
+	return count;
+}
@@ -38,3 +38,26 @@ int parse_validate(node_l_t *pred, node_l_t *curr);
 int parse_find(intset_l_t *set, val_t val);
 int parse_insert(intset_l_t *set, val_t val);
 int parse_delete(intset_l_t *set, val_t val);
+
+/*
+ * Bulk and range operations:
+ *  - parse_insert_many inserts the n sorted values of vals in a single
+ *    traversal, the values falling between the same two nodes are linked
+ *    together first and spliced in with one write under the locks of
+ *    these nodes, each run is thus inserted atomically,
+ *  - parse_delete_range locks the predecessor of [lo, hi] and the nodes
+ *    of the range in list order, marks them and unlinks them with one
+ *    write: no other update can interleave with the removal, a lookup
+ *    may still find a value of the range before it is marked. At most
+ *    LAZY_RANGE_LOCKS nodes are locked at once, a longer range is removed
+ *    in several steps,
+ *  - parse_count_range counts the values of [lo, hi] without locking, as
+ *    parse_find, each node is counted if it was present when visited but
+ *    the count is not a snapshot of the range.
+ * They return the number of values inserted, removed and counted.
+ */
+#define LAZY_RANGE_LOCKS                32
+
+int parse_insert_many(intset_l_t *set, val_t *vals, int n);
+int parse_delete_range(intset_l_t *set, val_t lo, val_t hi);
+int parse_count_range(intset_l_t *set, val_t lo, val_t hi);
@@ -43,6 +43,8 @@
 #define DEFAULT_LOCKTYPE	    	2
 #define DEFAULT_ALTERNATE	        0
 #define DEFAULT_EFFECTIVE	 	1
+#define DEFAULT_BATCH                   1
+#define DEFAULT_ELIMINATION             0
 
 #define XSTR(s)                         STR(s)
 #define STR(s)                          #s
@@ -59,7 +61,9 @@ typedef intptr_t val_t;
 #define VAL_MIN                         INT_MIN
 #define VAL_MAX                         INT_MAX
 
-#ifdef MUTEX
+#if defined LOCKLIB
+#include "../../utils/locks/locks.h"
+#elif defined MUTEX
 typedef pthread_mutex_t ptlock_t;
 #  define INIT_LOCK(lock)				pthread_mutex_init((pthread_mutex_t *) lock, NULL);
 #  define DESTROY_LOCK(lock)			pthread_mutex_destroy((pthread_mutex_t *) lock)
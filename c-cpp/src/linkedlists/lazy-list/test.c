@@ -22,6 +22,7 @@
  */
 
 #include "intset.h"
+#include "../../utils/locks/elimination.h"
 
 typedef struct barrier {
   pthread_cond_t complete;
@@ -89,6 +90,11 @@ inline long rand_range_re(unsigned int *seed, long r) {
 }
 long rand_range_re(unsigned int *seed, long r);
 
+int compare_val(const void *a, const void *b) {
+  val_t x = *(const val_t *)a, y = *(const val_t *)b;
+  return (x > y) - (x < y);
+}
+
 typedef struct thread_data {
   val_t first;
   long range;
@@ -96,6 +102,7 @@ typedef struct thread_data {
   int unit_tx;
   int alternate;
   int effective;
+  int batch;
   unsigned long nb_add;
   unsigned long nb_added;
   unsigned long nb_remove;
@@ -110,18 +117,27 @@ typedef struct thread_data {
   unsigned long nb_aborts_validate_commit;
   unsigned long nb_aborts_invalid_memory;
   unsigned long max_retries;
+  unsigned long nb_eliminated;
   unsigned int seed;
   intset_l_t *set;
+  elim_t *elim;
   barrier_t *barrier;
 } thread_data_t;
 
 
 void *test(void *data) {
   int unext, last = -1; 
+  int i, n;
   val_t val = 0;
+  val_t *vals;
 	
   thread_data_t *d = (thread_data_t *)data;
 	
+  if ((vals = (val_t *)malloc(d->batch * sizeof(val_t))) == NULL) {
+    perror("malloc");
+    exit(1);
+  }
+	
   /* Wait on barrier */
   barrier_cross(d->barrier);
 	
@@ -132,10 +148,33 @@ void *test(void *data) {
 			
     if (unext) { // update
 				
-      if (last < 0) { // add
+      if (d->batch > 1) { // batched updates
+	
+	if (last < 0) { // add a sorted batch
+	  for (i = 0; i < d->batch; i++)
+	    vals[i] = rand_range_re(&d->seed, d->range);
+	  qsort(vals, d->batch, sizeof(val_t), compare_val);
+	  n = set_insert_many_l(d->set, vals, d->batch, TRANSACTIONAL);
+	  if (n > 0) {
+	    d->nb_added += n;
+	    last = vals[0];
+	  }
+	  d->nb_add += d->batch;
+	} else { // remove a range of batch values
+	  val = d->alternate ? last : rand_range_re(&d->seed, d->range);
+	  n = set_remove_range_l(d->set, val, val + d->batch - 1, TRANSACTIONAL);
+	  if (n > 0 || d->alternate) {
+	    d->nb_removed += n;
+	    last = -1;
+	  }
+	  d->nb_remove += d->batch;
+	}
+	
+      } else if (last < 0) { // add
 					
 	val = rand_range_re(&d->seed, d->range);
-	if (set_add_l(d->set, val, TRANSACTIONAL)) {
+	if ((d->elim != NULL && elim_try(d->elim, ELIM_ADD, val)) ||
+	    set_add_l(d->set, val, TRANSACTIONAL)) {
 	  d->nb_added++;
 	  last = val;
 	} 				
@@ -145,7 +184,8 @@ void *test(void *data) {
 					
 	if (d->alternate) { // alternate mode
 						
-	  if (set_remove_l(d->set, last, TRANSACTIONAL)) {
+	  if ((d->elim != NULL && elim_try(d->elim, ELIM_REMOVE, last)) ||
+	      set_remove_l(d->set, last, TRANSACTIONAL)) {
 	    d->nb_removed++;
 	  }
 	  last = -1;
@@ -153,7 +193,8 @@ void *test(void *data) {
 	} else {
 					
 	  val = rand_range_re(&d->seed, d->range);
-	  if (set_remove_l(d->set, val, TRANSACTIONAL)) {
+	  if ((d->elim != NULL && elim_try(d->elim, ELIM_REMOVE, val)) ||
+	      set_remove_l(d->set, val, TRANSACTIONAL)) {
 	    d->nb_removed++;
 	    last = -1;
 	  } 
@@ -183,9 +224,14 @@ void *test(void *data) {
 	}
       }	else val = rand_range_re(&d->seed, d->range);
 				
-      if (set_contains_l(d->set, val, TRANSACTIONAL)) 
-	d->nb_found++;
-      d->nb_contains++;			
+      if (d->batch > 1) { // count a range of batch values
+	d->nb_found += set_count_range_l(d->set, val, val + d->batch - 1, TRANSACTIONAL);
+	d->nb_contains += d->batch;
+      } else {
+	if (set_contains_l(d->set, val, TRANSACTIONAL)) 
+	  d->nb_found++;
+	d->nb_contains++;
+      }
     }
 			
     /* Is the next op an update? */
@@ -197,6 +243,8 @@ void *test(void *data) {
     }
 			
   }	
+  d->nb_eliminated = elim_stats.eliminated;
+  free(vals);
   return NULL;
 }
 
@@ -212,16 +260,19 @@ int main(int argc, char **argv)
     {"seed",                      required_argument, NULL, 'S'},
     {"update-rate",               required_argument, NULL, 'u'},
     {"unit-tx",                   required_argument, NULL, 'x'},
+    {"batch-size",                required_argument, NULL, 'g'},
+    {"elimination",               required_argument, NULL, 'E'},
     {NULL, 0, NULL, 0}
   };
 	
   intset_l_t *set;
+  elim_t elim;
   int i, c, size;
   val_t last = 0; 
   val_t val = 0;
   unsigned long reads, effreads, updates, effupds, aborts, aborts_locked_read, aborts_locked_write,
     aborts_validate_read, aborts_validate_write, aborts_validate_commit,
-    aborts_invalid_memory, max_retries;
+    aborts_invalid_memory, max_retries, eliminated;
   thread_data_t *data;
   pthread_t *threads;
   pthread_attr_t attr;
@@ -237,11 +288,13 @@ int main(int argc, char **argv)
   int unit_tx = DEFAULT_LOCKTYPE;
   int alternate = DEFAULT_ALTERNATE;
   int effective = DEFAULT_EFFECTIVE;
+  int batch = DEFAULT_BATCH;
+  int elimination = DEFAULT_ELIMINATION;
   sigset_t block_set;
 	
   while(1) {
     i = 0;
-    c = getopt_long(argc, argv, "hAf:d:i:t:r:S:u:x:", long_options, &i);
+    c = getopt_long(argc, argv, "hAf:d:i:t:r:S:u:x:g:E:", long_options, &i);
 		
     if(c == -1)
       break;
@@ -279,6 +332,11 @@ int main(int argc, char **argv)
 	     "        RNG seed (0=time-based, default=" XSTR(DEFAULT_SEED) ")\n"
 	     "  -u, --update-rate <int>\n"
 	     "        Percentage of update transactions (default=" XSTR(DEFAULT_UPDATE) ")\n"
+	     "  -g, --batch-size <int>\n"
+	     "        Values per update and read, adds insert a sorted batch of random values,\n"
+	     "        removes and reads remove and count a range of values (default=" XSTR(DEFAULT_BATCH) ")\n"
+	     "  -E, --elimination <int>\n"
+	     "        Slots of the elimination layer of the single value updates (0=none, default=" XSTR(DEFAULT_ELIMINATION) ")\n"
 	     "  -x, --lock-based algorithm (default=1)\n"
 	     "        Use lock-based algorithm\n"
 	     "        1 = lock-coupling,\n"
@@ -309,6 +367,12 @@ int main(int argc, char **argv)
     case 'u':
       update = atoi(optarg);
       break;
+    case 'g':
+      batch = atoi(optarg);
+      break;
+    case 'E':
+      elimination = atoi(optarg);
+      break;
     case 'x':
       printf("The parameter x is not valid for this benchmark.\n");
       exit(0);
@@ -331,8 +395,13 @@ int main(int argc, char **argv)
   assert(nb_threads > 0);
   assert(range > 0 && range >= initial);
   assert(update >= 0 && update <= 100);
+  assert(batch > 0);
+  assert(elimination >= 0);
 	
   printf("Set type     : lazy linked list\n");
+#ifdef LOCKLIB
+  printf("Lock type    : %s\n", LOCK_NAME);
+#endif
   printf("Length       : %d\n", duration);
   printf("Initial size : %d\n", initial);
   printf("Thread num   : %d\n", nb_threads);
@@ -342,6 +411,8 @@ int main(int argc, char **argv)
   printf("Lock alg     : %d\n", unit_tx);
   printf("Alternate    : %d\n", alternate);
   printf("Effective    : %d\n", effective);
+  printf("Batch size   : %d\n", batch);
+  printf("Elimination  : %d\n", elimination);
   printf("Type sizes   : int=%d/long=%d/ptr=%d/word=%d\n",
 	 (int)sizeof(int),
 	 (int)sizeof(long),
@@ -366,6 +437,8 @@ int main(int argc, char **argv)
     srand(seed);
 	
   set = set_new_l();
+  if (elimination > 0)
+    elim_init(&elim, elimination);
 	
   stop = 0;
 	
@@ -398,6 +471,7 @@ int main(int argc, char **argv)
     data[i].unit_tx = unit_tx;
     data[i].alternate = alternate;
     data[i].effective = effective;
+    data[i].batch = batch;
     data[i].nb_add = 0;
     data[i].nb_added = 0;
     data[i].nb_remove = 0;
@@ -414,6 +488,7 @@ int main(int argc, char **argv)
     data[i].max_retries = 0;
     data[i].seed = rand();
     data[i].set = set;
+    data[i].elim = (elimination > 0 ? &elim : NULL);
     data[i].barrier = &barrier;
     if (pthread_create(&threads[i], &attr, test, (void *)(&data[i])) != 0) {
       fprintf(stderr, "Error creating thread\n");
@@ -458,6 +533,7 @@ int main(int argc, char **argv)
   updates = 0;
   effupds = 0;
   max_retries = 0;
+  eliminated = 0;
   for (i = 0; i < nb_threads; i++) {
     printf("Thread %d\n", i);
     printf("  #add        : %lu\n", data[i].nb_add);
@@ -490,6 +566,7 @@ int main(int argc, char **argv)
 		
     //size += data[i].diff;
     size += data[i].nb_added - data[i].nb_removed;
+    eliminated += data[i].nb_eliminated;
     if (max_retries < data[i].max_retries)
       max_retries = data[i].max_retries;
   }
@@ -520,9 +597,17 @@ int main(int argc, char **argv)
   printf("  #val-c      : %lu (%f / s)\n", aborts_validate_commit, aborts_validate_commit * 1000.0 / duration);
   printf("  #inv-mem    : %lu (%f / s)\n", aborts_invalid_memory, aborts_invalid_memory * 1000.0 / duration);
   printf("Max retries   : %lu\n", max_retries);
+  if (elimination > 0)
+    printf("#eliminated   : %lu (%f %% of updates)\n", eliminated,
+	   (updates ? 100.0 * eliminated / updates : 0.0));
+#ifdef LOCKLIB
+  lock_print_stats();
+#endif
 	
   /* Delete set */
   set_delete_l(set);
+  if (elimination > 0)
+    elim_destroy(&elim);
 	
   free(threads);
   free(data);
@@ -330,6 +330,9 @@ int main(int argc, char **argv)
   assert(update >= 0 && update <= 100);
 	
   printf("Set type     : linked list\n");
+#ifdef LOCKLIB
+  printf("Lock type    : %s\n", LOCK_NAME);
+#endif
   printf("Length       : %d\n", duration);
   printf("Initial size : %d\n", initial);
   printf("Nb threads   : %d\n", nb_threads);
@@ -517,6 +520,9 @@ int main(int argc, char **argv)
   printf("  #val-c      : %lu (%f / s)\n", aborts_validate_commit, aborts_validate_commit * 1000.0 / duration);
   printf("  #inv-mem    : %lu (%f / s)\n", aborts_invalid_memory, aborts_invalid_memory * 1000.0 / duration);
   printf("Max retries   : %lu\n", max_retries);
+#ifdef LOCKLIB
+  lock_print_stats();
+#endif
 	
   /* Delete set */
   set_delete_l(set);
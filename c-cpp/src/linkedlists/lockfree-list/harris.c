@@ -63,14 +63,43 @@ inline long get_marked_ref(long w) {
  * Encountered nodes that are marked as logically deleted are physically removed
  * from the list, yet not garbage collected.
  */
-node_t *harris_search(intset_t *set, val_t val, node_t **left_node) {
+int harris_use_finger = 0;
+__thread harris_finger_t harris_finger;
+int harris_read_only = 0;
+
+/*
+ * harris_start returns the node from which a search for val starts, the
+ * finger of the thread if it precedes val, the head otherwise.
+ */
+static inline node_t *harris_start(intset_t *set, val_t val, int finger) {
+	node_t *f = harris_finger.node;
+
+	if (finger && f != NULL && harris_finger.set == set && f->val < val)
+		return f;
+	return set->head;
+}
+
+static inline node_t *harris_found(intset_t *set, node_t *left_node, node_t *right_node) {
+	harris_finger.set = set;
+	harris_finger.node = left_node;
+	return right_node;
+}
+
+static node_t *harris_search_finger(intset_t *set, val_t val, node_t **left_node, int finger) {
 	node_t *left_node_next, *right_node;
 	left_node_next = set->head;
 	
+	harris_finger.searches++;
 search_again:
 	do {
-		node_t *t = set->head;
-		node_t *t_next = set->head->next;
+		node_t *t = harris_start(set, val, finger);
+		node_t *t_next = t->next;
+		
+		if (is_marked_ref((long) t_next)) {
+			/* The finger was removed, start from the head */
+			t = set->head;
+			t_next = t->next;
+		} else if (t != set->head) harris_finger.hits++;
 		
 		/* Find left_node and right_node */
 		do {
@@ -79,6 +108,7 @@ search_again:
 				left_node_next = t_next;
 			}
 			t = (node_t *) get_unmarked_ref((long) t_next);
+			harris_finger.nodes++;
 			if (!t->next) break;
 			t_next = t->next;
 		} while (is_marked_ref((long) t_next) || (t->val < val));
@@ -88,7 +118,7 @@ search_again:
 		if (left_node_next == right_node) {
 			if (right_node->next && is_marked_ref((long) right_node->next))
 				goto search_again;
-			else return right_node;
+			else return harris_found(set, *left_node, right_node);
 		}
 		
 		/* Remove one or more marked nodes */
@@ -97,12 +127,34 @@ search_again:
 						  right_node)) {
 			if (right_node->next && is_marked_ref((long) right_node->next))
 				goto search_again;
-			else return right_node;
+			else return harris_found(set, *left_node, right_node);
 		} 
 		
 	} while (1);
 }
 
+node_t *harris_search(intset_t *set, val_t val, node_t **left_node) {
+	return harris_search_finger(set, val, left_node, harris_use_finger);
+}
+
+/*
+ * harris_contains returns whether there is an unmarked node owning value
+ * val, without writing: the marked nodes are traversed and left for the
+ * updates to unlink. It is linearized as the contains of the lazy list.
+ */
+int harris_contains(intset_t *set, val_t val) {
+	node_t *t;
+	
+	harris_finger.searches++;
+	t = (node_t *) get_unmarked_ref((long) set->head->next);
+	harris_finger.nodes++;
+	while (t->next && t->val < val) {
+		t = (node_t *) get_unmarked_ref((long) t->next);
+		harris_finger.nodes++;
+	}
+	return (t->next && t->val == val && !is_marked_ref((long) t->next));
+}
+
 /*
  * harris_find returns whether there is a node in the list owning value val.
  */
@@ -110,6 +162,8 @@ int harris_find(intset_t *set, val_t val) {
 	node_t *right_node, *left_node;
 	left_node = set->head;
 	
+	if (harris_read_only)
+		return harris_contains(set, val);
 	right_node = harris_search(set, val, &left_node);
 	if ((!right_node->next) || right_node->val != val)
 		return 0;
@@ -162,5 +216,102 @@ int harris_delete(intset_t *set, val_t val) {
 	return 1;
 }
 
+/*
+ * harris_insert_many inserts the n sorted values of vals, each search
+ * starts from the left node of the previous one (the finger). The values
+ * lower than the right node are linked together and spliced in with a
+ * single CAS, a failed CAS frees the run, which was not published yet.
+ */
+int harris_insert_many(intset_t *set, val_t *vals, int n) {
+	node_t *newnode, *right_node, *left_node, *first, *last;
+	int i = 0, j, k, added = 0;
+	left_node = set->head;
+	
+	while (i < n) {
+		right_node = harris_search_finger(set, vals[i], &left_node, 1);
+		if (right_node->val == vals[i]) {
+			i++;
+			continue;
+		}
+		first = last = NULL;
+		for (j = i, k = 0; j < n && vals[j] < right_node->val; j++) {
+			if (last != NULL && last->val == vals[j])
+				continue;
+			newnode = new_node(vals[j], right_node, 0);
+			if (last == NULL)
+				first = newnode;
+			else
+				last->next = newnode;
+			last = newnode;
+			k++;
+		}
+		/* mem-bar between node creation and insertion */
+		AO_nop_full();
+		if (ATOMIC_CAS_MB(&left_node->next, right_node, first)) {
+			/* The next search starts from the end of the run */
+			harris_found(set, last, right_node);
+			added += k;
+			i = j;
+		} else {
+			while (first != NULL) {
+				newnode = first;
+				first = (first == last) ? NULL : first->next;
+				free(newnode);
+			}
+		}
+	}
+	return added;
+}
 
+/*
+ * harris_delete_range marks the nodes owning a value of [lo, hi] one after
+ * the other and then unlinks them all with the search for lo. Each value
+ * is removed at its own CAS, the range is not removed atomically: a value
+ * inserted behind the traversal is left in the list.
+ */
+int harris_delete_range(intset_t *set, val_t lo, val_t hi) {
+	node_t *right_node, *right_node_next, *left_node;
+	int removed = 0;
+	left_node = set->head;
+	
+	right_node = harris_search(set, lo, &left_node);
+	while (right_node->next && right_node->val <= hi) {
+		right_node_next = right_node->next;
+		if (is_marked_ref((long) right_node_next)) {
+			/* Removed by another thread */
+			right_node = (node_t *) get_unmarked_ref((long) right_node_next);
+		} else if (ATOMIC_CAS_MB(&right_node->next, 
+								 right_node_next, 
+								 get_marked_ref((long) right_node_next))) {
+			removed++;
+			right_node = right_node_next;
+		}
+	}
+	if (removed > 0)
+		harris_search(set, lo, &left_node);
+	return removed;
+}
 
+/*
+ * harris_count_range counts the unmarked nodes owning a value of [lo, hi]
+ * without writing, as harris_contains. Each node is counted if it was
+ * present when traversed, the count is not a snapshot of the range.
+ */
+int harris_count_range(intset_t *set, val_t lo, val_t hi) {
+	node_t *t, *t_next;
+	int count = 0;
+	
+	harris_finger.searches++;
+	t = (node_t *) get_unmarked_ref((long) set->head->next);
+	while (t->next && t->val < lo) {
+		t = (node_t *) get_unmarked_ref((long) t->next);
+		harris_finger.nodes++;
+	}
+	while ((t_next = t->next) != NULL && t->val <= hi) {
+		if (!is_marked_ref((long) t_next))
+			count++;
+		t = (node_t *) get_unmarked_ref((long) t_next);
+		harris_finger.nodes++;
+	}
+	return count;
+}
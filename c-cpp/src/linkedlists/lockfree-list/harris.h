@@ -36,7 +36,43 @@ inline long set_mark(long i);
 inline long get_unmarked_ref(long w);
 inline long get_marked_ref(long w);
 
+/*
+ * Per-thread finger: the last left node found by the searches of the
+ * thread, from which the next search starts when its value is ahead
+ * (with harris_use_finger set). The nodes are never freed, a finger that
+ * was removed meanwhile is detected by its marked next pointer and the
+ * search then starts from the head. The statistics count the searches,
+ * those that started from the finger and the nodes they traversed.
+ */
+typedef struct harris_finger {
+	intset_t *set;
+	node_t *node;
+	unsigned long searches;
+	unsigned long hits;
+	unsigned long nodes;
+} harris_finger_t;
+
+extern int harris_use_finger;
+extern __thread harris_finger_t harris_finger;
+
+/*
+ * With harris_read_only set, harris_find neither helps nor unlinks: it
+ * traverses the marked nodes (harris_contains, wait-free) instead of
+ * removing them as harris_search does.
+ */
+extern int harris_read_only;
+
 node_t *harris_search(intset_t *set, val_t val, node_t **left_node);
+int harris_contains(intset_t *set, val_t val);
 int harris_find(intset_t *set, val_t val);
 int harris_insert(intset_t *set, val_t val);
 int harris_delete(intset_t *set, val_t val);
+
+/*
+ * Bulk and range operations, they return the number of values inserted,
+ * removed and counted. The values of harris_insert_many are sorted, the
+ * values falling between the same two nodes are inserted atomically.
+ */
+int harris_insert_many(intset_t *set, val_t *vals, int n);
+int harris_delete_range(intset_t *set, val_t lo, val_t hi);
+int harris_count_range(intset_t *set, val_t lo, val_t hi);
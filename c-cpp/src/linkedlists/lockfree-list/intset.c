@@ -23,6 +23,7 @@ int set_contains(intset_t *set, val_t val, int transactional)
 #ifdef SEQUENTIAL
 	node_t *prev, *next;
 	
+	COARSE_READ_BEGIN();
 	prev = set->head;
 	next = prev->next;
 	while (next->val < val) {
@@ -30,6 +31,7 @@ int set_contains(intset_t *set, val_t val, int transactional)
 		next = prev->next;
 	}
 	result = (next->val == val);
+	COARSE_READ_END();
 
 #elif defined STM			
 
@@ -112,7 +114,9 @@ int set_add(intset_t *set, val_t val, int transactional)
 	
 #ifdef SEQUENTIAL /* Unprotected */
 		
+		COARSE_WRITE_BEGIN();
 		result = set_seq_add(set, val);
+		COARSE_WRITE_END();
 		
 #elif defined STM
 	
@@ -179,6 +183,7 @@ int set_remove(intset_t *set, val_t val, int transactional)
 	
 	node_t *prev, *next;
 
+	COARSE_WRITE_BEGIN();
 	prev = set->head;
 	next = prev->next;
 	while (next->val < val) {
@@ -188,8 +193,11 @@ int set_remove(intset_t *set, val_t val, int transactional)
 	result = (next->val == val);
 	if (result) {
 		prev->next = next->next;
+#ifndef SEQLOCK /* optimistic readers may still traverse it */
 		free(next);
+#endif
 	}
+	COARSE_WRITE_END();
 			
 #elif defined STM
 	
@@ -246,4 +254,43 @@ int set_remove(intset_t *set, val_t val, int transactional)
 	return result;
 }
 
+int set_insert_many(intset_t *set, val_t *vals, int n, int transactional)
+{
+	int i, result = 0;
+
+#ifdef LOCKFREE
+	if (transactional)
+		return harris_insert_many(set, vals, n);
+#endif
+	for (i = 0; i < n; i++)
+		result += set_add(set, vals[i], transactional);
+	return result;
+}
+
+int set_remove_range(intset_t *set, val_t lo, val_t hi, int transactional)
+{
+	int result = 0;
+	val_t val;
 
+#ifdef LOCKFREE
+	if (transactional)
+		return harris_delete_range(set, lo, hi);
+#endif
+	for (val = lo; val <= hi; val++)
+		result += set_remove(set, val, transactional);
+	return result;
+}
+
+int set_count_range(intset_t *set, val_t lo, val_t hi, int transactional)
+{
+	int result = 0;
+	val_t val;
+
+#ifdef LOCKFREE
+	if (transactional)
+		return harris_count_range(set, lo, hi);
+#endif
+	for (val = lo; val <= hi; val++)
+		result += set_contains(set, val, transactional);
+	return result;
+}
@@ -13,3 +13,11 @@ int set_contains(intset_t *set, val_t val, int transactional);
 int set_add(intset_t *set, val_t val, int transactional);
 int set_remove(intset_t *set, val_t val, int transactional);
 
+/*
+ * Bulk and range operations, the values of set_insert_many are sorted.
+ * Only the lock-free list has dedicated ones (see harris.h), the other
+ * builds run one operation per value.
+ */
+int set_insert_many(intset_t *set, val_t *vals, int n, int transactional);
+int set_remove_range(intset_t *set, val_t lo, val_t hi, int transactional);
+int set_count_range(intset_t *set, val_t lo, val_t hi, int transactional);
@@ -36,6 +36,8 @@
 #define DEFAULT_ELASTICITY							4
 #define DEFAULT_ALTERNATE								0
 #define DEFAULT_EFFECTIVE								1
+#define DEFAULT_BATCH                   1
+#define DEFAULT_ELIMINATION             0
 
 #define XSTR(s)                         STR(s)
 #define STR(s)                          #s
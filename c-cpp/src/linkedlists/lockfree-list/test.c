@@ -22,6 +22,7 @@
  */
 
 #include "intset.h"
+#include "../../utils/locks/elimination.h"
 
 typedef struct barrier {
 	pthread_cond_t complete;
@@ -92,6 +93,10 @@ inline long rand_range_re(unsigned int *seed, long r) {
 }
 long rand_range_re(unsigned int *seed, long r);
 
+int compare_val(const void *a, const void *b) {
+	val_t x = *(const val_t *)a, y = *(const val_t *)b;
+	return (x > y) - (x < y);
+}
 
 typedef struct thread_data {
 	val_t first;
@@ -100,12 +105,17 @@ typedef struct thread_data {
 	int unit_tx;
 	int alternate;
 	int effective;
+	int batch;
 	unsigned long nb_add;
 	unsigned long nb_added;
 	unsigned long nb_remove;
 	unsigned long nb_removed;	
 	unsigned long nb_contains;
 	unsigned long nb_found;
+	unsigned long nb_searches;
+	unsigned long nb_finger_hits;
+	unsigned long nb_visited;
+	unsigned long nb_eliminated;
 	unsigned long nb_aborts;
 	unsigned long nb_aborts_locked_read;
 	unsigned long nb_aborts_locked_write;
@@ -117,16 +127,24 @@ typedef struct thread_data {
 	unsigned long max_retries;
 	unsigned int seed;
 	intset_t *set;
+	elim_t *elim;
 	barrier_t *barrier;
 	unsigned long failures_because_contention;
 } thread_data_t;
 
 void *test(void *data) {
 	int unext, last = -1; 
+	int i, n;
 	val_t val = 0;
+	val_t *vals;
 	
 	thread_data_t *d = (thread_data_t *)data;
 	
+	if ((vals = (val_t *)malloc(d->batch * sizeof(val_t))) == NULL) {
+		perror("malloc");
+		exit(1);
+	}
+	
 	/* Create transaction */
 	TM_THREAD_ENTER();
 	/* Wait on barrier */
@@ -143,10 +161,33 @@ void *test(void *data) {
 		
 		if (unext) { // update
 			
-			if (last < 0) { // add
+			if (d->batch > 1) { // batched updates
+				
+				if (last < 0) { // add a sorted batch
+					for (i = 0; i < d->batch; i++)
+						vals[i] = rand_range_re(&d->seed, d->range);
+					qsort(vals, d->batch, sizeof(val_t), compare_val);
+					n = set_insert_many(d->set, vals, d->batch, TRANSACTIONAL);
+					if (n > 0) {
+						d->nb_added += n;
+						last = vals[0];
+					}
+					d->nb_add += d->batch;
+				} else { // remove a range of batch values
+					val = d->alternate ? last : rand_range_re(&d->seed, d->range);
+					n = set_remove_range(d->set, val, val + d->batch - 1, TRANSACTIONAL);
+					if (n > 0 || d->alternate) {
+						d->nb_removed += n;
+						last = -1;
+					}
+					d->nb_remove += d->batch;
+				}
+				
+			} else if (last < 0) { // add
 		
 				val = rand_range_re(&d->seed, d->range);
-				if (set_add(d->set, val, TRANSACTIONAL)) {
+				if ((d->elim != NULL && elim_try(d->elim, ELIM_ADD, val)) ||
+					set_add(d->set, val, TRANSACTIONAL)) {
 					d->nb_added++;
 					last = val;
 				} 				
@@ -155,7 +196,8 @@ void *test(void *data) {
 			} else { // remove
 				
 				if (d->alternate) { // alternate mode (default)
-					if (set_remove(d->set, last, TRANSACTIONAL)) {
+					if ((d->elim != NULL && elim_try(d->elim, ELIM_REMOVE, last)) ||
+						set_remove(d->set, last, TRANSACTIONAL)) {
 						d->nb_removed++;
 					} 
 					last = -1;
@@ -163,7 +205,8 @@ void *test(void *data) {
 					/* Random computation only in non-alternated cases */
 					val = rand_range_re(&d->seed, d->range);
 					/* Remove one random value */
-					if (set_remove(d->set, val, TRANSACTIONAL)) {
+					if ((d->elim != NULL && elim_try(d->elim, ELIM_REMOVE, val)) ||
+						set_remove(d->set, val, TRANSACTIONAL)) {
 						d->nb_removed++;
 						/* Repeat until successful, to avoid size variations */
 						last = -1;
@@ -193,9 +236,14 @@ void *test(void *data) {
 				}
 			}	else val = rand_range_re(&d->seed, d->range);
 			
-			if (set_contains(d->set, val, TRANSACTIONAL)) 
-				d->nb_found++;
-			d->nb_contains++;
+			if (d->batch > 1) { // count a range of batch values
+				d->nb_found += set_count_range(d->set, val, val + d->batch - 1, TRANSACTIONAL);
+				d->nb_contains += d->batch;
+			} else {
+				if (set_contains(d->set, val, TRANSACTIONAL)) 
+					d->nb_found++;
+				d->nb_contains++;
+			}
 	
 		}
 		
@@ -213,6 +261,12 @@ void *test(void *data) {
 	}
 #endif /* ICC */
 	
+	d->nb_searches = harris_finger.searches;
+	d->nb_finger_hits = harris_finger.hits;
+	d->nb_visited = harris_finger.nodes;
+	d->nb_eliminated = elim_stats.eliminated;
+	free(vals);
+	
 	/* Free transaction */
 	TM_THREAD_EXIT();
 	
@@ -234,17 +288,23 @@ int main(int argc, char **argv) {
 		{"seed",                      required_argument, NULL, 'S'},
 		{"update-rate",               required_argument, NULL, 'u'},
 		{"elasticity",                required_argument, NULL, 'x'},
+		{"finger",                    no_argument,       NULL, 'F'},
+		{"read-only",                 no_argument,       NULL, 'R'},
+		{"batch-size",                required_argument, NULL, 'g'},
+		{"elimination",               required_argument, NULL, 'E'},
 		{NULL, 0, NULL, 0}
 	};
 	
 	intset_t *set;
+	elim_t elim;
 	int i, c, size;
 	val_t last = 0; 
 	val_t val = 0;
 	unsigned long reads, effreads, updates, effupds, aborts, aborts_locked_read, 
 	aborts_locked_write, aborts_validate_read, aborts_validate_write, 
 	aborts_validate_commit, aborts_invalid_memory, aborts_double_write, 
-	max_retries, failures_because_contention;
+	max_retries, failures_because_contention, searches, finger_hits, visited,
+	eliminated;
 	thread_data_t *data;
 	pthread_t *threads;
 	pthread_attr_t attr;
@@ -260,11 +320,13 @@ int main(int argc, char **argv) {
 	int unit_tx = DEFAULT_ELASTICITY;
 	int alternate = DEFAULT_ALTERNATE;
 	int effective = DEFAULT_EFFECTIVE;
+	int batch = DEFAULT_BATCH;
+	int elimination = DEFAULT_ELIMINATION;
 	sigset_t block_set;
 	
 	while(1) {
 		i = 0;
-		c = getopt_long(argc, argv, "hAf:d:i:t:r:S:u:x:", long_options, &i);
+		c = getopt_long(argc, argv, "hAFRf:d:i:t:r:S:u:x:g:E:", long_options, &i);
 		
 		if(c == -1)
 			break;
@@ -288,6 +350,10 @@ int main(int argc, char **argv) {
 								 "        Print this message\n"
 								 "  -A, --alternate (default="XSTR(DEFAULT_ALTERNATE)")\n"
 								 "        Consecutive insert/remove target the same value\n"
+								 "  -F, --finger\n"
+								 "        Harris searches start from the last position of the thread\n"
+								 "  -R, --read-only\n"
+								 "        Harris contains traverses the marked nodes instead of unlinking them\n"
 								 "  -f, --effective <int>\n"
 								 "        update txs must effectively write (0=trial, 1=effective, default=" XSTR(DEFAULT_EFFECTIVE) ")\n"
 								 "  -d, --duration <int>\n"
@@ -302,6 +368,11 @@ int main(int argc, char **argv) {
 								 "        RNG seed (0=time-based, default=" XSTR(DEFAULT_SEED) ")\n"
 								 "  -u, --update-rate <int>\n"
 								 "        Percentage of update transactions (default=" XSTR(DEFAULT_UPDATE) ")\n"
+								 "  -g, --batch-size <int>\n"
+								 "        Values per update and read, adds insert a sorted batch of random values,\n"
+								 "        removes and reads remove and count a range of values (default=" XSTR(DEFAULT_BATCH) ")\n"
+								 "  -E, --elimination <int>\n"
+								 "        Slots of the elimination layer of the single value updates (0=none, default=" XSTR(DEFAULT_ELIMINATION) ")\n"
 								 "  -x, --elasticity (default=4)\n"
 								 "        Use elastic transactions\n"
 								 "        0 = non-protected,\n"
@@ -316,6 +387,18 @@ int main(int argc, char **argv) {
 				case 'A':
 					alternate = 1;
 					break;
+				case 'F':
+					harris_use_finger = 1;
+					break;
+				case 'R':
+					harris_read_only = 1;
+					break;
+				case 'g':
+					batch = atoi(optarg);
+					break;
+				case 'E':
+					elimination = atoi(optarg);
+					break;
 				case 'f':
 					effective = atoi(optarg);
 					break;
@@ -353,6 +436,8 @@ int main(int argc, char **argv) {
 	assert(nb_threads > 0);
 	assert(range > 0 && range >= initial);
 	assert(update >= 0 && update <= 100);
+	assert(batch > 0);
+	assert(elimination >= 0);
 	
 	printf("Bench type   : linked list\n");
 	printf("Duration     : %d\n", duration);
@@ -364,6 +449,15 @@ int main(int argc, char **argv) {
 	printf("Elasticity   : %d\n", unit_tx);
 	printf("Alternate    : %d\n", alternate);
 	printf("Effective    : %d\n", effective);
+#ifdef COARSE_NAME
+	printf("Lock type    : %s\n", COARSE_NAME);
+#endif
+#ifdef LOCKFREE
+	printf("Finger       : %d\n", harris_use_finger);
+	printf("Read-only    : %d\n", harris_read_only);
+	printf("Batch size   : %d\n", batch);
+	printf("Elimination  : %d\n", elimination);
+#endif
 	printf("Type sizes   : int=%d/long=%d/ptr=%d/word=%d\n",
 				 (int)sizeof(int),
 				 (int)sizeof(long),
@@ -388,6 +482,8 @@ int main(int argc, char **argv) {
 		srand(seed);
 	
 	set = set_new();
+	if (elimination > 0)
+		elim_init(&elim, elimination);
 	stop = 0;
 	
 	/* Init STM */
@@ -420,6 +516,7 @@ int main(int argc, char **argv) {
 		data[i].unit_tx = unit_tx;
 		data[i].alternate = alternate;
 		data[i].effective = effective;
+		data[i].batch = batch;
 		data[i].nb_add = 0;
 		data[i].nb_added = 0;
 		data[i].nb_remove = 0;
@@ -437,6 +534,7 @@ int main(int argc, char **argv) {
 		data[i].max_retries = 0;
 		data[i].seed = rand();
 		data[i].set = set;
+		data[i].elim = (elimination > 0 ? &elim : NULL);
 		data[i].barrier = &barrier;
 		data[i].failures_because_contention = 0;
 		if (pthread_create(&threads[i], &attr, test, (void *)(&data[i])) != 0) {
@@ -490,6 +588,10 @@ int main(int argc, char **argv) {
 	updates = 0;
 	effupds = 0;
 	max_retries = 0;
+	searches = 0;
+	finger_hits = 0;
+	visited = 0;
+	eliminated = 0;
 	for (i = 0; i < nb_threads; i++) {
 		printf("Thread %d\n", i);
 		printf("  #add        : %lu\n", data[i].nb_add);
@@ -524,6 +626,10 @@ int main(int argc, char **argv) {
 		updates += (data[i].nb_add + data[i].nb_remove);
 		effupds += data[i].nb_removed + data[i].nb_added; 
 		size += data[i].nb_added - data[i].nb_removed;
+		searches += data[i].nb_searches;
+		finger_hits += data[i].nb_finger_hits;
+		visited += data[i].nb_visited;
+		eliminated += data[i].nb_eliminated;
 		if (max_retries < data[i].max_retries)
 			max_retries = data[i].max_retries;
 	}
@@ -566,9 +672,24 @@ int main(int argc, char **argv) {
 				 aborts_double_write * 1000.0 / duration);
 	printf("  #failures   : %lu\n",  failures_because_contention);
 	printf("Max retries   : %lu\n", max_retries);
+#ifdef LOCKFREE
+	printf("#searches     : %lu\n", searches);
+	printf("  #from finger: %lu (%f %%)\n", finger_hits, 
+				 (searches ? 100.0 * finger_hits / searches : 0.0));
+	printf("  nodes/search: %f\n", (searches ? (double) visited / searches : 0.0));
+#endif
+	
+	if (elimination > 0)
+		printf("#eliminated   : %lu (%f %% of updates)\n", eliminated, 
+					 (updates ? 100.0 * eliminated / updates : 0.0));
+#ifdef COARSE_NAME
+	COARSE_PRINT_STATS();
+#endif
 	
 	/* Delete set */
 	set_delete(set);
+	if (elimination > 0)
+		elim_destroy(&elim);
 	
 	/* Cleanup STM */
 	TM_SHUTDOWN();
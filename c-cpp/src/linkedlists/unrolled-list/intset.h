@@ -0,0 +1,24 @@
+/*
+ * File:
+ *   intset.h
+ * Description:
+ *   Unrolled linked list integer set operations
+ *
+ * intset.h is part of Synchrobench
+ * 
+ * Synchrobench is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, version 2
+ * of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "unrolled.h"
+
+int set_contains_u(intset_u_t *set, val_t val, int transactional);
+int set_add_u(intset_u_t *set, val_t val, int transactional);
+int set_remove_u(intset_u_t *set, val_t val, int transactional);
@@ -0,0 +1,97 @@
+/*
+ * File:
+ *   linkedlist-lock.c
+ * Description:
+ *   Lock-based unrolled linked list implementation of an integer set
+ *
+ * linkedlist-lock.c is part of Synchrobench
+ * 
+ * Synchrobench is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, version 2
+ * of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "linkedlist-lock.h"
+
+node_u_t *new_node_u(val_t min, node_u_t *next)
+{
+  node_u_t *node;
+  
+  node = (node_u_t *)malloc(sizeof(node_u_t));
+  if (node == NULL) {
+    perror("malloc");
+    exit(1);
+  }
+  node->min = min;
+  node->next = next;
+  node->version = 0;
+  node->count = 0;
+  node->marked = 0;
+  INIT_LOCK(&node->lock);
+  return node;
+}
+
+intset_u_t *set_new_u()
+{
+  intset_u_t *set;
+  node_u_t *min, *max;
+
+  if ((set = (intset_u_t *)malloc(sizeof(intset_u_t))) == NULL) {
+    perror("malloc");
+    exit(1);
+  }
+  max = new_node_u(VAL_MAX, NULL);
+  min = new_node_u(VAL_MIN, max);
+  set->head = min;
+
+  return set;
+}
+
+void set_delete_u(intset_u_t *set)
+{
+  node_u_t *node, *next;
+
+  node = set->head;
+  while (node != NULL) {
+    next = node->next;
+    DESTROY_LOCK(&node->lock);
+    free(node);
+    node = next;
+  }
+  free(set);
+}
+
+int set_size_u(intset_u_t *set)
+{
+  int size = 0;
+  node_u_t *node;
+
+  node = set->head;
+  while (node != NULL) {
+    size += node->count;
+    node = node->next;
+  }
+
+  return size;
+}
+
+/* Number of nodes that can hold keys (all but the tail) */
+int set_nodes_u(intset_u_t *set)
+{
+  int nodes = 0;
+  node_u_t *node;
+
+  node = set->head;
+  while (node->next != NULL) {
+    nodes++;
+    node = node->next;
+  }
+
+  return nodes;
+}
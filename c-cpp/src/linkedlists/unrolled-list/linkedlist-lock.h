@@ -0,0 +1,109 @@
+/*
+ * File:
+ *   linkedlist-lock.h
+ * Description:
+ *   Lock-based unrolled linked list implementation of an integer set: each
+ *   node holds a small sorted array of keys so that a traversal visits
+ *   one node (and about one cache miss) per UNROLLED_KEYS keys.
+ *
+ * linkedlist-lock.h is part of Synchrobench
+ * 
+ * Synchrobench is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, version 2
+ * of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <assert.h>
+#include <getopt.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/time.h>
+#include <time.h>
+#include <stdint.h>
+
+#include <atomic_ops.h>
+
+#define DEFAULT_DURATION                10000
+#define DEFAULT_INITIAL                 256
+#define DEFAULT_NB_THREADS              1
+#define DEFAULT_RANGE                   0x7FFFFFFF
+#define DEFAULT_SEED                    0
+#define DEFAULT_UPDATE                  20
+#define DEFAULT_ALTERNATE	        0
+#define DEFAULT_EFFECTIVE	 	1
+
+#define XSTR(s)                         STR(s)
+#define STR(s)                          #s
+
+/* 
+ * Keys per node, the default node fits in two cache lines with the 
+ * spinlocks. A node is split when full and merged with its successor 
+ * when both hold at most UNROLLED_MERGE keys together.
+ */
+#ifndef UNROLLED_KEYS
+#define UNROLLED_KEYS                   11
+#endif
+#define UNROLLED_MERGE                  (UNROLLED_KEYS / 2)
+
+#define ATOMIC_CAS_MB_FBAR(a, e, v)     (AO_compare_and_swap_full((volatile AO_t *)(a), (AO_t)(e), (AO_t)(v)))
+
+#define ATOMIC_CAS_MB_NOBAR(a, e, v)    (AO_compare_and_swap((volatile AO_t *)(a), (AO_t)(e), (AO_t)(v)))
+
+static volatile AO_t stop;
+
+#define TRANSACTIONAL                   d->unit_tx
+
+typedef intptr_t val_t;
+#define VAL_MIN                         INT_MIN
+#define VAL_MAX                         INT_MAX
+
+#if defined LOCKLIB
+#include "../../utils/locks/locks.h"
+#elif defined MUTEX
+typedef pthread_mutex_t ptlock_t;
+#  define INIT_LOCK(lock)				pthread_mutex_init((pthread_mutex_t *) lock, NULL);
+#  define DESTROY_LOCK(lock)			pthread_mutex_destroy((pthread_mutex_t *) lock)
+#  define LOCK(lock)					pthread_mutex_lock((pthread_mutex_t *) lock)
+#  define UNLOCK(lock)					pthread_mutex_unlock((pthread_mutex_t *) lock)
+#else
+typedef pthread_spinlock_t ptlock_t;
+#  define INIT_LOCK(lock)				pthread_spin_init((pthread_spinlock_t *) lock, PTHREAD_PROCESS_PRIVATE);
+#  define DESTROY_LOCK(lock)			pthread_spin_destroy((pthread_spinlock_t *) lock)
+#  define LOCK(lock)					pthread_spin_lock((pthread_spinlock_t *) lock)
+#  define UNLOCK(lock)					pthread_spin_unlock((pthread_spinlock_t *) lock)
+#endif
+
+/*
+ * A node holds the keys of [min, next->min) in keys[0..count-1], sorted.
+ * min never changes, the head has min VAL_MIN and the tail VAL_MAX (and 
+ * no keys). The version is odd while the node is modified (under its 
+ * lock), readers validate their read of the node against it.
+ */
+typedef struct node_u {
+  val_t min;
+  struct node_u *next;
+  volatile AO_t version;
+  int count;
+  int marked;
+  val_t keys[UNROLLED_KEYS];
+  ptlock_t lock;
+} node_u_t;
+
+typedef struct intset_u {
+  node_u_t *head;
+} intset_u_t;
+
+node_u_t *new_node_u(val_t min, node_u_t *next);
+intset_u_t *set_new_u();
+void set_delete_u(intset_u_t *set);
+int set_size_u(intset_u_t *set);
+int set_nodes_u(intset_u_t *set);
@@ -0,0 +1,218 @@
+/*
+ * File:
+ *   unrolled.c
+ * Description:
+ *   Unrolled linked list implementation of an integer set. Each node
+ *   holds up to UNROLLED_KEYS sorted keys of the interval [min, next->min)
+ *   as in the unrolled lists of Shao et al. and Platz et al., with the
+ *   lazy list synchronization of Heller et al.:
+ *   - updates lock the node of the key and validate that it is still
+ *     unmarked and still covers the key,
+ *   - a full node is split in two halves, the new node being linked once
+ *     initialized,
+ *   - a removal merges the node with its successor (locked in list order)
+ *     when both hold at most UNROLLED_MERGE keys together, the successor
+ *     is then marked,
+ *   - lookups do not lock, they read the keys of the node between two
+ *     reads of its version and retry if the node was modified meanwhile.
+ *   As in the lazy list, the unlinked nodes are not freed.
+ *
+ * unrolled.c is part of Synchrobench
+ *
+ * Synchrobench is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, version 2
+ * of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "unrolled.h"
+
+__thread unrolled_stat_t unrolled_stat;
+
+/*
+ * Returns the node whose interval contains val, without synchronization.
+ */
+node_u_t *unrolled_locate(intset_u_t *set, val_t val) {
+	node_u_t *curr, *next;
+
+	curr = set->head;
+	unrolled_stat.nodes++;
+	while ((next = curr->next)->min <= val) {
+		unrolled_stat.keys += curr->count;
+		curr = next;
+		unrolled_stat.nodes++;
+	}
+	return curr;
+}
+
+/*
+ * Checks, with the lock of node held, that node is still in the list
+ * and that val belongs to its interval.
+ */
+inline int unrolled_validate(node_u_t *node, val_t val) {
+	return (!node->marked && node->next->min > val);
+}
+
+/* Position of the first key of node greater than or equal to val */
+inline int unrolled_index(node_u_t *node, val_t val) {
+	int i, n = node->count;
+
+	if (n > UNROLLED_KEYS) n = UNROLLED_KEYS;
+	for (i = 0; i < n && node->keys[i] < val; i++)
+		;
+	return i;
+}
+
+inline void unrolled_write_begin(node_u_t *node) {
+	AO_fetch_and_add_full(&node->version, 1);
+}
+
+inline void unrolled_write_end(node_u_t *node) {
+	AO_fetch_and_add_full(&node->version, 1);
+}
+
+/*
+ * Inserts val at position i of node, splitting it first if it is full.
+ * The caller holds the lock of node and has begun writing it.
+ */
+void unrolled_put(node_u_t *node, int i, val_t val) {
+	node_u_t *newnode;
+	int j, half = UNROLLED_KEYS / 2;
+
+	if (node->count == UNROLLED_KEYS) {
+		newnode = new_node_u(node->keys[half], node->next);
+		for (j = half; j < UNROLLED_KEYS; j++)
+			newnode->keys[j - half] = node->keys[j];
+		newnode->count = UNROLLED_KEYS - half;
+		node->count = half;
+		if (i > half)
+			unrolled_put(newnode, i - half, val);
+		else
+			unrolled_put(node, i, val);
+		/* mem-bar between node creation and insertion */
+		AO_nop_full();
+		node->next = newnode;
+		return;
+	}
+	for (j = node->count; j > i; j--)
+		node->keys[j] = node->keys[j - 1];
+	node->keys[i] = val;
+	node->count++;
+}
+
+/*
+ * Removes the key at position i of node, the caller holds the lock of
+ * node and has begun writing it.
+ */
+void unrolled_take(node_u_t *node, int i) {
+	int j;
+
+	for (j = i + 1; j < node->count; j++)
+		node->keys[j - 1] = node->keys[j];
+	node->count--;
+}
+
+int unrolled_find(intset_u_t *set, val_t val) {
+	node_u_t *curr, *next;
+	AO_t version;
+	int i, found;
+
+ restart:
+	curr = unrolled_locate(set, val);
+	while (1) {
+		version = AO_load_full(&curr->version);
+		if (version & 1)
+			continue;
+		if (curr->marked)
+			goto restart;
+		next = curr->next;
+		if (next->min <= val) {
+			/* curr was split meanwhile */
+			curr = next;
+			unrolled_stat.nodes++;
+			continue;
+		}
+		i = unrolled_index(curr, val);
+		found = (i < curr->count && curr->keys[i] == val);
+		if (AO_load_full(&curr->version) == version) {
+			unrolled_stat.keys += i + 1;
+			return found;
+		}
+	}
+}
+
+int unrolled_insert(intset_u_t *set, val_t val) {
+	node_u_t *curr;
+	int i;
+
+	while (1) {
+		curr = unrolled_locate(set, val);
+		LOCK(&curr->lock);
+		if (!unrolled_validate(curr, val)) {
+			UNLOCK(&curr->lock);
+			continue;
+		}
+		i = unrolled_index(curr, val);
+		unrolled_stat.keys += i + 1;
+		if (i < curr->count && curr->keys[i] == val) {
+			UNLOCK(&curr->lock);
+			return 0;
+		}
+		unrolled_write_begin(curr);
+		unrolled_put(curr, i, val);
+		unrolled_write_end(curr);
+		UNLOCK(&curr->lock);
+		return 1;
+	}
+}
+
+/*
+ * The successor can only be unlinked by a thread holding the lock of
+ * curr, so it is still the successor once locked. Nodes are always 
+ * locked in list order.
+ */
+int unrolled_delete(intset_u_t *set, val_t val) {
+	node_u_t *curr, *next;
+	int i, j;
+
+	while (1) {
+		curr = unrolled_locate(set, val);
+		LOCK(&curr->lock);
+		if (!unrolled_validate(curr, val)) {
+			UNLOCK(&curr->lock);
+			continue;
+		}
+		i = unrolled_index(curr, val);
+		unrolled_stat.keys += i + 1;
+		if (i == curr->count || curr->keys[i] != val) {
+			UNLOCK(&curr->lock);
+			return 0;
+		}
+		unrolled_write_begin(curr);
+		unrolled_take(curr, i);
+		next = curr->next;
+		if (next->next != NULL &&
+			curr->count + next->count <= UNROLLED_MERGE) {
+			LOCK(&next->lock);
+			/* next may have grown before being locked */
+			if (curr->count + next->count <= UNROLLED_MERGE) {
+				unrolled_write_begin(next);
+				for (j = 0; j < next->count; j++)
+					curr->keys[curr->count + j] = next->keys[j];
+				curr->count += next->count;
+				next->marked = 1;
+				curr->next = next->next;
+				unrolled_write_end(next);
+			}
+			UNLOCK(&next->lock);
+		}
+		unrolled_write_end(curr);
+		UNLOCK(&curr->lock);
+		return 1;
+	}
+}
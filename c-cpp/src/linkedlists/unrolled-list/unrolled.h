@@ -0,0 +1,49 @@
+/*
+ * File:
+ *   unrolled.h
+ * Description:
+ *   Unrolled linked list implementation of an integer set. Updates lock 
+ *   the node of the key, split it when full and merge it with its 
+ *   successor when both become sparse. Lookups do not lock, they validate
+ *   their read of a node with its version.
+ *
+ * unrolled.h is part of Synchrobench
+ * 
+ * Synchrobench is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, version 2
+ * of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "linkedlist-lock.h"
+
+/* 
+ * Traversal statistics of the calling thread: the nodes visited and the 
+ * nodes a list with one key per node would have visited for the same 
+ * operations (the keys passed plus the node of the key).
+ */
+typedef struct unrolled_stat {
+  unsigned long nodes;
+  unsigned long keys;
+} unrolled_stat_t;
+
+extern __thread unrolled_stat_t unrolled_stat;
+
+/* node accesses, the writers hold the lock of the node */
+node_u_t *unrolled_locate(intset_u_t *set, val_t val);
+int unrolled_validate(node_u_t *node, val_t val);
+int unrolled_index(node_u_t *node, val_t val);
+void unrolled_write_begin(node_u_t *node);
+void unrolled_write_end(node_u_t *node);
+void unrolled_put(node_u_t *node, int i, val_t val);
+void unrolled_take(node_u_t *node, int i);
+
+/* linked list accesses */
+int unrolled_find(intset_u_t *set, val_t val);
+int unrolled_insert(intset_u_t *set, val_t val);
+int unrolled_delete(intset_u_t *set, val_t val);
@@ -25,6 +25,24 @@ int set_contains(intset_t *set, val_t val);
 int set_insert(intset_t *set, val_t val);
 int set_remove(intset_t *set, val_t val);
 
+// Bulk and range operations, they return the number of values inserted,
+// removed and counted. The values of set_insert_many are sorted.
+int set_insert_many(intset_t *set, val_t *vals, int n);
+int set_remove_range(intset_t *set, val_t lo, val_t hi);
+int set_count_range(intset_t *set, val_t lo, val_t hi);
+
+// Per-thread finger: searches start from the last predecessor found by the
+// thread when set_use_finger is set. The statistics count the searches,
+// those that started from the finger and the nodes they traversed.
+typedef struct finger_stat {
+    unsigned long searches;
+    unsigned long hits;
+    unsigned long nodes;
+} finger_stat_t;
+
+extern int set_use_finger;
+extern __thread finger_stat_t finger_stat;
+
 // Locked operations
 #ifdef MUTEX
 typedef pthread_mutex_t ptlock_t;
@@ -35,6 +35,7 @@
 
 #include "intset.h"
 #include "versioned-linkedlist.h"
+#include "../../utils/locks/elimination.h"
 
 #define DEFAULT_DURATION                10000
 #define DEFAULT_INITIAL                 256
@@ -48,6 +49,8 @@
 #define DEFAULT_LOCKTYPE                2
 #define DEFAULT_ALTERNATE               0
 #define DEFAULT_EFFECTIVE               1
+#define DEFAULT_BATCH                   1
+#define DEFAULT_ELIMINATION             0
 #define XSTR(s)                         STR(s)
 #define STR(s)                          #s
 
@@ -123,6 +126,10 @@ inline long rand_range_re(unsigned int *seed, long r) {
 }
 long rand_range_re(unsigned int *seed, long r);
 
+int compare_val(const void *a, const void *b) {
+    val_t x = *(const val_t *)a, y = *(const val_t *)b;
+    return (x > y) - (x < y);
+}
 
 typedef struct thread_data {
     val_t first;
@@ -134,12 +141,17 @@ typedef struct thread_data {
     int unit_tx;
     int alternate;
     int effective;
+    int batch;
     unsigned long nb_add;
     unsigned long nb_added;
     unsigned long nb_remove;
     unsigned long nb_removed;
     unsigned long nb_contains;
     unsigned long nb_found;
+    unsigned long nb_searches;
+    unsigned long nb_finger_hits;
+    unsigned long nb_visited;
+    unsigned long nb_eliminated;
     unsigned long nb_aborts;
     unsigned long nb_aborts_locked_read;
     unsigned long nb_aborts_locked_write;
@@ -151,6 +163,7 @@ typedef struct thread_data {
     unsigned long max_retries;
     unsigned int seed;
     intset_t *set;
+    elim_t *elim;
     barrier_t *barrier;
     unsigned long failures_because_contention;
 } thread_data_t;
@@ -171,6 +184,14 @@ void *test(void *data) {
     if (d.bias_enabled)
         last = d.bias_offset;
 
+    // Sorted values of the batched adds.
+    val_t *vals = malloc(d.batch * sizeof(val_t));
+    if (NULL == vals) {
+        perror("malloc");
+        exit(1);
+    }
+    int i, n;
+
     while (atomic_load(&stop) == 0) {
         // Is the next op an update?
         int do_update;
@@ -189,9 +210,32 @@ void *test(void *data) {
             last = (rand_range_re(&d.seed, 2) == 1) ? -1 : value;
         }
 
-        if (do_update && last < 0) {
+        if (do_update && d.batch > 1 && last < 0) {
+            // Add a sorted batch
+            vals[0] = value;
+            for (i = 1; i < d.batch; i++)
+                vals[i] = rand_range_re(&d.seed, d.range);
+            qsort(vals, d.batch, sizeof(val_t), compare_val);
+            n = set_insert_many(d.set, vals, d.batch);
+            if (n > 0) {
+                d.nb_added += n;
+                last = vals[0];
+            }
+            d.nb_add += d.batch;
+        } else if (do_update && d.batch > 1) {
+            // Remove a range of batch values
+            if (d.alternate)
+                value = last;
+            n = set_remove_range(d.set, value, value + d.batch - 1);
+            if (n > 0 || d.alternate) {
+                d.nb_removed += n;
+                last = -1;
+            }
+            d.nb_remove += d.batch;
+        } else if (do_update && last < 0) {
             // Add
-            if (set_insert(d.set, value)) {
+            if ((d.elim != NULL && elim_try(d.elim, ELIM_ADD, value)) ||
+                set_insert(d.set, value)) {
                 d.nb_added++;
                 last = value;
             }
@@ -201,11 +245,13 @@ void *test(void *data) {
 
             // If in alternate mode, remove the last item added.
             if (d.alternate) {
-                if (set_remove(d.set, last))
+                if ((d.elim != NULL && elim_try(d.elim, ELIM_REMOVE, last)) ||
+                    set_remove(d.set, last))
                     d.nb_removed++;
                 last = -1;
             } else {
-                if (set_remove(d.set, value)) {
+                if ((d.elim != NULL && elim_try(d.elim, ELIM_REMOVE, value)) ||
+                    set_remove(d.set, value)) {
                     d.nb_removed++;
                     last = -1;
                 }
@@ -225,12 +271,24 @@ void *test(void *data) {
                 }
             }
 
-            if (set_contains(d.set, value))
-                d.nb_found++;
-            d.nb_contains++;
+            if (d.batch > 1) {
+                // Count a range of batch values
+                d.nb_found += set_count_range(d.set, value, value + d.batch - 1);
+                d.nb_contains += d.batch;
+            } else {
+                if (set_contains(d.set, value))
+                    d.nb_found++;
+                d.nb_contains++;
+            }
         }
     }
 
+    d.nb_searches = finger_stat.searches;
+    d.nb_finger_hits = finger_stat.hits;
+    d.nb_visited = finger_stat.nodes;
+    d.nb_eliminated = elim_stats.eliminated;
+    free(vals);
+
     *(thread_data_t *)data = d;
 
     return NULL;
@@ -253,17 +311,22 @@ int main(int argc, char **argv) {
         {"bias-range",               required_argument, NULL, 'b'},
         {"bias-offset",               required_argument, NULL, 'u'},
         {"elasticity",                required_argument, NULL, 'x'},
+        {"finger",                    no_argument,       NULL, 'F'},
+        {"batch-size",                required_argument, NULL, 'g'},
+        {"elimination",               required_argument, NULL, 'E'},
         {NULL, 0, NULL, 0}
     };
 
     intset_t *set;
+    elim_t elim;
     int i, c, size;
     val_t last = 0;
     val_t val = 0;
     unsigned long reads, effreads, updates, effupds, aborts, aborts_locked_read,
     aborts_locked_write, aborts_validate_read, aborts_validate_write,
     aborts_validate_commit, aborts_invalid_memory, aborts_double_write,
-    max_retries, failures_because_contention;
+    max_retries, failures_because_contention, searches, finger_hits, visited,
+    eliminated;
     thread_data_t *data;
     pthread_t *threads;
     pthread_attr_t attr;
@@ -282,11 +345,13 @@ int main(int argc, char **argv) {
     int unit_tx = DEFAULT_ELASTICITY;
     int alternate = DEFAULT_ALTERNATE;
     int effective = DEFAULT_EFFECTIVE;
+    int batch = DEFAULT_BATCH;
+    int elimination = DEFAULT_ELIMINATION;
     sigset_t block_set;
 
     while(1) {
         i = 0;
-        c = getopt_long(argc, argv, "hAf:d:i:t:r:S:u:b:B:x:", long_options, &i);
+        c = getopt_long(argc, argv, "hAFf:d:i:t:r:S:u:b:B:x:g:E:", long_options, &i);
 
         if(c == -1)
             break;
@@ -310,6 +375,8 @@ int main(int argc, char **argv) {
                                  "        Print this message\n"
                                  "  -A, --alternate (default="XSTR(DEFAULT_ALTERNATE)")\n"
                                  "        Consecutive insert/remove target the same value\n"
+                                 "  -F, --finger\n"
+                                 "        Searches start from the last position of the thread\n"
                                  "  -f, --effective <int>\n"
                                  "        update txs must effectively write (0=trial, 1=effective, default=" XSTR(DEFAULT_EFFECTIVE) ")\n"
                                  "  -d, --duration <int>\n"
@@ -328,6 +395,11 @@ int main(int argc, char **argv) {
                                  "        If used, updates will take place in range [B, B+b)\n"
                                  "  -B, --bias-offset <int>\n"
                                  "        If used, updates will take place in range [B, B+b)\n"
+                                 "  -g, --batch-size <int>\n"
+                                 "        Values per update and read, adds insert a sorted batch of random values,\n"
+                                 "        removes and reads remove and count a range of values (default=" XSTR(DEFAULT_BATCH) ")\n"
+                                 "  -E, --elimination <int>\n"
+                                 "        Slots of the elimination layer of the single value updates (0=none, default=" XSTR(DEFAULT_ELIMINATION) ")\n"
                                  "  -x, --elasticity (default=4)\n"
                                  "        Use elastic transactions\n"
                                  "        0 = non-protected,\n"
@@ -342,6 +414,9 @@ int main(int argc, char **argv) {
                 case 'A':
                     alternate = 1;
                     break;
+                case 'F':
+                    set_use_finger = 1;
+                    break;
                 case 'f':
                     effective = atoi(optarg);
                     break;
@@ -372,6 +447,12 @@ int main(int argc, char **argv) {
                 case 'x':
                     unit_tx = atoi(optarg);
                     break;
+                case 'g':
+                    batch = atoi(optarg);
+                    break;
+                case 'E':
+                    elimination = atoi(optarg);
+                    break;
                 case '?':
                     printf("Use -h or --help for help\n");
                     exit(0);
@@ -385,6 +466,8 @@ int main(int argc, char **argv) {
     assert(nb_threads > 0);
     assert(range > 0 && range >= initial);
     assert(update >= 0 && update <= 100);
+    assert(batch > 0);
+    assert(elimination >= 0);
     if (bias_range != DEFAULT_BIAS_RANGE || bias_offset != DEFAULT_BIAS_OFFSET) {
         bias_enabled = 1;
         assert(bias_range >= 0);
@@ -392,6 +475,7 @@ int main(int argc, char **argv) {
     }
 
     printf("Bench type   : " ALGONAME "\n");
+    printf("Lock type    : " VERLOCK_NAME "\n");
     printf("Duration     : %d\n", duration);
     printf("Initial size : %d\n", initial);
     printf("Nb threads   : %d\n", nb_threads);
@@ -404,6 +488,9 @@ int main(int argc, char **argv) {
     printf("Elasticity   : %d\n", unit_tx);
     printf("Alternate    : %d\n", alternate);
     printf("Effective    : %d\n", effective);
+    printf("Finger       : %d\n", set_use_finger);
+    printf("Batch size   : %d\n", batch);
+    printf("Elimination  : %d\n", elimination);
     printf("Type sizes   : int=%d/long=%d/ptr=%d/word=%d/val_t=%d\n",
            (int)sizeof(int),
            (int)sizeof(long),
@@ -430,6 +517,8 @@ int main(int argc, char **argv) {
         srand(seed);
 
     set = set_new();
+    if (elimination > 0)
+        elim_init(&elim, elimination);
     atomic_store(&stop, 0);
 
     /* Init STM */
@@ -465,6 +554,7 @@ int main(int argc, char **argv) {
         data[i].unit_tx = unit_tx;
         data[i].alternate = alternate;
         data[i].effective = effective;
+        data[i].batch = batch;
         data[i].nb_add = 0;
         data[i].nb_added = 0;
         data[i].nb_remove = 0;
@@ -482,6 +572,7 @@ int main(int argc, char **argv) {
         data[i].max_retries = 0;
         data[i].seed = rand();
         data[i].set = set;
+        data[i].elim = (elimination > 0 ? &elim : NULL);
         data[i].barrier = &barrier;
         data[i].failures_because_contention = 0;
         if (pthread_create(&threads[i], &attr, test, (void *)(&data[i])) != 0) {
@@ -531,6 +622,10 @@ int main(int argc, char **argv) {
     updates = 0;
     effupds = 0;
     max_retries = 0;
+    searches = 0;
+    finger_hits = 0;
+    visited = 0;
+    eliminated = 0;
     for (i = 0; i < nb_threads; i++) {
         printf("Thread %d\n", i);
         printf("  #add        : %lu\n", data[i].nb_add);
@@ -565,6 +660,10 @@ int main(int argc, char **argv) {
         updates += (data[i].nb_add + data[i].nb_remove);
         effupds += data[i].nb_removed + data[i].nb_added;
         size += data[i].nb_added - data[i].nb_removed;
+        searches += data[i].nb_searches;
+        finger_hits += data[i].nb_finger_hits;
+        visited += data[i].nb_visited;
+        eliminated += data[i].nb_eliminated;
         if (max_retries < data[i].max_retries)
             max_retries = data[i].max_retries;
     }
@@ -601,9 +700,18 @@ int main(int argc, char **argv) {
     printf("  #dup-w      : %lu (%f / s)\n", aborts_double_write, aborts_double_write * 1000.0 / duration);
     printf("  #failures   : %lu\n",  failures_because_contention);
     printf("Max retries   : %lu\n", max_retries);
+    printf("#searches     : %lu\n", searches);
+    printf("  #from finger: %lu (%f %%)\n", finger_hits,
+           (searches ? 100.0 * finger_hits / searches : 0.0));
+    printf("  nodes/search: %f\n", (searches ? (double) visited / searches : 0.0));
+    if (elimination > 0)
+        printf("#eliminated   : %lu (%f %% of updates)\n", eliminated,
+               (updates ? 100.0 * eliminated / updates : 0.0));
 
     /* Delete set */
     set_delete(set);
+    if (elimination > 0)
+        elim_destroy(&elim);
 
     /* Cleanup STM */
     //TM_SHUTDOWN();
@@ -26,13 +26,43 @@
 /* common operations for set algorithms */
 #include "mixin.c"
 
+int set_use_finger = 0;
+__thread finger_stat_t finger_stat;
+
+/* last predecessor found by the thread, nodes are never freed */
+static __thread intset_t* finger_set = NULL;
+static __thread node_t* finger = NULL;
+
+/* start of a search: the finger if it precedes val and is not deleted */
+static node_t* search_start(intset_t *set, val_t val) {
+    node_t* start = finger;
+
+    finger_stat.searches++;
+    if (set_use_finger && start != NULL && finger_set == set &&
+        start->val < val && !start->deleted) {
+        finger_stat.hits++;
+        return start;
+    }
+
+    return set->head;
+}
+
+static inline void set_finger(intset_t *set, node_t* prev) {
+    finger_set = set;
+    finger = prev;
+}
+
 /* wait-free contains */
 int set_contains(intset_t *set, val_t val) {
-    node_t* curr = set->head;
+    node_t* prev = search_start(set, val);
+    node_t* curr = prev;
 
     while (curr->val < val) {
+        prev = curr;
         curr = curr->next;
+        finger_stat.nodes++;
     }
+    set_finger(set, prev);
 
     /* if value is present and not logically deleted */
     return (curr->val == val && !curr->deleted);
@@ -72,6 +102,7 @@ static void traverse(val_t val, node_t** prev, node_t** curr, node_t* start) {
     while ((*curr)->val < val) {
         *prev = *curr;
         *curr = (*curr)->next;
+        finger_stat.nodes++;
     }
 
 }
@@ -84,7 +115,7 @@ int set_insert(intset_t *set, val_t val){
 
 /* full abort: restart from traversal */
 restart_from_traverse:
-    traverse(val, &prev, &curr, set->head);
+    traverse(val, &prev, &curr, search_start(set, val));
 
 /* partial abort: restart from validate */
 restart_from_validate:
@@ -100,6 +131,8 @@ restart_from_validate:
         goto restart_from_traverse;
     }
 
+    set_finger(set, prev);
+
     /* value already exists in the set */
     if (curr->val == val) {
         return false;
@@ -134,7 +167,7 @@ int set_remove(intset_t *set, val_t val) {
 
 /* full abort: restart from traversal */
 restart_from_traverse:
-    traverse(val, &prev, &curr, set->head);
+    traverse(val, &prev, &curr, search_start(set, val));
 
 /* partial abort: restart from validate */
 restart_from_validate:
@@ -145,6 +178,8 @@ restart_from_validate:
         goto restart_from_traverse;
     }
 
+    set_finger(set, prev);
+
     /* if value is not present or is logically deleted */
     if (curr->val != val || curr->deleted) {
         return false;
@@ -170,3 +205,155 @@ restart_from_validate:
 
     return true;
 }
+
+/* frees a run of nodes that was not linked to the list */
+static void free_run(node_t* first, node_t* last) {
+    node_t* next;
+
+    while (first != last) {
+        next = first->next;
+        free(first);
+        first = next;
+    }
+    free(last);
+}
+
+/*
+ * The values lower than curr are linked together before locking prev and
+ * spliced in with a single write, each run is thus inserted atomically.
+ * The traversal for the next run resumes from the end of the previous.
+ */
+int set_insert_many(intset_t *set, val_t *vals, int n) {
+    node_t* prev = set->head;
+    node_t* curr = NULL;
+    node_t* first;
+    node_t* last;
+    verlock_t prev_version;
+    int i = 0, j, k, added = 0;
+
+    while (i < n) {
+        traverse(vals[i], &prev, &curr, prev);
+
+restart_from_validate:
+        if (!validate(vals[i], &prev, &curr, &prev_version) || curr->deleted) {
+            /* restart from the head */
+            prev = set->head;
+            continue;
+        }
+
+        set_finger(set, prev);
+
+        /* value already exists in the set */
+        if (curr->val == vals[i]) {
+            i++;
+            continue;
+        }
+
+        /* pre-allocate the run, pre-linked to curr */
+        first = last = NULL;
+        for (j = i, k = 0; j < n && vals[j] < curr->val; j++) {
+            if (last != NULL && last->val == vals[j])
+                continue;
+            if (last == NULL)
+                first = last = new_node(vals[j], curr);
+            else
+                last = last->next = new_node(vals[j], curr);
+            k++;
+        }
+
+        if (!try_lock_at_version(&prev->lock, prev_version)) {
+            free_run(first, last);
+            goto restart_from_validate;
+        }
+
+        prev->next = first;
+
+        unlock_and_increment_version(&prev->lock);
+
+        added += k;
+        i = j;
+        prev = last;
+    }
+
+    return added;
+}
+
+/*
+ * The predecessor of the range and the nodes of the range are locked in
+ * list order: no other update can interleave with the removal, a lookup
+ * may still find a value of the range before it is logically deleted.
+ */
+int set_remove_range(intset_t *set, val_t lo, val_t hi) {
+    node_t* prev = NULL;
+    node_t* curr = NULL;
+    node_t* next;
+    verlock_t prev_version;
+    int removed = 0;
+
+/* full abort: restart from traversal */
+restart_from_traverse:
+    traverse(lo, &prev, &curr, search_start(set, lo));
+
+/* partial abort: restart from validate */
+restart_from_validate:
+    if (!validate(lo, &prev, &curr, &prev_version)) {
+        goto restart_from_traverse;
+    }
+
+    set_finger(set, prev);
+
+    /* curr is being removed, wait for it to be unlinked */
+    if (curr->deleted) {
+        goto restart_from_traverse;
+    }
+
+    /* no value in range */
+    if (curr->next == NULL || curr->val > hi) {
+        return 0;
+    }
+
+    if (!try_lock_at_version(&prev->lock, prev_version)) {
+        goto restart_from_validate;
+    }
+
+    /* a locked node cannot be removed nor get a new successor */
+    for (next = curr; next->next != NULL && next->val <= hi; next = next->next) {
+        spinlock(&next->lock);
+        next->deleted = true;
+        removed++;
+    }
+
+    prev->next = next;
+    unlock_and_increment_version(&prev->lock);
+
+    while (curr != next) {
+        prev = curr;
+        curr = curr->next;
+        unlock_and_increment_version(&prev->lock);
+    }
+
+    return removed;
+}
+
+/* wait-free, each node is counted if it was present when traversed */
+int set_count_range(intset_t *set, val_t lo, val_t hi) {
+    node_t* prev = search_start(set, lo);
+    node_t* curr = prev;
+    int count = 0;
+
+    while (curr->val < lo) {
+        prev = curr;
+        curr = curr->next;
+        finger_stat.nodes++;
+    }
+    set_finger(set, prev);
+
+    while (curr->next != NULL && curr->val <= hi) {
+        if (!curr->deleted)
+            count++;
+        curr = curr->next;
+        finger_stat.nodes++;
+    }
+
+    return count;
+}
@@ -32,7 +32,7 @@ struct node {
   val_t val;
   struct node* next;
   int deleted;
-  _Atomic(verlock_t) lock;
+  versioned_lock_t lock;
 };
 
 struct intset {
@@ -0,0 +1,301 @@
+/*
+ * background.c: background maintenance of the B-skiplist
+ *
+ */
+
+/*
+
+Module Overview
+
+As in the no hot spot skip list, a single background thread carries out
+all the modifications of the index levels and the physical removals
+from the node level, so that worker threads do not contend on the
+index. Each pass of the thread:
+> traverses the node level, swinging the next pointer of the predecessor
+  of each frozen node to the copy of the node and freezing the empty
+  nodes (except the first one) so that they are removed the same way,
+> collects the lo key of each remaining node,
+> builds new index levels from these keys, packing INODE_KEYS keys per
+  index node, and publishes them by swapping the top of the index,
+> frees the former index nodes and the nodes it unlinked.
+
+The index being rebuilt at each pass from the nodes linked at this
+time, a node unlinked during a pass is not referenced by the new index
+levels: it is freed with the former index levels, once no operation can
+hold a reference to it.
+
+*/
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "background.h"
+#include "skiplist.h"
+#include "garbagecoll.h"
+#include "ptst.h"
+#include "common.h"
+
+/* - Private variables - */
+
+static set_t *set;	        /* the set to maintain */
+static pthread_t bg_thread;	/* background thread */
+
+static int bg_finished;
+static int bg_running;
+static int bg_sleep_time;
+
+/* the nodes collected by the pass, also used to backtrack */
+static node_t **bg_nodes;
+static int bg_nb_nodes;
+static int bg_max_nodes;
+
+/* the nodes unlinked by the pass */
+static node_t **bg_unlinked;
+static int bg_nb_unlinked;
+static int bg_max_unlinked;
+
+static struct bg_stats {
+        unsigned long passes;
+        unsigned long unlinked;
+        unsigned long removed;
+        unsigned long keys;     /* keys and nodes found by the last pass */
+        unsigned long nodes;
+        unsigned long inodes;
+} bg_stats;
+
+/* - Private function declarations - */
+
+static void* bg_loop(void *args);
+static void bg_pass(ptst_t *ptst);
+static void bg_push(node_t ***array, int *nb, int *max, node_t *node);
+static inode_t* bg_build(ptst_t *ptst);
+static void bg_free_index(inode_t *inode, ptst_t *ptst);
+
+/* - Private function definitions - */
+
+/**
+ * bg_loop - loop for maintaining background skiplist
+ * @args: void* args as per pthread_create (not used)
+ *
+ * Returns a void* value as per pthread_create requirements.
+ */
+static void* bg_loop(void *args)
+{
+        struct sl_ptst *ptst;
+
+        assert(NULL != set);
+
+        while (1) {
+                if (bg_finished)
+                        break;
+
+                usleep(bg_sleep_time);
+
+                #ifdef USE_GC
+                ptst = ptst_critical_enter();
+                #endif
+
+                bg_pass(ptst);
+
+                #ifdef USE_GC
+                ptst_critical_exit(ptst);
+                #endif
+        }
+
+        return NULL;
+}
+
+/**
+ * bg_push - append a node to an array of nodes, growing it as needed
+ */
+static void bg_push(node_t ***array, int *nb, int *max, node_t *node)
+{
+        if (*nb == *max) {
+                *max = *max ? 2 * *max : 1024;
+                *array = realloc(*array, *max * sizeof(node_t*));
+                if (NULL == *array) {
+                        perror("malloc");
+                        exit(1);
+                }
+        }
+        (*array)[(*nb)++] = node;
+}
+
+/**
+ * bg_pass - traverse the node level and rebuild the index levels
+ * @ptst: per-thread state
+ *
+ * Note: the link is the next pointer of the last collected node (the
+ * head of the set at first). When this node was frozen meanwhile, its
+ * link is tagged: the pass drops it from the collected nodes and goes
+ * back to the link of the previous one, so as to swing it.
+ */
+static void bg_pass(ptst_t *ptst)
+{
+        node_t **link = (node_t**) &set->head;
+        node_t *node, *next;
+        inode_t *top, *old;
+        unsigned long keys = 0;
+        int i;
+
+        bg_nb_nodes = 0;
+        bg_nb_unlinked = 0;
+
+        while (1) {
+                node = *link;
+                if (is_frozen(node)) {
+                        keys -= bg_nodes[--bg_nb_nodes]->nb_keys;
+                        link = (0 == bg_nb_nodes) ? (node_t**) &set->head :
+                                (node_t**) &bg_nodes[bg_nb_nodes - 1]->next;
+                        continue;
+                }
+                if (NULL == node)
+                        break;
+                next = node->next;
+                if (is_frozen(next)) {
+                        if (CAS(link, node, get_unfrozen(next)))
+                                bg_push(&bg_unlinked, &bg_nb_unlinked,
+                                        &bg_max_unlinked, node);
+                        continue;
+                }
+                if (0 == node->nb_keys && 0 != bg_nb_nodes) {
+                        /* remove the empty node, its range goes to its pred */
+                        if (CAS(&node->next, next, get_frozen(next)))
+                                bg_stats.removed++;
+                        continue;
+                }
+                bg_push(&bg_nodes, &bg_nb_nodes, &bg_max_nodes, node);
+                keys += node->nb_keys;
+                link = (node_t**) &node->next;
+        }
+
+        top = bg_build(ptst);
+        old = set->top;
+        BARRIER();
+        set->top = top;
+        if (NULL != old)
+                bg_free_index(old, ptst);
+        for (i = 0; i < bg_nb_unlinked; i++)
+                node_delete(bg_unlinked[i], ptst);
+
+        bg_stats.passes++;
+        bg_stats.unlinked += bg_nb_unlinked;
+        bg_stats.keys = keys;
+        bg_stats.nodes = bg_nb_nodes;
+}
+
+/**
+ * bg_build - build the index levels over the collected nodes
+ * @ptst: per-thread state
+ *
+ * Returns the top index node. Each index level packs INODE_KEYS children
+ * per index node, the index nodes of a level are built in place of the
+ * children they cover in the array of collected nodes.
+ */
+static inode_t* bg_build(ptst_t *ptst)
+{
+        void **child = (void**) bg_nodes;
+        inode_t *inode;
+        int nb = bg_nb_nodes, level = 0, i, j;
+        sl_key_t key;
+
+        bg_stats.inodes = 0;
+        do {
+                for (i = 0, j = 0; i < nb; i++) {
+                        if (0 == i % INODE_KEYS) {
+                                inode = inode_new(level, ptst);
+                                bg_stats.inodes++;
+                        }
+                        key = (0 == level) ? ((node_t*) child[i])->lo :
+                                ((inode_t*) child[i])->keys[0];
+                        inode->keys[inode->nb_keys] = key;
+                        inode->child[inode->nb_keys++] = child[i];
+                        if (INODE_KEYS == inode->nb_keys || i == nb - 1)
+                                child[j++] = (void*) inode;
+                }
+                nb = j;
+                level++;
+        } while (nb > 1);
+        set->levels = level;
+
+        return (inode_t*) child[0];
+}
+
+/**
+ * bg_free_index - free the index nodes of a former index
+ * @inode: the top of the former index
+ * @ptst: per-thread state
+ */
+static void bg_free_index(inode_t *inode, ptst_t *ptst)
+{
+        int i;
+
+        if (inode->level > 0)
+                for (i = 0; i < inode->nb_keys; i++)
+                        bg_free_index((inode_t*) inode->child[i], ptst);
+        inode_delete(inode, ptst);
+}
+
+/* - Public Background Interface - */
+
+/**
+ * bg_init - initialise the background module
+ * @s: the set to maintain
+ */
+void bg_init(set_t *s)
+{
+        set = s;
+        bg_finished = 0;
+        bg_running = 0;
+        memset(&bg_stats, 0, sizeof(bg_stats));
+}
+
+/**
+ * bg_start - start the background thread
+ * @sleep_time: the time to sleep the bg thread per iteration
+ *
+ * Note: Only starts the background thread if it is not currently
+ * running.
+ */
+void bg_start(int sleep_time)
+{
+        if (!bg_running) {
+                bg_running = 1;
+                bg_finished = 0;
+                bg_sleep_time = sleep_time;
+                pthread_create(&bg_thread, NULL, bg_loop, NULL);
+        }
+}
+
+/**
+ * bg_stop - stop the background thread
+ */
+void bg_stop(void)
+{
+        if (bg_running) {
+                bg_finished = 1;
+                pthread_join(bg_thread, NULL);
+                BARRIER();
+                bg_running = 0;
+        }
+}
+
+/**
+ * bg_print_stats - print background statistics
+ */
+void bg_print_stats(void)
+{
+        printf("#bg passes    : %lu\n", bg_stats.passes);
+        printf("  #unlinked   : %lu (%lu empty nodes removed)\n",
+               bg_stats.unlinked, bg_stats.removed);
+        printf("#nodes        : %lu (%d keys, %d bytes, %f keys / node)\n",
+               bg_stats.nodes, NODE_KEYS, (int) sizeof(node_t),
+               bg_stats.nodes ? (double) bg_stats.keys / bg_stats.nodes : 0.0);
+        printf("#index nodes  : %lu (%d keys, %d bytes, %d levels)\n",
+               bg_stats.inodes, INODE_KEYS, (int) sizeof(inode_t),
+               set->levels);
+}
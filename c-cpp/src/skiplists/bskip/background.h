@@ -0,0 +1,15 @@
+/*
+ * This is the interface for the background thread functions.
+ */
+#ifndef BACKGROUND_H_
+#define BACKGROUND_H_
+
+#include "skiplist.h"
+#include "ptst.h"
+
+void bg_init(set_t *s);
+void bg_start(int sleep_time);
+void bg_stop(void);
+void bg_print_stats(void);
+
+#endif /* BACKGROUND_H_ */
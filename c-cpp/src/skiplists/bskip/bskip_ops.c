@@ -0,0 +1,313 @@
+/*
+ * bskip_ops.c: contains/insert/delete B-skiplist operations
+ *
+ */
+
+/*
+
+Module Overview
+
+This module provides the three basic skip list operations:
+> insert(key)
+> contains(key)
+> delete(key)
+
+All operations first find the entry node of their key in the index
+levels, the node of the lowest index level with the greatest lo key
+less than or equal to the search key, and then use the private function
+sl_locate() to walk the node level from there to the node holding the
+range of the key, i.e. the last node whose lo key is less than or equal
+to the search key.
+
+The nodes are immutable, except for their next pointer. An insert or a
+delete builds a copy of the node with the key added or removed (two
+halves if the node is full) pointing to the next node, and freezes the
+node with a CAS of its next pointer to the tagged pointer to the copy:
+the CAS is the linearisation point of the update, and fails if the node
+was frozen by a concurrent update, in which case the update starts again.
+The frozen node stays in the list until the background thread swings the
+next pointer of its predecessor to its copy, meanwhile the operations
+reaching it continue with its copy.
+
+A node left empty by a delete is only removed by the background thread,
+by freezing it with its own next node as copy: its range then belongs to
+its predecessor. An operation reaching a removed node from its
+predecessor goes back to the predecessor, an operation starting from a
+removed node (an index entry older than the removal) starts again from
+the first node.
+
+*/
+
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <atomic_ops.h>
+
+#include "common.h"
+#include "skiplist.h"
+#include "bskip_ops.h"
+#include "background.h"
+#include "garbagecoll.h"
+#include "ptst.h"
+
+/* - Private Functions - */
+
+static __thread struct sl_path_stats {
+        unsigned long ops;
+        unsigned long inodes;
+        unsigned long nodes;
+        unsigned long restarts;
+} sl_stats;
+
+/**
+ * sl_resolve - skip the frozen nodes
+ * @node: the node to start from (can be NULL)
+ *
+ * Returns the first node that is not frozen, following the copies of
+ * the frozen nodes, or NULL if the nodes replacing the last node were
+ * removed.
+ */
+static node_t* sl_resolve(node_t *node)
+{
+        node_t *next;
+
+        while (NULL != node) {
+                next = node->next;
+                if (!is_frozen(next))
+                        break;
+                node = get_unfrozen(next);
+        }
+
+        return node;
+}
+
+/**
+ * sl_entry - find the entry node of a key in the index levels
+ * @set: the skip list set
+ * @key: the search key
+ *
+ * Returns the node of the lowest index level with the greatest lo key
+ * less than or equal to @key, or the first node if there is no index.
+ */
+static node_t* sl_entry(set_t *set, sl_key_t key)
+{
+        inode_t *inode = set->top;
+        int i;
+
+        if (NULL == inode || inode->keys[0] > key)
+                return set->head;
+        while (1) {
+                sl_stats.inodes++;
+                for (i = 1; i < inode->nb_keys && inode->keys[i] <= key; i++)
+                        ;
+                if (0 == inode->level)
+                        return (node_t*) inode->child[i - 1];
+                inode = (inode_t*) inode->child[i - 1];
+        }
+}
+
+/**
+ * sl_locate - find the node holding the range of a key
+ * @set: the skip list set
+ * @key: the search key
+ * @next: the next pointer of the returned node
+ *
+ * Returns a node that was not frozen when its next pointer @next was
+ * read, with a lo key less than or equal to @key, and whose next node,
+ * skipping the frozen nodes, had a lo key greater than @key.
+ */
+static node_t* sl_locate(set_t *set, sl_key_t key, node_t **next)
+{
+        node_t *prev = NULL, *node, *succ, *nx;
+
+        node = sl_resolve(sl_entry(set, key));
+        if (NULL == node || node->lo > key) {
+                sl_stats.restarts++;
+                node = sl_resolve(set->head);
+        }
+        while (1) {
+                sl_stats.nodes++;
+                nx = node->next;
+                if (is_frozen(nx)) {
+                        /* continue from the copy of the node */
+                        succ = sl_resolve(get_unfrozen(nx));
+                        if (NULL == succ || succ->lo > key) {
+                                /* the node was removed */
+                                if (NULL != prev) {
+                                        node = prev;
+                                        prev = NULL;
+                                } else {
+                                        sl_stats.restarts++;
+                                        node = sl_resolve(set->head);
+                                }
+                        } else {
+                                node = succ;
+                        }
+                        continue;
+                }
+                succ = sl_resolve(nx);
+                if (NULL == succ || succ->lo > key)
+                        break;
+                prev = node;
+                node = succ;
+        }
+        *next = nx;
+
+        return node;
+}
+
+/**
+ * sl_find - find the position of a key in a node
+ * @node: the node
+ * @key: the search key
+ * @found: set to 1 if @key is in @node, to 0 otherwise
+ *
+ * Returns the index of the first key of @node greater than or equal to
+ * @key.
+ */
+static int sl_find(node_t *node, sl_key_t key, int *found)
+{
+        int i;
+
+        for (i = 0; i < node->nb_keys && node->keys[i] < key; i++)
+                ;
+        *found = (i < node->nb_keys && node->keys[i] == key);
+
+        return i;
+}
+
+/**
+ * sl_copy_insert - build the copy of a node with a key added
+ * @node: the node
+ * @next: the next pointer of the copy
+ * @key: the key to add
+ * @pos: the position of @key in @node
+ * @ptst: per-thread state
+ *
+ * Returns the copy, or the first of its two halves (the second one being
+ * its next node) if @node is full.
+ */
+static node_t* sl_copy_insert(node_t *node, node_t *next, sl_key_t key,
+                              int pos, ptst_t *ptst)
+{
+        sl_key_t keys[NODE_KEYS + 1];
+        node_t *first, *second;
+        int nb = node->nb_keys, half;
+
+        memcpy(keys, (sl_key_t*) node->keys, pos * sizeof(sl_key_t));
+        keys[pos] = key;
+        memcpy(keys + pos + 1, (sl_key_t*) node->keys + pos,
+               (nb - pos) * sizeof(sl_key_t));
+        nb++;
+
+        if (nb <= NODE_KEYS) {
+                first = node_new(node->lo, next, ptst);
+                memcpy((sl_key_t*) first->keys, keys, nb * sizeof(sl_key_t));
+                first->nb_keys = nb;
+                return first;
+        }
+
+        half = nb / 2;
+        second = node_new(keys[half], next, ptst);
+        memcpy((sl_key_t*) second->keys, keys + half,
+               (nb - half) * sizeof(sl_key_t));
+        second->nb_keys = nb - half;
+        first = node_new(node->lo, second, ptst);
+        memcpy((sl_key_t*) first->keys, keys, half * sizeof(sl_key_t));
+        first->nb_keys = half;
+
+        return first;
+}
+
+/**
+ * sl_copy_delete - build the copy of a node with a key removed
+ * @node: the node
+ * @next: the next pointer of the copy
+ * @pos: the position of the key to remove in @node
+ * @ptst: per-thread state
+ */
+static node_t* sl_copy_delete(node_t *node, node_t *next, int pos,
+                              ptst_t *ptst)
+{
+        node_t *copy;
+        int nb = node->nb_keys;
+
+        copy = node_new(node->lo, next, ptst);
+        memcpy((sl_key_t*) copy->keys, (sl_key_t*) node->keys,
+               pos * sizeof(sl_key_t));
+        memcpy((sl_key_t*) copy->keys + pos, (sl_key_t*) node->keys + pos + 1,
+               (nb - pos - 1) * sizeof(sl_key_t));
+        copy->nb_keys = nb - 1;
+
+        return copy;
+}
+
+/* - The public bskip_ops interface - */
+
+/**
+ * sl_do_operation - perform an operation on the set
+ * @set: the skip list set
+ * @optype: the type of operation this is
+ * @key: the search key
+ *
+ * Returns the result of the operation: 1 if the key was found (contains)
+ * or the set was modified (insert and delete), 0 otherwise.
+ */
+int sl_do_operation(set_t *set, sl_optype_t optype, sl_key_t key)
+{
+        node_t *node, *next, *copy, *second;
+        int pos, found, result = 0;
+        ptst_t *ptst;
+
+        assert(NULL != set);
+
+#ifdef USE_GC
+        ptst = ptst_critical_enter();
+#endif
+
+        sl_stats.ops++;
+        while (1) {
+                node = sl_locate(set, key, &next);
+                pos = sl_find(node, key, &found);
+                if (CONTAINS == optype) {
+                        result = found;
+                        break;
+                }
+                if ((INSERT == optype) == found) {
+                        result = 0;
+                        break;
+                }
+                if (INSERT == optype)
+                        copy = sl_copy_insert(node, next, key, pos, ptst);
+                else
+                        copy = sl_copy_delete(node, next, pos, ptst);
+                if (CAS(&node->next, next, get_frozen(copy))) {
+                        result = 1;
+                        break;
+                }
+                /* the node was frozen by another update */
+                if (copy->next != next) {
+                        second = copy->next;
+                        node_delete(second, ptst);
+                }
+                node_delete(copy, ptst);
+        }
+
+#ifdef USE_GC
+        ptst_critical_exit(ptst);
+#endif
+
+        return result;
+}
+
+/**
+ * sl_path_stats - statistics of the searches of the calling thread
+ */
+void sl_path_stats(unsigned long *ops, unsigned long *inodes,
+                   unsigned long *nodes, unsigned long *restarts)
+{
+        *ops      = sl_stats.ops;
+        *inodes   = sl_stats.inodes;
+        *nodes    = sl_stats.nodes;
+        *restarts = sl_stats.restarts;
+}
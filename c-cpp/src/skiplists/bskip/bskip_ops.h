@@ -0,0 +1,30 @@
+/*
+ * Interface for the B-skiplist operations.
+ */
+#ifndef BSKIP_OPS_H_
+#define BSKIP_OPS_H_
+
+#include "skiplist.h"
+
+typedef enum sl_optype sl_optype_t;
+enum sl_optype {
+        CONTAINS,
+        DELETE,
+        INSERT
+};
+
+int sl_do_operation(set_t *set, sl_optype_t optype, sl_key_t key);
+
+/*
+ * sl_path_stats returns the number of operations of the calling thread,
+ * the index nodes and nodes they went through and the number of
+ * searches restarted from the first node.
+ */
+void sl_path_stats(unsigned long *ops, unsigned long *inodes,
+                   unsigned long *nodes, unsigned long *restarts);
+
+#define sl_contains(a, b) sl_do_operation((a), CONTAINS, (b));
+#define sl_delete(a, b) sl_do_operation((a), DELETE, (b));
+#define sl_insert(a, b) sl_do_operation((a), INSERT, (b));
+
+#endif /* BSKIP_OPS_H_ */
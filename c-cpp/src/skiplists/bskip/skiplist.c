@@ -0,0 +1,215 @@
+/*
+ * skiplist.c: definitions of the B-skiplist data stucture
+ *
+ */
+
+/*
+
+Module overview
+
+This module provides the basic structures used to create a
+cache-conscious skip list in the manner of the B-skiplist: instead of
+one key per node and one node per index item, the nodes of each level
+pack many sorted keys in a few cache lines, so that a search takes
+a logarithmic number of cache misses of a much larger base.
+
+The node level is a lock-free list of immutable nodes, each holding the
+keys of a range starting at its lo key. An update replaces the node of
+its key by a modified copy, or by two halves when it is full, with a
+single CAS freezing the next pointer of the node (see bskip_ops.c).
+The index levels are built by a background thread from the node level
+and swapped in at once (see background.c), as the index of the
+no hot spot skip list is maintained by its background thread.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "common.h"
+#include "skiplist.h"
+#include "background.h"
+#include "garbagecoll.h"
+#include "ptst.h"
+
+static int gc_id[NUM_LEVELS];
+
+/* - Public skiplist interface - */
+
+/**
+ * node_new - create a new node with no keys
+ * @lo: the lowest key of the range of the node
+ * @next: the next node pointer for the new node
+ * @ptst: the per-thread state
+ */
+node_t* node_new(sl_key_t lo, node_t *next, ptst_t *ptst)
+{
+        node_t *node;
+
+        node = gc_alloc(ptst, gc_id[NODE_LEVEL]);
+
+        node->lo      = lo;
+        node->next    = next;
+        node->nb_keys = 0;
+
+        return node;
+}
+
+/**
+ * inode_new - create a new index node with no keys
+ * @level: the index level of the new inode (0 above the nodes)
+ * @ptst: per-thread state
+ */
+inode_t* inode_new(unsigned int level, ptst_t *ptst)
+{
+        inode_t *inode;
+
+        inode = gc_alloc(ptst, gc_id[INODE_LEVEL]);
+
+        inode->level   = level;
+        inode->nb_keys = 0;
+
+        return inode;
+}
+
+/**
+ * node_delete - delete a node
+ * @node: the node to delete
+ */
+void node_delete(node_t *node, ptst_t *ptst)
+{
+        gc_free(ptst, (void*)node, gc_id[NODE_LEVEL]);
+}
+
+/**
+ * inode_delete - delete an index node
+ * @inode: the index node to delete
+ */
+void inode_delete(inode_t *inode, ptst_t *ptst)
+{
+        gc_free(ptst, (void*)inode, gc_id[INODE_LEVEL]);
+}
+
+/**
+ * set_new - create a new set implemented as a B-skiplist
+ * @bg_start: if 1 start the bg thread, otherwise don't
+ *
+ * Returns a newly created skip list set, with a first node for the
+ * range of all keys and no index.
+ */
+set_t* set_new(int start)
+{
+        set_t *set;
+        ptst_t *ptst;
+
+        set = malloc(sizeof(set_t));
+        if (!set) {
+                perror("Failed to malloc a set\n");
+                exit(1);
+        }
+
+        ptst = ptst_critical_enter();
+        set->head = node_new(0, NULL, ptst);
+        ptst_critical_exit(ptst);
+
+        set->top = NULL;
+        set->levels = 0;
+
+        bg_init(set);
+        if (start)
+                bg_start(0);
+
+        return set;
+}
+
+/**
+ * set_delete - delete the set
+ * @set: the set to delete
+ */
+void set_delete(set_t *set)
+{
+        /* stop the background thread */
+        bg_stop();
+
+        /* warning - we are not deallocating the memory for the skip list */
+}
+
+/**
+ * set_print - print the set
+ * @set: the skip list set to print
+ * @flag: if non-zero print the keys
+ *
+ * Note: checks the order of the keys, must not run concurrently with
+ * updates.
+ */
+void set_print(set_t *set, int flag)
+{
+        node_t *node = set->head;
+        int i, num_nodes = 0, num_frozen = 0, num_elements = 0;
+
+        printf("There were %d index levels\n", set->levels);
+
+        while (NULL != node) {
+                if (is_frozen(node->next)) {
+                        /* frozen nodes are only followed to their copies */
+                        num_frozen++;
+                        node = get_unfrozen(node->next);
+                        continue;
+                }
+                for (i = 0; i < node->nb_keys; i++) {
+                        if (flag)
+                                printf("%lu ", node->keys[i]);
+                        if (node->keys[i] < node->lo ||
+                            (i > 0 && node->keys[i - 1] >= node->keys[i]) ||
+                            (NULL != node->next &&
+                             node->keys[i] >= node->next->lo))
+                                printf("\nError: key %lu out of order in node %lu\n",
+                                       node->keys[i], node->lo);
+                }
+                num_nodes++;
+                num_elements += node->nb_keys;
+                node = node->next;
+        }
+        if (flag)
+                printf("\n");
+        printf("There were %d nodes (%d frozen) representing %d logical elements\n",
+               num_nodes, num_frozen, num_elements);
+}
+
+/**
+ * set_size - print the size of the set
+ * @set: the set to print the size of
+ * @flag: if zero count the nodes instead of the keys
+ *
+ * Return the size of the set.
+ */
+int set_size(set_t *set, int flag)
+{
+        node_t *node = set->head;
+        int size = 0;
+
+        while (NULL != node) {
+                if (is_frozen(node->next)) {
+                        node = get_unfrozen(node->next);
+                        continue;
+                }
+                size += flag ? node->nb_keys : 1;
+                node = node->next;
+        }
+
+        return size;
+}
+
+/**
+ * set_subsystem_init - initialise the set subsystem
+ *
+ * Note: the sizes are rounded to whole cache lines, the chunks of the
+ * garbage collector being line aligned the nodes do not straddle lines.
+ */
+void set_subsystem_init(void)
+{
+        gc_id[NODE_LEVEL]  = gc_add_allocator((sizeof(node_t) +
+                CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1));
+        gc_id[INODE_LEVEL] = gc_add_allocator((sizeof(inode_t) +
+                CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1));
+}
@@ -0,0 +1,81 @@
+/*
+ * skiplist.h: definitions of the B-skiplist data structure
+ *
+ * The node level is a linked list of nodes packing up to NODE_KEYS
+ * sorted keys each, and the index levels are nodes packing up to
+ * INODE_KEYS sorted keys with the node or index node of the level below
+ * each of them leads to.
+ */
+
+#ifndef SKIPLIST_H_
+#define SKIPLIST_H_
+
+#include <atomic_ops.h>
+
+#include "common.h"
+#include "ptst.h"
+#include "garbagecoll.h"
+
+#define NUM_LEVELS 2
+#define NODE_LEVEL 0
+#define INODE_LEVEL 1
+
+/* a node takes two cache lines, an index node four */
+#define NODE_KEYS 13
+#define INODE_KEYS 15
+
+typedef unsigned long sl_key_t;
+
+/*
+ * A node holds the keys of [lo, lo of the next node), its keys never
+ * change once it is linked. An update freezes the node by replacing its
+ * next pointer by the tagged pointer to the nodes replacing it (the last
+ * of which points to the former next node), or to the next node itself
+ * if the node is removed.
+ */
+typedef VOLATILE struct sl_node node_t;
+struct sl_node {
+        sl_key_t lo;
+        struct sl_node *next;
+        unsigned int nb_keys;
+        sl_key_t keys[NODE_KEYS];
+};
+
+#define is_frozen(_p)      (((unsigned long)(_p)) & 1)
+#define get_frozen(_p)     ((node_t*)(((unsigned long)(_p)) | 1))
+#define get_unfrozen(_p)   ((node_t*)(((unsigned long)(_p)) & ~1UL))
+
+/*
+ * An index node is immutable: the background thread rebuilds the index
+ * levels and publishes them at once. At the lowest index level, the
+ * children are nodes.
+ */
+typedef VOLATILE struct sl_inode inode_t;
+struct sl_inode {
+        unsigned int level;
+        unsigned int nb_keys;
+        sl_key_t keys[INODE_KEYS];
+        void *child[INODE_KEYS];
+};
+
+typedef VOLATILE struct sl_set set_t;
+struct sl_set {
+        inode_t *top;
+        node_t  *head;
+        int levels;
+};
+
+node_t* node_new(sl_key_t lo, node_t *next, ptst_t *ptst);
+inode_t* inode_new(unsigned int level, ptst_t *ptst);
+
+void node_delete(node_t *node, ptst_t *ptst);
+void inode_delete(inode_t *inode, ptst_t *ptst);
+
+set_t* set_new(int bg_start);
+void set_delete(set_t *set);
+void set_print(set_t *set, int flag);
+int set_size(set_t *set, int flag);
+
+void set_subsystem_init(void);
+
+#endif /* SKIPLIST_H_ */
@@ -90,6 +90,8 @@ static struct gc_global_st
 
     /* The current epoch. */
     VOLATILE unsigned int current;
+    /* Number of epoch updates, unlike @current it does not wrap around. */
+    VOLATILE unsigned long nr_epochs;
     CACHE_PAD(1);
 
     /* Exclusive access to gc_reclaim(). */
@@ -346,6 +348,13 @@ static void gc_reclaim(void)
         if ( (ptst->count > 1) && (ptst->gc->epoch != curr_epoch) ) goto out;
     }
 
+    /*
+     * Count the epoch update before any garbage can be reused, so that
+     * a thread reading an unchanged count knows none was (see gc_epochs).
+     */
+    gc_global.nr_epochs++;
+    WMB();
+
     /*
      * Three-epoch-old garbage lists move to allocation lists.
      * Two-epoch-old garbage lists are cleaned out.
@@ -571,6 +580,15 @@ void gc_enter(ptst_t *ptst)
 }
 
 
+unsigned long gc_epochs(ptst_t *ptst)
+{
+    unsigned long epochs = gc_global.nr_epochs;
+
+    if ( ptst->gc->epoch != gc_global.current ) return GC_NO_EPOCHS;
+    return epochs;
+}
+
+
 void gc_exit(ptst_t *ptst)
 {
     MB();
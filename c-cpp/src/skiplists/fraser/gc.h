@@ -33,6 +33,17 @@ void gc_add_ptr_to_hook_list(ptst_t *ptst, void *ptr, int hook_id);
 void gc_enter(ptst_t *ptst);
 void gc_exit(ptst_t *ptst);
 
+/*
+ * Number of epoch updates so far. Memory freed to the collector is reused
+ * at least two updates later, so a block reached in a critical region is
+ * still valid in a later one if the count did not change in between, as
+ * long as it was read at the start of the first region. Returns
+ * GC_NO_EPOCHS, which must not be used so, if the epoch of the calling
+ * thread lags the current one.
+ */
+#define GC_NO_EPOCHS (~0UL)
+unsigned long gc_epochs(ptst_t *ptst);
+
 /* Start-of-day initialisation of garbage collector. */
 void _init_gc_subsystem(void);
 void _destroy_gc_subsystem(void);
@@ -5,6 +5,14 @@
 typedef unsigned long setkey_t;
 typedef void         *setval_t;
 
+/* Statistics of the linearizable range scans of a thread. */
+typedef struct set_range_stat
+{
+    unsigned long keys;     /* keys reported by the scans      */
+    unsigned long retries;  /* unsuccessful validations        */
+    unsigned long blocked;  /* scans that blocked the updates  */
+} set_range_stat_t;
+
 
 #ifdef __SET_IMPLEMENTATION__
 
@@ -96,6 +104,65 @@ set_t *set_alloc(void);
  */
 /*setval_t*/ int set_lookup(set_t *s, setkey_t k);
 
+/*
+ * Searches start from the per-thread finger (the predecessors found by the
+ * previous search of the thread) when @set_finger_enabled is set.
+ * Searches start at the highest level in use when @set_top_level_enabled
+ * is set (default), and at the top of the sentinels otherwise.
+ * set_finger_stats returns the number of searches of the calling thread,
+ * how many of them started from the finger, the nodes they traversed and
+ * the levels they went down.
+ */
+extern int set_finger_enabled;
+extern int set_top_level_enabled;
+void set_finger_stats(unsigned long *searches, unsigned long *hits,
+                      unsigned long *nodes, unsigned long *levels);
+
+/*
+ * Write the keys of set @s in [@lo, @hi] to @keys, in increasing order
+ * and at most @max of them, and return their number. The scan is weakly
+ * consistent: each key present during the whole scan is reported and
+ * each reported key was present at some point of the scan.
+ */
+int set_range(set_t *s, setkey_t lo, setkey_t hi, setkey_t *keys, int max);
+
+/*
+ * Set @set_range_linearizable before any update to count the updates in
+ * padded stripes of keys, at the cost of two atomic increments per
+ * update. set_range_snapshot then validates the weakly consistent scan
+ * against the stripes of its keys: it is linearized before the validation
+ * if no update of these keys was in progress or completed during the
+ * scan. After @retries unsuccessful scans, it prevents new updates from
+ * starting and waits for the updates in progress to complete.
+ */
+extern int set_range_linearizable;
+int set_range_snapshot(set_t *s, setkey_t lo, setkey_t hi, setkey_t *keys,
+                       int max, int retries, set_range_stat_t *stat);
+
+/*
+ * Priority queue on set @s. set_pq_insert adds @k (with value @v, not
+ * NULL) unless it is present and returns 1 if it did. set_pq_delete_min
+ * removes the lowest key of @s, writes it to @k and returns 1, or
+ * returns 0 if it found @s empty. The removed nodes are unlinked by
+ * batches, when a delete-min went through more than @set_pq_bound of them.
+ * With @set_pq_spray set to the number of threads, the delete-min is
+ * relaxed as in the SprayList: it removes one of the lowest
+ * O(p log^3 p) keys, chosen at random.
+ * set_pq_flush unlinks and frees the batch of the calling thread, which
+ * must call it before it exits.
+ * set_pq_stats returns the delete-mins of the calling thread, the deleted
+ * nodes they went through, the batches they unlinked and the sprays that
+ * found no key and fell back to the lowest one.
+ * The delete-mins are not counted by the linearizable range scans.
+ */
+extern int set_pq_bound;
+extern int set_pq_spray;
+int set_pq_insert(set_t *s, setkey_t k, setval_t v);
+int set_pq_delete_min(set_t *s, setkey_t *k);
+void set_pq_flush(void);
+void set_pq_stats(unsigned long *deletes, unsigned long *skipped,
+                  unsigned long *batches, unsigned long *fallbacks);
+
 void set_print(set_t *set);
 unsigned long set_count(set_t *set);
 void set_print_nodenums(set_t *set);
@@ -62,13 +62,76 @@ struct node_st
     sh_node_pt next[1];
 };
 
+/*
+ * When the linearizable range scans are enabled, the updates are counted
+ * in padded stripes of keys: the word of a stripe counts the updates in
+ * progress (bits 0-15) and the updates that modified the set (bits 16 and
+ * up). A range scan that blocks the updates raises @range_gate.
+ */
+#define STRIPES             64
+#define STRIPE_PENDING      1UL
+#define STRIPE_VERSION_INC  (1UL << 16)
+#define STRIPE_MASK         (STRIPE_VERSION_INC - 1)
+
+typedef struct stripe_st
+{
+    volatile unsigned long word;
+    char pad[CACHE_LINE_SIZE - sizeof(unsigned long)];
+} stripe_t;
+
+/*
+ * @top is the number of levels in use: a new node raises it to its level
+ * before it is linked, and it never decreases. Searches start at this
+ * level instead of NUM_LEVELS, the levels above only hold the sentinels.
+ */
 struct set_st
 {
-    node_t head;
+    node_t    *tail;
+    VOLATILE int top;
+    stripe_t   stripes[STRIPES];
+    volatile unsigned long range_gate;
+    node_t     head;
 };
 
 static int gc_id[NUM_LEVELS];
 
+/*
+ * Per-thread finger: the predecessors at each level found by the last
+ * search of the thread, with the number of epochs of the garbage
+ * collector when it started. The predecessors are only used if no epoch
+ * went by since, so that their memory cannot have been reused, and are
+ * not kept if the epoch of the thread lagged the current one.
+ */
+typedef struct finger_st
+{
+    set_t        *set;
+    unsigned long epochs;
+    sh_node_pt    pa[NUM_LEVELS];
+    unsigned long searches, hits, nodes, levels;
+} finger_t;
+
+/*
+ * Per-thread batch of the priority queue: the nodes claimed by the
+ * delete-mins of the thread, marked but not yet unlinked nor freed.
+ */
+#define PQ_BATCH 64
+
+typedef struct pq_st
+{
+    set_t        *set;
+    int           nb;
+    sh_node_pt    claimed[PQ_BATCH];
+    unsigned long deletes, skipped, batches, fallbacks;
+} pq_t;
+
+int set_finger_enabled = 0;
+int set_top_level_enabled = 1;
+int set_range_linearizable = 0;
+int set_pq_bound = 32;
+int set_pq_spray = 0;
+static __thread finger_t finger;
+static __thread pq_t pq;
+
 /*
  * PRIVATE FUNCTIONS
  */
@@ -87,6 +150,47 @@ static int get_level(ptst_t *ptst)
 }
 
 
+/*
+ * Size of the blocks of the nodes of @levels levels. With COMPACT_NODES,
+ * it is a power of two up to a cache line and whole lines above: the
+ * chunks of the garbage collector being line aligned, the nodes do not
+ * straddle lines, the key of a node shares its first line with its four
+ * lowest forward pointers.
+ */
+static int node_size(int levels)
+{
+    int sz = sizeof(node_t) + (levels - 1)*sizeof(node_t *);
+#ifdef COMPACT_NODES
+    int p = sizeof(node_t);
+    while ( p < sz ) p <<= 1;
+    if ( p <= CACHE_LINE_SIZE ) return(p);
+    sz = (sz + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1);
+#endif
+    return(sz);
+}
+
+
+/* Number of levels a search goes through. */
+static int search_levels(set_t *l)
+{
+    int top;
+    if ( !set_top_level_enabled ) return(NUM_LEVELS);
+    READ_FIELD(top, l->top);
+    return(top);
+}
+
+
+/* Raise the number of levels in use to @level, for a node about to be linked. */
+static void raise_top(set_t *l, int level)
+{
+    int top;
+    while ( (top = l->top) < level )
+    {
+        if ( CASIO(&l->top, top, level) == top ) break;
+    }
+}
+
+
 /*
  * Allocate a new node, and initialise its @level field.
  * NB. Initialisation will eventually be pushed into garbage collector,
@@ -122,13 +226,19 @@ static sh_node_pt strong_search_predecessors(
 {
     sh_node_pt x, x_next, old_x_next, y, y_next;
     setkey_t  y_k;
-    int        i;
+    int        i, top;
 
  retry:
     RMB();
 
     x = &l->head;
-    for ( i = NUM_LEVELS - 1; i >= 0; i-- )
+    top = search_levels(l);
+    for ( i = NUM_LEVELS - 1; i >= top; i-- )
+    {
+        if ( pa ) pa[i] = x;
+        if ( na ) na[i] = l->tail;
+    }
+    for ( i = top - 1; i >= 0; i-- )
     {
         /* We start our search at previous level's unmarked predecessor. */
         READ_FIELD(x_next, x->next[i]);
@@ -168,17 +278,50 @@ static sh_node_pt strong_search_predecessors(
 }
 
 
-/* This function does not remove marked nodes. Use it optimistically. */
+/*
+ * This function does not remove marked nodes. Use it optimistically.
+ * With the finger, the search at each level resumes from the predecessor
+ * found at this level by the previous search of the thread, if it is
+ * ahead of the current position, before @k and still not marked at this
+ * level (hence still in the list). It must be called first thing in the
+ * critical region, before any node is reached.
+ */
 static sh_node_pt weak_search_predecessors(
-    set_t *l, setkey_t k, sh_node_pt *pa, sh_node_pt *na)
+    ptst_t *ptst, set_t *l, setkey_t k, sh_node_pt *pa, sh_node_pt *na)
 {
-    sh_node_pt x, x_next;
+    sh_node_pt x, x_next, y, *fa = NULL, preds[NUM_LEVELS];
     setkey_t  x_next_k;
-    int        i;
+    unsigned long epochs = 0;
+    int        i, top, hit = 0;
+
+    if ( set_finger_enabled )
+    {
+        epochs = gc_epochs(ptst);
+        if ( (finger.set == l) && (finger.epochs == epochs) ) fa = finger.pa;
+        if ( pa == NULL ) pa = preds;
+    }
+    finger.searches++;
 
     x = &l->head;
-    for ( i = NUM_LEVELS - 1; i >= 0; i-- )
+    top = search_levels(l);
+    for ( i = NUM_LEVELS - 1; i >= top; i-- )
+    {
+        if ( pa ) pa[i] = x;
+        if ( na ) na[i] = l->tail;
+    }
+    finger.levels += top;
+    for ( i = top - 1; i >= 0; i-- )
     {
+        if ( fa != NULL )
+        {
+            y = fa[i];
+            if ( (y->k > x->k) && (y->k < k) && !is_marked_ref(y->next[i]) )
+            {
+                x   = y;
+                hit = 1;
+            }
+        }
+
         for ( ; ; )
         {
             READ_FIELD(x_next, x->next[i]);
@@ -188,12 +331,21 @@ static sh_node_pt weak_search_predecessors(
             if ( x_next_k >= k ) break;
 
             x = x_next;
+            finger.nodes++;
         }
 
         if ( pa ) pa[i] = x;
         if ( na ) na[i] = x_next;
     }
 
+    if ( set_finger_enabled )
+    {
+        memcpy(finger.pa, pa, sizeof(finger.pa));
+        finger.set    = (epochs != GC_NO_EPOCHS) ? l : NULL;
+        finger.epochs = epochs;
+        finger.hits  += hit;
+    }
+
     return(x_next);
 }
 
@@ -260,6 +412,40 @@ static void do_full_delete(ptst_t *ptst, set_t *l, sh_node_pt x, int level)
 }
 
 
+/* Atomically add @x to the word @w. */
+static void add_word(volatile unsigned long *w, unsigned long x)
+{
+    unsigned long o = *w, n;
+    while ( (n = CASPO(w, o, o + x)) != o ) o = n;
+}
+
+
+/*
+ * Announce an update of (internal) key @k in its stripe, waiting while a
+ * range scan blocks the updates.
+ */
+static void update_begin(set_t *l, setkey_t k)
+{
+    volatile unsigned long *w = &l->stripes[k % STRIPES].word;
+
+    for ( ; ; )
+    {
+        add_word(w, STRIPE_PENDING);
+        MB();
+        if ( !l->range_gate ) return;
+        add_word(w, -STRIPE_PENDING);
+        while ( l->range_gate ) MB();
+    }
+}
+
+
+static void update_end(set_t *l, setkey_t k, int modified)
+{
+    add_word(&l->stripes[k % STRIPES].word,
+             modified ? STRIPE_VERSION_INC - STRIPE_PENDING : -STRIPE_PENDING);
+}
+
+
 /*
  * PUBLIC FUNCTIONS
  */
@@ -270,7 +456,7 @@ set_t *set_alloc(void)
     node_t *n;
     int i;
 
-    n = malloc(sizeof(*n) + (NUM_LEVELS-1)*sizeof(node_t *));
+    n = ALIGNED_ALLOC(sizeof(*n) + (NUM_LEVELS-1)*sizeof(node_t *));
     memset(n, 0, sizeof(*n) + (NUM_LEVELS-1)*sizeof(node_t *));
     n->k = SENTINEL_KEYMAX;
 
@@ -281,7 +467,11 @@ set_t *set_alloc(void)
      */
     memset(n->next, 0xfe, NUM_LEVELS*sizeof(node_t *));
 
-    l = malloc(sizeof(*l) + (NUM_LEVELS-1)*sizeof(node_t *));
+    l = ALIGNED_ALLOC(sizeof(*l) + (NUM_LEVELS-1)*sizeof(node_t *));
+    l->tail = n;
+    l->top = 1;
+    memset(l->stripes, 0, sizeof(l->stripes));
+    l->range_gate = 0;
     l->head.k = SENTINEL_KEYMIN;
     l->head.level = NUM_LEVELS;
     for ( i = 0; i < NUM_LEVELS; i++ )
@@ -303,9 +493,11 @@ int set_update(set_t *l, setkey_t k, setval_t v, int overwrite)
 
     k = CALLER_TO_INTERNAL_KEY(k);
 
+    if ( set_range_linearizable ) update_begin(l, k);
+
     ptst = critical_enter();
 
-    succ = weak_search_predecessors(l, k, preds, succs);
+    succ = weak_search_predecessors(ptst, l, k, preds, succs);
 
  retry:
     ov = NULL;
@@ -350,6 +542,7 @@ int set_update(set_t *l, setkey_t k, setval_t v, int overwrite)
         new->v = v;
     }
     level = new->level;
+    raise_top(l, level);
 
     /* If successors don't change, this saves us some CAS operations. */
     for ( i = 0; i < level; i++ )
@@ -413,6 +606,7 @@ int set_update(set_t *l, setkey_t k, setval_t v, int overwrite)
     }
  out:
     critical_exit(ptst);
+    if ( set_range_linearizable ) update_end(l, k, result);
     return(result);
 }
 
@@ -426,9 +620,11 @@ int set_remove(set_t *l, setkey_t k)
 
     k = CALLER_TO_INTERNAL_KEY(k);
 
+    if ( set_range_linearizable ) update_begin(l, k);
+
     ptst = critical_enter();
 
-    x = weak_search_predecessors(l, k, preds, NULL);
+    x = weak_search_predecessors(ptst, l, k, preds, NULL);
 
     if ( x->k > k ) goto out;
     READ_FIELD(level, x->level);
@@ -472,6 +668,7 @@ int set_remove(set_t *l, setkey_t k)
 
  out:
     critical_exit(ptst);
+    if ( set_range_linearizable ) update_end(l, k, result);
     return(result);
 }
 
@@ -487,7 +684,7 @@ int set_lookup(set_t *l, setkey_t k)
 
     ptst = critical_enter();
 
-    x = weak_search_predecessors(l, k, NULL, NULL);
+    x = weak_search_predecessors(ptst, l, k, NULL, NULL);
     if ( x->k == k ) READ_FIELD(v, x->v);
 
     critical_exit(ptst);
@@ -497,6 +694,267 @@ int set_lookup(set_t *l, setkey_t k)
     return(result);
 }
 
+/*
+ * The scan walks level 0 from the first node not less than @lo, through
+ * the marked nodes as a lookup does, and skips the deleted nodes.
+ */
+int set_range(set_t *l, setkey_t lo, setkey_t hi, setkey_t *keys, int max)
+{
+    setval_t  v;
+    ptst_t    *ptst;
+    sh_node_pt x;
+    int n = 0;
+
+    lo = CALLER_TO_INTERNAL_KEY(lo);
+    hi = CALLER_TO_INTERNAL_KEY(hi);
+
+    ptst = critical_enter();
+
+    x = weak_search_predecessors(ptst, l, lo, NULL, NULL);
+    while ( (n < max) && (x->k <= hi) )
+    {
+        READ_FIELD(v, x->v);
+        if ( v != NULL ) keys[n++] = x->k - 2;
+        x = get_unmarked_ref(x->next[0]);
+    }
+
+    critical_exit(ptst);
+
+    return(n);
+}
+
+
+/*
+ * Only the stripes of the keys of the range are validated, so that the
+ * updates of other keys do not invalidate the scan.
+ */
+int set_range_snapshot(set_t *l, setkey_t lo, setkey_t hi, setkey_t *keys,
+                       int max, int retries, set_range_stat_t *stat)
+{
+    unsigned long words[STRIPES];
+    setkey_t  k = CALLER_TO_INTERNAL_KEY(lo);
+    int nb, i, n, attempt, valid;
+
+    assert(set_range_linearizable);
+
+    if ( hi < lo ) return(0);
+    nb = (hi - lo < STRIPES) ? (int)(hi - lo) + 1 : STRIPES;
+
+    for ( attempt = 0; attempt < retries; attempt++ )
+    {
+        valid = 1;
+        for ( i = 0; (i < nb) && valid; i++ )
+        {
+            words[i] = l->stripes[(k + i) % STRIPES].word;
+            valid = !(words[i] & STRIPE_MASK);
+        }
+        if ( valid )
+        {
+            RMB();
+            n = set_range(l, lo, hi, keys, max);
+            RMB();
+            for ( i = 0; (i < nb) && valid; i++ )
+                valid = (l->stripes[(k + i) % STRIPES].word == words[i]);
+            if ( valid )
+            {
+                stat->keys += n;
+                return(n);
+            }
+        }
+        stat->retries++;
+    }
+
+    /* Block the updates and wait for those in progress. */
+    add_word(&l->range_gate, 1);
+    MB();
+    for ( i = 0; i < nb; i++ )
+        while ( l->stripes[(k + i) % STRIPES].word & STRIPE_MASK ) MB();
+    n = set_range(l, lo, hi, keys, max);
+    add_word(&l->range_gate, -1UL);
+    stat->keys += n;
+    stat->blocked++;
+
+    return(n);
+}
+
+
+/*
+ * PRIORITY QUEUE
+ *
+ * As in the queue of Lindén and Jonsson, the delete-min walks level 0
+ * from the head and claims the first node whose value it swaps to NULL,
+ * the linearisation point of set_remove(). It marks the node but leaves
+ * it linked: the deleted prefix of the list is unlinked at once by the
+ * delete-min that went through more than @set_pq_bound deleted nodes, with
+ * a search that swings the pointers of the head over the whole prefix.
+ * The other delete-mins do not write the head. Each thread keeps the
+ * nodes it claimed in its batch until such a search, and then frees
+ * those whose insert completed, as set_remove() does.
+ */
+
+/*
+ * Unlink the deleted nodes before the greatest key of the batch, then
+ * make sure that each node of the batch is unlinked and free it unless
+ * its insert is still in progress (the insert frees it then). After the
+ * first search, the others usually find no pointer to swing.
+ */
+static void pq_flush(ptst_t *ptst)
+{
+    sh_node_pt x;
+    setkey_t  k = 0;
+    int        i, level;
+
+    for ( i = 0; i < pq.nb; i++ )
+        if ( pq.claimed[i]->k > k ) k = pq.claimed[i]->k;
+    (void)strong_search_predecessors(pq.set, k + 1, NULL, NULL);
+
+    for ( i = 0; i < pq.nb; i++ )
+    {
+        x = pq.claimed[i];
+        READ_FIELD(level, x->level);
+        if ( check_for_full_delete(x) )
+        {
+            MB(); /* make sure we see node at all levels. */
+            do_full_delete(ptst, pq.set, x, (level & LEVEL_MASK) - 1);
+        }
+    }
+
+    pq.nb = 0;
+    pq.batches++;
+}
+
+
+/*
+ * SprayList of Alistarh et al.: descend from level log p + 1, jumping
+ * over a random number of nodes in [0, log^3 p] at each level, so that
+ * the p threads land on distinct nodes among the first O(p log^3 p).
+ */
+static sh_node_pt pq_spray(set_t *l, ptst_t *ptst)
+{
+    sh_node_pt x = &l->head, x_next;
+    int        lg = 0, i, j, jump;
+
+    while ( (1 << lg) < set_pq_spray ) lg++;
+    i = (lg + 1 < search_levels(l)) ? lg + 1 : search_levels(l);
+    while ( --i >= 0 )
+    {
+        jump = rand_next(ptst) % (lg * lg * lg + 1);
+        for ( j = 0; j < jump; j++ )
+        {
+            x_next = get_unmarked_ref(x->next[i]);
+            if ( x_next == l->tail ) break;
+            x = x_next;
+        }
+    }
+
+    return(x);
+}
+
+
+/*
+ * Claim the first node after @x, counting the deleted nodes it goes
+ * through. Returns the tail if it found no node to claim.
+ */
+static sh_node_pt pq_claim(set_t *l, sh_node_pt x)
+{
+    setval_t v;
+
+    for ( x = get_unmarked_ref(x->next[0]); x != l->tail;
+          x = get_unmarked_ref(x->next[0]) )
+    {
+        READ_FIELD(v, x->v);
+        while ( v != NULL )
+        {
+            if ( CASPO(&x->v, v, NULL) == v ) return(x);
+            READ_FIELD(v, x->v);
+        }
+        pq.skipped++;
+    }
+
+    return(x);
+}
+
+
+int set_pq_insert(set_t *l, setkey_t k, setval_t v)
+{
+    return(set_update(l, k, v, 0));
+}
+
+
+int set_pq_delete_min(set_t *l, setkey_t *k)
+{
+    ptst_t    *ptst;
+    sh_node_pt x;
+    unsigned long skipped = pq.skipped;
+    int        level, result = 0;
+
+    ptst = critical_enter();
+
+    if ( (pq.set != l) && (pq.nb > 0) ) pq_flush(ptst);
+    pq.set = l;
+    pq.deletes++;
+
+    x = l->tail;
+    if ( set_pq_spray > 1 )
+    {
+        x = pq_claim(l, pq_spray(l, ptst));
+        if ( x == l->tail ) pq.fallbacks++;
+    }
+    if ( x == l->tail )
+        x = pq_claim(l, &l->head);
+
+    if ( x != l->tail )
+    {
+        /* Committed to @x: mark it, it is unlinked with the batch. */
+        WEAK_DEP_ORDER_WMB();
+        READ_FIELD(level, x->level);
+        mark_deleted(x, level & LEVEL_MASK);
+        pq.claimed[pq.nb++] = x;
+        *k = x->k - 2;
+        result = 1;
+    }
+
+    if ( (pq.nb == PQ_BATCH) ||
+         ((pq.nb > 0) && (pq.skipped - skipped > set_pq_bound)) )
+        pq_flush(ptst);
+
+    critical_exit(ptst);
+
+    return(result);
+}
+
+
+void set_pq_flush(void)
+{
+    ptst_t *ptst;
+
+    if ( pq.nb == 0 ) return;
+
+    ptst = critical_enter();
+    pq_flush(ptst);
+    critical_exit(ptst);
+}
+
+
+void set_pq_stats(unsigned long *deletes, unsigned long *skipped,
+                  unsigned long *batches, unsigned long *fallbacks)
+{
+    *deletes   = pq.deletes;
+    *skipped   = pq.skipped;
+    *batches   = pq.batches;
+    *fallbacks = pq.fallbacks;
+}
+
+
+void set_finger_stats(unsigned long *searches, unsigned long *hits,
+                      unsigned long *nodes, unsigned long *levels)
+{
+    *searches = finger.searches;
+    *hits     = finger.hits;
+    *nodes    = finger.nodes;
+    *levels   = finger.levels;
+}
+
 void set_print(set_t *set)
 {
 	node_t *curr;
@@ -515,7 +973,7 @@ void set_print(set_t *set)
 		}
 		arr[level-1]++;
 		printf("\n");
-		curr = curr->next[0];
+		curr = get_unmarked_ref(curr->next[0]);
 	} while (SENTINEL_KEYMAX != curr->k);
 	for (j=0; j<NUM_LEVELS; j++)
 		printf("%d nodes of level %d\n", arr[j], j+1);
@@ -529,7 +987,7 @@ unsigned long set_count(set_t *set)
 	curr = &set->head;
 	do {
 		if (curr->v != NULL && curr->v != curr) ++i;
-                curr = curr->next[0];
+                curr = get_unmarked_ref(curr->next[0]);
 	} while (SENTINEL_KEYMAX != curr->k);
 
         return i;
@@ -559,7 +1017,7 @@ void _init_set_subsystem(void)
 
     for ( i = 0; i < NUM_LEVELS; i++ )
     {
-        gc_id[i] = gc_add_allocator(sizeof(node_t) + i*sizeof(node_t *));
+        gc_id[i] = gc_add_allocator(node_size(i + 1));
     }
 
     printf("_init_set_subsystem() done\n");
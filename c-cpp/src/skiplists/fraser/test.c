@@ -56,6 +56,11 @@
  #define DEFAULT_MONITOR                 0
  #define DEFAULT_TEST                    0
  #define DEFAULT_PARALLELISM             1
+ #define DEFAULT_TOP_LEVEL               1
+ #define DEFAULT_SCAN                    0
+ #define DEFAULT_RANGE_WIDTH             100
+ #define DEFAULT_RANGE_RETRIES           16
+ #define DEFAULT_PQ                      0
  
  #define LOG2NUMTHREADS 					8
  
@@ -197,6 +202,10 @@ enum event_num {
 	 int unit_tx;
 	 int alternate;
 	 int effective;
+	 int scan;
+	 int width;
+	 int linearizable;
+	 int pq;
 	 int cache_monitoring;
 	 int validation_txs;
 	 unsigned long nb_add;
@@ -205,6 +214,16 @@ enum event_num {
 	 unsigned long nb_removed;
 	 unsigned long nb_contains;
 	 unsigned long nb_found;
+	 unsigned long nb_scan;
+	 set_range_stat_t range_stat;
+	 unsigned long nb_searches;
+	 unsigned long nb_finger_hits;
+	 unsigned long nb_visited;
+	 unsigned long nb_levels;
+	 unsigned long nb_pq_deletes;
+	 unsigned long nb_pq_skipped;
+	 unsigned long nb_pq_batches;
+	 unsigned long nb_pq_fallbacks;
 	 unsigned long nb_aborts;
 	 unsigned long nb_aborts_locked_read;
 	 unsigned long nb_aborts_locked_write;
@@ -260,11 +279,17 @@ enum event_num {
  */
  
  void *test(void *data) {
-	 int i, unext, last = -1; 
-	 setkey_t val = 0;
+	 int i, n, unext, last = -1; 
+	 setkey_t val = 0, min;
+	 setkey_t *keys;
  
 	 thread_data_t *d = (thread_data_t *)data;
  
+	 if ((keys = (setkey_t *)malloc(d->width * sizeof(setkey_t))) == NULL) {
+		 perror("malloc");
+		 exit(1);
+	 }
+ 
 	 /* Create transaction */
 	 TM_THREAD_ENTER();
 
@@ -325,7 +350,8 @@ enum event_num {
 			 if (last < 0) { // add
  
 				 val = rand_range_re(&d->seed, d->range);
-				 if (sl_add_old(d->set, val)) {
+				 if (d->pq ? set_pq_insert(d->set, val, (setval_t) val) :
+					 sl_add_old(d->set, val)) {
 					 d->nb_added++;
 					 last = val;
 				 }
@@ -333,7 +359,12 @@ enum event_num {
  
 			 } else { // remove
  
-				 if (d->alternate) { // alternate mode (default)
+				 if (d->pq) { // delete-min
+					 if (set_pq_delete_min(d->set, &min)) {
+						 d->nb_removed++;
+					 }
+					 last = -1;
+				 } else if (d->alternate) { // alternate mode (default)
 					 if (sl_remove_old(d->set, (setkey_t) last)) {
 						 d->nb_removed++;
 					 }
@@ -351,6 +382,17 @@ enum event_num {
 				 d->nb_remove++;
 			 }
  
+		 } else if (d->scan && rand_range_re(&d->seed, 100 - d->update) <= d->scan) { // range scan
+ 
+			 val = rand_range_re(&d->seed, d->range);
+			 if (d->linearizable)
+				 n = set_range_snapshot(d->set, val, val + d->width - 1, keys, d->width,
+										DEFAULT_RANGE_RETRIES, &d->range_stat);
+			 else
+				 n = set_range(d->set, val, val + d->width - 1, keys, d->width);
+			 d->range_stat.keys += d->linearizable ? 0 : n;
+			 d->nb_scan++;
+ 
 		 } else { // read
  
 			 if (d->alternate) {
@@ -381,7 +423,7 @@ enum event_num {
 		 /* Is the next op an update? */
 		 if (d->effective) { // a failed remove/add is a read-only tx
 			 unext = ((100 * (d->nb_added + d->nb_removed))
-							  < (d->update * (d->nb_add + d->nb_remove + d->nb_contains)));
+							  < (d->update * (d->nb_add + d->nb_remove + d->nb_contains + d->nb_scan)));
 		 } else { // remove/add (even failed) is considered as an update
 			 unext = (rand_range_re(&d->seed, 100) - 1 < d->update);
 		 }
@@ -406,6 +448,13 @@ enum event_num {
         for (i = 0; i < NUM_EVENTS; i++) close(fds[i]);
     }
  
+	 set_finger_stats(&d->nb_searches, &d->nb_finger_hits, &d->nb_visited,
+					  &d->nb_levels);
+	 set_pq_flush();
+	 set_pq_stats(&d->nb_pq_deletes, &d->nb_pq_skipped, &d->nb_pq_batches,
+				  &d->nb_pq_fallbacks);
+	 free(keys);
+
 	 /* Free transaction */
 		 TM_THREAD_EXIT();
  
@@ -483,6 +532,12 @@ enum event_num {
 		 {"cache monitoring", 		   required_argument, NULL, 'm'},
 		 {"test mode",                 required_argument, NULL, 'v'},
 		 {"population parallelism",    required_argument, NULL, 'p'},
+		 {"finger",                    no_argument,       NULL, 'F'},
+		 {"top-level",                 required_argument, NULL, 'T'},
+		 {"scan-rate",                 required_argument, NULL, 's'},
+		 {"range-width",               required_argument, NULL, 'w'},
+		 {"linearizable",              no_argument,       NULL, 'L'},
+		 {"priority-queue",            required_argument, NULL, 'q'},
 		 {NULL, 0, NULL, 0}
 	 };
  
@@ -491,7 +546,8 @@ enum event_num {
 		 unsigned long size;
 	 setkey_t last = 0;
 	 setkey_t val = 0;
-	 unsigned long reads, effreads, updates, effupds, aborts, aborts_locked_read, aborts_locked_write,
+	 unsigned long searches, finger_hits, visited, levels;
+	 unsigned long reads, effreads, updates, effupds, scans, scanned, scan_retries, scan_blocked, pq_deletes, pq_skipped, pq_batches, pq_fallbacks, aborts, aborts_locked_read, aborts_locked_write,
 	 aborts_validate_read, aborts_validate_write, aborts_validate_commit,
 	 aborts_invalid_memory, aborts_double_write, max_retries, failures_because_contention,
 	 L1_cache_accesses, L1_cache_misses, L3_cache_accesses, L3_cache_misses, total_cache_accesses, total_cache_misses;
@@ -514,12 +570,17 @@ enum event_num {
 	 int cache_monitoring = DEFAULT_MONITOR;
 	 int test_mode = DEFAULT_TEST;
 	 int pop_par = DEFAULT_PARALLELISM;
+	 int top_level = DEFAULT_TOP_LEVEL;
+	 int scan = DEFAULT_SCAN;
+	 int width = DEFAULT_RANGE_WIDTH;
+	 int linearizable = 0;
+	 int pq = DEFAULT_PQ;
 	 sigset_t block_set;
 		 int unbalanced = DEFAULT_UNBALANCED;
  
 	 while(1) {
 		 i = 0;
-		 c = getopt_long(argc, argv, "hAf:d:i:t:r:S:u:U:m:v:p:"
+		 c = getopt_long(argc, argv, "hAFLf:d:i:t:r:S:u:U:m:v:p:T:s:w:q:"
 										 , long_options, &i);
  
 		 if(c == -1)
@@ -543,6 +604,8 @@ enum event_num {
 								 "        Print this message\n"
 								 "  -A, --Alternate\n"
 								 "        Consecutive insert/remove target the same value\n"
+								 "  -F, --finger\n"
+								 "        Searches start from the last position of the thread\n"
 								 "  -f, --effective <int>\n"
 								 "        update txs must effectively write (0=trial, 1=effective, default=" XSTR(DEFAULT_EFFECTIVE) ")\n"
 								 "  -d, --duration <int>\n"
@@ -553,10 +616,21 @@ enum event_num {
 								 "        Number of threads (default=" XSTR(DEFAULT_NB_THREADS) ")\n"
 								 "  -r, --range <int>\n"
 								 "        Range of integer values inserted in set (default=" XSTR(DEFAULT_RANGE) ")\n"
-								 "  -s, --seed <int>\n"
+								 "  -S, --seed <int>\n"
 								 "        RNG seed (0=time-based, default=" XSTR(DEFAULT_SEED) ")\n"
 								 "  -u, --update-rate <int>\n"
 								 "        Percentage of update transactions (default=" XSTR(DEFAULT_UPDATE) ")\n"
+								 "  -s, --scan-rate <int>\n"
+								 "        Percentage of range scans, at most 100 - update rate (default=" XSTR(DEFAULT_SCAN) ")\n"
+								 "  -w, --range-width <int>\n"
+								 "        Number of consecutive keys of a range scan (default=" XSTR(DEFAULT_RANGE_WIDTH) ")\n"
+								 "  -L, --linearizable\n"
+								 "        Linearizable range scans, updates are counted per stripe of keys\n"
+								 "  -q, --priority-queue <int>\n"
+								 "        Removes delete the minimum (default=" XSTR(DEFAULT_PQ) ")\n"
+								 "        0 = set, removes delete random keys,\n"
+								 "        1 = priority queue, with batched unlinking of the deleted prefix,\n"
+								 "        2 = relaxed priority queue, delete-mins spray over the lowest keys\n"
 								 "  -U, --unbalance <int>\n"
 								 "        Percentage of skewness of the distribution of values (default=" XSTR(DEFAULT_UNBALANCED) ")\n"
 								 "  -m, --cache monitoring (default=0)\n"
@@ -567,11 +641,16 @@ enum event_num {
 								 "        non-zero = validate correctness, dictates number of validation txs,\n"
 								 "  -p, --population parallelism <int>\n"
 								 "        Number of threads that take part in the set initialization(default=" XSTR(DEFAULT_PARALLELISM) ")\n"
+								 "  -T, --top-level <int>\n"
+								 "        Searches start at the highest level in use (0=at the top of the sentinels, default=" XSTR(DEFAULT_TOP_LEVEL) ")\n"
 								  );
 					 exit(0);
 				 case 'A':
 					 alternate = 1;
 					 break;
+				 case 'F':
+					 set_finger_enabled = 1;
+					 break;
 				 case 'f':
 					 effective = atoi(optarg);
 					 break;
@@ -605,6 +684,21 @@ enum event_num {
 				 case 'p':
 					 pop_par = atoi(optarg);
 					 break;
+				 case 'T':
+					 top_level = atoi(optarg);
+					 break;
+				 case 's':
+					 scan = atoi(optarg);
+					 break;
+				 case 'w':
+					 width = atoi(optarg);
+					 break;
+				 case 'L':
+					 linearizable = 1;
+					 break;
+				 case 'q':
+					 pq = atoi(optarg);
+					 break;
 				 case '?':
 					 printf("Use -h or --help for help\n");
 					 exit(0);
@@ -618,6 +712,14 @@ enum event_num {
 	 assert(nb_threads > 0);
 	 assert(range > 0 && range >= initial);
 	 assert(update >= 0 && update <= 100);
+	 assert(scan >= 0 && scan <= 100 - update);
+	 assert(width > 0);
+	 assert(pq >= 0 && pq <= 2);
+	 assert(!pq || !linearizable);
+
+	 set_top_level_enabled = top_level;
+	 set_range_linearizable = linearizable;
+	 set_pq_spray = (2 == pq) ? nb_threads : 0;
  
 	 printf("Set type     : skip list\n");
 	 printf("Duration     : %d\n", duration);
@@ -629,6 +731,12 @@ enum event_num {
 	 printf("Elasticity   : %d\n", unit_tx);
 	 printf("Alternate    : %d\n", alternate);
 	 printf("Efffective   : %d\n", effective);
+	 printf("Finger       : %d\n", set_finger_enabled);
+	 printf("Top level    : %d\n", top_level);
+	 printf("Scan rate    : %d\n", scan);
+	 printf("Range width  : %d\n", width);
+	 printf("Linearizable : %d\n", linearizable);
+	 printf("Prio. queue  : %d\n", pq);
 	 printf("Type sizes   : int=%d/long=%d/ptr=%d/word=%d\n",
 				  (int)sizeof(int),
 				  (int)sizeof(long),
@@ -749,12 +857,26 @@ enum event_num {
 		 data[i].unit_tx = unit_tx;
 		 data[i].alternate = alternate;
 		 data[i].effective = effective;
+		 data[i].scan = scan;
+		 data[i].width = width;
+		 data[i].linearizable = linearizable;
+		 data[i].pq = pq;
+		 data[i].nb_scan = 0;
+		 memset(&data[i].range_stat, 0, sizeof(set_range_stat_t));
 		 data[i].nb_add = 0;
 		 data[i].nb_added = 0;
 		 data[i].nb_remove = 0;
 		 data[i].nb_removed = 0;
 		 data[i].nb_contains = 0;
 		 data[i].nb_found = 0;
+		 data[i].nb_searches = 0;
+		 data[i].nb_finger_hits = 0;
+		 data[i].nb_visited = 0;
+		 data[i].nb_levels = 0;
+		 data[i].nb_pq_deletes = 0;
+		 data[i].nb_pq_skipped = 0;
+		 data[i].nb_pq_batches = 0;
+		 data[i].nb_pq_fallbacks = 0;
 		 data[i].nb_aborts = 0;
 		 data[i].nb_aborts_locked_read = 0;
 		 data[i].nb_aborts_locked_write = 0;
@@ -849,7 +971,19 @@ enum event_num {
 		 effreads = 0;
 		 updates = 0;
 		 effupds = 0;
+		 scans = 0;
+		 scanned = 0;
+		 scan_retries = 0;
+		 scan_blocked = 0;
+		 pq_deletes = 0;
+		 pq_skipped = 0;
+		 pq_batches = 0;
+		 pq_fallbacks = 0;
 		 max_retries = 0;
+		 searches = 0;
+		 finger_hits = 0;
+		 visited = 0;
+		 levels = 0;
 		 L1_cache_misses = 0; 
  		 L1_cache_accesses = 0;
  		 L3_cache_misses = 0;
@@ -898,6 +1032,14 @@ enum event_num {
 			 (data[i].nb_remove - data[i].nb_removed);
 			 updates += (data[i].nb_add + data[i].nb_remove);
 			 effupds += data[i].nb_removed + data[i].nb_added;
+			 scans += data[i].nb_scan;
+			 scanned += data[i].range_stat.keys;
+			 scan_retries += data[i].range_stat.retries;
+			 scan_blocked += data[i].range_stat.blocked;
+			 pq_deletes += data[i].nb_pq_deletes;
+			 pq_skipped += data[i].nb_pq_skipped;
+			 pq_batches += data[i].nb_pq_batches;
+			 pq_fallbacks += data[i].nb_pq_fallbacks;
 			 size += data[i].nb_added - data[i].nb_removed;
 			 L1_cache_misses += data[i].L1_cache_misses;
 			 L1_cache_accesses += data[i].L1_cache_accesses;
@@ -905,12 +1047,16 @@ enum event_num {
 			 L3_cache_accesses += data[i].L3_cache_accesses;
 			 total_cache_misses += data[i].total_cache_misses;
 			 total_cache_accesses += data[i].total_cache_accesses;
+			 searches += data[i].nb_searches;
+			 finger_hits += data[i].nb_finger_hits;
+			 visited += data[i].nb_visited;
+			 levels += data[i].nb_levels;
 			 if (max_retries < data[i].max_retries)
 				 max_retries = data[i].max_retries;
 		 }
 		 // printf("Set size      : %lu (expected: %lu)\n", set_count(set), size);
 		 printf("Duration      : %d (ms)\n", duration);
-		 printf("#txs          : %lu (%f / s)\n", reads + updates, (reads + updates) * 1000.0 / duration);
+		 printf("#txs          : %lu (%f / s)\n", reads + updates + scans, (reads + updates + scans) * 1000.0 / duration);
  
 		 printf("#read txs     : ");
 		 if (effective) {
@@ -927,6 +1073,20 @@ enum event_num {
 						 duration);
 		 } else printf("%lu (%f / s)\n", updates, updates * 1000.0 / duration);
  
+		 printf("#range scans  : %lu (%f / s)\n", scans, scans * 1000.0 / duration);
+		 printf("  #keys       : %lu (%f / scan)\n", scanned, scans ? (double) scanned / scans : 0.0);
+		 if (linearizable) {
+			 printf("  #retries    : %lu (%f / scan)\n", scan_retries, scans ? (double) scan_retries / scans : 0.0);
+			 printf("  #blocked    : %lu\n", scan_blocked);
+		 }
+		 if (pq) {
+			 printf("#delete-mins  : %lu (%f / s)\n", pq_deletes, pq_deletes * 1000.0 / duration);
+			 printf("  #skipped    : %lu (%f / delete-min)\n", pq_skipped, pq_deletes ? (double) pq_skipped / pq_deletes : 0.0);
+			 printf("  #batches    : %lu (%f deletes / batch)\n", pq_batches, pq_batches ? (double) pq_deletes / pq_batches : 0.0);
+			 if (2 == pq)
+				 printf("  #fallbacks  : %lu\n", pq_fallbacks);
+		 }
+ 
 		 printf("#aborts       : %lu (%f / s)\n", aborts, aborts * 1000.0 / duration);
 		 printf("  #lock-r     : %lu (%f / s)\n", aborts_locked_read, aborts_locked_read * 1000.0 / duration);
 		 printf("  #lock-w     : %lu (%f / s)\n", aborts_locked_write, aborts_locked_write * 1000.0 / duration);
@@ -937,6 +1097,12 @@ enum event_num {
 		 printf("  #dup-w      : %lu (%f / s)\n", aborts_double_write, aborts_double_write * 1000.0 / duration);
 		 printf("  #failures   : %lu\n",  failures_because_contention);
 		 printf("Max retries   : %lu\n", max_retries);
+		 printf("#searches     : %lu\n", searches);
+		 printf("  #from finger: %lu (%f %%)\n", finger_hits,
+				(searches ? 100.0 * finger_hits / searches : 0.0));
+		 printf("  nodes/search: %f\n", (searches ? (double) visited / searches : 0.0));
+		 printf("  levels/srch : %f\n", (searches ? (double) levels / searches : 0.0));
+		 printf("  path length : %f\n", (searches ? (double) (visited + levels) / searches : 0.0));
 		if (cache_monitoring) {
 			printf("#L1 cache misses    : %lu\n", L1_cache_misses);
 			printf("#L1 cache accesses  : %lu\n", L1_cache_accesses);
@@ -59,7 +59,9 @@ reads from memory to occur.
 #include <pthread.h>
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
+#include <sys/time.h>
 
 #include "background.h"
 #include "skiplist.h"
@@ -94,14 +96,118 @@ static int bg_tall_deleted;
 /* the amount of time the bg thread sleeps for each iteration */
 static int bg_sleep_time;
 
+/* - Adaptive maintenance - */
+
+#define BG_STRIPES      64      /* backlog counters */
+#define BG_ADAPT_SHIFT  4       /* sleep time goes down to base >> 4 */
+#define BG_BACKLOG_HIGH 64      /* shorten the sleep above size / 64 */
+#define BG_BACKLOG_LOW  1024    /* lengthen the sleep below size / 1024 */
+#define BG_SAMPLES      32      /* keys sampled for the path length */
+#define BG_HISTORY      64      /* points of the staleness time series */
+
+/* 1 to scale the sleep time and the passes to the backlog */
+int bg_adaptive = 1;
+
+/*
+ * Successful inserts of new nodes and logical deletes, these are the
+ * nodes the next pass has to index or to remove. Each worker thread
+ * counts in its own stripe, the background thread sums the stripes and
+ * compares with the sums of its previous pass.
+ */
+typedef struct bg_backlog bg_backlog_t;
+static struct bg_backlog {
+        AO_t inserts;
+        AO_t deletes;
+        char pad[CACHE_LINE_SIZE - 2 * sizeof(AO_t)];
+} bg_backlog[BG_STRIPES];
+static AO_t bg_nb_stripes;
+static __thread bg_backlog_t *bg_stripe;
+
+/* the sleep time is bg_sleep_time >> bg_sleep_shift */
+static int bg_sleep_shift;
+
+/* keys sampled during the last node pass to measure the path length */
+static sl_key_t bg_samples[BG_SAMPLES];
+static int bg_nb_samples;
+
+/* index staleness over time, points are merged by pairs when full */
+typedef struct bg_point bg_point_t;
+static struct bg_point {
+        unsigned long time;     /* ms since bg_start() */
+        double path;            /* average search path length */
+        double backlog;         /* average backlog at wake-up */
+} bg_history[BG_HISTORY], bg_acc;
+static int bg_nb_points;
+static unsigned long bg_span;   /* wake-ups per point */
+static unsigned long bg_acc_n;  /* wake-ups accumulated in bg_acc */
+static struct timeval bg_start_time;
+
+static struct bg_sched_stats {
+        unsigned long wakeups;
+        unsigned long passes;
+        unsigned long node_passes;
+        unsigned long sleep_sum;
+        unsigned long paths;
+        double path_sum;
+        double path_max;
+} bg_sched;
+
+/* - Partitioned maintenance - */
+
+#define BG_MAX_THREADS  BG_SAMPLES      /* one sampled key per boundary */
+#define BG_NO_KEY       ((sl_key_t) -1) /* lo key of an empty partition */
+
+/* number of maintenance threads, each maintains a key-range partition */
+int bg_threads = 1;
+
+/*
+ * Partition k holds the nodes from its lo key up to the lo key of
+ * partition k + 1, the first partition also holds the head. The threads
+ * write the index nodes of their partition only: an index node raised
+ * right after an index node of the previous partition, and the deleted
+ * index nodes at the start of the partition, are linked and unlinked
+ * by the first thread after the threads traversed the level.
+ */
+typedef struct bg_part bg_part_t;
+static struct bg_part {
+        sl_key_t lo;            /* first key of the partition */
+        int id;
+        int non_deleted;
+        int tall_deleted;
+        int raised;             /* nodes raised by the current phase */
+        int unlink;             /* the previous index node gets first */
+        inode_t *first;         /* first live index node of the level */
+        inode_t *first_new;     /* first raised index node, not linked */
+        int stride;
+        int nb_samples;
+        sl_key_t samples[BG_SAMPLES];
+        CACHE_PAD(0);
+} bg_parts[BG_MAX_THREADS];
+static int bg_nb_parts;
+static pthread_t bg_helpers[BG_MAX_THREADS];
+static pthread_barrier_t bg_barrier;
+static int bg_node_pass;        /* the pass traverses the node level */
+static int bg_quit;             /* the helper threads must exit */
+
 /* - Private Functions - */
 
 static void* bg_loop(void *args);
-static void bg_trav_nodes(ptst_t *ptst);
+static void* bg_helper(void *args);
+static int bg_maintain(ptst_t *ptst);
+static int bg_pass(bg_part_t *p, ptst_t *ptst);
+static void bg_sync(void);
+static sl_key_t bg_hi(bg_part_t *p);
+static inode_t* bg_find_pred(int i, sl_key_t key);
+static void bg_partition(void);
+static void bg_split(void);
+static int bg_stitch(int i);
+static void bg_trav_nodes(bg_part_t *p, ptst_t *ptst);
 static void bg_lower_ilevel(inode_t *new_low, ptst_t *ptst);
-static int bg_raise_nlevel(inode_t *inode, ptst_t *ptst);
-static int bg_raise_ilevel(inode_t *iprev,inode_t *iprev_tall,
-                           int height, ptst_t *ptst);
+static void bg_raise_nlevel(bg_part_t *p, ptst_t *ptst);
+static void bg_raise_ilevel(bg_part_t *p, int i, ptst_t *ptst);
+static void bg_backlog_sum(unsigned long *inserts, unsigned long *deletes);
+static void bg_adapt(unsigned long backlog);
+static void bg_record(unsigned long backlog);
 
 /**
  * bg_loop - loop for maintaining index levels
@@ -109,79 +215,301 @@ static int bg_raise_ilevel(inode_t *iprev,inode_t *iprev_tall,
  *
  * Returns a void* value as per pthread_create requirements.
  * Note: Do this loop forever while the program is running.
+ * In adaptive mode, a wake-up with no backlog after a pass that left
+ * the index unchanged does not traverse the list, and the node level
+ * is only traversed when there are logical deletes to complete.
+ * This thread maintains the first partition and drives the others.
  */
 static void* bg_loop(void *args)
 {
-        inode_t *inode;
-        inode_t *inew;
-        inode_t *inodes[MAX_LEVELS];
-        int raised = 0; /* keep track of if we raised index level */
-        int threshold;  /* for testing if we should lower index level */
-        int i;
+        unsigned long inserts, deletes, last_inserts, last_deletes;
+        unsigned long backlog;
+        int changed = 1; /* the index changed during the last pass */
         struct sl_ptst *ptst;
 
         assert(NULL != set);
 
+        bg_backlog_sum(&last_inserts, &last_deletes);
+
         while (1) {
                 if (bg_finished)
                         break;
 
-                usleep(bg_sleep_time);
+                usleep(bg_sleep_time >> bg_sleep_shift);
+                bg_sched.sleep_sum += bg_sleep_time >> bg_sleep_shift;
+                ++bg_sched.wakeups;
 
                 #ifdef USE_GC
                 ptst = ptst_critical_enter();
                 #endif
 
-                for (i = 0; i < MAX_LEVELS; i++)
-                        inodes[i] = NULL;
+                bg_backlog_sum(&inserts, &deletes);
+                backlog = (inserts - last_inserts) + (deletes - last_deletes);
+                bg_record(backlog);
 
-                #ifdef BG_STATS
-                ++bg_stats.loops;
+                bg_node_pass = 1;
+                if (bg_adaptive) {
+                        bg_adapt(backlog);
+                        bg_node_pass = changed || deletes != last_deletes;
+                }
+                if (!bg_adaptive || changed || 0 != backlog) {
+                        last_inserts = inserts;
+                        last_deletes = deletes;
+                        changed = bg_maintain(ptst);
+                }
+
+                #ifdef USE_GC
+                ptst_critical_exit(ptst);
                 #endif
+        }
 
-                bg_non_deleted = 0;
-                bg_tall_deleted = 0;
+        /* release the helper threads */
+        bg_quit = 1;
+        bg_sync();
+
+        return NULL;
+}
+
+/**
+ * bg_helper - loop of the threads maintaining the other partitions
+ * @args: the partition
+ *
+ * Returns a void* value as per pthread_create requirements.
+ */
+static void* bg_helper(void *args)
+{
+        bg_part_t *p = (bg_part_t *) args;
+        struct sl_ptst *ptst;
+
+        while (1) {
+                /* wait for the next pass */
+                bg_sync();
+                if (bg_quit)
+                        break;
+
+                #ifdef USE_GC
+                ptst = ptst_critical_enter();
+                #endif
+
+                bg_pass(p, ptst);
+
+                #ifdef USE_GC
+                ptst_critical_exit(ptst);
+                #endif
+        }
+
+        return NULL;
+}
+
+/**
+ * bg_sync - wait for all the maintenance threads
+ */
+static void bg_sync(void)
+{
+        if (bg_nb_parts > 1)
+                pthread_barrier_wait(&bg_barrier);
+}
 
-                /* traverse the node level and do physical deletes */
-                bg_trav_nodes(ptst);
+/**
+ * bg_hi - first key after a partition
+ * @p: the partition
+ */
+static sl_key_t bg_hi(bg_part_t *p)
+{
+        if (p->id + 1 < bg_nb_parts)
+                return bg_parts[p->id + 1].lo;
+        return BG_NO_KEY;
+}
 
-                assert(set->head->level < MAX_LEVELS);
+/**
+ * bg_find_pred - find the last index node before a key
+ * @i: the index level
+ * @key: the key
+ *
+ * Returns the index node with the greatest key less than @key at level
+ * @i, or the head index node at this level.
+ */
+static inode_t* bg_find_pred(int i, sl_key_t key)
+{
+        inode_t *item = set->top;
+        int level;
+
+        for (level = set->head->level - 1; ; level--) {
+                while (NULL != item->right && item->right->node->key < key)
+                        item = item->right;
+                if (level == i)
+                        return item;
+                item = item->down;
+        }
+}
+
+/**
+ * bg_partition - set the partitions of a pass
+ *
+ * Note: the partitions start at evenly spaced keys sampled during the
+ * last node pass, the first one holds the whole list until there are
+ * enough samples.
+ */
+static void bg_partition(void)
+{
+        int k;
+
+        bg_parts[0].lo = 0;
+        for (k = 1; k < bg_nb_parts; k++) {
+                if (bg_nb_samples < bg_nb_parts)
+                        bg_parts[k].lo = BG_NO_KEY;
+                else
+                        bg_parts[k].lo =
+                                bg_samples[k * bg_nb_samples / bg_nb_parts];
+        }
+}
 
-                /* get the first index node at each level */
-                inode = set->top;
-                for (i = set->head->level - 1; i >= 0; i--) {
-                        inodes[i] = inode;
-                        assert(NULL != inodes[i]);
-                        inode = inode->down;
+/**
+ * bg_split - merge the keys sampled by the partitions
+ *
+ * Note: each key sampled by a partition stands for the stride nodes
+ * following it, bg_samples is set to BG_SAMPLES keys evenly spaced
+ * among the non-deleted nodes of the list.
+ */
+static void bg_split(void)
+{
+        unsigned long total = 0, count = 0;
+        bg_part_t *p;
+        int j = 0, k, s;
+
+        for (k = 0; k < bg_nb_parts; k++)
+                total += bg_parts[k].non_deleted;
+
+        for (k = 0; k < bg_nb_parts; k++) {
+                p = &bg_parts[k];
+                for (s = 0; s < p->nb_samples; s++) {
+                        count += p->stride;
+                        while (j < BG_SAMPLES && j * total < count * BG_SAMPLES)
+                                bg_samples[j++] = p->samples[s];
                 }
-                assert(NULL == inode);
+        }
+        bg_nb_samples = j;
+}
 
-                /* raise bottom level nodes */
-                raised = bg_raise_nlevel(inodes[0], ptst);
+/**
+ * bg_stitch - link the partitions at their boundaries
+ * @i: the index level traversed by the partitions, -1 for the node level
+ *
+ * Note: this is done by the first thread while the others wait.
+ */
+static int bg_stitch(int i)
+{
+        bg_part_t *p;
+        inode_t *pred;
+        int k, raised = 0;
+#ifndef NDEBUG
+        inode_t *item;
+#endif
+
+        for (k = 0; k < bg_nb_parts; k++) {
+                p = &bg_parts[k];
+                raised |= p->raised;
+                if (p->unlink) {
+                        /* unlink the leading deleted index nodes */
+                        pred = bg_find_pred(i, p->lo);
+                        pred->right = p->first;
+                }
+                if (NULL != p->first_new) {
+                        pred = bg_find_pred(i + 1, p->first_new->node->key);
+#ifndef NDEBUG
+                        /* the later raises of @p are chained after it */
+                        for (item = p->first_new; item != pred->right;
+                             item = item->right)
+                                assert(NULL != item);
+#endif
+                        pred->right = p->first_new;
+                }
+        }
 
-                if (raised && (1 == set->head->level)) {
-                        /* add a new index level */
-                        inew = inode_new(NULL, set->top, set->head, ptst);
-                        set->top = inew;
-                        ++set->head->level;
-                        assert(NULL == inodes[1]);
-                        inodes[1] = set->top;
+        return raised;
+}
+
+/**
+ * bg_maintain - do a maintenance pass
+ * @ptst: per-thread state
+ *
+ * Returns 1 if the index levels were raised or lowered and 0 otherwise.
+ */
+static int bg_maintain(ptst_t *ptst)
+{
+        int changed;
+
+        #ifdef BG_STATS
+        ++bg_stats.loops;
+        #endif
+        ++bg_sched.passes;
+        if (bg_node_pass)
+                ++bg_sched.node_passes;
+
+        bg_partition();
+
+        /* start the pass of the helper threads */
+        bg_sync();
+
+        changed = bg_pass(&bg_parts[0], ptst);
+
+        /* if needed, remove the lowest index level */
+        if (bg_node_pass && bg_tall_deleted > bg_non_deleted * 10) {
+                if (set->head->level > 1) {
+                        bg_lower_ilevel(bg_find_pred(1, 0),/* level above */
+                                        ptst);
+                        changed = 1;
 
                         #ifdef BG_STATS
-                        ++bg_stats.raises;
+                        ++bg_stats.lowers;
                         #endif
                 }
+        }
 
-                /* raise the index level nodes */
-                for (i = 0; i < (set->head->level - 1); i++) {
-                        assert(i < MAX_LEVELS-1);
-                        raised = bg_raise_ilevel(inodes[i],/* level raised */
-                                                 inodes[i + 1],/* level above */
-                                                 i + 1,/* current height */
-                                                 ptst);
+        return changed;
+}
+
+/**
+ * bg_pass - maintain a partition during a pass
+ * @p: the partition
+ * @ptst: per-thread state
+ *
+ * Returns 1 to the first thread if the index levels were raised.
+ * Note: all the threads run the phases of the pass together, the first
+ * one links the partitions and adds the index levels between them.
+ */
+static int bg_pass(bg_part_t *p, ptst_t *ptst)
+{
+        inode_t *inew;
+        int raised = 0; /* keep track of if we raised index level */
+        int changed = 0;
+        int first = (0 == p->id);
+        int i, k;
+
+        /* traverse the node level and do physical deletes */
+        if (bg_node_pass)
+                bg_trav_nodes(p, ptst);
+        bg_sync();
+        if (first && bg_node_pass) {
+                bg_non_deleted = 0;
+                bg_tall_deleted = 0;
+                for (k = 0; k < bg_nb_parts; k++) {
+                        bg_non_deleted += bg_parts[k].non_deleted;
+                        bg_tall_deleted += bg_parts[k].tall_deleted;
                 }
+                bg_split();
+        }
+
+        assert(set->head->level < MAX_LEVELS);
+
+        /* raise bottom level nodes */
+        bg_raise_nlevel(p, ptst);
+        bg_sync();
+        if (first) {
+                raised = bg_stitch(-1);
+                changed |= raised;
 
-                if (raised) {
+                if (raised && (1 == set->head->level)) {
                         /* add a new index level */
                         inew = inode_new(NULL, set->top, set->head, ptst);
                         set->top = inew;
@@ -191,50 +519,203 @@ static void* bg_loop(void *args)
                         ++bg_stats.raises;
                         #endif
                 }
-
-                /* if needed, remove the lowest index level */
-                threshold = bg_non_deleted * 10;
-                if (bg_tall_deleted > threshold) {
-                        if (NULL != inodes[1]) {
-                                bg_lower_ilevel(inodes[1],/* level above */
-                                                ptst);
+        }
+        bg_sync();
+
+        /* raise the index level nodes */
+        for (i = 0; i < (set->head->level - 1); i++) {
+                assert(i < MAX_LEVELS-1);
+                bg_raise_ilevel(p, i, ptst);
+                bg_sync();
+                if (first) {
+                        raised = bg_stitch(i);
+                        changed |= raised;
+
+                        /*
+                         * add a new index level before the threads read
+                         * the number of levels again after the barrier
+                         */
+                        if (raised && (i + 1) == (set->head->level - 1)) {
+                                inew = inode_new(NULL, set->top, set->head,
+                                                 ptst);
+                                set->top = inew;
+                                ++set->head->level;
 
                                 #ifdef BG_STATS
-                                ++bg_stats.lowers;
+                                ++bg_stats.raises;
                                 #endif
                         }
                 }
+                bg_sync();
+        }
 
-                #ifdef USE_GC
-                ptst_critical_exit(ptst);
-                #endif
+        return changed;
+}
+
+/**
+ * bg_backlog_sum - sum the backlog counters of all threads
+ * @inserts: set to the number of inserts of new nodes
+ * @deletes: set to the number of logical deletes
+ */
+static void bg_backlog_sum(unsigned long *inserts, unsigned long *deletes)
+{
+        int i;
+
+        *inserts = 0;
+        *deletes = 0;
+        for (i = 0; i < BG_STRIPES; i++) {
+                *inserts += AO_load(&bg_backlog[i].inserts);
+                *deletes += AO_load(&bg_backlog[i].deletes);
         }
+}
 
-        return NULL;
+/**
+ * bg_adapt - scale the sleep time to the backlog
+ * @backlog: updates since the last pass
+ *
+ * Note: the sleep time is halved while the backlog is more than
+ * 1/BG_BACKLOG_HIGH of the list and doubled back towards the base
+ * sleep time while it is less than 1/BG_BACKLOG_LOW of the list.
+ */
+static void bg_adapt(unsigned long backlog)
+{
+        unsigned long size = bg_non_deleted + 1;
+
+        if (backlog * BG_BACKLOG_HIGH > size) {
+                if (bg_sleep_shift < BG_ADAPT_SHIFT)
+                        ++bg_sleep_shift;
+        } else if (backlog * BG_BACKLOG_LOW < size) {
+                if (bg_sleep_shift > 0)
+                        --bg_sleep_shift;
+        }
+}
+
+/**
+ * bg_path_length - length of the search path to a key
+ * @key: the search key
+ *
+ * Returns the number of index and node hops of a search for @key.
+ */
+static int bg_path_length(sl_key_t key)
+{
+        inode_t *item, *next_item;
+        node_t *node, *next;
+        int hops = 0;
+
+        item = set->top;
+        while (1) {
+                next_item = item->right;
+                if (NULL == next_item || next_item->node->key > key) {
+                        next_item = item->down;
+                        if (NULL == next_item)
+                                break;
+                }
+                item = next_item;
+                ++hops;
+        }
+        node = item->node;
+        while (NULL != (next = node->next) && next->key <= key) {
+                node = next;
+                ++hops;
+        }
+
+        return hops;
+}
+
+/**
+ * bg_record - record the index staleness at a wake-up
+ * @backlog: updates since the last pass
+ *
+ * Note: the staleness is the average search path length to the keys
+ * sampled during the last node pass.
+ */
+static void bg_record(unsigned long backlog)
+{
+        struct timeval now;
+        double path = 0;
+        int i;
+
+        if (0 == bg_nb_samples)
+                return;
+
+        for (i = 0; i < bg_nb_samples; i++)
+                path += bg_path_length(bg_samples[i]);
+        path /= bg_nb_samples;
+
+        ++bg_sched.paths;
+        bg_sched.path_sum += path;
+        if (path > bg_sched.path_max)
+                bg_sched.path_max = path;
+
+        bg_acc.path += path;
+        bg_acc.backlog += backlog;
+        if (++bg_acc_n < bg_span)
+                return;
+
+        if (BG_HISTORY == bg_nb_points) {
+                /* halve the resolution of the time series */
+                for (i = 0; i < BG_HISTORY / 2; i++) {
+                        bg_history[i].time = bg_history[2 * i + 1].time;
+                        bg_history[i].path = (bg_history[2 * i].path +
+                                              bg_history[2 * i + 1].path) / 2;
+                        bg_history[i].backlog = (bg_history[2 * i].backlog +
+                                                 bg_history[2 * i + 1].backlog) / 2;
+                }
+                bg_nb_points = BG_HISTORY / 2;
+                bg_span *= 2;
+                if (bg_acc_n < bg_span)
+                        return;
+        }
+
+        gettimeofday(&now, NULL);
+        bg_history[bg_nb_points].time =
+                (now.tv_sec - bg_start_time.tv_sec) * 1000 +
+                (now.tv_usec - bg_start_time.tv_usec) / 1000;
+        bg_history[bg_nb_points].path = bg_acc.path / bg_acc_n;
+        bg_history[bg_nb_points].backlog = bg_acc.backlog / bg_acc_n;
+        ++bg_nb_points;
+
+        bg_acc.path = 0;
+        bg_acc.backlog = 0;
+        bg_acc_n = 0;
 }
 
 /**
- * bg_trav_nodes - traverse node level of skip list and maintain
+ * bg_trav_nodes - traverse node level of a partition and maintain
+ * @p: the partition
  * @ptst: per-thread state
  * 
  * Note: this will try to remove each of the nodes in the list,
  * in order to extract nodes that have already been logically deleted
- * but that are still accessible.
+ * but that are still accessible. It also samples the key of one
+ * non-deleted node every stride nodes.
  */
-static void bg_trav_nodes(ptst_t *ptst)
+static void bg_trav_nodes(bg_part_t *p, ptst_t *ptst)
 {
         node_t *prev, *node;
+        sl_key_t hi = bg_hi(p);
 
         assert(NULL != set && NULL != set->head);
 
-        prev = set->head;
-        node = prev->next;
-        while (NULL != node) {
+        p->stride = bg_non_deleted / (BG_SAMPLES * bg_nb_parts) + 1;
+        p->non_deleted = 0;
+        p->tall_deleted = 0;
+        p->nb_samples = 0;
+        if (BG_NO_KEY == p->lo)
+                return;
+
+        prev = bg_find_pred(0, p->lo)->node;
+        while (NULL != (node = prev->next) && node->key < p->lo)
+                prev = node;
+        while (NULL != node && node->key < hi) {
                 bg_remove(prev, node, ptst);
-                if (NULL != node->val && node != node->val)
-                        ++bg_non_deleted;
-                else if (node->level >= 1)
-                        ++bg_tall_deleted;
+                if (NULL != node->val && node != node->val) {
+                        if (0 == p->non_deleted % p->stride &&
+                            p->nb_samples < BG_SAMPLES)
+                                p->samples[p->nb_samples++] = node->key;
+                        ++p->non_deleted;
+                } else if (node->level >= 1)
+                        ++p->tall_deleted;
                 prev = node;
                 node = node->next;
         }
@@ -242,86 +723,103 @@ static void bg_trav_nodes(ptst_t *ptst)
 
 /**
  * bg_raise_nlevel - raise level 0 nodes into index levels 
- * @inode: the index node at the start of the bottom index level
+ * @p: the partition
  * @ptst: per-thread state
  *
- * Returns 1 if a node was raised and 0 otherwise.
+ * Note: p->raised is set to 1 if a node was raised and 0 otherwise.
  */
-static int bg_raise_nlevel(inode_t *inode, ptst_t *ptst)
+static void bg_raise_nlevel(bg_part_t *p, ptst_t *ptst)
 {
-        int raised = 0;
         node_t *prev, *node, *next;
-        inode_t *inew, *above, *above_prev;
-
-        above = above_prev = inode;
+        inode_t *inew, *above;
+        sl_key_t hi = bg_hi(p);
 
-        assert(NULL != inode);
+        p->raised = 0;
+        p->unlink = 0;
+        p->first_new = NULL;
+        if (BG_NO_KEY == p->lo)
+                return;
 
-        prev = set->head;
-        node = set->head->next;
+        above = bg_find_pred(0, p->lo);
+        prev = above->node;
+        while (NULL != (node = prev->next) && node->key < p->lo)
+                prev = node;
 
         if (NULL == node)
-                return 0;
+                return;
 
         next = node->next;
 
-        while (NULL != next) {
+        while (NULL != next && node->key < hi) {
                 /* don't raise deleted nodes */
                 if (node != node->val) {
                         if (((prev->level == 0) &&
                              (node->level == 0)) &&
                              (next->level == 0)) {
 
-                                raised = 1;
+                                p->raised = 1;
 
-                                /* get the correct index above and behind */
-                                while (above && above->node->key < node->key) {
+                                /* get the correct index behind */
+                                while (NULL != above->right &&
+                                       above->right->node->key < node->key)
                                         above = above->right;
-                                        if (above != inode->right)
-                                                above_prev = above_prev->right;
-                                }
-
 
                                 /* add a new index item above node */
-                                inew = inode_new(above_prev->right, NULL,
+                                inew = inode_new(above->right, NULL,
                                                  node, ptst);
-                                above_prev->right = inew;
+                                if (above->node->key < p->lo)
+                                        p->first_new = inew;
+                                else
+                                        above->right = inew;
                                 node->level = 1;
-                                above_prev = inode = above = inew;
+                                above = inew;
                         }
                 }
                 prev = node;
                 node = next;
                 next = next->next;
         }
-
-        return raised;
 }
 
 /**
  * bg_raise_ilevel - raise the index levels
- * @iprev: the first index node at this level
- * @iprev_tall: the first index node at the next highest level
- * @height: the height of the level we are raising
+ * @p: the partition
+ * @i: the index level to raise
  * @ptst: per-thread state
  *
- * Returns 1 if a node was raised and 0 otherwise.
+ * Note: p->raised is set to 1 if a node was raised and 0 otherwise.
  */
-static int bg_raise_ilevel(inode_t *iprev, inode_t *iprev_tall,
-                           int height, ptst_t *ptst)
+static void bg_raise_ilevel(bg_part_t *p, int i, ptst_t *ptst)
 {
-        int raised = 0;
-        inode_t *index, *inext, *inew, *above, *above_prev;
-
-        above = above_prev = iprev_tall;
-
-        assert(NULL != iprev);
-        assert(NULL != iprev_tall);
+        inode_t *iprev, *index, *inext, *inew, *above;
+        sl_key_t hi = bg_hi(p);
+        int height = i + 1;
+
+        p->raised = 0;
+        p->unlink = 0;
+        p->first_new = NULL;
+        if (BG_NO_KEY == p->lo)
+                return;
 
+        iprev = bg_find_pred(i, p->lo);
+        above = bg_find_pred(i + 1, p->lo);
         index = iprev->right;
 
-        while ((NULL != index) && (NULL != (inext = index->right))) {
-                while (index->node->val == index->node) {
+        if (iprev->node->key < p->lo) {
+                /* unlinked at the stitching, iprev is not ours */
+                while (NULL != index && index->node->key < hi &&
+                       index->node->val == index->node)
+                        index = index->right;
+                if (index != iprev->right) {
+                        p->first = index;
+                        p->unlink = 1;
+                }
+        }
+
+        while ((NULL != index) && index->node->key < hi &&
+               (NULL != (inext = index->right))) {
+                while (index->node->val == index->node &&
+                       index->node->key < hi) {
                         /* skip deleted nodes */
                         iprev->right = inext;
                         if (NULL == inext)
@@ -330,32 +828,31 @@ static int bg_raise_ilevel(inode_t *iprev, inode_t *iprev_tall,
                         index = inext;
                         inext = inext->right;
                 }
-                if (NULL == inext)
+                if (NULL == inext || index->node->key >= hi)
                         break;
                 if (((iprev->node->level <= height) &&
                      (index->node->level <= height)) &&
                      (inext->node->level <= height)) {
 
-                        raised = 1;
+                        p->raised = 1;
 
-                        /* get the correct index above and behind */
-                        while (above && above->node->key < index->node->key) {
+                        /* get the correct index behind */
+                        while (NULL != above->right &&
+                               above->right->node->key < index->node->key)
                                 above = above->right;
-                                if (above != iprev_tall->right)
-                                        above_prev = above_prev->right;
-                        }
 
-                        inew = inode_new(above_prev->right, index,
+                        inew = inode_new(above->right, index,
                                          index->node, ptst);
-                        above_prev->right = inew;
+                        if (above->node->key < p->lo)
+                                p->first_new = inew;
+                        else
+                                above->right = inew;
                         index->node->level = height + 1;
-                        above_prev = above = iprev_tall = inew;
+                        above = inew;
                 }
                 iprev = index;
                 index = inext;
         }
-
-        return raised;
 }
 
 /**
@@ -403,42 +900,114 @@ void bg_init(set_t *s)
 }
 
 /**
- * bg_start - start the background thread
+ * bg_start - start the background threads
  * @sleep_time: the time to sleep the bg thread per iteration
  *
- * Note: Only starts the background thread if it is not currently
- * running.
+ * Note: Only starts the background threads if they are not currently
+ * running, bg_threads threads maintain the partitions of the list.
  */
 void bg_start(int sleep_time)
 {
+        int k;
+
         if (!bg_running) {
                 bg_running = 1;
                 bg_finished = 0;
                 bg_sleep_time = sleep_time;
+                bg_sleep_shift = 0;
+                memset(&bg_sched, 0, sizeof(bg_sched));
+                memset(&bg_acc, 0, sizeof(bg_acc));
+                bg_nb_points = 0;
+                bg_span = 1;
+                bg_acc_n = 0;
+                gettimeofday(&bg_start_time, NULL);
+
+                bg_nb_parts = bg_threads;
+                if (bg_nb_parts < 1)
+                        bg_nb_parts = 1;
+                if (bg_nb_parts > BG_MAX_THREADS)
+                        bg_nb_parts = BG_MAX_THREADS;
+                bg_quit = 0;
+                if (bg_nb_parts > 1)
+                        pthread_barrier_init(&bg_barrier, NULL, bg_nb_parts);
+                for (k = 0; k < bg_nb_parts; k++)
+                        bg_parts[k].id = k;
+                for (k = 1; k < bg_nb_parts; k++)
+                        pthread_create(&bg_helpers[k], NULL, bg_helper,
+                                       &bg_parts[k]);
                 pthread_create(&bg_thread, NULL, bg_loop, NULL);
         }
 }
 
 /**
- * bg_stop - stop the background thread
+ * bg_stop - stop the background threads
  */
 void bg_stop(void)
 {
+        int k;
+
         if (bg_running) {
                 bg_finished = 1;
                 pthread_join(bg_thread, NULL);
+                for (k = 1; k < bg_nb_parts; k++)
+                        pthread_join(bg_helpers[k], NULL);
+                if (bg_nb_parts > 1)
+                        pthread_barrier_destroy(&bg_barrier);
                 BARRIER();
                 bg_running = 0;
         }
 }
 
+/**
+ * bg_note_insert - count the insert of a new node
+ */
+void bg_note_insert(void)
+{
+        if (NULL == bg_stripe)
+                bg_stripe = &bg_backlog[FAI(&bg_nb_stripes) % BG_STRIPES];
+        FAI(&bg_stripe->inserts);
+}
+
+/**
+ * bg_note_delete - count a logical delete
+ */
+void bg_note_delete(void)
+{
+        if (NULL == bg_stripe)
+                bg_stripe = &bg_backlog[FAI(&bg_nb_stripes) % BG_STRIPES];
+        FAI(&bg_stripe->deletes);
+}
+
 /**
  * bg_print_stats - print background statistics
  *
- * Note: this is a noop if BG_STATS is not defined.
+ * Note: the scheduling and staleness statistics are those since the
+ * last bg_start(), the others are only printed if BG_STATS is defined.
  */
 void bg_print_stats(void)
 {
+        int i, k, largest = 0;
+
+        printf("#bg wake-ups  : %lu (%lu passes, %lu node passes)\n",
+               bg_sched.wakeups, bg_sched.passes, bg_sched.node_passes);
+        for (k = 0; k < bg_nb_parts; k++)
+                if (bg_parts[k].non_deleted > largest)
+                        largest = bg_parts[k].non_deleted;
+        printf("  #threads    : %d (largest partition %f %%)\n",
+               bg_nb_parts,
+               bg_non_deleted ? 100.0 * largest / bg_non_deleted : 0.0);
+        printf("  #avg sleep  : %f (us, last %d)\n",
+               bg_sched.wakeups ?
+               (double) bg_sched.sleep_sum / bg_sched.wakeups : 0.0,
+               bg_sleep_time >> bg_sleep_shift);
+        printf("  #path length: %f (max %f)\n",
+               bg_sched.paths ? bg_sched.path_sum / bg_sched.paths : 0.0,
+               bg_sched.path_max);
+        for (i = 0; i < bg_nb_points; i++)
+                printf("    %8lu ms : path %f, backlog %f\n",
+                       bg_history[i].time, bg_history[i].path,
+                       bg_history[i].backlog);
+
         #ifdef BG_STATS
         printf("Loops = %i\n", bg_stats.loops);
         printf("Raises = %i\n", bg_stats.raises);
@@ -9,10 +9,17 @@
 #include "skiplist.h"
 #include "ptst.h"
 
+/* 1 (default) to scale the maintenance to the backlog, 0 for fixed */
+extern int bg_adaptive;
+/* number of maintenance threads (default 1), read by bg_start() */
+extern int bg_threads;
+
 void bg_init(set_t *s);
 void bg_start(int sleep_time);
 void bg_stop(void);
 void bg_print_stats(void);
+void bg_note_insert(void);
+void bg_note_delete(void);
 void bg_remove(node_t *prev, node_t *node, ptst_t *ptst);
 void bg_help_remove(node_t *prev, node_t *node, ptst_t *ptst);
 
@@ -39,6 +39,19 @@ the appropriate action is taken based on the abstract operation
 being performed. For example, if we are conducting a delete and
 node.key is equal to the search key, then we try to extract node.
 
+The range scans sl_range() and sl_range_snapshot() find the entry-point
+of the lowest key of their range the same way and then walk the node
+level up to the highest key. The linearizable one validates the walk
+against the stripes of the update counters of the set, see
+nohotspot_ops.h.
+
+The delete-min sl_pq_delete_min() walks the node level from the head
+and logically deletes the first node it finds with a value, as a delete
+does. It leaves the physical removal of the node to the background
+thread, so that a delete-min only writes the value of the node it
+deletes, at the cost of going through the logically deleted nodes that
+the background thread did not remove yet.
+
 Worthy to note is that worker threads in this skip list implementation
 do not perform maintenance of the index levels: this is carried 
 out by a background thread. Worker threads do, however, perform
@@ -61,8 +74,19 @@ finished.
 #include "garbagecoll.h"
 #include "ptst.h"
 
+int sl_range_linearizable = 0;
+
 /* - Private Functions - */
 
+static __thread struct sl_pq_stats {
+        unsigned long deletes;
+        unsigned long skipped;
+} sl_pq;
+
+static node_t* sl_entry(set_t *set, sl_key_t key);
+static void sl_update_begin(set_t *set, sl_key_t key);
+static void sl_update_end(set_t *set, sl_key_t key, int modified);
+
 static int sl_finish_contains(sl_key_t key, node_t *node, val_t node_val,
                               ptst_t *ptst);
 static int sl_finish_delete(sl_key_t key, node_t *node, val_t node_val,
@@ -122,6 +146,7 @@ static int sl_finish_delete(sl_key_t key, node_t *node, val_t node_val,
                                 }
                                 else if (CAS(&node->val, node_val, NULL)) {
                                         result = 1;
+                                        bg_note_delete();
 
                                         break;
                                 }
@@ -176,6 +201,7 @@ static int sl_finish_insert(sl_key_t key, val_t val, node_t *node,
                         if (NULL != next)
                                 next->prev = new; /* safe */
                         result = 1;
+                        bg_note_insert();
                 } else {
                         node_delete(new, ptst);
                 }
@@ -184,6 +210,66 @@ static int sl_finish_insert(sl_key_t key, val_t val, node_t *node,
         return result;
 }
 
+/**
+ * sl_entry - find an entry-point to the node level
+ * @set: the skip list set
+ * @key: the search key
+ *
+ * Returns the node of the index item with the greatest key less than
+ * @key, or equal to it if the descent stops there.
+ */
+static node_t* sl_entry(set_t *set, sl_key_t key)
+{
+        inode_t *item, *next_item;
+
+        item = set->top;
+        while (1) {
+                next_item = item->right;
+                if (NULL == next_item || next_item->node->key > key) {
+                        next_item = item->down;
+                        if (NULL == next_item)
+                                return item->node;
+                } else if (next_item->node->key == key) {
+                        return item->node;
+                }
+                item = next_item;
+        }
+}
+
+/**
+ * sl_update_begin - announce an update in the stripe of its key
+ * @set: the skip list set
+ * @key: the key of the update
+ *
+ * Note: waits while a range scan blocks the updates.
+ */
+static void sl_update_begin(set_t *set, sl_key_t key)
+{
+        volatile AO_t *word = &set->stripes[key % SL_STRIPES].word;
+
+        while (1) {
+                AO_fetch_and_add_full(word, SL_STRIPE_PENDING);
+                if (!AO_load_full(&set->range_gate))
+                        return;
+                AO_fetch_and_add_full(word, (AO_t) -SL_STRIPE_PENDING);
+                while (AO_load_full(&set->range_gate))
+                        ;
+        }
+}
+
+/**
+ * sl_update_end - complete an update announced by sl_update_begin()
+ * @set: the skip list set
+ * @key: the key of the update
+ * @modified: 1 if the update modified the set, 0 otherwise
+ */
+static void sl_update_end(set_t *set, sl_key_t key, int modified)
+{
+        AO_fetch_and_add_full(&set->stripes[key % SL_STRIPES].word,
+                              modified ? SL_STRIPE_VERSION_INC -
+                              SL_STRIPE_PENDING : (AO_t) -SL_STRIPE_PENDING);
+}
+
 /* - The public nohotspot_ops interface - */
 
 /**
@@ -198,7 +284,6 @@ static int sl_finish_insert(sl_key_t key, val_t val, node_t *node,
  */
 int sl_do_operation(set_t *set, sl_optype_t optype, sl_key_t key, val_t val)
 {
-        inode_t *item = NULL, *next_item = NULL;
         node_t *node = NULL, *next = NULL;
         val_t node_val = NULL, *next_val = NULL;
         int result = 0;
@@ -206,26 +291,15 @@ int sl_do_operation(set_t *set, sl_optype_t optype, sl_key_t key, val_t val)
 
         assert(NULL != set);
 
+        if (sl_range_linearizable && CONTAINS != optype)
+                sl_update_begin(set, key);
+
 #ifdef USE_GC
         ptst = ptst_critical_enter();
 #endif
 
         /* find an entry-point to the node-level */
-        item = set->top;
-        while (1) {
-                next_item = item->right;
-                if (NULL == next_item || next_item->node->key > key) {
-                        next_item = item->down;
-                        if (NULL == next_item) {
-                                node = item->node;
-                                break;
-                        }
-                } else if (next_item->node->key == key) {
-                        node = item->node;
-                        break;
-                }
-                item = next_item;
-        }
+        node = sl_entry(set, key);
         /* find the correct node and next */
         while (1) {
                 while (node == (node_val = node->val)) {
@@ -256,9 +330,190 @@ int sl_do_operation(set_t *set, sl_optype_t optype, sl_key_t key, val_t val)
                 node = next;
         }
 
+#ifdef USE_GC
+        ptst_critical_exit(ptst);
+#endif
+
+        if (sl_range_linearizable && CONTAINS != optype)
+                sl_update_end(set, key, 1 == result);
+
+        return result;
+}
+
+/**
+ * sl_range - weakly consistent scan of a range of keys
+ * @set: the skip list set
+ * @lo: the lowest key of the range
+ * @hi: the highest key of the range
+ * @keys: the array receiving the keys
+ * @max: the size of @keys
+ *
+ * Returns the number of keys written to @keys.
+ * Note: the scan walks the node level from the entry-point of @lo as
+ * sl_do_operation() does, so each node found logically deleted is
+ * skipped and each node found physically removed is helped out.
+ */
+int sl_range(set_t *set, sl_key_t lo, sl_key_t hi, sl_key_t *keys, int max)
+{
+        node_t *node, *next;
+        val_t node_val;
+        int n = 0;
+        ptst_t *ptst;
+
+        assert(NULL != set);
+
+#ifdef USE_GC
+        ptst = ptst_critical_enter();
+#endif
+
+        node = sl_entry(set, lo);
+        while (n < max) {
+                while (node == (node_val = node->val)) {
+                        node = node->prev;
+                }
+                next = node->next;
+                if (NULL != next && (node_t*)next->val == next) {
+                        bg_help_remove(node, next, ptst);
+                        continue;
+                }
+                /* lo moves past each key reported, not to report it twice */
+                if (node->key >= lo && node->key <= hi && NULL != node_val) {
+                        keys[n++] = node->key;
+                        lo = node->key + 1;
+                }
+                if (NULL == next || next->key > hi)
+                        break;
+                node = next;
+        }
+
+#ifdef USE_GC
+        ptst_critical_exit(ptst);
+#endif
+
+        return n;
+}
+
+/**
+ * sl_range_snapshot - linearizable scan of a range of keys
+ * @set: the skip list set
+ * @lo: the lowest key of the range
+ * @hi: the highest key of the range
+ * @keys: the array receiving the keys
+ * @max: the size of @keys
+ * @retries: the number of scans before blocking the updates
+ * @stat: the statistics of the calling thread
+ *
+ * Returns the number of keys written to @keys.
+ * Note: only the stripes of the keys of the range are validated, so the
+ * updates of other keys do not invalidate the scan.
+ */
+int sl_range_snapshot(set_t *set, sl_key_t lo, sl_key_t hi, sl_key_t *keys,
+                      int max, int retries, sl_range_stat_t *stat)
+{
+        AO_t words[SL_STRIPES];
+        int nb, i, n, attempt, valid;
+
+        assert(sl_range_linearizable);
+
+        if (hi < lo)
+                return 0;
+        nb = (hi - lo < SL_STRIPES) ? (int) (hi - lo) + 1 : SL_STRIPES;
+
+        for (attempt = 0; attempt < retries; attempt++) {
+                valid = 1;
+                for (i = 0; i < nb && valid; i++) {
+                        words[i] = AO_load_full(&set->stripes[(lo + i) %
+                                                SL_STRIPES].word);
+                        valid = !(words[i] & SL_STRIPE_MASK);
+                }
+                if (valid) {
+                        n = sl_range(set, lo, hi, keys, max);
+                        for (i = 0; i < nb && valid; i++)
+                                valid = (AO_load_full(&set->stripes[(lo + i) %
+                                         SL_STRIPES].word) == words[i]);
+                        if (valid) {
+                                stat->keys += n;
+                                return n;
+                        }
+                }
+                stat->retries++;
+        }
+
+        /* block the updates and wait for those in progress */
+        FAI(&set->range_gate);
+        for (i = 0; i < nb; i++)
+                while (AO_load_full(&set->stripes[(lo + i) %
+                                    SL_STRIPES].word) & SL_STRIPE_MASK)
+                        ;
+        n = sl_range(set, lo, hi, keys, max);
+        FAD(&set->range_gate);
+        stat->keys += n;
+        stat->blocked++;
+
+        return n;
+}
+
+/**
+ * sl_pq_delete_min - delete the lowest key of the set
+ * @set: the skip list set
+ * @key: set to the deleted key
+ *
+ * Returns 1 if a key was deleted and 0 if the set was found empty.
+ * Note: the walk helps out the nodes found physically removed, as
+ * sl_do_operation() does.
+ */
+int sl_pq_delete_min(set_t *set, sl_key_t *key)
+{
+        node_t *node, *next;
+        val_t node_val;
+        int result = 0;
+        ptst_t *ptst;
+
+        assert(NULL != set);
+
+#ifdef USE_GC
+        ptst = ptst_critical_enter();
+#endif
+
+        sl_pq.deletes++;
+        node = set->head;
+        while (1) {
+                while (node == (node_val = node->val)) {
+                        node = node->prev;
+                }
+                next = node->next;
+                if (NULL != next && (node_t*)next->val == next) {
+                        bg_help_remove(node, next, ptst);
+                        continue;
+                }
+                if (NULL != node_val) {
+                        if (CAS(&node->val, node_val, NULL)) {
+                                *key = node->key;
+                                result = 1;
+                                bg_note_delete();
+                                break;
+                        }
+                        continue;
+                }
+                if (NULL == next)
+                        break;
+                if (node != set->head)
+                        sl_pq.skipped++;
+                node = next;
+        }
+
 #ifdef USE_GC
         ptst_critical_exit(ptst);
 #endif
 
         return result;
 }
+
+/**
+ * sl_pq_stats - statistics of the delete-mins of the calling thread
+ */
+void sl_pq_stats(unsigned long *deletes, unsigned long *skipped)
+{
+        *deletes = sl_pq.deletes;
+        *skipped = sl_pq.skipped;
+}
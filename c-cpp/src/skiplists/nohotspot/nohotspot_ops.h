@@ -19,9 +19,49 @@ enum sl_optype {
 
 int sl_do_operation(set_t *set, sl_optype_t optype, sl_key_t key, val_t val);
 
+/*
+ * sl_range writes the keys of the set in [lo, hi] to keys, in increasing
+ * order and at most max of them, and returns their number. The scan is
+ * weakly consistent: each key present during the whole scan is reported
+ * and each reported key was present at some point of the scan.
+ */
+int sl_range(set_t *set, sl_key_t lo, sl_key_t hi, sl_key_t *keys, int max);
+
+/*
+ * Set sl_range_linearizable before any update to count the updates in the
+ * stripes of the set, at the cost of two atomic increments per update.
+ * sl_range_snapshot then validates the weakly consistent scan against the
+ * stripes of its keys: it is linearized before the validation if no
+ * update of these keys was in progress or completed during the scan.
+ * After "retries" unsuccessful scans, it prevents new updates from
+ * starting and waits for the updates in progress to complete.
+ */
+extern int sl_range_linearizable;
+
+typedef struct sl_range_stat {
+        unsigned long keys;     /* keys reported by the scans */
+        unsigned long retries;  /* unsuccessful validations */
+        unsigned long blocked;  /* scans that blocked the updates */
+} sl_range_stat_t;
+
+int sl_range_snapshot(set_t *set, sl_key_t lo, sl_key_t hi, sl_key_t *keys,
+                      int max, int retries, sl_range_stat_t *stat);
+
+/*
+ * Priority queue on the set: sl_pq_insert adds a key as sl_insert does,
+ * sl_pq_delete_min deletes the lowest key, writes it to key and returns 1,
+ * or returns 0 if it found the set empty. The deleted nodes are removed
+ * by the background thread. sl_pq_stats returns the delete-mins of the
+ * calling thread and the logically deleted nodes they went through.
+ * The delete-mins are not counted by the linearizable range scans.
+ */
+int sl_pq_delete_min(set_t *set, sl_key_t *key);
+void sl_pq_stats(unsigned long *deletes, unsigned long *skipped);
+
 /* these are macros instead of functions to improve performance */
 #define sl_contains(a, b) sl_do_operation((a), CONTAINS, (b), NULL);
 #define sl_delete(a, b) sl_do_operation((a), DELETE, (b), NULL);
 #define sl_insert(a, b, c) sl_do_operation((a), INSERT, (b), (c));
+#define sl_pq_insert(a, b, c) sl_do_operation((a), INSERT, (b), (c))
 
 #endif /* NOHOTSPOT_OPS_H_ */
@@ -32,6 +32,9 @@ to implement this way.
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <assert.h>
 
 #include "common.h"
 #include "skiplist.h"
@@ -41,6 +44,79 @@ to implement this way.
 
 static int gc_id[NUM_LEVELS];
 
+/* a key range of a bulk load, built by one thread */
+typedef struct bulk_range {
+        sl_key_t *keys;
+        val_t    *vals;
+        int      lo, hi;        /* positions of the range in the keys */
+        int      levels;
+        node_t   *first, *last;
+        inode_t  *ifirst[MAX_LEVELS], *ilast[MAX_LEVELS];
+} bulk_range_t;
+
+/**
+ * bulk_height - the tower height of the node at position @pos (from 1)
+ * of a perfectly balanced skip list of @levels index levels: the number
+ * of trailing zeros of @pos, so that every 2^i-th node reaches level i.
+ */
+static int bulk_height(unsigned long pos, int levels)
+{
+        int h = 0;
+
+        while (h < levels && 0 == (pos & 1)) {
+                pos >>= 1;
+                h++;
+        }
+        return h;
+}
+
+/**
+ * bulk_build - build the nodes and index nodes of a key range
+ * @arg: the bulk_range_t of the range
+ *
+ * Note: the nodes and the index nodes of each level are chained
+ * within the range only, the ranges are linked by set_bulk_load.
+ */
+static void* bulk_build(void *arg)
+{
+        bulk_range_t *r = (bulk_range_t*) arg;
+        node_t *node, *prev = NULL;
+        inode_t *inode, *down;
+        ptst_t *ptst;
+        int i, h, l;
+
+        ptst = ptst_critical_enter();
+        for (l = 0; l < r->levels; l++)
+                r->ifirst[l] = r->ilast[l] = NULL;
+        r->first = NULL;
+        for (i = r->lo; i < r->hi; i++) {
+                assert(0 == i || r->keys[i - 1] < r->keys[i]);
+                h = bulk_height(i + 1, r->levels);
+                node = node_new(r->keys[i],
+                                r->vals ? r->vals[i] : (val_t) r->keys[i],
+                                prev, NULL, h, ptst);
+                if (NULL == prev)
+                        r->first = node;
+                else
+                        prev->next = node;
+                prev = node;
+
+                down = NULL;
+                for (l = 0; l < h; l++) {
+                        inode = inode_new(NULL, down, node, ptst);
+                        if (NULL == r->ilast[l])
+                                r->ifirst[l] = inode;
+                        else
+                                r->ilast[l]->right = inode;
+                        r->ilast[l] = down = inode;
+                }
+        }
+        r->last = prev;
+        ptst_critical_exit(ptst);
+
+        return NULL;
+}
+
 /* - Public skiplist interface - */
 
 /**
@@ -144,6 +220,8 @@ set_t* set_new(int start)
         set->top->node  = set->head;
 
         set->raises = 0;
+        memset((void*) set->stripes, 0, sizeof(set->stripes));
+        set->range_gate = 0;
 
         bg_init(set);
         if (start)
@@ -152,6 +230,93 @@ set_t* set_new(int start)
         return set;
 }
 
+/**
+ * set_bulk_load - build the set from sorted keys
+ * @set: the empty set, its background threads stopped
+ * @keys: the keys, in increasing order and above 0 (the key of the head)
+ * @vals: the values of the keys, or NULL to map each key to itself
+ * @n: the number of keys
+ * @nb_threads: the number of threads building the key ranges
+ *
+ * Builds the node level and a perfectly balanced index in one pass, the
+ * index the background thread converges to: floor(log2(@n)) index levels,
+ * the i-th node reaching level bulk_height(i). Each thread builds the
+ * nodes and index nodes of a contiguous range of the keys, the ranges
+ * are then linked at each level.
+ *
+ * Returns the number of index levels.
+ */
+int set_bulk_load(set_t *set, sl_key_t *keys, val_t *vals, int n,
+                  int nb_threads)
+{
+        bulk_range_t *ranges;
+        pthread_t *threads;
+        node_t *last = set->head;
+        inode_t *ilast[MAX_LEVELS], *top;
+        ptst_t *ptst;
+        int levels = 1, k, l;
+
+        assert(NULL == set->head->next && NULL == set->top->right &&
+               NULL == set->top->down);
+        assert(0 == n || keys[0] > set->head->key);
+        if (0 == n)
+                return 1;
+        while (levels < MAX_LEVELS - 1 && (2UL << levels) <= (unsigned long) n)
+                levels++;
+        if (nb_threads < 1)
+                nb_threads = 1;
+        if (nb_threads > n)
+                nb_threads = n;
+
+        ranges = malloc(nb_threads * sizeof(bulk_range_t));
+        threads = malloc(nb_threads * sizeof(pthread_t));
+        if (NULL == ranges || NULL == threads) {
+                perror("malloc");
+                exit(1);
+        }
+        for (k = 0; k < nb_threads; k++) {
+                ranges[k].keys = keys;
+                ranges[k].vals = vals;
+                ranges[k].lo = (long) n * k / nb_threads;
+                ranges[k].hi = (long) n * (k + 1) / nb_threads;
+                ranges[k].levels = levels;
+                if (pthread_create(&threads[k], NULL, bulk_build,
+                                   &ranges[k]) != 0) {
+                        fprintf(stderr, "Error creating thread\n");
+                        exit(1);
+                }
+        }
+        for (k = 0; k < nb_threads; k++)
+                pthread_join(threads[k], NULL);
+
+        /* link the ranges, the head index nodes head each level */
+        ptst = ptst_critical_enter();
+        top = set->top;
+        ilast[0] = top;
+        for (l = 1; l < levels; l++)
+                ilast[l] = top = inode_new(NULL, top, set->head, ptst);
+        ptst_critical_exit(ptst);
+        for (k = 0; k < nb_threads; k++) {
+                last->next = ranges[k].first;
+                ranges[k].first->prev = last;
+                last = ranges[k].last;
+                for (l = 0; l < levels; l++) {
+                        if (NULL == ranges[k].ifirst[l])
+                                continue;
+                        ilast[l]->right = ranges[k].ifirst[l];
+                        ilast[l] = ranges[k].ilast[l];
+                }
+        }
+        set->head->level = levels;
+        BARRIER();
+        set->top = top;
+
+        free(ranges);
+        free(threads);
+
+        return levels;
+}
+
 /**
  * set_delete - delete the set
  * @set: the set to delete
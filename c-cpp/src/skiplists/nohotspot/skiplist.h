@@ -41,12 +41,30 @@ struct sl_inode {
         struct sl_node  *node;
 };
 
+/*
+ * The updates are counted in padded stripes of keys when the linearizable
+ * range scans are enabled: the word of a stripe counts the updates in
+ * progress (bits 0-15) and the updates that modified the set (bits 16 and
+ * up).
+ */
+#define SL_STRIPES              64
+#define SL_STRIPE_PENDING       1UL
+#define SL_STRIPE_VERSION_INC   (1UL << 16)
+#define SL_STRIPE_MASK          (SL_STRIPE_VERSION_INC - 1)
+
+typedef struct sl_stripe {
+        volatile AO_t word;
+        char pad[CACHE_LINE_SIZE - sizeof(AO_t)];
+} sl_stripe_t;
+
 /* the skip list set */
 typedef VOLATILE struct sl_set set_t;
 struct sl_set {
         inode_t *top;
         node_t  *head;
         int raises;
+        sl_stripe_t stripes[SL_STRIPES];
+        volatile AO_t range_gate;
 };
 
 node_t* node_new(sl_key_t key, val_t val, node_t *prev, node_t *next,
@@ -58,6 +76,8 @@ void node_delete(node_t *node, ptst_t *ptst);
 void inode_delete(inode_t *inode, ptst_t *ptst);
 
 set_t* set_new(int bg_start);
+int set_bulk_load(set_t *set, sl_key_t *keys, val_t *vals, int n,
+                  int nb_threads);
 void set_delete(set_t *set);
 void set_print(set_t *set, int flag);
 int set_size(set_t *set, int flag);
@@ -39,6 +39,7 @@
 #include "tm.h"
 #include "ptst.h"
 #include "garbagecoll.h"
+#include "bulk_keys.h"
 
 #define DEFAULT_DURATION                10000
 #define DEFAULT_INITIAL                 256
@@ -53,6 +54,13 @@
 #define DEFAULT_TEST                    0
 #define DEFAULT_PARALLELISM             1
 #define DEFAULT_UNBALANCED              0
+#define DEFAULT_MAINTENANCE             1
+#define DEFAULT_BG_THREADS              1
+#define DEFAULT_SCAN                    0
+#define DEFAULT_RANGE_WIDTH             100
+#define DEFAULT_RANGE_RETRIES           16
+#define DEFAULT_PQ                      0
+#define DEFAULT_BULK                    0
 
 #define XSTR(s)                         STR(s)
 #define STR(s)                          #s
@@ -103,6 +111,7 @@ static inline int max(int a, int b) {
 }
 
 #include "intset.h"
+#include "nohotspot_ops.h"
 #include "background.h"
 #include <unistd.h>
 #include <stdbool.h>
@@ -201,6 +210,10 @@ typedef struct thread_data {
 	int unit_tx;
 	int alternate;
 	int effective;
+	int scan;
+	int width;
+	int linearizable;
+	int pq;
 	int cache_monitoring;
     int validation_txs;
 	unsigned long nb_add;
@@ -209,6 +222,10 @@ typedef struct thread_data {
 	unsigned long nb_removed;
 	unsigned long nb_contains;
 	unsigned long nb_found;
+	unsigned long nb_scan;
+	sl_range_stat_t range_stat;
+	unsigned long nb_pq_deletes;
+	unsigned long nb_pq_skipped;
 	unsigned long nb_aborts;
 	unsigned long nb_aborts_locked_read;
 	unsigned long nb_aborts_locked_write;
@@ -299,11 +316,17 @@ void* sanity_check(void *data) {
 
 
 void *test(void *data) {
-	int i, unext, last = -1; 
+	int i, n, unext, last = -1; 
 	unsigned int val = 0;
+	sl_key_t *keys, min;
 	
 	thread_data_t *d = (thread_data_t *)data;
 	
+	if ((keys = (sl_key_t *)malloc(d->width * sizeof(sl_key_t))) == NULL) {
+		perror("malloc");
+		exit(1);
+	}
+	
 	/* Create transaction */
 	TM_THREAD_ENTER();
 
@@ -363,7 +386,8 @@ void *test(void *data) {
 			if (last < 0) { // add
 				
 				val = rand_range_re(&d->seed, d->range);
-				if (sl_add_old(d->set, val, TRANSACTIONAL)) {
+				if (d->pq ? sl_pq_insert(d->set, val, (val_t) ((long) val)) :
+				    sl_add_old(d->set, val, TRANSACTIONAL)) {
 					d->nb_added++;
 					last = val;
 				} 				
@@ -371,7 +395,12 @@ void *test(void *data) {
 				
 			} else { // remove
 				
-				if (d->alternate) { // alternate mode (default)
+				if (d->pq) { // delete-min
+					if (sl_pq_delete_min(d->set, &min)) {
+						d->nb_removed++;
+					}
+					last = -1;
+				} else if (d->alternate) { // alternate mode (default)
 					if (sl_remove_old(d->set, last, TRANSACTIONAL)) {
 						d->nb_removed++;
 					} 
@@ -389,6 +418,17 @@ void *test(void *data) {
 				d->nb_remove++;
 			}
 			
+		} else if (d->scan && rand_range_re(&d->seed, 100 - d->update) <= d->scan) { // range scan
+			
+			val = rand_range_re(&d->seed, d->range);
+			if (d->linearizable)
+				n = sl_range_snapshot(d->set, val, val + d->width - 1, keys, d->width,
+				                      DEFAULT_RANGE_RETRIES, &d->range_stat);
+			else
+				n = sl_range(d->set, val, val + d->width - 1, keys, d->width);
+			d->range_stat.keys += d->linearizable ? 0 : n;
+			d->nb_scan++;
+			
 		} else { // read
 			
 			if (d->alternate) {
@@ -419,7 +459,7 @@ void *test(void *data) {
 		/* Is the next op an update? */
 		if (d->effective) { // a failed remove/add is a read-only tx
 			unext = ((100 * (d->nb_added + d->nb_removed))
-							 < (d->update * (d->nb_add + d->nb_remove + d->nb_contains)));
+							 < (d->update * (d->nb_add + d->nb_remove + d->nb_contains + d->nb_scan)));
 		} else { // remove/add (even failed) is considered as an update
 			unext = (rand_range_re(&d->seed, 100) - 1 < d->update);
 		}
@@ -443,6 +483,8 @@ void *test(void *data) {
 
         for (i = 0; i < NUM_EVENTS; i++) close(fds[i]);
     }
+	sl_pq_stats(&d->nb_pq_deletes, &d->nb_pq_skipped);
+	free(keys);
 
 	/* Free transaction */
 	TM_THREAD_EXIT();
@@ -482,12 +524,19 @@ int main(int argc, char **argv)
 		{"initial-size",              required_argument, NULL, 'i'},
 		{"num-threads",               required_argument, NULL, 'n'},
 		{"range",                     required_argument, NULL, 'r'},
-		{"seed",                      required_argument, NULL, 's'},
+		{"seed",                      required_argument, NULL, 'S'},
 		{"update-rate",               required_argument, NULL, 'u'},
 		{"elasticity",                required_argument, NULL, 'x'},
 		{"cache monitoring", required_argument, NULL, 'm'},
         {"test mode", required_argument, NULL, 'v'},
 		{"population parallelism",    required_argument, NULL, 'p'},
+		{"maintenance",               required_argument, NULL, 'M'},
+		{"bg-threads",                required_argument, NULL, 'K'},
+		{"scan-rate",                 required_argument, NULL, 's'},
+		{"range-width",               required_argument, NULL, 'w'},
+		{"linearizable",              no_argument,       NULL, 'L'},
+		{"priority-queue",            required_argument, NULL, 'q'},
+		{"bulk",                      required_argument, NULL, 'B'},
 		{NULL, 0, NULL, 0}
 	};
 	
@@ -495,7 +544,7 @@ int main(int argc, char **argv)
 	int i, c, size;
 	unsigned int last = 0; 
 	unsigned int val = 0;
-	unsigned long reads, effreads, updates, effupds, aborts, aborts_locked_read, aborts_locked_write,
+	unsigned long reads, effreads, updates, effupds, scans, scanned, scan_retries, scan_blocked, pq_deletes, pq_skipped, aborts, aborts_locked_read, aborts_locked_write,
 	aborts_validate_read, aborts_validate_write, aborts_validate_commit,
 	aborts_invalid_memory, aborts_double_write, max_retries, failures_because_contention,
 	L1_cache_accesses, L1_cache_misses, L3_cache_accesses, L3_cache_misses, total_cache_accesses, total_cache_misses;
@@ -518,6 +567,15 @@ int main(int argc, char **argv)
 	int cache_monitoring = DEFAULT_MONITOR;
     int test_mode = DEFAULT_TEST;
 	int pop_par = DEFAULT_PARALLELISM;
+	int maintenance = DEFAULT_MAINTENANCE;
+	int nb_bg_threads = DEFAULT_BG_THREADS;
+	int scan = DEFAULT_SCAN;
+	int width = DEFAULT_RANGE_WIDTH;
+	int linearizable = 0;
+	int pq = DEFAULT_PQ;
+	int bulk = DEFAULT_BULK;
+	sl_key_t *keys;
+	struct timeval pop_start, pop_end;
 	sigset_t block_set;
         struct sl_ptst *ptst;
         struct sl_node *temp;
@@ -526,7 +584,7 @@ int main(int argc, char **argv)
 
 	while(1) {
 		i = 0;
-		c = getopt_long(argc, argv, "hAf:d:i:t:r:S:u:x:U:m:v:p:"
+		c = getopt_long(argc, argv, "hALf:d:i:t:r:S:u:x:U:m:v:p:M:K:s:w:q:B:"
 										, long_options, &i);
 		
 		if(c == -1)
@@ -564,6 +622,14 @@ int main(int argc, char **argv)
 								 "        RNG seed (0=time-based, default=" XSTR(DEFAULT_SEED) ")\n"
 								 "  -u, --update-rate <int>\n"
 								 "        Percentage of update transactions (default=" XSTR(DEFAULT_UPDATE) ")\n"
+								 "  -s, --scan-rate <int>\n"
+								 "        Percentage of range scans, at most 100 - update rate (default=" XSTR(DEFAULT_SCAN) ")\n"
+								 "  -w, --range-width <int>\n"
+								 "        Number of consecutive keys of a range scan (default=" XSTR(DEFAULT_RANGE_WIDTH) ")\n"
+								 "  -L, --linearizable\n"
+								 "        Linearizable range scans, updates are counted per stripe of keys\n"
+								 "  -q, --priority-queue <int>\n"
+								 "        Removes delete the minimum, the background thread removes the nodes (default=" XSTR(DEFAULT_PQ) ")\n"
 								 "  -x, --elasticity (default=4)\n"
 								 "        Use elastic transactions\n"
 								 "        0 = non-protected,\n"
@@ -580,11 +646,35 @@ int main(int argc, char **argv)
                                  "        non-zero = validate correctness, dictates number of validation txs,\n"
 								 "  -p, --population parallelism <int>\n"
                 				 "        Number of threads that take part in the set initialization(default=" XSTR(DEFAULT_PARALLELISM) ")\n"
+								 "  -M, --maintenance <int>\n"
+								 "        Background maintenance (default=" XSTR(DEFAULT_MAINTENANCE) ")\n"
+								 "        0 = traverse the list at a fixed interval,\n"
+								 "        1 = adapt the interval and the passes to the backlog\n"
+								 "  -K, --bg-threads <int>\n"
+								 "        Number of maintenance threads, each maintains a key range (default=" XSTR(DEFAULT_BG_THREADS) ")\n"
+								 "  -B, --bulk <int>\n"
+								 "        Bulk load the initial keys, sorted, with a balanced index, using this\n"
+								 "        number of threads (0=insert them one by one, default=" XSTR(DEFAULT_BULK) ")\n"
 								 );
 					exit(0);
 				case 'A':
 					alternate = 1;
 					break;
+				case 'L':
+					linearizable = 1;
+					break;
+				case 'q':
+					pq = atoi(optarg);
+					break;
+				case 'B':
+					bulk = atoi(optarg);
+					break;
+				case 's':
+					scan = atoi(optarg);
+					break;
+				case 'w':
+					width = atoi(optarg);
+					break;
 				case 'f':
 					effective = atoi(optarg);
 					break;
@@ -621,6 +711,12 @@ int main(int argc, char **argv)
 				case 'p':
 					pop_par = atoi(optarg);
 					break;
+				case 'M':
+					maintenance = atoi(optarg);
+					break;
+				case 'K':
+					nb_bg_threads = atoi(optarg);
+					break;
 				case '?':
 					printf("Use -h or --help for help\n");
 					exit(0);
@@ -634,6 +730,10 @@ int main(int argc, char **argv)
 	assert(nb_threads > 0);
 	assert(range > 0 && range >= initial);
 	assert(update >= 0 && update <= 100);
+	assert(nb_bg_threads > 0);
+	assert(scan >= 0 && scan <= 100 - update);
+	assert(width > 0);
+	assert(!pq || !linearizable);
 	
 	printf("Set type     : skip list\n");
 	printf("Duration     : %d\n", duration);
@@ -645,6 +745,12 @@ int main(int argc, char **argv)
 	printf("Elasticity   : %d\n", unit_tx);
 	printf("Alternate    : %d\n", alternate);
 	printf("Efffective   : %d\n", effective);
+	printf("Maintenance  : %s\n", maintenance ? "adaptive" : "fixed");
+	printf("Bg threads   : %d\n", nb_bg_threads);
+	printf("Scan rate    : %d\n", scan);
+	printf("Range width  : %d\n", width);
+	printf("Linearizable : %d\n", linearizable);
+	printf("Prio. queue  : %d\n", pq);
 	printf("Type sizes   : int=%d/long=%d/ptr=%d/word=%d\n",
 				 (int)sizeof(int),
 				 (int)sizeof(long),
@@ -678,6 +784,7 @@ int main(int argc, char **argv)
         ptst_subsystem_init();
         gc_subsystem_init();
         set_subsystem_init();
+        sl_range_linearizable = linearizable;
         set = set_new(1);
 	stop = 0;
 
@@ -698,69 +805,88 @@ int main(int argc, char **argv)
 	TM_STARTUP();
 	
 	// Populate set 
-	printf("Adding %d entries to set\n", initial);
-	if (pop_par == 1 || initial < 1000000) {
-		i = 0;
-		while (i < initial) {
-			if (unbalanced)
-							val = rand_range_re(&global_seed, initial);
-			else
-							val = rand_range_re(&global_seed, range);
-			if (sl_add_old(set, val, 0)) {
-				last = val;
-				i++;
-			}
-		}
+	gettimeofday(&pop_start, NULL);
+	if (bulk > 0 && initial > 0) {
+		printf("Bulk loading %d entries to set\n", initial);
+		keys = bulk_keys(initial, unbalanced ? initial : range, &global_seed);
+		bg_stop();
+		i = set_bulk_load(set, keys, NULL, initial, bulk);
+		last = keys[initial - 1];
+		free(keys);
 		size = set_size(set, 1);
-		printf("Set size     : %d\n", size); // avoid sequential traversal during parallel population
-		printf("Level max    : %d\n", levelmax);
-	}
-	else{ // currently does not support unbalanced
-		pthread_attr_init(&attr);
-		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
-		for (i=0; i<pop_par; i++) {
-			pop_data[i].lastp = (i==0) ? &last : NULL;
-			pop_data[i].range = range;
-			pop_data[i].set = set;
-			pop_data[i].to_populate = initial/pop_par + ((i==0) ? (initial % pop_par) : 0);
-			if (pthread_create(&threads[i], &attr, set_populate, (void *)(&pop_data[i])) != 0) {
-				fprintf(stderr, "Error creating thread\n");
-				exit(1);
+		printf("Set size     : %d\n", size);
+		printf("Number of levels is %d\n", i);
+	} else {
+		printf("Adding %d entries to set\n", initial);
+		if (pop_par == 1 || initial < 1000000) {
+			i = 0;
+			while (i < initial) {
+				if (unbalanced)
+								val = rand_range_re(&global_seed, initial);
+				else
+								val = rand_range_re(&global_seed, range);
+				if (sl_add_old(set, val, 0)) {
+					last = val;
+					i++;
+				}
 			}
+			size = set_size(set, 1);
+			printf("Set size     : %d\n", size); // avoid sequential traversal during parallel population
+			printf("Level max    : %d\n", levelmax);
 		}
-		pthread_attr_destroy(&attr);
-		for (i = 0; i < pop_par; i++) {
-			if (pthread_join(threads[i], NULL) != 0) {
-				fprintf(stderr, "Error waiting for thread completion\n");
-				exit(1);
+		else{ // currently does not support unbalanced
+			pthread_attr_init(&attr);
+			pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+			for (i=0; i<pop_par; i++) {
+				pop_data[i].lastp = (i==0) ? &last : NULL;
+				pop_data[i].range = range;
+				pop_data[i].set = set;
+				pop_data[i].to_populate = initial/pop_par + ((i==0) ? (initial % pop_par) : 0);
+				if (pthread_create(&threads[i], &attr, set_populate, (void *)(&pop_data[i])) != 0) {
+					fprintf(stderr, "Error creating thread\n");
+					exit(1);
+				}
 			}
-		}
-  	} 
-
-        // nullify all the index nodes we created so
-        // we can start again and rebalance the skip list
-        bg_stop();
-
-        // the following code is hacky since it creates a memory
-        // leak - we cut off all the nodes in the index levels
-        // without reclaiming them - this is only a one-off though
-        ptst = ptst_critical_enter();
-        set->top = inode_new(NULL, NULL, set->head, ptst);
-        ptst_critical_exit(ptst);
-        set->head->level = 1;
-        temp = set->head->next;
-        while (temp) {
-            temp->level = 0;
-            temp = temp->next;
-        }
-
-        // wait till the list is balanced
-        bg_start(0);
-        while (set->head->level < floor_log_2(initial)) {
-            AO_nop_full();
-        }
-        printf("Number of levels is %d\n", set->head->level);
-        bg_stop();
+			pthread_attr_destroy(&attr);
+			for (i = 0; i < pop_par; i++) {
+				if (pthread_join(threads[i], NULL) != 0) {
+					fprintf(stderr, "Error waiting for thread completion\n");
+					exit(1);
+				}
+			}
+	  	} 
+
+	        // nullify all the index nodes we created so
+	        // we can start again and rebalance the skip list
+	        bg_stop();
+
+	        // the following code is hacky since it creates a memory
+	        // leak - we cut off all the nodes in the index levels
+	        // without reclaiming them - this is only a one-off though
+	        ptst = ptst_critical_enter();
+	        set->top = inode_new(NULL, NULL, set->head, ptst);
+	        ptst_critical_exit(ptst);
+	        set->head->level = 1;
+	        temp = set->head->next;
+	        while (temp) {
+	            temp->level = 0;
+	            temp = temp->next;
+	        }
+
+	        // wait till the list is balanced
+	        bg_start(0);
+	        while (set->head->level < floor_log_2(initial)) {
+	            AO_nop_full();
+	        }
+	        printf("Number of levels is %d\n", set->head->level);
+	        bg_stop();
+	}
+	gettimeofday(&pop_end, NULL);
+	printf("Populate time: %d ms\n",
+	       (int)((pop_end.tv_sec * 1000 + pop_end.tv_usec / 1000) -
+	             (pop_start.tv_sec * 1000 + pop_start.tv_usec / 1000)));
+        bg_adaptive = maintenance;
+        bg_threads = nb_bg_threads;
         bg_start(1000000);
 
         // Access set from all threads 
@@ -776,6 +902,14 @@ int main(int argc, char **argv)
 		data[i].unit_tx = unit_tx;
 		data[i].alternate = alternate;
 		data[i].effective = effective;
+		data[i].scan = scan;
+		data[i].width = width;
+		data[i].linearizable = linearizable;
+		data[i].pq = pq;
+		data[i].nb_pq_deletes = 0;
+		data[i].nb_pq_skipped = 0;
+		data[i].nb_scan = 0;
+		memset(&data[i].range_stat, 0, sizeof(sl_range_stat_t));
 		data[i].nb_add = 0;
 		data[i].nb_added = 0;
 		data[i].nb_remove = 0;
@@ -876,6 +1010,12 @@ int main(int argc, char **argv)
         effreads = 0;
         updates = 0;
         effupds = 0;
+        scans = 0;
+        scanned = 0;
+        scan_retries = 0;
+        scan_blocked = 0;
+        pq_deletes = 0;
+        pq_skipped = 0;
         max_retries = 0;
 		L1_cache_misses = 0;
 		L1_cache_accesses = 0;
@@ -925,6 +1065,12 @@ int main(int argc, char **argv)
                         (data[i].nb_remove - data[i].nb_removed);
             updates += (data[i].nb_add + data[i].nb_remove);
             effupds += data[i].nb_removed + data[i].nb_added;
+            scans += data[i].nb_scan;
+            scanned += data[i].range_stat.keys;
+            scan_retries += data[i].range_stat.retries;
+            scan_blocked += data[i].range_stat.blocked;
+            pq_deletes += data[i].nb_pq_deletes;
+            pq_skipped += data[i].nb_pq_skipped;
             size += data[i].nb_added - data[i].nb_removed;
 			L1_cache_misses += data[i].L1_cache_misses;
 			L1_cache_accesses += data[i].L1_cache_accesses;
@@ -939,7 +1085,7 @@ int main(int argc, char **argv)
         	printf("Set size      : %d (expected: %d)\n", set_size(set, 1), size);
 		}
         printf("Duration      : %d (ms)\n", duration);
-        printf("#txs          : %lu (%f / s)\n", reads + updates, (reads + updates) * 1000.0 / duration);
+        printf("#txs          : %lu (%f / s)\n", reads + updates + scans, (reads + updates + scans) * 1000.0 / duration);
 
         printf("#read txs     : ");
         if (effective) {
@@ -956,6 +1102,17 @@ int main(int argc, char **argv)
                                                               duration);
         } else printf("%lu (%f / s)\n", updates, updates * 1000.0 / duration);
 
+        printf("#range scans  : %lu (%f / s)\n", scans, scans * 1000.0 / duration);
+        printf("  #keys       : %lu (%f / scan)\n", scanned, scans ? (double) scanned / scans : 0.0);
+        if (linearizable) {
+            printf("  #retries    : %lu (%f / scan)\n", scan_retries, scans ? (double) scan_retries / scans : 0.0);
+            printf("  #blocked    : %lu\n", scan_blocked);
+        }
+        if (pq) {
+            printf("#delete-mins  : %lu (%f / s)\n", pq_deletes, pq_deletes * 1000.0 / duration);
+            printf("  #skipped    : %lu (%f / delete-min)\n", pq_skipped, pq_deletes ? (double) pq_skipped / pq_deletes : 0.0);
+        }
+
         printf("#aborts       : %lu (%f / s)\n", aborts, aborts * 1000.0 / duration);
         printf("  #lock-r     : %lu (%f / s)\n", aborts_locked_read, aborts_locked_read * 1000.0 / duration);
         printf("  #lock-w     : %lu (%f / s)\n", aborts_locked_write, aborts_locked_write * 1000.0 / duration);
@@ -10,11 +10,11 @@
  *
  *	This is a custom allocator to process allocation requests for NUMASK. It services
  *	index and intermediate layer node allocation requests. We deploy one instance per NUMA
- *	zone. The inherent latency of the OS call in numa_alloc_local (it mmaps per request)
+ *	zone. The inherent latency of the OS call in numa_alloc_onnode (it mmaps per request)
  *	practically requires these. Our allocator consists of a linear allocator with three
  *	main alterations:
  *		- it can reallocate buffers, if necessary
- *		- allocations are made in a specific NUMA zone
+ *		- allocations are made on the memory node of a specific NUMA zone
  *		- requests are custom aligned for index and intermediate nodes to fit cache lines
  *
  *	A basic linear allocator works as follows: upon initialization, a buffer is allocated.
@@ -28,11 +28,11 @@
 #include "common.h"
 
 /* Constructor */
-numa_allocator::numa_allocator(unsigned ssize)
-	:buf_size(ssize), empty(false), num_buffers(0), buf_old(NULL),
+numa_allocator::numa_allocator(unsigned ssize, int node)
+	:buf_size(ssize), numa_node(node), empty(false), num_buffers(0), buf_old(NULL),
 	 other_buffers(NULL), last_alloc_half(false), cache_size(CACHE_LINE_SIZE)
 {
-	buf_cur = buf_start = numa_alloc_local(buf_size);
+	buf_cur = buf_start = buffer_alloc();
 }
 
 /* Destructor */
@@ -123,7 +123,12 @@ void numa_allocator::nrealloc(void) {
 	}
 
 	// allocate new buffer & update pointers and total size
-	buf_cur = buf_start = numa_alloc_local(buf_size);
+	buf_cur = buf_start = buffer_alloc();
+}
+
+/* buffer_alloc() - allocates a buffer on the memory node of the zone, if known */
+void* numa_allocator::buffer_alloc(void) {
+	return (numa_node >= 0)? numa_alloc_onnode(buf_size, numa_node): numa_alloc(buf_size);
 }
 
 /* align() - gets the aligned size given requested size */
@@ -12,6 +12,7 @@ class numa_allocator {
 private:
 	void*		buf_start;
 	unsigned	buf_size;
+	int			numa_node;
 	void*		buf_cur;
 	bool		empty;
 	void*		buf_old;
@@ -24,10 +25,11 @@ private:
 
 	void nrealloc(void);
 	void nreset(void);
+	void* buffer_alloc(void);
 	inline unsigned align(unsigned old, unsigned alignment);
 
 public:
-	numa_allocator(unsigned ssize);
+	numa_allocator(unsigned ssize, int node);
 	~numa_allocator();
 	void* nalloc(unsigned size);
 	void nfree(void *ptr, unsigned size);
@@ -26,12 +26,14 @@
 #include <numaif.h>
 #include <atomic_ops.h>
 #include <numa.h>
+#include <algorithm>
 
 #include "common.h"
 #include "background.h"
 #include "skiplist.h"
 #include "search.h"
 #include "queue.h"
+#include "topology.h"
 
 /**
  * reset_indermediate_levels() - iterates through intermediate level and sets their level to 0
@@ -108,71 +110,108 @@ static void bg_trav_mnodes(search_layer* sl) {
 }
 
 /**
- *  update_intermediate_layer() - updates intermediate layer from queue
+ *  update_intermediate_layer() - applies a batch of updates from the queue to the
+ *  	intermediate layer
  *  @sl - search layer object for reference
- *  @ijob - node to add/remove to the intermediate layer
+ *
+ *  The jobs are sorted by key (keeping the order of the jobs of a key) and applied
+ *  in one merged pass: the search for a key resumes at each index level from where
+ *  the search for the previous key stopped, and on the intermediate layer from the
+ *  previous position, so that each node is traversed at most once per batch.
+ *  Only the helper of the zone modifies its layers, the positions remain valid.
+ *  Returns the number of jobs applied
  */
-int update_intermediate_layer(search_layer* sl, q_node* job) {
-	if(!job) return 0;
+int update_intermediate_layer(search_layer* sl) {
+	q_job	 batch[QUEUE_BATCH];
+	inode_t* path[MAX_LEVELS];
 	int 	 numa_zone	= sl->get_zone();
-	sl_key_t test_key 	= job->node->key;
-	inode_t* item 		= sl->get_sentinel();
-#ifdef ADDRESS_CHECKING
-	zone_access_check(numa_zone, item, &sl->bg_local_accesses, &sl->bg_foreign_accesses, sl->index_ignore);
-#endif
-	inode_t* next_item	= NULL;
-	mnode_t *mnode, *next;
+	unsigned long pending, lag, now;
+	inode_t  *item, *next_item;
+	mnode_t  *mnode, *next, *last = NULL;
+	int 	 n, i, depth;
+
+	n = sl->get_queue()->pop_batch(batch, QUEUE_BATCH, &pending);
+	if(n == 0) return 0;
+	std::stable_sort(batch, batch + n, [](const q_job& a, const q_job& b) {
+		return a.node->key < b.node->key;
+	});
+	for(depth = 0; depth < MAX_LEVELS; ++depth) {
+		path[depth] = NULL;
+	}
 
-	// index layer traversal
-	while(1) {
-		next_item = item->right;
-#ifdef ADDRESS_CHECKING
-		zone_access_check(numa_zone, next_item, &sl->bg_local_accesses, &sl->bg_foreign_accesses, sl->index_ignore);
-#endif
-		if (NULL == next_item || next_item->key > job->node->key) {
-			next_item = item->down;
+	for(i = 0; i < n; ++i) {
+		node_t*  job_node = batch[i].node;
+		sl_key_t test_key = job_node->key;
+
+		// index layer traversal, resumed at each level
+		item = sl->get_sentinel();
 #ifdef ADDRESS_CHECKING
-			zone_access_check(numa_zone, next_item, &sl->bg_local_accesses, &sl->bg_foreign_accesses, sl->index_ignore);
+		zone_access_check(numa_zone, item, &sl->bg_local_accesses, &sl->bg_foreign_accesses, sl->index_ignore);
 #endif
-			if(NULL == next_item) {
-				mnode = item->intermed;
+		for(depth = 0; ; ++depth) {
+			assert(depth < MAX_LEVELS);
+			if(path[depth] != NULL && path[depth]->key > item->key) {
+				item = path[depth];
+			}
+			while((next_item = item->right) != NULL && next_item->key < test_key) {
 #ifdef ADDRESS_CHECKING
-				zone_access_check(numa_zone, mnode, &sl->bg_local_accesses, &sl->bg_foreign_accesses, sl->index_ignore);
+				zone_access_check(numa_zone, next_item, &sl->bg_local_accesses, &sl->bg_foreign_accesses, sl->index_ignore);
 #endif
+				item = next_item;
+			}
+			path[depth] = item;
+			if(NULL == item->down || (NULL != next_item && next_item->key == test_key)) {
 				break;
 			}
-		} else if (next_item->key == job->node->key) {
-			mnode = item->intermed;
+			item = item->down;
 #ifdef ADDRESS_CHECKING
-			zone_access_check(numa_zone, mnode, &sl->bg_local_accesses, &sl->bg_foreign_accesses, sl->index_ignore);
+			zone_access_check(numa_zone, item, &sl->bg_local_accesses, &sl->bg_foreign_accesses, sl->index_ignore);
 #endif
-			break;
 		}
-		item = next_item;
-	}
+		mnode = item->intermed;
+		if(last != NULL && last->key > mnode->key) {
+			mnode = last;
+		}
+#ifdef ADDRESS_CHECKING
+		zone_access_check(numa_zone, mnode, &sl->bg_local_accesses, &sl->bg_foreign_accesses, sl->index_ignore);
+#endif
 
-	// intermediate layer traversal and actual update
-	while(1) {
-		next = mnode->next;
+		// intermediate layer traversal and actual update
+		while(1) {
+			next = mnode->next;
 #ifdef ADDRESS_CHECKING
-		zone_access_check(numa_zone, next, &sl->bg_local_accesses, &sl->bg_foreign_accesses, sl->index_ignore);
+			zone_access_check(numa_zone, next, &sl->bg_local_accesses, &sl->bg_foreign_accesses, sl->index_ignore);
 #endif
-		if(!next || next->key > test_key) {
-			// if not marked for deletion, we know it's an insert operation
-			if(job->node->val != NULL && job->node->val != job->node) {
-				if(mnode->key == test_key) {
-					if(mnode->marked){ mnode->marked = false; }
+			if(!next || next->key > test_key) {
+				// if not marked for deletion, we know it's an insert operation
+				if(job_node->val != NULL && job_node->val != job_node) {
+					if(mnode->key == test_key) {
+						if(mnode->marked){ mnode->marked = false; }
+					} else {
+						mnode->next = mnode_new(next, job_node, 0, numa_zone);
+					}
 				} else {
-					mnode->next = mnode_new(next, job->node, 0, numa_zone);
+					if(mnode->key == test_key){ mnode->marked = true; }
 				}
-			} else {
-				if(mnode->key == test_key){ mnode->marked = true; }
+				break;
 			}
-			break;
+			mnode = next;
 		}
-		mnode = next;
+		last = mnode;
+	}
+
+	// propagation stats
+	now = queue_clock();
+	sl->q_batches++;
+	sl->q_jobs += n;
+	sl->q_depth_sum += pending;
+	if(pending > sl->q_depth_max) sl->q_depth_max = pending;
+	for(i = 0; i < n; ++i) {
+		lag = now - batch[i].stamp;
+		sl->q_lag_sum += lag;
+		if(lag > sl->q_lag_max) sl->q_lag_max = lag;
 	}
-	return 1;
+	return n;
 }
 
 /**
@@ -324,7 +363,6 @@ void bg_lower_ilevel(inode_t *new_low, int zone)
  */
 void* per_NUMA_helper(void* args) {
 	search_layer* obj 		= (search_layer*)args;
-	update_queue*  updates 	= obj->get_queue();
 	inode_t* sentinel 		= obj->get_sentinel();
 	int		 numa_zone		= obj->get_zone();
 	inode_t *inode, *inew;
@@ -333,11 +371,8 @@ void* per_NUMA_helper(void* args) {
 	int threshold;  /* for testing if we should lower index level */
 	int i;
 
-	// Pin to Zone & CPU
-	cpu_set_t cpuset;
-	CPU_ZERO(&cpuset);
-	CPU_SET(obj->get_zone(), &cpuset);
-	pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+	// Pin to the CPUs of the zone
+	run_on_zone(numa_zone);
 
 	// at end of population, we want to reset the towers
 	if(obj->repopulate) {
@@ -355,7 +390,7 @@ void* per_NUMA_helper(void* args) {
 		usleep(obj->sleep_time);
 
 		/* intermediate layer management */
-		while(!obj->finished && update_intermediate_layer(obj, updates->pop())){}
+		while(!obj->finished && update_intermediate_layer(obj)){}
 
 		for (i = 0; i < MAX_LEVELS; i++)
 				inodes[i] = NULL;
@@ -477,12 +512,28 @@ extern int				num_numa_zones;
  * add_job_to_queues() - adds recently updated node (successful insert/delete)
  * 	to the queues of all NUMA zones
  * @node - node to be pushed
+ *
+ * Returns false, without pushing it, if the queue of a zone is full. The node
+ * is then counted once as delayed by that zone, however many passes retry it.
  */
-void add_job_to_queues(node_t* node) {
+bool add_job_to_queues(node_t* node) {
 	assert(search_layers != NULL);
 	for(int i = 0; i < num_numa_zones; ++i) {
-		search_layers[i]->get_queue()->push(node);
+		if(search_layers[i]->get_queue()->full()) {
+			if(!node->delayed) {
+				node->delayed = true;
+				search_layers[i]->get_queue()->delay();
+			}
+			return false;
+		}
+	}
+	node->fresh = false;
+	node->delayed = false;
+	unsigned long stamp = queue_clock();
+	for(int i = 0; i < num_numa_zones; ++i) {
+		search_layers[i]->get_queue()->push(node, stamp);
 	}
+	return true;
 }
 
 /**
@@ -499,7 +550,7 @@ void* data_layer_helper(void* args) {
 	int cur_numa_zone	= 0;
 	while(1) {
 		// sleep & change zones for fairness
-		numa_run_on_node(cur_numa_zone);
+		run_on_zone(cur_numa_zone);
 		usleep(sleep_time);
 		if(*done) break;
 		cur_numa_zone = ++cur_numa_zone % num_numa_zones;
@@ -509,8 +560,7 @@ void* data_layer_helper(void* args) {
 		node_t* node = prev->next;
 		while(node) {
 			if(node->fresh) {
-				// add newly inserted/removed node to queues
-				node->fresh = false;
+				// add newly inserted/removed node to queues, or retry next pass
 				add_job_to_queues(node);
 			}
 			else if(node->level == 0) {
@@ -1,55 +1,102 @@
 /**
- * queue.cpp - SPSC queue for NUMA zones
- * 	Based on Dmitry Vyukov's C implementation
+ * queue.cpp - SPMC update ring for NUMA zones
  *
  * Author: Henry Daly, 2018
  *
  */
 
+/**
+ * Module Overview:
+ *
+ *	The data-layer helper is the only producer of the ring of each zone: it pushes
+ *	the recently updated nodes, after checking that the rings of all the zones have
+ *	room for them (otherwise the node stays fresh and is pushed by a later pass). The
+ *	slots are preallocated, so a push only writes its slot and publishes the tail.
+ *	Consumers drain a batch of consecutive jobs at once: they copy the jobs and then
+ *	claim them by moving the head with a CAS, so that several helpers could share a
+ *	zone. The producer does not reuse a slot before the head moved past it.
+ */
+
 #include <numa.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
 #include "queue.h"
 #include "common.h"
 
-/* new_qnode() - allocates an empty qnode */
-q_node* new_qnode(node_t* ptr) {
-	q_node* new_job = (q_node*)malloc(sizeof(q_node));
-	new_job->node = ptr;
-	new_job->next = 0;
-	return new_job;
-}
 /* Constructor */
 update_queue::update_queue()
+:tail(0), num_full(0), head(0)
 {
-	stub = new_qnode(0);
-	head = tail = stub;
+	jobs = (q_job*)malloc(QUEUE_SIZE * sizeof(q_job));
+	if(jobs == NULL) {
+		perror("malloc");
+		exit(1);
+	}
+	// first touch from the zone helper's node
+	memset(jobs, 0, QUEUE_SIZE * sizeof(q_job));
 }
 
 /* Destructor */
 update_queue::~update_queue()
 {
-	q_node* f = head;
-	while(f) {
-		q_node* x = f->next;
-		free(f);
-		f = x;
-	}
+	free(jobs);
 }
 
-/* push() - pushes node to queue */
-void update_queue::push(node_t* ptr) {
-	q_node* spot = new_qnode(ptr);
-	tail->next = spot;
-	tail = spot;
+/* full() - checks if the ring has no room for a push (producer only) */
+bool update_queue::full(void) {
+	return tail - AO_load_acquire(&head) >= QUEUE_SIZE;
+}
 
+/* push() - pushes node to the ring, which must not be full (producer only) */
+void update_queue::push(node_t* ptr, unsigned long stamp) {
+	q_job* job = &jobs[tail & (QUEUE_SIZE - 1)];
+	job->node = ptr;
+	job->stamp = stamp;
+	AO_store_release(&tail, tail + 1);
 }
 
-/* pop() - attempts to pop node from queue */
-q_node* update_queue::pop(void) {
-	q_node* popped = head;
-	if(!head->next) return NULL;
-	head = head->next;
-	popped->node = head->node;
-	return popped;
+/**
+ * pop_batch() - pops up to @max jobs from the ring into @batch
+ * @depth - set to the number of jobs in the ring before the pop
+ *
+ * Returns the number of jobs popped
+ */
+int update_queue::pop_batch(q_job* batch, int max, unsigned long* depth) {
+	AO_t h, t;
+	int n, i;
+
+	do {
+		h = AO_load_acquire(&head);
+		t = AO_load_acquire(&tail);
+		*depth = t - h;
+		n = (t - h < (AO_t)max)? (int)(t - h): max;
+		if(n == 0) return 0;
+		for(i = 0; i < n; ++i) {
+			batch[i] = jobs[(h + i) & (QUEUE_SIZE - 1)];
+		}
+	} while(!CAS(&head, h, h + n));
+	return n;
 }
 
+/* delay() - counts a node whose push is delayed because the ring is full (producer only) */
+void update_queue::delay(void) {
+	num_full++;
+}
+
+/* get_full() - returns the number of nodes whose push was delayed because the ring was full */
+unsigned long update_queue::get_full(void) {
+	return num_full;
+}
+
+/* reset_full() - clears the count of delayed pushes (producer stopped) */
+void update_queue::reset_full(void) {
+	num_full = 0;
+}
+
+/* queue_clock() - returns a monotonic time in microseconds */
+unsigned long queue_clock(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000UL + ts.tv_nsec / 1000;
+}
@@ -1,5 +1,5 @@
 /*
- * Interface for SPSC Queue
+ * Interface for the SPMC update ring
  *
  * Author: Henry Daly, 2018
  */
@@ -10,22 +10,35 @@
 #include "skiplist.h"
 #include "common.h"
 
-struct q_node {
-	q_node*	next;
-	node_t*	node;
+#define QUEUE_SIZE	(1 << 14)	// jobs per ring, a power of two
+#define QUEUE_BATCH	256			// jobs drained at once by a helper
+
+struct q_job {
+	node_t*			node;
+	unsigned long	stamp;		// time of the push (us)
 };
 
 class update_queue{
 private:
-	q_node* head;
-	q_node* tail;
-	q_node* stub;
+	q_job*			jobs;
+	CACHE_PAD(0);
+	volatile AO_t	tail;		// next slot to push to (producer only)
+	unsigned long	num_full;
+	CACHE_PAD(1);
+	volatile AO_t	head;		// next job to pop
+	CACHE_PAD(2);
 
 public:
 			update_queue();
 			~update_queue();
-	void	push(node_t* ptr);
-	q_node*	pop();
+	bool	full(void);
+	void	push(node_t* ptr, unsigned long stamp);
+	void	delay(void);
+	int		pop_batch(q_job* batch, int max, unsigned long* depth);
+	unsigned long get_full(void);
+	void	reset_full(void);
 };
 
+unsigned long queue_clock(void);
+
 #endif /* QUEUE_H_ */
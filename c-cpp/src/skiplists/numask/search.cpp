@@ -14,6 +14,7 @@
  */
 
 #include <pthread.h>
+#include <assert.h>
 #include "search.h"
 #include "queue.h"
 #include "skiplist.h"
@@ -24,7 +25,8 @@
 /* Constructor */
 search_layer::search_layer(int nzone, inode_t* ssentinel, update_queue* q)
 :finished(false), running(false), numa_zone(nzone), bg_tall_deleted(0), bg_non_deleted(0),
- repopulate(false), sentinel(ssentinel), updates(q), sleep_time(0), helper(0)
+ repopulate(false), sentinel(ssentinel), updates(q), sleep_time(0), helper(0),
+ q_batches(0), q_jobs(0), q_depth_sum(0), q_depth_max(0), q_lag_sum(0), q_lag_max(0)
 {
 	srand(time(NULL));
 #ifdef BG_STATS
@@ -94,6 +96,45 @@ void search_layer::reset_sentinel(void) {
 	repopulate = true;
 }
 
+/* reset_queue_stats() - clears the propagation stats (helper stopped) */
+void search_layer::reset_queue_stats(void) {
+	q_batches = q_jobs = q_depth_sum = q_depth_max = q_lag_sum = q_lag_max = 0;
+	updates->reset_full();
+}
+
+/**
+ * bulk_load() - builds the intermediate and index layers of a bulk loaded data layer
+ *
+ * 	Note: the helper must be stopped and the layers empty. Every data layer node gets
+ * 	an intermediate node and a tower of its height, the sentinel a tower of the number
+ * 	of levels (see data_layer_bulk_load()).
+ */
+void search_layer::bulk_load(void) {
+	mnode_t* mhead = sentinel->intermed;
+	mnode_t* mlast = mhead;
+	int levels = mhead->node->level;
+	inode_t* last[MAX_LEVELS];
+	inode_t* top = sentinel;
+	inode_t* inode;
+	node_t* node;
+	int l;
+
+	assert(NULL == sentinel->right && NULL == sentinel->down && NULL == mhead->next);
+	last[0] = sentinel;
+	for(l = 1; l < levels; ++l) {
+		last[l] = top = inode_new(NULL, top, mhead, numa_zone);
+	}
+	for(node = mhead->node->next; node != NULL; node = node->next) {
+		mlast = mlast->next = mnode_new(NULL, node, node->level, numa_zone);
+		inode = NULL;
+		for(l = 0; l < (int)node->level; ++l) {
+			inode = last[l] = last[l]->right = inode_new(NULL, inode, mlast, numa_zone);
+		}
+	}
+	mhead->level = levels;
+	set_sentinel(top);
+}
+
 #ifdef BG_STATS
 /**
  * bg_stats() - print background statistics
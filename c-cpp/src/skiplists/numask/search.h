@@ -35,6 +35,13 @@ public:
 	int bg_tall_deleted;
 	int sleep_time;
 	bool repopulate;
+	// propagation stats, updated by the helper
+	unsigned long q_batches;
+	unsigned long q_jobs;
+	unsigned long q_depth_sum;
+	unsigned long q_depth_max;
+	unsigned long q_lag_sum;
+	unsigned long q_lag_max;
 
 	search_layer(int nzone, inode_t* ssentinel, update_queue* q);;
 	~search_layer();
@@ -45,6 +52,8 @@ public:
 	int get_zone(void);
 	update_queue* get_queue(void);
 	void reset_sentinel(void);
+	void reset_queue_stats(void);
+	void bulk_load(void);
 
 #ifdef ADDRESS_CHECKING
 	bool			index_ignore;
@@ -8,11 +8,14 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
 #include <numa.h>
 #include <numaif.h>
 #include "common.h"
 #include "skiplist.h"
 #include "allocator.h"
+#include "topology.h"
 
 numa_allocator** allocators;
 
@@ -26,6 +29,50 @@ numa_allocator** allocators;
  */
 extern bool	initial_populate;
 
+/* a key range of a bulk load, built by one thread */
+struct bulk_range {
+	sl_key_t*	keys;
+	val_t*		vals;
+	int			lo, hi;		// positions of the range in the keys
+	int			levels;
+	node_t*		first;
+	node_t*		last;
+};
+
+/**
+ * bulk_height() - returns the tower height of the node at position @pos (from 1) of
+ * 	a perfectly balanced skip list of @levels index levels: the number of trailing
+ * 	zeros of @pos, so that every 2^i-th node reaches level i
+ */
+static uint bulk_height(unsigned long pos, int levels) {
+	int h = 0;
+	while(h < levels && 0 == (pos & 1)) {
+		pos >>= 1;
+		h++;
+	}
+	return h;
+}
+
+/* bulk_build() - builds and chains the data layer nodes of a key range */
+static void* bulk_build(void* args) {
+	bulk_range* r = (bulk_range*)args;
+	node_t *node, *prev = NULL;
+
+	r->first = NULL;
+	for(int i = r->lo; i < r->hi; ++i) {
+		assert(0 == i || r->keys[i - 1] < r->keys[i]);
+		node = node_new(r->keys[i], r->vals? r->vals[i]: (val_t)r->keys[i], prev, NULL);
+		node->level = bulk_height(i + 1, r->levels);
+		// the search layers are built from the data layer, not from the queues
+		node->fresh = false;
+		if(NULL == prev)	r->first = node;
+		else 				prev->next = node;
+		prev = node;
+	}
+	r->last = prev;
+	return NULL;
+}
+
 /* - Public skiplist interface - */
 
 /**
@@ -44,6 +91,7 @@ node_t* node_new(sl_key_t key, val_t val, node_t *prev, node_t *next)
         node->prev      = prev;
         node->next      = next;
         node->fresh		= true;
+        node->delayed	= false;
         node->level		= 0;
         return node;
 }
@@ -150,6 +198,70 @@ int data_layer_size(node_t* head, int flag)
         return size;
 }
 
+/**
+ * data_layer_bulk_load() - builds the data layer from sorted keys
+ * @head	   - the sentinel node for the data layer, alone in it
+ * @keys	   - the keys, in increasing order and above 0 (the key of the sentinel)
+ * @vals	   - the values of the keys, or NULL to map each key to itself
+ * @n		   - the number of keys
+ * @nb_threads - the number of threads building the key ranges
+ *
+ * Each node gets the height of its tower in a perfectly balanced index of
+ * floor(log2(@n)) levels, the index the helpers converge to, and the sentinel
+ * gets the number of levels. The search layers of the zones are then built from
+ * these heights by search_layer::bulk_load().
+ *
+ * Returns the number of index levels
+ */
+int data_layer_bulk_load(node_t* head, sl_key_t* keys, val_t* vals, int n, int nb_threads) {
+	bulk_range* ranges;
+	pthread_t* threads;
+	node_t* last = head;
+	int levels = 1, k;
+
+	assert(NULL == head->next);
+	assert(0 == n || keys[0] > head->key);
+	while(levels < MAX_LEVELS - 1 && (2UL << levels) <= (unsigned long)n) {
+		levels++;
+	}
+	if(nb_threads > n)	nb_threads = n;
+	if(nb_threads < 1)	nb_threads = 1;
+
+	ranges = (bulk_range*)malloc(nb_threads * sizeof(bulk_range));
+	threads = (pthread_t*)malloc(nb_threads * sizeof(pthread_t));
+	if(NULL == ranges || NULL == threads) {
+		perror("malloc");
+		exit(1);
+	}
+	for(k = 0; k < nb_threads; ++k) {
+		ranges[k].keys = keys;
+		ranges[k].vals = vals;
+		ranges[k].lo = (long)n * k / nb_threads;
+		ranges[k].hi = (long)n * (k + 1) / nb_threads;
+		ranges[k].levels = levels;
+		if(pthread_create(&threads[k], NULL, bulk_build, (void*)&ranges[k]) != 0) {
+			fprintf(stderr, "Error creating thread\n");
+			exit(1);
+		}
+	}
+	for(k = 0; k < nb_threads; ++k) {
+		pthread_join(threads[k], NULL);
+	}
+
+	// link the ranges
+	for(k = 0; k < nb_threads; ++k) {
+		if(NULL == ranges[k].first) continue;
+		last->next = ranges[k].first;
+		ranges[k].first->prev = last;
+		last = ranges[k].last;
+	}
+	head->level = levels;
+
+	free(ranges);
+	free(threads);
+	return levels;
+}
+
 #ifdef ADDRESS_CHECKING
 /**
  * check_addr() - check specific address using get_mempolicy to see if it is on the supposed node
@@ -172,7 +284,7 @@ int check_addr(int supposed_node, void* addr) {
  */
 void zone_access_check(int node, void* addr, volatile long* local, volatile long* foreign, bool dont_count) {
 	int result;
-	if(1 == (result = check_addr(node, addr))) {
+	if(1 == (result = check_addr(zone_node(node), addr))) {
 		(*foreign)++;
 		if(dont_count){ (*foreign)--; }
 	} else if(result == 0) {
@@ -37,6 +37,7 @@ struct sl_node {
 	sl_key_t 			key;
 	volatile uint		level;
 	bool 				fresh;
+	bool				delayed;	// push delayed by a full ring
 };
 
 /* index layer nodes */
@@ -66,6 +67,7 @@ void node_delete(node_t *node);
 void inode_delete(inode_t *inode, int zone);
 void mnode_delete(mnode_t* mnode, int zone);
 int data_layer_size(node_t* head, int flag);
+int data_layer_bulk_load(node_t* head, sl_key_t* keys, val_t* vals, int n, int nb_threads);
 
 #ifdef ADDRESS_CHECKING
 	int check_addr(int supposed_node, void* addr);
@@ -34,6 +34,8 @@
 #include "queue.h"
 #include "search.h"
 #include "allocator.h"
+#include "topology.h"
+#include "bulk_keys.h"
 
 #define DEFAULT_DURATION                10000
 #define DEFAULT_INITIAL                 1024
@@ -45,7 +47,8 @@
 #define DEFAULT_ALTERNATE               0
 #define DEFAULT_EFFECTIVE               1
 #define DEFAULT_UNBALANCED              0
-#define MAX_NUMA_ZONES 					numa_max_node() + 1
+#define DEFAULT_EMULATED                0
+#define DEFAULT_BULK                    0
 #define MIN_NUMA_ZONES					1
 
 #define XSTR(s)                         STR(s)
@@ -129,14 +132,10 @@ struct zone_init_args {
 void* zone_init(void* args) {
 	zone_init_args* zia = (zone_init_args*)args;
 
-	cpu_set_t cpuset;
-	CPU_ZERO(&cpuset);
-	CPU_SET(zia->numa_zone, &cpuset);
 	sleep(1);
-	pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
-	numa_set_preferred(zia->numa_zone);
+	run_on_zone(zia->numa_zone);
 
-	numa_allocator* na = new numa_allocator(zia->allocator_size);
+	numa_allocator* na = new numa_allocator(zia->allocator_size, zone_node(zia->numa_zone));
 	allocators[zia->numa_zone] = na;
 
 	mnode_t* mnode = mnode_new(NULL, zia->node_sentinel, 1, zia->numa_zone);
@@ -147,6 +146,15 @@ void* zone_init(void* args) {
 	return NULL;
 }
 
+/* zone_bulk_load() - builds the search layer of a NUMA zone after a bulk load */
+void* zone_bulk_load(void* args) {
+	search_layer* sl = (search_layer*)args;
+
+	run_on_zone(sl->get_zone());
+	sl->bulk_load();
+	return NULL;
+}
+
 /*
  * Returns a pseudo-random value in [1;range).
  * Depending on the symbolic constant RAND_MAX>=32767 defined in stdlib.h,
@@ -219,7 +227,7 @@ void *test(void *data) {
 	// run test thread on correct NUMA zone
 	search_layer* sl = d->sl;
 	int cur_zone = sl->get_zone();
-	numa_run_on_node(cur_zone);
+	run_on_zone(cur_zone);
 
 	/* Create transaction */
 	TM_THREAD_ENTER();
@@ -360,10 +368,14 @@ int main(int argc, char **argv)
 	sigset_t block_set;
 	struct sl_node *temp;
 	int unbalanced = DEFAULT_UNBALANCED;
-	num_numa_zones = MAX_NUMA_ZONES;
+	int emulated = DEFAULT_EMULATED;
+	int bulk = DEFAULT_BULK;
+	sl_key_t *keys;
+	struct timeval pop_start, pop_end;
+	num_numa_zones = 0;
 	while(1) {
 		i = 0;
-		c = getopt_long(argc, argv, "hAf:d:i:t:r:S:u:x:U:z:P:"
+		c = getopt_long(argc, argv, "hAf:d:i:t:r:S:u:x:U:z:P:eB:"
 										, long_options, &i);
 
 		if(c == -1)
@@ -410,7 +422,12 @@ int main(int argc, char **argv)
 								 "        4 = read/add/rem elastic-tx,\n"
 								 "        5 = fraser lock-free\n"
 								 "  -z <int>\n"
-								 "        Number of NUMA zones to use (default = " XSTR(MAX_NUMA_ZONES) ")\n"
+								 "        Number of NUMA zones to use (default = number of NUMA nodes with CPUs)\n"
+								 "  -e\n"
+								 "        Emulate the zones on the CPUs of one NUMA node (default = one zone per CPU, at least 2)\n"
+								 "  -B <int>\n"
+								 "        Bulk load the initial keys, sorted, with balanced search layers, using this\n"
+								 "        number of threads for the data layer and one per zone (0 = insert them one by one, default=" XSTR(DEFAULT_BULK) ")\n"
 								 );
 					exit(0);
 				case 'A':
@@ -446,6 +463,12 @@ int main(int argc, char **argv)
 				case 'z':
 					num_numa_zones = atoi(optarg);
 					break;
+				case 'e':
+					emulated = 1;
+					break;
+				case 'B':
+					bulk = atoi(optarg);
+					break;
 				case '?':
 					printf("Use -h or --help for help\n");
 					exit(0);
@@ -459,13 +482,12 @@ int main(int argc, char **argv)
 	assert(nb_threads > 1);
 	assert(range > 0 && range >= initial);
 	assert(update >= 0 && update <= 100);
-	assert(num_numa_zones >= MIN_NUMA_ZONES && num_numa_zones <= MAX_NUMA_ZONES);
-	if(num_numa_zones > nb_threads) num_numa_zones = nb_threads;	// don't spawn unnecessary background threads
-
-	if(numa_available() == -1) {
-		printf("Error: NUMA unavailable on this system.\n");
-		exit(0);
+	if(num_numa_zones == 0) {
+		num_numa_zones = topology_default_zones(emulated);
 	}
+	assert(num_numa_zones >= MIN_NUMA_ZONES && num_numa_zones <= topology_max_zones(emulated));
+	if(num_numa_zones > nb_threads) num_numa_zones = nb_threads;	// don't spawn unnecessary background threads
+	num_numa_zones = topology_init(num_numa_zones, emulated);
 
 	printf("Set type     : skip list\n");
 	printf("Duration     : %d\n", duration);
@@ -483,6 +505,7 @@ int main(int argc, char **argv)
 				 (int)sizeof(void *),
 				 (int)sizeof(uintptr_t));
 	printf("NUMA Zones   : %d\n", num_numa_zones);
+	topology_print();
 
 	timeout.tv_sec = duration / 1000;
 	timeout.tv_nsec = (duration % 1000) * 1000000;
@@ -543,12 +566,6 @@ int main(int argc, char **argv)
 	printf("Initializing STM\n");
 
 	TM_STARTUP();
-	// Populate set
-	printf("Adding %d entries to set\n", initial);
-	i = 0;
-	initial_populate = true;
-
-
 	// start data-layer-helper thread
 	bool test_complete = false;
 	bg_dl_args* data_info = (bg_dl_args*)malloc(sizeof(bg_dl_args));
@@ -558,48 +575,80 @@ int main(int argc, char **argv)
 	pthread_t dhelper_thread;
 	pthread_create(&dhelper_thread, NULL, data_layer_helper, (void*)data_info);
 
-	for(int i = 0; i < num_numa_zones; ++i) {
-		search_layers[i]->start_helper(0);
-	}
-
-	int cur_zone = 0;
-	numa_run_on_node(cur_zone);
-	usleep(10);
-	while (i < initial) {
-		if (unbalanced) {
-			val = rand_range_re(&global_seed, initial);
-		} else {
-            val = rand_range_re(&global_seed, range);
+	// Populate set
+	gettimeofday(&pop_start, NULL);
+	if (bulk > 0 && initial > 0) {
+		printf("Bulk loading %d entries to set\n", initial);
+		keys = bulk_keys(initial, unbalanced ? initial : range, &global_seed);
+		data_layer_bulk_load(sentinel_node, keys, NULL, initial, bulk);
+		last = keys[initial - 1];
+		free(keys);
+		for(int i = 0; i < num_numa_zones; ++i) {
+			pthread_create(&thds[i], NULL, zone_bulk_load, (void*)search_layers[i]);
 		}
-		if (sl_add_old(search_layers[cur_zone], val, 0)) {
-			last = val;
-			i++;
-			if(i %(initial / num_numa_zones) == 0 && cur_zone != num_numa_zones - 1) {
-				numa_run_on_node(++cur_zone);
-			}
+		for(int i = 0; i < num_numa_zones; ++i) {
+			pthread_join(thds[i], NULL);
+		}
+		size = data_layer_size(sentinel_node, 1);
+		printf("Set size     : %d\n", size);
+		for(int i = 0; i < num_numa_zones; ++i) {
+			search_layers[i]->start_helper(1000000);
+			printf("Number of levels in zone %d is %d\n", i, search_layers[i]->get_sentinel()->intermed->level);
+		}
+	} else {
+		printf("Adding %d entries to set\n", initial);
+		i = 0;
+		initial_populate = true;
+
+
+		for(int i = 0; i < num_numa_zones; ++i) {
+			search_layers[i]->start_helper(0);
 		}
 
-	}
+		int cur_zone = 0;
+		run_on_zone(cur_zone);
+		usleep(10);
+		while (i < initial) {
+			if (unbalanced) {
+				val = rand_range_re(&global_seed, initial);
+			} else {
+	            val = rand_range_re(&global_seed, range);
+			}
+			if (sl_add_old(search_layers[cur_zone], val, 0)) {
+				last = val;
+				i++;
+				if(i %(initial / num_numa_zones) == 0 && cur_zone != num_numa_zones - 1) {
+					run_on_zone(++cur_zone);
+				}
+			}
 
-	size = data_layer_size(sentinel_node, 1);
-	printf("Set size     : %d\n", size);
-	printf("Level max    : %d\n", levelmax);
-	initial_populate = false;
+		}
 
-	// nullify all the index nodes we created so
-	// we can start again and rebalance the skip list
-	// wait until the list is balanced
-	for(int i = 0; i < num_numa_zones; ++i) {
-		search_layers[i]->stop_helper();
-		search_layers[i]->reset_sentinel();
-		search_layers[i]->start_helper(0);
-	}
-	for(int i = 0; i < num_numa_zones; ++i) {
-		while(search_layers[i]->get_sentinel()->intermed->level < floor_log_2(initial)){}
-		search_layers[i]->stop_helper();
-		search_layers[i]->start_helper(1000000);
-		printf("Number of levels in zone %d is %d\n", i, search_layers[i]->get_sentinel()->intermed->level);
+		size = data_layer_size(sentinel_node, 1);
+		printf("Set size     : %d\n", size);
+		printf("Level max    : %d\n", levelmax);
+		initial_populate = false;
+
+		// nullify all the index nodes we created so
+		// we can start again and rebalance the skip list
+		// wait until the list is balanced
+		for(int i = 0; i < num_numa_zones; ++i) {
+			search_layers[i]->stop_helper();
+			search_layers[i]->reset_sentinel();
+			search_layers[i]->start_helper(0);
+		}
+		for(int i = 0; i < num_numa_zones; ++i) {
+			while(search_layers[i]->get_sentinel()->intermed->level < floor_log_2(initial)){}
+			search_layers[i]->stop_helper();
+			search_layers[i]->reset_queue_stats();
+			search_layers[i]->start_helper(1000000);
+			printf("Number of levels in zone %d is %d\n", i, search_layers[i]->get_sentinel()->intermed->level);
+		}
 	}
+	gettimeofday(&pop_end, NULL);
+	printf("Populate time: %d ms\n",
+	       (int)((pop_end.tv_sec * 1000 + pop_end.tv_usec / 1000) -
+	             (pop_start.tv_sec * 1000 + pop_start.tv_usec / 1000)));
 
 	barrier_init(&barrier, nb_threads + 1);
 	pthread_attr_init(&attr);
@@ -768,6 +817,26 @@ int main(int argc, char **argv)
 	printf("  #failures   : %lu\n",  failures_because_contention);
 	printf("Max retries   : %lu\n", max_retries);
 
+	unsigned long q_batches = 0, q_jobs = 0, q_depth_sum = 0, q_depth_max = 0,
+				  q_lag_sum = 0, q_lag_max = 0, q_full = 0;
+	for(int i = 0; i < num_numa_zones; ++i) {
+		search_layer* sl = search_layers[i];
+		q_batches += sl->q_batches;
+		q_jobs += sl->q_jobs;
+		q_depth_sum += sl->q_depth_sum;
+		if(sl->q_depth_max > q_depth_max) q_depth_max = sl->q_depth_max;
+		q_lag_sum += sl->q_lag_sum;
+		if(sl->q_lag_max > q_lag_max) q_lag_max = sl->q_lag_max;
+		q_full += sl->get_queue()->get_full();
+	}
+	printf("#prop. batches: %lu (%f jobs / batch)\n", q_batches,
+		   q_batches? (double)q_jobs / q_batches: 0.0);
+	printf("  #depth      : %f avg, %lu max\n",
+		   q_batches? (double)q_depth_sum / q_batches: 0.0, q_depth_max);
+	printf("  #lag (us)   : %f avg, %lu max\n",
+		   q_jobs? (double)q_lag_sum / q_jobs: 0.0, q_lag_max);
+	printf("  #full       : %lu\n", q_full);
+
 #ifdef ADDRESS_CHECKING
 	int app_local = 0;
 	int app_foreign = 0;
@@ -0,0 +1,236 @@
+/*
+ * topology.cpp: mapping of the NUMA zones to memory nodes and CPUs
+ *
+ */
+
+/**
+ * Module Overview:
+ *
+ *	Each NUMA zone has its own allocator and search layer. This module maps every zone
+ *	to a memory node and to the CPUs of that node, so that the threads of a zone (its
+ *	application threads and helper, and the data-layer helper while it visits the zone)
+ *	run next to the memory the zone allocates from. The CPUs of a node are read from
+ *	libnuma, or from sysfs when libnuma is not available, and restricted to the CPUs
+ *	the process may run on. Nodes without CPUs are skipped.
+ *
+ *	In emulated mode, the CPUs of the first node are partitioned into the requested
+ *	number of logical zones, which all allocate on that node. This way the replication
+ *	of the search layers can be tested and profiled on a single-node machine. When
+ *	there are more zones than CPUs, the zones share the CPUs round-robin.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+#include <numa.h>
+#include "topology.h"
+
+static numa_zone_info	zones[MAX_ZONES];
+static int				num_zones = 0;
+static bool				emulated = false;
+static int				has_libnuma = -1;
+static cpu_set_t		allowed_cpus;
+
+/* detect() - checks for libnuma and gets the CPUs the process may run on */
+static void detect(void) {
+	if(has_libnuma == -1) {
+		has_libnuma = (numa_available() != -1);
+		sched_getaffinity(0, sizeof(cpu_set_t), &allowed_cpus);
+	}
+}
+
+/* parse_cpulist() - adds the ids of a sysfs list ("0-3,8-11") to @cpus */
+static void parse_cpulist(const char* list, cpu_set_t* cpus) {
+	char* end;
+	long lo, hi;
+
+	while(*list) {
+		lo = hi = strtol(list, &end, 10);
+		if(end == list) break;
+		if(*end == '-') {
+			hi = strtol(end + 1, &end, 10);
+		}
+		for(long cpu = lo; cpu <= hi && cpu < CPU_SETSIZE; ++cpu) {
+			CPU_SET(cpu, cpus);
+		}
+		list = (*end == ',')? end + 1: end;
+	}
+}
+
+/* read_sysfs() - reads a sysfs list into @ids, returns 0 if the file does not exist */
+static int read_sysfs(const char* path, cpu_set_t* ids) {
+	char list[4096];
+	FILE* f = fopen(path, "r");
+
+	CPU_ZERO(ids);
+	if(f == NULL) return 0;
+	if(fgets(list, sizeof(list), f) != NULL) {
+		parse_cpulist(list, ids);
+	}
+	fclose(f);
+	return 1;
+}
+
+/* max_node() - returns the highest memory node id */
+static int max_node(void) {
+	cpu_set_t nodes;
+	int node, max = 0;
+
+	if(has_libnuma) return numa_max_node();
+	if(read_sysfs("/sys/devices/system/node/possible", &nodes)) {
+		for(node = 0; node < CPU_SETSIZE; ++node) {
+			if(CPU_ISSET(node, &nodes)) max = node;
+		}
+	}
+	return max;
+}
+
+/* node_cpus() - gets the allowed CPUs of memory node @node and returns their number */
+static int node_cpus(int node, cpu_set_t* cpus) {
+	char path[64];
+
+	CPU_ZERO(cpus);
+	if(has_libnuma) {
+		struct bitmask* mask = numa_allocate_cpumask();
+		if(numa_node_to_cpus(node, mask) == 0) {
+			for(unsigned cpu = 0; cpu < mask->size && cpu < CPU_SETSIZE; ++cpu) {
+				if(numa_bitmask_isbitset(mask, cpu)) CPU_SET(cpu, cpus);
+			}
+		}
+		numa_free_cpumask(mask);
+	} else {
+		snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+		if(!read_sysfs(path, cpus) && node == 0) {
+			// no node information at all: a single node with every CPU
+			CPU_OR(cpus, cpus, &allowed_cpus);
+		}
+	}
+	CPU_AND(cpus, cpus, &allowed_cpus);
+	return CPU_COUNT(cpus);
+}
+
+/* first_node() - gets the CPUs of the first node with CPUs and returns this node */
+static int first_node(cpu_set_t* cpus) {
+	int node;
+
+	for(node = 0; node <= max_node(); ++node) {
+		if(node_cpus(node, cpus) > 0) return node;
+	}
+	// CPUs outside any node: use them all on node 0
+	CPU_ZERO(cpus);
+	CPU_OR(cpus, cpus, &allowed_cpus);
+	return 0;
+}
+
+/* topology_max_zones() - returns the number of zones that can be used */
+int topology_max_zones(bool emulate) {
+	cpu_set_t cpus;
+	int node, count = 0;
+
+	detect();
+	if(emulate) return MAX_ZONES;
+	for(node = 0; node <= max_node(); ++node) {
+		if(node_cpus(node, &cpus) > 0) count++;
+	}
+	return (count < MAX_ZONES)? count: MAX_ZONES;
+}
+
+/**
+ * topology_default_zones() - returns the default number of zones: one per node with
+ * 	CPUs, or in emulated mode one per CPU of the first node (at least two)
+ */
+int topology_default_zones(bool emulate) {
+	cpu_set_t cpus;
+	int count;
+
+	if(!emulate) return topology_max_zones(false);
+	detect();
+	first_node(&cpus);
+	count = CPU_COUNT(&cpus);
+	return (count < 2)? 2: (count < MAX_ZONES)? count: MAX_ZONES;
+}
+
+/**
+ * topology_init() - maps the zones to nodes and CPUs
+ * @nzones  - number of zones
+ * @emulate - partition the CPUs of one node into @nzones logical zones
+ *
+ * Returns the number of zones mapped
+ */
+int topology_init(int nzones, bool emulate) {
+	cpu_set_t cpus;
+	int cpu_ids[CPU_SETSIZE];
+	int node, cpu, ncpus, i, c;
+
+	assert(nzones >= 1 && nzones <= MAX_ZONES);
+	detect();
+	emulated = emulate;
+	num_zones = 0;
+
+	if(!emulate) {
+		for(node = 0; node <= max_node() && num_zones < nzones; ++node) {
+			numa_zone_info* z = &zones[num_zones];
+			if((z->num_cpus = node_cpus(node, &z->cpus)) == 0) continue;
+			z->node = node;
+			num_zones++;
+		}
+		return num_zones;
+	}
+
+	// emulated zones on the first node with CPUs
+	node = first_node(&cpus);
+	ncpus = CPU_COUNT(&cpus);
+	for(cpu = 0, c = 0; cpu < CPU_SETSIZE; ++cpu) {
+		if(CPU_ISSET(cpu, &cpus)) cpu_ids[c++] = cpu;
+	}
+	for(i = 0; i < nzones; ++i) {
+		numa_zone_info* z = &zones[i];
+		z->node = node;
+		CPU_ZERO(&z->cpus);
+		if(nzones <= ncpus) {
+			// contiguous share of the CPUs
+			for(c = i * ncpus / nzones; c < (i + 1) * ncpus / nzones; ++c) {
+				CPU_SET(cpu_ids[c], &z->cpus);
+			}
+		} else {
+			CPU_SET(cpu_ids[i % ncpus], &z->cpus);
+		}
+		z->num_cpus = CPU_COUNT(&z->cpus);
+	}
+	num_zones = nzones;
+	return num_zones;
+}
+
+/* zone_node() - returns the memory node of zone @zone, -1 without libnuma */
+int zone_node(int zone) {
+	assert(zone >= 0 && zone < num_zones);
+	return has_libnuma? zones[zone].node: -1;
+}
+
+/* run_on_zone() - binds the calling thread to the CPUs and memory node of zone @zone */
+void run_on_zone(int zone) {
+	assert(zone >= 0 && zone < num_zones);
+	pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &zones[zone].cpus);
+	if(has_libnuma) {
+		numa_set_preferred(zones[zone].node);
+	}
+}
+
+/* topology_print() - prints the mapping of the zones */
+void topology_print(void) {
+	int cpu, first;
+
+	printf("Zone mapping : %s (%s)\n", emulated? "emulated": "NUMA nodes",
+		   has_libnuma? "libnuma": "sysfs");
+	for(int i = 0; i < num_zones; ++i) {
+		printf("  zone %-2d    : node %d, cpus", i, zones[i].node);
+		for(cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+			if(!CPU_ISSET(cpu, &zones[i].cpus)) continue;
+			for(first = cpu; cpu + 1 < CPU_SETSIZE && CPU_ISSET(cpu + 1, &zones[i].cpus); ++cpu) {}
+			if(first == cpu) printf(" %d", cpu);
+			else printf(" %d-%d", first, cpu);
+		}
+		printf("\n");
+	}
+}
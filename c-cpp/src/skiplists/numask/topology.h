@@ -0,0 +1,24 @@
+/*
+ * Interface for the mapping of NUMA zones to nodes and CPUs
+ */
+#ifndef TOPOLOGY_H_
+#define TOPOLOGY_H_
+
+#include <sched.h>
+
+#define MAX_ZONES	64
+
+struct numa_zone_info {
+	int			node;		// memory node of the zone
+	cpu_set_t	cpus;		// CPUs the threads of the zone run on
+	int			num_cpus;
+};
+
+int		topology_init(int num_zones, bool emulate);
+int		topology_max_zones(bool emulate);
+int		topology_default_zones(bool emulate);
+int		zone_node(int zone);
+void	run_on_zone(int zone);
+void	topology_print(void);
+
+#endif /* TOPOLOGY_H_ */
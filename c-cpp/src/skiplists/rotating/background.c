@@ -48,6 +48,8 @@ common with other multi-threaded skip list implementations.
 #include <pthread.h>
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
 
 #include "common.h"
 #include "background.h"
@@ -86,18 +88,113 @@ static int bg_go;
 
 int bg_should_delete;
 
+/* - Adaptive maintenance - */
+
+#define BG_STRIPES      64      /* backlog counters */
+#define BG_ADAPT_SHIFT  4       /* sleep time goes down to base >> 4 */
+#define BG_BACKLOG_HIGH 64      /* shorten the sleep above size / 64 */
+#define BG_BACKLOG_LOW  1024    /* lengthen the sleep below size / 1024 */
+#define BG_SAMPLES      32      /* keys sampled for the path length */
+#define BG_HISTORY      64      /* points of the staleness time series */
+
+/* 1 to scale the sleep time and the passes to the backlog */
+int bg_adaptive = 1;
+
+/*
+ * Successful inserts of new nodes and logical deletes, counted by each
+ * worker thread in its own stripe (see nohotspot/background.c).
+ */
+typedef struct bg_backlog bg_backlog_t;
+static struct bg_backlog {
+        AO_t inserts;
+        AO_t deletes;
+        char pad[CACHE_LINE_SIZE - 2 * sizeof(AO_t)];
+} bg_backlog[BG_STRIPES];
+static AO_t bg_nb_stripes;
+static __thread bg_backlog_t *bg_stripe;
+
+/* the sleep time is bg_sleep_time >> bg_sleep_shift */
+static int bg_sleep_shift;
+
+/* keys sampled during the last pass to measure the path length */
+static unsigned long bg_samples[BG_SAMPLES];
+static int bg_nb_samples;
+
+/* index staleness over time, points are merged by pairs when full */
+typedef struct bg_point bg_point_t;
+static struct bg_point {
+        unsigned long time;     /* ms since bg_start() */
+        double path;            /* average search path length */
+        double backlog;         /* average backlog at wake-up */
+} bg_history[BG_HISTORY], bg_acc;
+static int bg_nb_points;
+static unsigned long bg_span;   /* wake-ups per point */
+static unsigned long bg_acc_n;  /* wake-ups accumulated in bg_acc */
+static struct timeval bg_start_time;
+
+static struct bg_sched_stats {
+        unsigned long wakeups;
+        unsigned long passes;
+        unsigned long sleep_sum;
+        unsigned long paths;
+        double path_sum;
+        double path_max;
+} bg_sched;
+
+/* - Partitioned maintenance - */
+
+#define BG_MAX_THREADS  BG_SAMPLES      /* one sampled key per boundary */
+#define BG_NO_KEY       (~0UL)          /* lo key of an empty partition */
+
+/* number of maintenance threads, each maintains a key-range partition */
+int bg_threads = 1;
+
+/*
+ * Partition k holds the nodes from its lo key up to the lo key of
+ * partition k + 1, the first partition also holds the head. The threads
+ * write the successors of the nodes of their partition only, the
+ * first thread links the partitions at their boundaries after each
+ * level (see nohotspot/background.c).
+ */
+typedef struct bg_part bg_part_t;
+static struct bg_part {
+        unsigned long lo;       /* first key of the partition */
+        int id;
+        int non_deleted;
+        int deleted;
+        int tall_deleted;
+        int raised;             /* nodes raised by the current phase */
+        int unlink;             /* the previous index node gets first */
+        node_t *first;          /* first live node of the level */
+        node_t *first_new;      /* first raised node, not linked */
+        int stride;
+        int nb_samples;
+        unsigned long samples[BG_SAMPLES];
+        CACHE_PAD(0);
+} bg_parts[BG_MAX_THREADS];
+static int bg_nb_parts;
+static pthread_t bg_helpers[BG_MAX_THREADS];
+static pthread_barrier_t bg_barrier;
+static int bg_quit;             /* the helper threads must exit */
+
 /* - Private Functions - */
 
 static void* bg_loop(void *args);
-static int bg_trav_nodes(ptst_t *ptst);
+static void* bg_helper(void *args);
+static int bg_maintain(ptst_t *ptst);
+static int bg_pass(bg_part_t *p, ptst_t *ptst);
+static void bg_sync(void);
+static unsigned long bg_hi(bg_part_t *p);
+static node_t* bg_find_pred(unsigned long i, unsigned long key);
+static void bg_partition(void);
+static void bg_split(void);
+static int bg_stitch(unsigned long i);
+static void bg_trav_nodes(bg_part_t *p, ptst_t *ptst);
 static void bg_lower_ilevel(ptst_t *ptst);
-static int bg_raise_ilevel(int height, ptst_t *ptst);
-static void get_index_above(node_t *head,
-                            node_t **prev,
-                            node_t **node,
-                            unsigned long i,
-                            unsigned long key,
-                            unsigned long zero);
+static void bg_raise_ilevel(bg_part_t *p, int height, ptst_t *ptst);
+static void bg_backlog_sum(unsigned long *inserts, unsigned long *deletes);
+static void bg_adapt(unsigned long backlog);
+static void bg_record(unsigned long backlog);
 
 /**
  * bg_loop - loop for maintaining index levels
@@ -105,15 +202,15 @@ static void get_index_above(node_t *head,
  *
  * Returns a void* value as per pthread_create requirements.
  * Note: Do this loop forever while the program is running.
+ * In adaptive mode, a wake-up with no backlog after a pass that left
+ * the index unchanged does not traverse the list.
+ * This thread maintains the first partition and drives the others.
  */
 static void* bg_loop(void *args)
 {
-        node_t  *head  = set->head;
-        int raised = 0; /* keep track of if we raised index level */
-        int threshold;  /* for testing if we should lower index level */
-        unsigned long i;
-        ptst_t *ptst = NULL;
-        unsigned long zero;
+        unsigned long inserts, deletes, last_inserts, last_deletes;
+        unsigned long backlog;
+        int changed = 1; /* the index changed during the last pass */
 
         assert(NULL != set);
         bg_counter = 0;
@@ -129,25 +226,281 @@ static void* bg_loop(void *args)
         bg_stats.delete_succeeds = 0;
         #endif
 
+        bg_backlog_sum(&last_inserts, &last_deletes);
+
         while (1) {
 
-                usleep(bg_sleep_time);
+                usleep(bg_sleep_time >> bg_sleep_shift);
 
                 if (bg_finished)
                         break;
 
-                zero = sl_zero;
+                bg_sched.sleep_sum += bg_sleep_time >> bg_sleep_shift;
+                ++bg_sched.wakeups;
 
-                #ifdef BG_STATS
-                ++(bg_stats.loops);
-                #endif
+                bg_backlog_sum(&inserts, &deletes);
+                backlog = (inserts - last_inserts) + (deletes - last_deletes);
+                bg_record(backlog);
+
+                if (bg_adaptive)
+                        bg_adapt(backlog);
+                if (!bg_adaptive || changed || 0 != backlog) {
+                        last_inserts = inserts;
+                        last_deletes = deletes;
+                        changed = bg_maintain(NULL);
+                }
+        }
+
+        /* release the helper threads */
+        bg_quit = 1;
+        bg_sync();
+
+        return NULL;
+}
+
+/**
+ * bg_helper - loop of the threads maintaining the other partitions
+ * @args: the partition
+ *
+ * Returns a void* value as per pthread_create requirements.
+ */
+static void* bg_helper(void *args)
+{
+        bg_part_t *p = (bg_part_t *) args;
+
+        while (1) {
+                /* wait for the next pass */
+                bg_sync();
+                if (bg_quit)
+                        break;
+                bg_pass(p, NULL);
+        }
+
+        return NULL;
+}
+
+/**
+ * bg_sync - wait for all the maintenance threads
+ */
+static void bg_sync(void)
+{
+        if (bg_nb_parts > 1)
+                pthread_barrier_wait(&bg_barrier);
+}
+
+/**
+ * bg_hi - first key after a partition
+ * @p: the partition
+ */
+static unsigned long bg_hi(bg_part_t *p)
+{
+        if (p->id + 1 < bg_nb_parts)
+                return bg_parts[p->id + 1].lo;
+        return BG_NO_KEY;
+}
+
+/**
+ * bg_find_pred - find the last index node before a key
+ * @i: the index level
+ * @key: the key
+ *
+ * Returns the node with the greatest key less than @key at index level
+ * @i, or the head.
+ */
+static node_t* bg_find_pred(unsigned long i, unsigned long key)
+{
+        node_t *item = set->head, *next;
+        unsigned long zero = sl_zero;
+        unsigned long level;
+
+        for (level = set->head->level - 1; ; level--) {
+                while (NULL != (next = item->succs[IDX(level,zero)]) &&
+                       next->key < key)
+                        item = next;
+                if (level == i)
+                        return item;
+        }
+}
+
+/**
+ * bg_partition - set the partitions of a pass
+ *
+ * Note: the partitions start at evenly spaced keys sampled during the
+ * last pass, the first one holds the whole list until there are
+ * enough samples.
+ */
+static void bg_partition(void)
+{
+        int k;
+
+        bg_parts[0].lo = 0;
+        for (k = 1; k < bg_nb_parts; k++) {
+                if (bg_nb_samples < bg_nb_parts)
+                        bg_parts[k].lo = BG_NO_KEY;
+                else
+                        bg_parts[k].lo =
+                                bg_samples[k * bg_nb_samples / bg_nb_parts];
+        }
+}
+
+/**
+ * bg_split - merge the keys sampled by the partitions
+ *
+ * Note: each key sampled by a partition stands for the stride nodes
+ * following it, bg_samples is set to BG_SAMPLES keys evenly spaced
+ * among the non-deleted nodes of the list.
+ */
+static void bg_split(void)
+{
+        unsigned long total = 0, count = 0;
+        bg_part_t *p;
+        int j = 0, k, s;
+
+        for (k = 0; k < bg_nb_parts; k++)
+                total += bg_parts[k].non_deleted;
+
+        for (k = 0; k < bg_nb_parts; k++) {
+                p = &bg_parts[k];
+                for (s = 0; s < p->nb_samples; s++) {
+                        count += p->stride;
+                        while (j < BG_SAMPLES && j * total < count * BG_SAMPLES)
+                                bg_samples[j++] = p->samples[s];
+                }
+        }
+        bg_nb_samples = j;
+}
+
+/**
+ * bg_stitch - link the partitions at their boundaries
+ * @i: the index level traversed by the partitions, -1 for the node level
+ *
+ * Returns 1 if a partition raised nodes and 0 otherwise.
+ * Note: this is done by the first thread while the others wait.
+ */
+static int bg_stitch(unsigned long i)
+{
+        unsigned long zero = sl_zero;
+        bg_part_t *p;
+        node_t *pred, *node, *next;
+        int k, raised = 0;
+
+        for (k = 0; k < bg_nb_parts; k++) {
+                p = &bg_parts[k];
+                raised |= p->raised;
+                if (p->unlink) {
+                        /* unlink the leading deleted nodes */
+                        pred = bg_find_pred(i, p->lo);
+                        node = pred->succs[IDX(i,zero)];
+                        pred->succs[IDX(i,zero)] = p->first;
+                        BARRIER(); /* do removal before level decrementing */
+                        while (node != p->first) {
+                                next = node->succs[IDX(i,zero)];
+                                --node->level;
+                                node = next;
+                        }
+                }
+                if (NULL != p->first_new) {
+                        pred = bg_find_pred(i + 1, p->first_new->key);
+#ifndef NDEBUG
+                        /* the later raises of @p are chained after it */
+                        for (node = p->first_new;
+                             node != pred->succs[IDX(i+1,zero)];
+                             node = node->succs[IDX(i+1,zero)])
+                                assert(NULL != node);
+#endif
+                        pred->succs[IDX(i+1,zero)] = p->first_new;
+                }
+        }
+
+        return raised;
+}
+
+/**
+ * bg_maintain - do a maintenance pass
+ * @ptst: per-thread state
+ *
+ * Returns 1 if the index levels were raised or lowered and 0 otherwise.
+ */
+static int bg_maintain(ptst_t *ptst)
+{
+        node_t  *head  = set->head;
+        int changed = 0;
+        int threshold;  /* for testing if we should lower index level */
+
+        #ifdef BG_STATS
+        ++(bg_stats.loops);
+        #endif
+        ++bg_sched.passes;
+
+        bg_partition();
+
+        /* start the pass of the helper threads */
+        bg_sync();
+
+        changed = bg_pass(&bg_parts[0], ptst);
+
+        // if needed, remove the lowest index level
+        threshold = bg_non_deleted * 10;
+        if (bg_tall_deleted > threshold) {
+                if (head->level > 1) {
+                        bg_lower_ilevel(ptst);
+                        changed = 1;
+
+                        #ifdef BG_STATS
+                        ++(bg_stats.lowers);
+                        #endif
+                }
+        }
+
+        if (bg_deleted > bg_non_deleted * 3) {
+                bg_should_delete = 1;
+                bg_stats.should_delete += 1;
+        }
+        else {
+                bg_should_delete = 0;
+        }
+        BARRIER();
+
+        return changed;
+}
+
+/**
+ * bg_pass - maintain a partition during a pass
+ * @p: the partition
+ * @ptst: per-thread state
+ *
+ * Returns 1 to the first thread if the index levels were raised.
+ * Note: all the threads run the phases of the pass together, the first
+ * one links the partitions and adds the index levels between them.
+ */
+static int bg_pass(bg_part_t *p, ptst_t *ptst)
+{
+        node_t  *head  = set->head;
+        int raised = 0; /* keep track of if we raised index level */
+        int changed = 0;
+        int first = (0 == p->id);
+        unsigned long i;
+        unsigned long zero;
+        int k;
 
+        zero = sl_zero;
+
+        // traverse the node level and try deletes/raises
+        bg_trav_nodes(p, ptst);
+        bg_sync();
+        if (first) {
                 bg_non_deleted = 0;
                 bg_deleted = 0;
                 bg_tall_deleted = 0;
+                for (k = 0; k < bg_nb_parts; k++) {
+                        bg_non_deleted += bg_parts[k].non_deleted;
+                        bg_deleted += bg_parts[k].deleted;
+                        bg_tall_deleted += bg_parts[k].tall_deleted;
+                }
+                bg_split();
 
-                // traverse the node level and try deletes/raises
-                raised = bg_trav_nodes(ptst);
+                raised = bg_stitch(-1);
+                changed |= raised;
 
                 if (raised && (1 == head->level)) {
                         // add a new index level
@@ -161,11 +514,18 @@ static void* bg_loop(void *args)
                         ++(bg_stats.raises);
                         #endif
                 }
+        }
+        bg_sync();
 
-                // raise the index level nodes
-                for (i = 0; (i+1) < set->head->level; i++) {
-                        assert(i < MAX_LEVELS);
-                        raised = bg_raise_ilevel(i + 1, ptst);
+        // raise the index level nodes
+        for (i = 0; (i+1) < set->head->level; i++) {
+                assert(i < MAX_LEVELS);
+                bg_raise_ilevel(p, i + 1, ptst);
+                bg_sync();
+
+                if (first) {
+                        raised = bg_stitch(i);
+                        changed |= raised;
 
                         if ((((i+1) == (head->level-1)) && raised)
                                         && head->level < MAX_LEVELS) {
@@ -181,66 +541,194 @@ static void* bg_loop(void *args)
                                 #endif
                         }
                 }
+                bg_sync();
+        }
 
-                // if needed, remove the lowest index level
-                threshold = bg_non_deleted * 10;
-                if (bg_tall_deleted > threshold) {
-                        if (head->level > 1) {
-                                bg_lower_ilevel(ptst);
+        return changed;
+}
 
-                                #ifdef BG_STATS
-                                ++(bg_stats.lowers);
-                                #endif
-                        }
-                }
+/**
+ * bg_backlog_sum - sum the backlog counters of all threads
+ * @inserts: set to the number of inserts of new nodes
+ * @deletes: set to the number of logical deletes
+ */
+static void bg_backlog_sum(unsigned long *inserts, unsigned long *deletes)
+{
+        int i;
+
+        *inserts = 0;
+        *deletes = 0;
+        for (i = 0; i < BG_STRIPES; i++) {
+                *inserts += AO_load(&bg_backlog[i].inserts);
+                *deletes += AO_load(&bg_backlog[i].deletes);
+        }
+}
+
+/**
+ * bg_adapt - scale the sleep time to the backlog
+ * @backlog: updates since the last pass
+ *
+ * Note: the sleep time is halved while the backlog is more than
+ * 1/BG_BACKLOG_HIGH of the list and doubled back towards the base
+ * sleep time while it is less than 1/BG_BACKLOG_LOW of the list.
+ */
+static void bg_adapt(unsigned long backlog)
+{
+        unsigned long size = bg_non_deleted + 1;
+
+        if (backlog * BG_BACKLOG_HIGH > size) {
+                if (bg_sleep_shift < BG_ADAPT_SHIFT)
+                        ++bg_sleep_shift;
+        } else if (backlog * BG_BACKLOG_LOW < size) {
+                if (bg_sleep_shift > 0)
+                        --bg_sleep_shift;
+        }
+}
+
+/**
+ * bg_path_length - length of the search path to a key
+ * @key: the search key
+ *
+ * Returns the number of index and node hops of a search for @key.
+ */
+static int bg_path_length(unsigned long key)
+{
+        node_t *item, *next_item, *next;
+        unsigned long zero, i;
+        int hops = 0;
+
+        zero = sl_zero;
+        i = set->head->level - 1;
 
-                if (bg_deleted > bg_non_deleted * 3) {
-                        bg_should_delete = 1;
-                        bg_stats.should_delete += 1;
+        item = set->head;
+        while (1) {
+                next_item = item->succs[IDX(i,zero)];
+                if (NULL == next_item || next_item->key > key) {
+                        if (zero == i)
+                                break;
+                        --i;
+                } else {
+                        item = next_item;
                 }
-                else {
-                        bg_should_delete = 0;
+                ++hops;
+        }
+        while (NULL != (next = item->next) && next->key <= key) {
+                item = next;
+                ++hops;
+        }
+
+        return hops;
+}
+
+/**
+ * bg_record - record the index staleness at a wake-up
+ * @backlog: updates since the last pass
+ *
+ * Note: the staleness is the average search path length to the keys
+ * sampled during the last pass.
+ */
+static void bg_record(unsigned long backlog)
+{
+        struct timeval now;
+        ptst_t *ptst;
+        double path = 0;
+        int i;
+
+        if (0 == bg_nb_samples)
+                return;
+
+        ptst = ptst_critical_enter();
+        for (i = 0; i < bg_nb_samples; i++)
+                path += bg_path_length(bg_samples[i]);
+        ptst_critical_exit(ptst);
+        path /= bg_nb_samples;
+
+        ++bg_sched.paths;
+        bg_sched.path_sum += path;
+        if (path > bg_sched.path_max)
+                bg_sched.path_max = path;
+
+        bg_acc.path += path;
+        bg_acc.backlog += backlog;
+        if (++bg_acc_n < bg_span)
+                return;
+
+        if (BG_HISTORY == bg_nb_points) {
+                /* halve the resolution of the time series */
+                for (i = 0; i < BG_HISTORY / 2; i++) {
+                        bg_history[i].time = bg_history[2 * i + 1].time;
+                        bg_history[i].path = (bg_history[2 * i].path +
+                                              bg_history[2 * i + 1].path) / 2;
+                        bg_history[i].backlog = (bg_history[2 * i].backlog +
+                                                 bg_history[2 * i + 1].backlog) / 2;
                 }
-                BARRIER();
+                bg_nb_points = BG_HISTORY / 2;
+                bg_span *= 2;
+                if (bg_acc_n < bg_span)
+                        return;
         }
 
-        return NULL;
+        gettimeofday(&now, NULL);
+        bg_history[bg_nb_points].time =
+                (now.tv_sec - bg_start_time.tv_sec) * 1000 +
+                (now.tv_usec - bg_start_time.tv_usec) / 1000;
+        bg_history[bg_nb_points].path = bg_acc.path / bg_acc_n;
+        bg_history[bg_nb_points].backlog = bg_acc.backlog / bg_acc_n;
+        ++bg_nb_points;
+
+        bg_acc.path = 0;
+        bg_acc.backlog = 0;
+        bg_acc_n = 0;
 }
 
 /**
- * bg_trav_nodes - traverse node level of skip list
+ * bg_trav_nodes - traverse node level of a partition
+ * @p: the partition
  * @ptst: per-thread state
  *
- * Returns 1 if a raise was done and 0 otherwise.
- *
  * Note: this tries to raise non-deleted nodes, and finished deletions that
- * have been started but not completed.
+ * have been started but not completed. It also samples the key of one
+ * non-deleted node every stride nodes. p->raised is set to 1 if a raise
+ * was done and 0 otherwise.
  */
-static int bg_trav_nodes(ptst_t *ptst)
+static void bg_trav_nodes(bg_part_t *p, ptst_t *ptst)
 {
         node_t *prev, *node, *next;
-        node_t *above_head = set->head, *above_prev, *above_next;
+        node_t *above;
         unsigned long zero = sl_zero;
-        int raised = 0;
+        unsigned long hi = bg_hi(p);
 
         assert(NULL != set && NULL != set->head);
 
+        p->stride = bg_non_deleted / (BG_SAMPLES * bg_nb_parts) + 1;
+        p->non_deleted = 0;
+        p->deleted = 0;
+        p->tall_deleted = 0;
+        p->nb_samples = 0;
+        p->raised = 0;
+        p->unlink = 0;
+        p->first_new = NULL;
+        if (BG_NO_KEY == p->lo)
+                return;
+
         ptst = ptst_critical_enter();
 
-        above_prev = above_next = above_head;
-        prev = set->head;
-        node = prev->next;
-        if (NULL == node)
-                return 0;
+        above = prev = bg_find_pred(0, p->lo);
+        while (NULL != (node = prev->next) && node->key < p->lo)
+                prev = node;
+        if (NULL == node) {
+                ptst_critical_exit(ptst);
+                return;
+        }
         next = node->next;
 
-        while (NULL != next) {
+        while (NULL != next && node->key < hi) {
 
                 if (NULL == node->val) {
                         bg_remove(prev, node, ptst);
                         if (node->level >= 1)
-                                ++bg_tall_deleted;
-                        ++bg_deleted;
+                                ++p->tall_deleted;
+                        ++p->deleted;
                 }
                 else if (node->val != node) {
                         if ((((0 == prev->level
@@ -250,24 +738,31 @@ static int bg_trav_nodes(ptst_t *ptst)
 
                                 node->level = 1;
 
-                                raised = 1;
+                                p->raised = 1;
 
-                                get_index_above(above_head, &above_prev,
-                                                &above_next, 0, node->key,
-                                                zero);
+                                // get the correct index node above
+                                while (NULL != above->succs[IDX(0,zero)] &&
+                                       above->succs[IDX(0,zero)]->key < node->key)
+                                        above = above->succs[IDX(0,zero)];
 
                                 // swap the pointers
-                                node->succs[IDX(0,zero)] = above_next;
+                                node->succs[IDX(0,zero)] = above->succs[IDX(0,zero)];
 
                                 BARRIER(); // make sure above happens first
 
-                                above_prev->succs[IDX(0,zero)] = node;
-                                above_next = above_prev = above_head = node;
+                                if (above->key < p->lo)
+                                        p->first_new = node;
+                                else
+                                        above->succs[IDX(0,zero)] = node;
+                                above = node;
                         }
                 }
 
                 if (NULL != node->val && node != node->val) {
-                        ++bg_non_deleted;
+                        if (0 == p->non_deleted % p->stride &&
+                            p->nb_samples < BG_SAMPLES)
+                                p->samples[p->nb_samples++] = node->key;
+                        ++p->non_deleted;
                 }
                 prev = node;
                 node = next;
@@ -275,54 +770,50 @@ static int bg_trav_nodes(ptst_t *ptst)
         }
 
         ptst_critical_exit(ptst);
-
-        return raised;
 }
 
-/**
- * get_index_above - get the index node above for a raise
- */
-static void get_index_above(node_t *above_head,
-                            node_t **above_prev,
-                            node_t **above_next,
-                            unsigned long i,
-                            unsigned long key,
-                            unsigned long zero)
-{
-        /* get the correct index node above */
-        while (*above_next && (*above_next)->key < key) {
-                *above_next = (*above_next)->succs[IDX(i,zero)];
-                if (*above_next != above_head->succs[IDX(i,zero)])
-                        *above_prev = (*above_prev)->succs[IDX(i,zero)];
-        }
-}
-
-
-
 /**
  * bg_raise_ilevel - raise the index levels
+ * @p: the partition
  * @h: the height of the level we are raising
  * @ptst: per-thread state
  *
- * Returns 1 if a node was raised and 0 otherwise.
+ * Note: p->raised is set to 1 if a node was raised and 0 otherwise.
  */
-static int bg_raise_ilevel(int h, ptst_t *ptst)
+static void bg_raise_ilevel(bg_part_t *p, int h, ptst_t *ptst)
 {
-        int raised = 0;
         unsigned long zero = sl_zero;
-        node_t *index, *inext, *iprev = set->head;
-        node_t *above_next, *above_prev, *above_head;
+        unsigned long hi = bg_hi(p);
+        node_t *index, *inext, *iprev;
+        node_t *above;
+
+        p->raised = 0;
+        p->unlink = 0;
+        p->first_new = NULL;
+        if (BG_NO_KEY == p->lo)
+                return;
 
         ptst = ptst_critical_enter();
 
-        above_next = above_prev = above_head = set->head;
+        iprev = bg_find_pred(h-1, p->lo);
+        above = bg_find_pred(h, p->lo);
 
         index = iprev->succs[IDX(h-1,zero)];
-        if (NULL == index)
-                return raised;
 
-        while (NULL != (inext = index->succs[IDX(h-1,zero)])) {
-                while (index->val == index) {
+        if (iprev->key < p->lo) {
+                // unlinked at the stitching, iprev is not ours
+                while (NULL != index && index->key < hi &&
+                       index->val == index)
+                        index = index->succs[IDX(h-1,zero)];
+                if (index != iprev->succs[IDX(h-1,zero)]) {
+                        p->first = index;
+                        p->unlink = 1;
+                }
+        }
+
+        while (NULL != index && index->key < hi &&
+               NULL != (inext = index->succs[IDX(h-1,zero)])) {
+                while (index->val == index && index->key < hi) {
 
                         // skip deleted nodes
                         iprev->succs[IDX(h-1,zero)] = inext;
@@ -334,33 +825,35 @@ static int bg_raise_ilevel(int h, ptst_t *ptst)
                         index = inext;
                         inext = inext->succs[IDX(h-1,zero)];
                 }
-                if (NULL == inext)
+                if (NULL == inext || index->key >= hi)
                         break;
                 if ( (((iprev->level <= h) && (index->level == h)) &&
                     (inext->level <= h)) && (index->val != index && NULL != index->val) ) {
-                        raised = 1;
+                        p->raised = 1;
 
                         /* find the correct index node above */
-                        get_index_above(above_head, &above_prev, &above_next,
-                                        h, index->key, zero);
+                        while (NULL != above->succs[IDX(h,zero)] &&
+                               above->succs[IDX(h,zero)]->key < index->key)
+                                above = above->succs[IDX(h,zero)];
 
                         /* fix the pointers and levels */
-                        index->succs[IDX(h,zero)] = above_next;
+                        index->succs[IDX(h,zero)] = above->succs[IDX(h,zero)];
                         BARRIER(); /* link index to above_next first */
-                        above_prev->succs[IDX(h,zero)] = index;
+                        if (above->key < p->lo)
+                                p->first_new = index;
+                        else
+                                above->succs[IDX(h,zero)] = index;
                         ++index->level;
 
                         assert(index->level == h+1);
 
-                        above_next = above_prev = above_head = index;
+                        above = index;
                 }
                 iprev = index;
                 index = index->succs[IDX(h-1,zero)];
         }
 
         ptst_critical_exit(ptst);
-
-        return raised;
 }
 
 /**
@@ -421,16 +914,39 @@ void bg_init(set_t *s)
 }
 
 /**
- * bg_start - start the background thread
+ * bg_start - start the background threads
  *
- * Note: Only start the background thread if it is not currently
- * running.
+ * Note: Only start the background threads if they are not currently
+ * running, bg_threads threads maintain the partitions of the list.
  */
 void bg_start(int sleep_time)
 {
+        int k;
+
         /* XXX not thread safe  XXX */
         if (!bg_running) {
                 bg_sleep_time = sleep_time;
+                bg_sleep_shift = 0;
+                memset(&bg_sched, 0, sizeof(bg_sched));
+                memset(&bg_acc, 0, sizeof(bg_acc));
+                bg_nb_points = 0;
+                bg_span = 1;
+                bg_acc_n = 0;
+                gettimeofday(&bg_start_time, NULL);
+
+                bg_nb_parts = bg_threads;
+                if (bg_nb_parts < 1)
+                        bg_nb_parts = 1;
+                if (bg_nb_parts > BG_MAX_THREADS)
+                        bg_nb_parts = BG_MAX_THREADS;
+                bg_quit = 0;
+                if (bg_nb_parts > 1)
+                        pthread_barrier_init(&bg_barrier, NULL, bg_nb_parts);
+                for (k = 0; k < bg_nb_parts; k++)
+                        bg_parts[k].id = k;
+                for (k = 1; k < bg_nb_parts; k++)
+                        pthread_create(&bg_helpers[k], NULL, bg_helper,
+                                       &bg_parts[k]);
                 bg_running = 1;
                 bg_finished = 0;
                 pthread_create(&bg_thread, NULL, bg_loop, NULL);
@@ -438,26 +954,75 @@ void bg_start(int sleep_time)
 }
 
 /**
- * bg_stop - stop the background thread
+ * bg_stop - stop the background threads
  */
 void bg_stop(void)
 {
+        int k;
+
         /* XXX not thread safe XXX */
         if (bg_running) {
                 bg_finished = 1;
                 pthread_join(bg_thread, NULL);
+                for (k = 1; k < bg_nb_parts; k++)
+                        pthread_join(bg_helpers[k], NULL);
+                if (bg_nb_parts > 1)
+                        pthread_barrier_destroy(&bg_barrier);
                 BARRIER();
                 bg_running = 0;
         }
 }
 
+/**
+ * bg_note_insert - count the insert of a new node
+ */
+void bg_note_insert(void)
+{
+        if (NULL == bg_stripe)
+                bg_stripe = &bg_backlog[FAI(&bg_nb_stripes) % BG_STRIPES];
+        FAI(&bg_stripe->inserts);
+}
+
+/**
+ * bg_note_delete - count a logical delete
+ */
+void bg_note_delete(void)
+{
+        if (NULL == bg_stripe)
+                bg_stripe = &bg_backlog[FAI(&bg_nb_stripes) % BG_STRIPES];
+        FAI(&bg_stripe->deletes);
+}
+
 /**
  * bg_print_stats - print background statistics
  *
- * Note: this is a noop if BG_STATS is not defined.
+ * Note: the scheduling and staleness statistics are those since the
+ * last bg_start(), the others are only printed if BG_STATS is defined.
  */
 void bg_print_stats(void)
 {
+        int i, k, largest = 0;
+
+        printf("#bg wake-ups  : %lu (%lu passes)\n",
+               bg_sched.wakeups, bg_sched.passes);
+        for (k = 0; k < bg_nb_parts; k++)
+                if (bg_parts[k].non_deleted > largest)
+                        largest = bg_parts[k].non_deleted;
+        printf("  #threads    : %d (largest partition %f %%)\n",
+               bg_nb_parts,
+               bg_non_deleted ? 100.0 * largest / bg_non_deleted : 0.0);
+        printf("  #avg sleep  : %f (us, last %d)\n",
+               bg_sched.wakeups ?
+               (double) bg_sched.sleep_sum / bg_sched.wakeups : 0.0,
+               bg_sleep_time >> bg_sleep_shift);
+        printf("  #path length: %f (max %f)\n",
+               bg_sched.paths ? bg_sched.path_sum / bg_sched.paths : 0.0,
+               bg_sched.path_max);
+        for (i = 0; i < bg_nb_points; i++)
+                printf("    %8lu ms : path %f, backlog %f\n",
+                       bg_history[i].time, bg_history[i].path,
+                       bg_history[i].backlog);
+
         #ifdef BG_STATS
         printf("Loops = %lu\n", bg_stats.loops);
         printf("Raises = %lu\n", bg_stats.raises);
@@ -39,6 +39,12 @@ the appropriate action is taken based on the abstract operation
 being performed. For example, if we are conducting a delete and
 node.key is equal to the search key, then we try to extract node.
 
+The range scans sl_range() and sl_range_snapshot() find the entry-point
+of the lowest key of their range the same way and then walk the node
+level up to the highest key. The linearizable one validates the walk
+against the stripes of the update counters of the set, see
+nohotspot_ops.h.
+
 Worthy to note is that worker threads in this skip list implementation
 do not perform maintenance of the index levels: this is carried
 out by a background thread. Worker threads do, however, perform
@@ -63,8 +69,14 @@ finished.
 
 extern int bg_should_delete;
 
+int sl_range_linearizable = 0;
+
 /* - Private Functions - */
 
+static node_t* sl_entry(set_t *set, unsigned long key);
+static void sl_update_begin(set_t *set, unsigned long key);
+static void sl_update_end(set_t *set, unsigned long key, int modified);
+
 static int sl_finish_contains(unsigned int key, node_t *node,
                               void *node_val, ptst_t *ptst);
 static int sl_finish_delete(unsigned int key, node_t *node,
@@ -125,6 +137,7 @@ static int sl_finish_delete(unsigned int key, node_t *node,
                                 }
                                 else if (CAS(&node->val, node_val, NULL)) {
                                         result = 1;
+                                        bg_note_delete();
                                         if (bg_should_delete) {
                                                 if (CAS(&node->raise_or_remove, 0, 1)) {
                                                         bg_remove(node->prev, node,
@@ -183,6 +196,7 @@ static int sl_finish_insert(unsigned int key, void *val, node_t *node,
                                 CAS(&next->prev, temp, new);
                         }
                         result = 1;
+                        bg_note_insert();
                 } else {
                         node_delete(new, ptst);
                 }
@@ -191,37 +205,24 @@ static int sl_finish_insert(unsigned int key, void *val, node_t *node,
         return result;
 }
 
-/* - The public nohotspot_ops interface - */
-
 /**
- * sl_do_operation - find node and next for this operation
+ * sl_entry - find an entry-point to the node level
  * @set: the skip list set
- * @optype: the type of operation this is
  * @key: the search key
- * @val: the seach value
  *
- * Returns the result of the operation.
- * Note: @val can be NULL.
+ * Returns the node with the greatest key less than or equal to @key
+ * found by the descent of the index levels.
+ * Note: must be called within a critical section.
  */
-int sl_do_operation(set_t *set, sl_optype_t optype, unsigned int key, void *val)
+static node_t* sl_entry(set_t *set, unsigned long key)
 {
-        node_t *item = NULL, *next_item = NULL;
-        node_t *node = NULL, *next = NULL;
-        node_t *head = set->head;
-        void *node_val = NULL, *next_val = NULL;
-        int result = 0;
-        ptst_t *ptst;
+        node_t *item, *next_item;
         unsigned long zero, i;
 
-        assert(NULL != set);
-
-        ptst = ptst_critical_enter();
-
         zero = sl_zero;
         i = set->head->level - 1;
 
-        /* find an entry-point to the node-level */
-        item = head;
+        item = set->head;
         while (1) {
                 next_item = item->succs[IDX(i,zero)];
 
@@ -229,14 +230,77 @@ int sl_do_operation(set_t *set, sl_optype_t optype, unsigned int key, void *val)
 
                         next_item = item;
                         if (zero == i) {
-                                node = item;
-                                break;
+                                return item;
                         } else {
                                 --i;
                         }
                 }
                 item = next_item;
         }
+}
+
+/**
+ * sl_update_begin - announce an update in the stripe of its key
+ * @set: the skip list set
+ * @key: the key of the update
+ *
+ * Note: waits while a range scan blocks the updates.
+ */
+static void sl_update_begin(set_t *set, unsigned long key)
+{
+        volatile AO_t *word = &set->stripes[key % SL_STRIPES].word;
+
+        while (1) {
+                AO_fetch_and_add_full(word, SL_STRIPE_PENDING);
+                if (!AO_load_full(&set->range_gate))
+                        return;
+                AO_fetch_and_add_full(word, (AO_t) -SL_STRIPE_PENDING);
+                while (AO_load_full(&set->range_gate))
+                        ;
+        }
+}
+
+/**
+ * sl_update_end - complete an update announced by sl_update_begin()
+ * @set: the skip list set
+ * @key: the key of the update
+ * @modified: 1 if the update modified the set, 0 otherwise
+ */
+static void sl_update_end(set_t *set, unsigned long key, int modified)
+{
+        AO_fetch_and_add_full(&set->stripes[key % SL_STRIPES].word,
+                              modified ? SL_STRIPE_VERSION_INC -
+                              SL_STRIPE_PENDING : (AO_t) -SL_STRIPE_PENDING);
+}
+
+/* - The public nohotspot_ops interface - */
+
+/**
+ * sl_do_operation - find node and next for this operation
+ * @set: the skip list set
+ * @optype: the type of operation this is
+ * @key: the search key
+ * @val: the seach value
+ *
+ * Returns the result of the operation.
+ * Note: @val can be NULL.
+ */
+int sl_do_operation(set_t *set, sl_optype_t optype, unsigned int key, void *val)
+{
+        node_t *node = NULL, *next = NULL;
+        void *node_val = NULL, *next_val = NULL;
+        int result = 0;
+        ptst_t *ptst;
+
+        assert(NULL != set);
+
+        if (sl_range_linearizable && CONTAINS != optype)
+                sl_update_begin(set, key);
+
+        ptst = ptst_critical_enter();
+
+        /* find an entry-point to the node-level */
+        node = sl_entry(set, key);
 
         /* find the correct node and next */
         while (1) {
@@ -273,5 +337,119 @@ int sl_do_operation(set_t *set, sl_optype_t optype, unsigned int key, void *val)
 
         ptst_critical_exit(ptst);
 
+        if (sl_range_linearizable && CONTAINS != optype)
+                sl_update_end(set, key, 1 == result);
+
         return result;
 }
+
+/**
+ * sl_range - weakly consistent scan of a range of keys
+ * @set: the skip list set
+ * @lo: the lowest key of the range
+ * @hi: the highest key of the range
+ * @keys: the array receiving the keys
+ * @max: the size of @keys
+ *
+ * Returns the number of keys written to @keys.
+ * Note: the scan walks the node level from the entry-point of @lo as
+ * sl_do_operation() does, so each node found logically deleted is
+ * skipped and each node found physically removed is helped out.
+ */
+int sl_range(set_t *set, unsigned long lo, unsigned long hi,
+             unsigned long *keys, int max)
+{
+        node_t *node, *next;
+        void *node_val;
+        int n = 0;
+        ptst_t *ptst;
+
+        assert(NULL != set);
+
+        ptst = ptst_critical_enter();
+
+        node = sl_entry(set, lo);
+        while (n < max) {
+                while (node == (node_val = node->val)) {
+                        node = node->prev;
+                }
+                next = node->next;
+                if (NULL != next && next->val == next) {
+                        bg_help_remove(node, next, ptst);
+                        continue;
+                }
+                /* lo moves past each key reported, not to report it twice */
+                if (node->key >= lo && node->key <= hi && NULL != node_val) {
+                        keys[n++] = node->key;
+                        lo = node->key + 1;
+                }
+                if (NULL == next || next->key > hi)
+                        break;
+                node = next;
+        }
+
+        ptst_critical_exit(ptst);
+
+        return n;
+}
+
+/**
+ * sl_range_snapshot - linearizable scan of a range of keys
+ * @set: the skip list set
+ * @lo: the lowest key of the range
+ * @hi: the highest key of the range
+ * @keys: the array receiving the keys
+ * @max: the size of @keys
+ * @retries: the number of scans before blocking the updates
+ * @stat: the statistics of the calling thread
+ *
+ * Returns the number of keys written to @keys.
+ * Note: only the stripes of the keys of the range are validated, so the
+ * updates of other keys do not invalidate the scan.
+ */
+int sl_range_snapshot(set_t *set, unsigned long lo, unsigned long hi,
+                      unsigned long *keys, int max, int retries,
+                      sl_range_stat_t *stat)
+{
+        AO_t words[SL_STRIPES];
+        int nb, i, n, attempt, valid;
+
+        assert(sl_range_linearizable);
+
+        if (hi < lo)
+                return 0;
+        nb = (hi - lo < SL_STRIPES) ? (int) (hi - lo) + 1 : SL_STRIPES;
+
+        for (attempt = 0; attempt < retries; attempt++) {
+                valid = 1;
+                for (i = 0; i < nb && valid; i++) {
+                        words[i] = AO_load_full(&set->stripes[(lo + i) %
+                                                SL_STRIPES].word);
+                        valid = !(words[i] & SL_STRIPE_MASK);
+                }
+                if (valid) {
+                        n = sl_range(set, lo, hi, keys, max);
+                        for (i = 0; i < nb && valid; i++)
+                                valid = (AO_load_full(&set->stripes[(lo + i) %
+                                         SL_STRIPES].word) == words[i]);
+                        if (valid) {
+                                stat->keys += n;
+                                return n;
+                        }
+                }
+                stat->retries++;
+        }
+
+        /* block the updates and wait for those in progress */
+        FAI(&set->range_gate);
+        for (i = 0; i < nb; i++)
+                while (AO_load_full(&set->stripes[(lo + i) %
+                                    SL_STRIPES].word) & SL_STRIPE_MASK)
+                        ;
+        n = sl_range(set, lo, hi, keys, max);
+        FAD(&set->range_gate);
+        stat->keys += n;
+        stat->blocked++;
+
+        return n;
+}
@@ -19,7 +19,7 @@
 #define NODE_SIZE 0
 
 #define IDX(_i, _z) ((_z) + (_i)) % MAX_LEVELS
-unsigned long sl_zero;
+extern unsigned long sl_zero;
 
 /* bottom-level nodes */
 typedef VOLATILE struct sl_node node_t;
@@ -34,10 +34,28 @@ struct sl_node {
         unsigned long   raise_or_remove;
 };
 
+/*
+ * The updates are counted in padded stripes of keys when the linearizable
+ * range scans are enabled: the word of a stripe counts the updates in
+ * progress (bits 0-15) and the updates that modified the set (bits 16 and
+ * up).
+ */
+#define SL_STRIPES              64
+#define SL_STRIPE_PENDING       1UL
+#define SL_STRIPE_VERSION_INC   (1UL << 16)
+#define SL_STRIPE_MASK          (SL_STRIPE_VERSION_INC - 1)
+
+typedef struct sl_stripe {
+        volatile AO_t   word;
+        char            pad[CACHE_LINE_SIZE - sizeof(AO_t)];
+} sl_stripe_t;
+
 /* the skip list set */
 typedef struct sl_set set_t;
 struct sl_set {
         struct sl_node  *head;
+        sl_stripe_t     stripes[SL_STRIPES];
+        volatile AO_t   range_gate;
 };
 
 node_t* node_new(unsigned long key, void *val, node_t *prev, node_t *next,
@@ -49,6 +67,8 @@ void node_delete(node_t *node, ptst_t *ptst);
 void marker_delete(node_t *node, ptst_t *ptst);
 
 set_t* set_new(int start);
+int set_bulk_load(set_t *set, unsigned long *keys, void **vals, int n,
+                  int nb_threads);
 void set_delete(set_t *set);
 void set_print(set_t *set, int flag);
 int set_size(set_t *set, int flag);
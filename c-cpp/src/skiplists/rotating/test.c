@@ -31,12 +31,14 @@
 #include <sys/time.h>
 #include <time.h>
 #include <stdint.h>
+#include <string.h>
 
 #include <atomic_ops.h>
 
 #include "tm.h"
 #include "ptst.h"
 #include "garbagecoll.h"
+#include "bulk_keys.h"
 
 #define DEFAULT_DURATION                10000
 #define DEFAULT_INITIAL                 256
@@ -48,6 +50,12 @@
 #define DEFAULT_ALTERNATE               0
 #define DEFAULT_EFFECTIVE               1
 #define DEFAULT_UNBALANCED              0
+#define DEFAULT_MAINTENANCE             1
+#define DEFAULT_BG_THREADS              1
+#define DEFAULT_SCAN                    0
+#define DEFAULT_RANGE_WIDTH             100
+#define DEFAULT_RANGE_RETRIES           16
+#define DEFAULT_BULK                    0
 
 #define XSTR(s)                         STR(s)
 #define STR(s)                          #s
@@ -63,6 +71,7 @@
 inline long rand_range(long r); /* declared in test.c */
 
 #include "intset.h"
+#include "nohotspot_ops.h"
 #include "background.h"
 
 volatile AO_t stop;
@@ -159,12 +168,17 @@ typedef struct thread_data {
 	int unit_tx;
 	int alternate;
 	int effective;
+	int scan;
+	int width;
+	int linearizable;
 	unsigned long nb_add;
 	unsigned long nb_added;
 	unsigned long nb_remove;
 	unsigned long nb_removed;
 	unsigned long nb_contains;
 	unsigned long nb_found;
+	unsigned long nb_scan;
+	sl_range_stat_t range_stat;
 	unsigned long nb_aborts;
 	unsigned long nb_aborts_locked_read;
 	unsigned long nb_aborts_locked_write;
@@ -204,11 +218,17 @@ void print_skiplist(set_t *set) {
 
 
 void *test(void *data) {
-	int unext, last = -1;
+	int n, unext, last = -1;
 	unsigned int val = 0;
+	unsigned long *keys;
 
 	thread_data_t *d = (thread_data_t *)data;
 
+	if ((keys = (unsigned long *)malloc(d->width * sizeof(unsigned long))) == NULL) {
+		perror("malloc");
+		exit(1);
+	}
+
 	/* Create transaction */
 	TM_THREAD_ENTER();
 	/* Wait on barrier */
@@ -255,6 +275,17 @@ void *test(void *data) {
 				d->nb_remove++;
 			}
 
+		} else if (d->scan && rand_range_re(&d->seed, 100 - d->update) <= d->scan) { // range scan
+
+			val = rand_range_re(&d->seed, d->range);
+			if (d->linearizable)
+				n = sl_range_snapshot(d->set, val, val + d->width - 1, keys, d->width,
+				                      DEFAULT_RANGE_RETRIES, &d->range_stat);
+			else
+				n = sl_range(d->set, val, val + d->width - 1, keys, d->width);
+			d->range_stat.keys += d->linearizable ? 0 : n;
+			d->nb_scan++;
+
 		} else { // read
 
 			if (d->alternate) {
@@ -285,7 +316,7 @@ void *test(void *data) {
 		/* Is the next op an update? */
 		if (d->effective) { // a failed remove/add is a read-only tx
 			unext = ((100 * (d->nb_added + d->nb_removed))
-							 < (d->update * (d->nb_add + d->nb_remove + d->nb_contains)));
+							 < (d->update * (d->nb_add + d->nb_remove + d->nb_contains + d->nb_scan)));
 		} else { // remove/add (even failed) is considered as an update
 			unext = (rand_range_re(&d->seed, 100) - 1 < d->update);
 		}
@@ -296,6 +327,8 @@ void *test(void *data) {
 	}
 #endif /* ICC */
 
+	free(keys);
+
 	/* Free transaction */
 	TM_THREAD_EXIT();
 
@@ -320,6 +353,12 @@ int main(int argc, char **argv)
 		{"update-rate",               required_argument, NULL, 'u'},
 		{"unbalance",                 required_argument, NULL, 'U'},
 		{"elasticity",                required_argument, NULL, 'x'},
+		{"maintenance",               required_argument, NULL, 'M'},
+		{"bg-threads",                required_argument, NULL, 'K'},
+		{"scan-rate",                 required_argument, NULL, 's'},
+		{"range-width",               required_argument, NULL, 'w'},
+		{"linearizable",              no_argument,       NULL, 'L'},
+		{"bulk",                      required_argument, NULL, 'B'},
 		{NULL, 0, NULL, 0}
 	};
 
@@ -327,7 +366,7 @@ int main(int argc, char **argv)
 	int i, c, size;
 	unsigned int last = 0;
 	unsigned int val = 0;
-	unsigned long reads, effreads, updates, effupds, aborts, aborts_locked_read, aborts_locked_write,
+	unsigned long reads, effreads, updates, effupds, scans, scanned, scan_retries, scan_blocked, aborts, aborts_locked_read, aborts_locked_write,
 	aborts_validate_read, aborts_validate_write, aborts_validate_commit,
 	aborts_invalid_memory, aborts_double_write, max_retries, failures_because_contention;
 	thread_data_t *data;
@@ -349,6 +388,14 @@ int main(int argc, char **argv)
         unsigned long top;
         node_t *node = NULL;
 				int unbalanced = DEFAULT_UNBALANCED;
+	int maintenance = DEFAULT_MAINTENANCE;
+	int nb_bg_threads = DEFAULT_BG_THREADS;
+	int scan = DEFAULT_SCAN;
+	int width = DEFAULT_RANGE_WIDTH;
+	int bulk = DEFAULT_BULK;
+	unsigned long *keys;
+	struct timeval pop_start, pop_end;
+	int linearizable = 0;
 	
 	// By default, do not use mono int
   int mono_int = 0;
@@ -357,7 +404,7 @@ int main(int argc, char **argv)
 
 	while(1) {
 		i = 0;
-		c = getopt_long(argc, argv, "hAmvf:d:i:t:r:S:u:U:", long_options, &i);
+		c = getopt_long(argc, argv, "hAmvLf:d:i:t:r:S:u:U:M:K:s:w:B:", long_options, &i);
 
 		if(c == -1)
 			break;
@@ -390,14 +437,29 @@ int main(int argc, char **argv)
 								 "        Number of threads (default=" XSTR(DEFAULT_NB_THREADS) ")\n"
 								 "  -r, --range <int>\n"
 								 "        Range of integer values inserted in set (default=" XSTR(DEFAULT_RANGE) ")\n"
-								 "  -s, --seed <int>\n"
+								 "  -S, --seed <int>\n"
 								 "        RNG seed (0=time-based, default=" XSTR(DEFAULT_SEED) ")\n"
 								 "  -u, --update-rate <int>\n"
 								 "        Percentage of update transactions (default=" XSTR(DEFAULT_UPDATE) ")\n"
+								 "  -s, --scan-rate <int>\n"
+								 "        Percentage of range scans, at most 100 - update rate (default=" XSTR(DEFAULT_SCAN) ")\n"
+								 "  -w, --range-width <int>\n"
+								 "        Number of consecutive keys of a range scan (default=" XSTR(DEFAULT_RANGE_WIDTH) ")\n"
+								 "  -L, --linearizable\n"
+								 "        Linearizable range scans, updates are counted per stripe of keys\n"
 								 "  -m, --mono-int\n"
                  "        Monotonically increasing integer values, beginning from 0\n"
                  "  -v, --reverse-int\n"
                  "        Reverse integers (i.e. from maximum to zero, monotonically decreasing)\n"
+								 "  -M, --maintenance <int>\n"
+								 "        Background maintenance (default=" XSTR(DEFAULT_MAINTENANCE) ")\n"
+								 "        0 = traverse the list at a fixed interval,\n"
+								 "        1 = adapt the interval and the passes to the backlog\n"
+								 "  -K, --bg-threads <int>\n"
+								 "        Number of maintenance threads, each maintains a key range (default=" XSTR(DEFAULT_BG_THREADS) ")\n"
+								 "  -B, --bulk <int>\n"
+								 "        Bulk load the initial keys, sorted, with a balanced index, using this\n"
+								 "        number of threads (0=insert them one by one, default=" XSTR(DEFAULT_BULK) ")\n"
 					       );
 					exit(0);
 				case 'A':
@@ -409,6 +471,15 @@ int main(int argc, char **argv)
         case 'v':
           reverse_int = 1;
           break;
+				case 'L':
+					linearizable = 1;
+					break;
+				case 's':
+					scan = atoi(optarg);
+					break;
+				case 'w':
+					width = atoi(optarg);
+					break;
 				case 'f':
 					effective = atoi(optarg);
 					break;
@@ -433,6 +504,15 @@ int main(int argc, char **argv)
 				case 'U':
                                         unbalanced = atoi(optarg);
                                         break;
+				case 'M':
+					maintenance = atoi(optarg);
+					break;
+				case 'K':
+					nb_bg_threads = atoi(optarg);
+					break;
+				case 'B':
+					bulk = atoi(optarg);
+					break;
 				case '?':
 					printf("Use -h or --help for help\n");
 					exit(0);
@@ -452,6 +532,9 @@ int main(int argc, char **argv)
 	assert(nb_threads > 0);
 	assert(range > 0 && range >= initial);
 	assert(update >= 0 && update <= 100);
+	assert(nb_bg_threads > 0);
+	assert(scan >= 0 && scan <= 100 - update);
+	assert(width > 0);
 
 	printf("Set type     : skip list\n");
 	printf("Duration     : %d\n", duration);
@@ -465,6 +548,11 @@ int main(int argc, char **argv)
 	printf("Efffective   : %d\n", effective);
 	printf("Mono int     : %d\n", mono_int);
   printf("Reverse int  : %d\n", reverse_int);
+	printf("Maintenance  : %s\n", maintenance ? "adaptive" : "fixed");
+	printf("Bg threads   : %d\n", nb_bg_threads);
+	printf("Scan rate    : %d\n", scan);
+	printf("Range width  : %d\n", width);
+	printf("Linearizable : %d\n", linearizable);
 	printf("Type sizes   : int=%d/long=%d/ptr=%d/word=%d\n",
 				 (int)sizeof(int),
 				 (int)sizeof(long),
@@ -494,6 +582,7 @@ int main(int argc, char **argv)
         ptst_subsystem_init();
         gc_subsystem_init();
         set_subsystem_init();
+        sl_range_linearizable = linearizable;
         set = set_new(1);
 	stop = 0;
 
@@ -514,66 +603,94 @@ int main(int argc, char **argv)
 	TM_STARTUP();
 
 	// Populate set
-	printf("Adding %d entries to set\n", initial);
-	i = 0;
-
-	while (i < initial) {
-    if(mono_int) {
-      val = i;
-    } else if(reverse_int) {
-      val = initial - 1 - i;
-    } else {
-      // Whether the key is unbalanced, if it is then just insert keys
-      // in the given range (i.e. the number of iterations)
-      if(unbalanced) {
-        val = rand_range_re(&global_seed, initial);
-      } else {
-        val = rand_range_re(&global_seed, range);
-      }
+	gettimeofday(&pop_start, NULL);
+	if (bulk > 0 && initial > 0) {
+		printf("Bulk loading %d entries to set\n", initial);
+		if (mono_int || reverse_int) {
+			// the same keys in any order, above the key of the head
+			if ((keys = (unsigned long *)malloc(initial * sizeof(unsigned long))) == NULL) {
+				perror("malloc");
+				exit(1);
+			}
+			for (i = 0; i < initial; i++)
+				keys[i] = i + 1;
+		} else {
+			keys = bulk_keys(initial, unbalanced ? initial : range, &global_seed);
 		}
+		bg_stop();
+		set_bulk_load(set, keys, NULL, initial, bulk);
+		last = keys[initial - 1];
+		free(keys);
+		size = set_size(set, 1);
+		printf("Set size     : %d\n", size);
+	} else {
+		printf("Adding %d entries to set\n", initial);
+		i = 0;
+
+		while (i < initial) {
+	    if(mono_int) {
+	      val = i;
+	    } else if(reverse_int) {
+	      val = initial - 1 - i;
+	    } else {
+	      // Whether the key is unbalanced, if it is then just insert keys
+	      // in the given range (i.e. the number of iterations)
+	      if(unbalanced) {
+	        val = rand_range_re(&global_seed, initial);
+	      } else {
+	        val = rand_range_re(&global_seed, range);
+	      }
+			}
 		
-		if (sl_add_old(set, val, 0)) {
-			last = val;
-			i++;
+			if (sl_add_old(set, val, 0)) {
+				last = val;
+				i++;
+			}
 		}
+		size = set_size(set, 1);
+		printf("Set size     : %d\n", size);
+		printf("Level max    : %d\n", levelmax);
+
+	        // nullify all the index levels
+	        bg_stop();
+	        /*
+	        top = set->head->level-1;
+	        for (i = 0; i <= top; i++) {
+	                node_t *prev = set->head;
+	                node_t *node = prev->succs[IDX(i,sl_zero)];
+	                while (node) {
+	                        prev->succs[IDX(i,sl_zero)] = NULL;
+	                        prev->level = 0;
+	                        prev->raise_or_remove = 0;
+	                        prev = node;
+	                        node = node->succs[IDX(i, sl_zero)];
+	                }
+	        }
+	        */
+	        node = set->head;
+	        while (node) {
+	                int i;
+	                for (i = 0; i < MAX_LEVELS; i++)
+	                        node->succs[i] = NULL;
+	                node->level = 0;
+	                node->raise_or_remove = 0;
+	                node = node->next;
+	        }
+
+	        // wait till the list is balanced
+	        set->head->level = 1;
+	        bg_start(0);
+	        while (set->head->level < floor_log_2(initial)) {
+	            AO_nop_full();
+	        }
+	        bg_stop();
 	}
-	size = set_size(set, 1);
-	printf("Set size     : %d\n", size);
-	printf("Level max    : %d\n", levelmax);
-
-        // nullify all the index levels
-        bg_stop();
-        /*
-        top = set->head->level-1;
-        for (i = 0; i <= top; i++) {
-                node_t *prev = set->head;
-                node_t *node = prev->succs[IDX(i,sl_zero)];
-                while (node) {
-                        prev->succs[IDX(i,sl_zero)] = NULL;
-                        prev->level = 0;
-                        prev->raise_or_remove = 0;
-                        prev = node;
-                        node = node->succs[IDX(i, sl_zero)];
-                }
-        }
-        */
-        node = set->head;
-        while (node) {
-                int i;
-                for (i = 0; i < MAX_LEVELS; i++)
-                        node->succs[i] = NULL;
-                node->level = 0;
-                node->raise_or_remove = 0;
-                node = node->next;
-        }
-
-        // wait till the list is balanced
-        set->head->level = 1;
-        bg_start(0);
-        while (set->head->level < floor_log_2(initial)) {
-            AO_nop_full();
-        }
-        bg_stop();
+	gettimeofday(&pop_end, NULL);
+	printf("Populate time: %d ms\n",
+	       (int)((pop_end.tv_sec * 1000 + pop_end.tv_usec / 1000) -
+	             (pop_start.tv_sec * 1000 + pop_start.tv_usec / 1000)));
+        bg_adaptive = maintenance;
+        bg_threads = nb_bg_threads;
         bg_start(50000);
         printf("Number of levels is %lu\n", set->head->level);
 
@@ -590,6 +707,11 @@ int main(int argc, char **argv)
 		data[i].unit_tx = unit_tx;
 		data[i].alternate = alternate;
 		data[i].effective = effective;
+		data[i].scan = scan;
+		data[i].width = width;
+		data[i].linearizable = linearizable;
+		data[i].nb_scan = 0;
+		memset(&data[i].range_stat, 0, sizeof(sl_range_stat_t));
 		data[i].nb_add = 0;
 		data[i].nb_added = 0;
 		data[i].nb_remove = 0;
@@ -669,6 +791,10 @@ int main(int argc, char **argv)
 	effreads = 0;
 	updates = 0;
 	effupds = 0;
+	scans = 0;
+	scanned = 0;
+	scan_retries = 0;
+	scan_blocked = 0;
 	max_retries = 0;
 	for (i = 0; i < nb_threads; i++) {
                 /*
@@ -705,13 +831,17 @@ int main(int argc, char **argv)
 		(data[i].nb_remove - data[i].nb_removed);
 		updates += (data[i].nb_add + data[i].nb_remove);
 		effupds += data[i].nb_removed + data[i].nb_added;
+		scans += data[i].nb_scan;
+		scanned += data[i].range_stat.keys;
+		scan_retries += data[i].range_stat.retries;
+		scan_blocked += data[i].range_stat.blocked;
 		size += data[i].nb_added - data[i].nb_removed;
 		if (max_retries < data[i].max_retries)
 			max_retries = data[i].max_retries;
 	}
 	printf("Set size      : %d (expected: %d)\n", set_size(set,1), size);
 	printf("Duration      : %d (ms)\n", duration);
-	printf("#txs          : %lu (%f / s)\n", reads + updates, (reads + updates) * 1000.0 / duration);
+	printf("#txs          : %lu (%f / s)\n", reads + updates + scans, (reads + updates + scans) * 1000.0 / duration);
 
 	printf("#read txs     : ");
 	if (effective) {
@@ -728,6 +858,13 @@ int main(int argc, char **argv)
 					 duration);
 	} else printf("%lu (%f / s)\n", updates, updates * 1000.0 / duration);
 
+	printf("#range scans  : %lu (%f / s)\n", scans, scans * 1000.0 / duration);
+	printf("  #keys       : %lu (%f / scan)\n", scanned, scans ? (double) scanned / scans : 0.0);
+	if (linearizable) {
+		printf("  #retries    : %lu (%f / scan)\n", scan_retries, scans ? (double) scan_retries / scans : 0.0);
+		printf("  #blocked    : %lu\n", scan_blocked);
+	}
+
 	printf("#aborts       : %lu (%f / s)\n", aborts, aborts * 1000.0 / duration);
 	printf("  #lock-r     : %lu (%f / s)\n", aborts_locked_read, aborts_locked_read * 1000.0 / duration);
 	printf("  #lock-w     : %lu (%f / s)\n", aborts_locked_write, aborts_locked_write * 1000.0 / duration);
@@ -25,12 +25,9 @@
 
 #define MAXLEVEL    32
 
-int sl_contains(sl_intset_t *set, val_t val, int transactional)
-{
-	int result = 0;
-	
-#ifdef SEQUENTIAL /* Unprotected */
-	
+#ifdef SEQUENTIAL
+
+static int sl_seq_contains(sl_intset_t *set, val_t val) {
 	int i;
 	sl_node_t *node, *next;
 	
@@ -43,7 +40,80 @@ int sl_contains(sl_intset_t *set, val_t val, int transactional)
 		}
 	}
 	node = node->next[0];
-	result = (node->val == val);
+	return (node->val == val);
+}
+
+static int sl_seq_remove(sl_intset_t *set, val_t val) {
+	int i, result;
+	sl_node_t *node, *next = NULL;
+	sl_node_t *preds[MAXLEVEL], *succs[MAXLEVEL];
+	
+	node = set->head;
+	for (i = node->toplevel-1; i >= 0; i--) {
+		next = node->next[i];
+		while (next->val < val) {
+			node = next;
+			next = node->next[i];
+		}
+		preds[i] = node;
+		succs[i] = node->next[i];
+	}
+	if ((result = (next->val == val)) == 1) {
+		for (i = 0; i < set->head->toplevel; i++) 
+			if (succs[i]->val == val)
+				preds[i]->next[i] = succs[i]->next[i];
+#ifndef SEQLOCK /* optimistic readers may still traverse it */
+		sl_delete_node(next); 
+#endif
+	}
+	return result;
+}
+
+#endif /* SEQUENTIAL */
+
+#ifdef COMBINING
+
+int sl_seq_add(sl_intset_t *set, val_t val);
+
+/* Operations run by the combiner */
+static intptr_t sl_comb_contains(void *set, intptr_t val) {
+	return sl_seq_contains((sl_intset_t *) set, (val_t) val);
+}
+
+static intptr_t sl_comb_add(void *set, intptr_t val) {
+	return sl_seq_add((sl_intset_t *) set, (val_t) val);
+}
+
+static intptr_t sl_comb_remove(void *set, intptr_t val) {
+	return sl_seq_remove((sl_intset_t *) set, (val_t) val);
+}
+
+#ifdef NODEREP
+static void *sl_new_replica(void) {
+	return sl_set_new();
+}
+
+nr_t *sl_replicate(sl_intset_t *set, int nb_zones) {
+	nr_init(&coarse_nr, set, sl_new_replica, nb_zones);
+	return &coarse_nr;
+}
+#endif
+
+#endif /* COMBINING */
+
+int sl_contains(sl_intset_t *set, val_t val, int transactional)
+{
+	int result = 0;
+	
+#ifdef SEQUENTIAL /* Unprotected */
+	
+#ifdef COMBINING
+	result = COMBINE_READ(sl_comb_contains, set, val);
+#else
+	COARSE_READ_BEGIN();
+	result = sl_seq_contains(set, val);
+	COARSE_READ_END();
+#endif
 		
 #elif defined STM
 	
@@ -121,13 +191,23 @@ int sl_add(sl_intset_t *set, val_t val, int transactional)
 	
   if (!transactional) {
 		
+#ifdef NODEREP /* populates all the replicas */
+    result = COMBINE(sl_comb_add, set, val);
+#else
     result = sl_seq_add(set, val);
+#endif
 	
   } else {
 
 #ifdef SEQUENTIAL
 		
+#ifdef COMBINING
+	result = COMBINE(sl_comb_add, set, val);
+#else
+	COARSE_WRITE_BEGIN();
 	result = sl_seq_add(set, val);
+	COARSE_WRITE_END();
+#endif
 		
 #elif defined STM
 	
@@ -197,26 +277,13 @@ int sl_remove(sl_intset_t *set, val_t val, int transactional)
 	
 #ifdef SEQUENTIAL
 	
-	int i;
-	sl_node_t *node, *next = NULL;
-	sl_node_t *preds[MAXLEVEL], *succs[MAXLEVEL];
-	
-	node = set->head;
-	for (i = node->toplevel-1; i >= 0; i--) {
-		next = node->next[i];
-		while (next->val < val) {
-			node = next;
-			next = node->next[i];
-		}
-		preds[i] = node;
-		succs[i] = node->next[i];
-	}
-	if ((result = (next->val == val)) == 1) {
-		for (i = 0; i < set->head->toplevel; i++) 
-			if (succs[i]->val == val)
-				preds[i]->next[i] = succs[i]->next[i];
-		sl_delete_node(next); 
-	}
+#ifdef COMBINING
+	result = COMBINE(sl_comb_remove, set, val);
+#else
+	COARSE_WRITE_BEGIN();
+	result = sl_seq_remove(set, val);
+	COARSE_WRITE_END();
+#endif
 
 #elif defined STM
 	
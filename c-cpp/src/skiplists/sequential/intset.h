@@ -26,3 +26,7 @@
 int sl_contains(sl_intset_t *set, val_t val, int transactional);
 int sl_add(sl_intset_t *set, val_t val, int transactional);
 int sl_remove(sl_intset_t *set, val_t val, int transactional);
+#ifdef NODEREP
+/* Replicates the empty set in nb_zones zones */
+nr_t *sl_replicate(sl_intset_t *set, int nb_zones);
+#endif
@@ -47,6 +47,7 @@
 #define DEFAULT_EFFECTIVE               1
 #define DEFAULT_MONITOR                 0
 #define DEFAULT_TEST                    0
+#define DEFAULT_NUMA_ZONES              0
 
 #define XSTR(s)                         STR(s)
 #define STR(s)                          #s
@@ -165,6 +165,10 @@ typedef struct thread_data {
     unsigned long L3_cache_misses;
     unsigned long total_cache_accesses;
     unsigned long total_cache_misses;
+#ifdef NODEREP
+	nr_t *nr;
+	int id;
+#endif
 } thread_data_t;
 
 
@@ -197,6 +201,9 @@ void *test(void *data) {
 	thread_data_t *d = (thread_data_t *)data;
 	/* Create transaction */
 	TM_THREAD_ENTER();
+#ifdef NODEREP
+	nr_thread_zone(d->nr, d->id);
+#endif
 
     /* set up perf events for cache behavior */
     int fds[NUM_EVENTS];
@@ -353,6 +360,9 @@ void* sanity_check(void *data) {
 	unsigned int lsb = d->first;
 	//printf("my lsb is: %d\n", lsb);
 	int key, i;
+#ifdef NODEREP
+	nr_thread_zone(d->nr, d->id);
+#endif
 	sleep(1);
 	/* Wait on barrier */
 	barrier_cross(d->barrier);
@@ -395,10 +405,14 @@ int main(int argc, char **argv)
 		{"elasticity",                required_argument, NULL, 'x'},
         {"cache monitoring", required_argument, NULL, 'm'},
 		{"test mode", required_argument, NULL, 'v'},
+		{"numa-zones",                required_argument, NULL, 'n'},
 		{NULL, 0, NULL, 0}
 	};
 	
 	sl_intset_t *set;
+#ifdef NODEREP
+	nr_t *nr;
+#endif
 	int i, c;
         unsigned long size;
 	val_t last = 0; 
@@ -424,11 +438,12 @@ int main(int argc, char **argv)
 	int effective = DEFAULT_EFFECTIVE;
     int cache_monitoring = DEFAULT_MONITOR;
     int test_mode = DEFAULT_TEST;
+	int numa_zones = DEFAULT_NUMA_ZONES;
 	sigset_t block_set;
 	
 	while(1) {
 		i = 0;
-		c = getopt_long(argc, argv, "hAf:d:i:t:r:S:u:x:m:v:"
+		c = getopt_long(argc, argv, "hAf:d:i:t:r:S:u:x:m:v:n:"
 										, long_options, &i);
 		
 		if(c == -1)
@@ -480,6 +495,9 @@ int main(int argc, char **argv)
                                  "  -v, --test mode (default=0)\n"
 								 "        0 = run benchmark,\n"
                                  "        non-zero = validate correctness, dictates number of validation txs,\n"
+								 "  -n, --numa-zones <int>\n"
+								 "        Zones of the replicas (node replication build only)\n"
+								 "        0 = one per NUMA node, more are emulated (default=" XSTR(DEFAULT_NUMA_ZONES) ")\n"
 								 );
 					exit(0);
 				case 'A':
@@ -515,6 +533,9 @@ int main(int argc, char **argv)
 				case 'v':
 					test_mode = atoi(optarg);
 				break;
+				case 'n':
+					numa_zones = atoi(optarg);
+					break;
 				case '?':
 					printf("Use -h or --help for help\n");
 					exit(0);
@@ -528,6 +549,7 @@ int main(int argc, char **argv)
 	assert(nb_threads > 0);
 	assert(range > 0 && range >= initial);
 	assert(update >= 0 && update <= 100);
+	assert(numa_zones >= 0);
 	
 	printf("Set type     : skip list\n");
 	printf("Duration     : %d\n", duration);
@@ -538,6 +560,9 @@ int main(int argc, char **argv)
 	printf("Update rate  : %d\n", update);
 	printf("Elasticity   : %d\n", unit_tx);
 	printf("Alternate    : %d\n", alternate);
+#ifdef COARSE_NAME
+	printf("Lock type    : %s\n", COARSE_NAME);
+#endif
 	printf("Efffective   : %d\n", effective);
 	printf("Type sizes   : int=%d/long=%d/ptr=%d/word=%d\n",
 				 (int)sizeof(int),
@@ -564,6 +589,11 @@ int main(int argc, char **argv)
 	
 	levelmax = floor_log_2((unsigned int) initial);
 	set = sl_set_new();
+#ifdef NODEREP
+	nr = sl_replicate(set, numa_zones);
+	printf("NUMA zones   : %d (%s)\n", nr->nb_zones, 
+		   nr->emulated ? "emulated" : "topology");
+#endif
 	stop = 0;
 	
 	global_seed = rand();
@@ -627,6 +657,10 @@ int main(int argc, char **argv)
 		data[i].seed = rand();
 		data[i].set = set;
 		data[i].barrier = &barrier;
+#ifdef NODEREP
+		data[i].nr = nr;
+		data[i].id = i;
+#endif
 		data[i].failures_because_contention = 0;
         data[i].cache_monitoring = cache_monitoring;
         data[i].L1_cache_misses = 0;
@@ -766,6 +800,9 @@ int main(int argc, char **argv)
 			if (max_retries < data[i].max_retries)
 				max_retries = data[i].max_retries;
 		}
+#ifdef NODEREP
+		nr_sync(nr);
+#endif
 		printf("Set size      : %lu (expected: %lu)\n", sl_set_size(set), size);
 		printf("Duration      : %d (ms)\n", duration);
 		printf("#txs          : %lu (%f / s)\n", reads + updates, (reads + updates) * 1000.0 / duration);
@@ -808,6 +845,10 @@ int main(int argc, char **argv)
 		}
 	}
 	
+#ifdef COARSE_NAME
+	COARSE_PRINT_STATS();
+#endif
+	
 	// Delete set 
 	sl_set_delete(set);
 	
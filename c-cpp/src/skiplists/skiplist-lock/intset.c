@@ -30,10 +30,35 @@ int sl_contains(sl_intset_t *set, val_t val, int transactional)
 
 int sl_add(sl_intset_t *set, val_t val, int transactional)
 {  
-	return optimistic_insert(set, val);
+	int result;
+
+	if (sl_range_linearizable)
+		optimistic_update_begin(set, val);
+	result = optimistic_insert(set, val);
+	if (sl_range_linearizable)
+		optimistic_update_end(set, val, result);
+	return result;
 }
 
 int sl_remove(sl_intset_t *set, val_t val, int transactional)
 {
-	return optimistic_delete(set, val);
+	int result;
+
+	if (sl_range_linearizable)
+		optimistic_update_begin(set, val);
+	result = optimistic_delete(set, val);
+	if (sl_range_linearizable)
+		optimistic_update_end(set, val, result);
+	return result;
+}
+
+int sl_range(sl_intset_t *set, val_t lo, val_t hi, val_t *keys, int max, int transactional)
+{
+	return optimistic_range(set, lo, hi, keys, max);
+}
+
+int sl_range_snapshot(sl_intset_t *set, val_t lo, val_t hi, val_t *keys, int max, 
+		      int retries, sl_range_stat_t *stat)
+{
+	return optimistic_range_snapshot(set, lo, hi, keys, max, retries, stat);
 }
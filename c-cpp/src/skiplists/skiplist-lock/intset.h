@@ -26,3 +26,6 @@
 int sl_contains(sl_intset_t *set, val_t val, int transactional);
 int sl_add(sl_intset_t *set, val_t val, int transactional);
 int sl_remove(sl_intset_t *set, val_t val, int transactional);
+int sl_range(sl_intset_t *set, val_t lo, val_t hi, val_t *keys, int max, int transactional);
+int sl_range_snapshot(sl_intset_t *set, val_t lo, val_t hi, val_t *keys, int max, 
+		      int retries, sl_range_stat_t *stat);
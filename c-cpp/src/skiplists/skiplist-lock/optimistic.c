@@ -95,6 +95,8 @@ inline void unlock_levels(sl_node_t **nodes, int highestlevel, int j) {
   }
 }
 
+#ifndef VERSIONED
+
 /*
  * Function optimistic_insert stands for the add method of the original paper.
  * Unlocking and freeing the memory are done at the right places.
@@ -244,3 +246,287 @@ int optimistic_delete(sl_intset_t *set, val_t val) {
     }
   }
 }
+
+#else /* VERSIONED */
+
+/*
+ * With the versioned locks, the search records the version of each 
+ * predecessor before reading its next pointer at this level. A writer 
+ * then locks the predecessors at these versions only, so that a 
+ * successful try-lock validates that the next pointer is unchanged and 
+ * that the predecessor is not deleted, without reading the nodes again: 
+ * a node keeps the lock of its deletion, so it cannot be locked at any 
+ * version once marked. The version of a node is incremented by each 
+ * update of its next pointers, the locks of a failed validation are 
+ * released without increment.
+ */
+static val_t optimistic_search_versions(sl_intset_t *set, val_t val, 
+					sl_node_t **preds, sl_node_t **succs,
+					verlock_t *vers) {
+  int found, i;
+  sl_node_t *pred, *curr;
+  verlock_t version;
+	
+  found = -1;
+  pred = set->head;
+	
+  for (i = (pred->toplevel - 1); i >= 0; i--) {
+    version = get_version(&pred->lock);
+    curr = pred->next[i];
+    while (val > curr->val) {
+      pred = curr;
+      version = get_version(&pred->lock);
+      curr = pred->next[i];
+    }
+    preds[i] = pred;
+    succs[i] = curr;
+    vers[i] = version;
+    if (found == -1 && val == curr->val) {
+      found = i;
+    }
+  }
+  return found;
+}
+
+/*
+ * Function unlock_versions unlocks the distinct nodes of the levels up to 
+ * highestlevel, incrementing their versions if they were modified.
+ */
+static void unlock_versions(sl_node_t **nodes, int highestlevel, int modified) {
+  int i;
+  sl_node_t *old = NULL;
+
+  for (i = 0; i <= highestlevel; i++) {
+    if (old != nodes[i]) {
+      if (modified)
+	unlock_and_increment_version(&nodes[i]->lock);
+      else
+	unlock_without_increment_version(&nodes[i]->lock);
+    }
+    old = nodes[i];
+  }
+}
+
+/*
+ * Function lock_versions locks the distinct predecessors of the levels 
+ * below toplevel at their versions. A predecessor of several levels must 
+ * have the same version at all of them. It returns the highest level 
+ * whose predecessor got locked, or -1 if the validation failed, in which 
+ * case the predecessors it locked are already unlocked.
+ */
+static int lock_versions(sl_node_t **preds, verlock_t *vers, int toplevel) {
+  int i, highest_locked = -1;
+
+  for (i = 0; i < toplevel; i++) {
+    if (i > 0 && preds[i] == preds[i-1]) {
+      if (vers[i] != vers[i-1])
+	break;
+    } else if (try_lock_at_version(&preds[i]->lock, vers[i])) {
+      highest_locked = i;
+    } else {
+      break;
+    }
+  }
+  if (i == toplevel)
+    return highest_locked;
+  unlock_versions(preds, highest_locked, 0);
+  return -1;
+}
+
+/*
+ * A failed validation only means that a predecessor was modified since the 
+ * search, so the updates retry after a short bounded backoff instead of 
+ * the sleeps of the blocking version.
+ */
+static void backoff_wait(unsigned int *backoff) {
+  unsigned int i;
+
+  for (i = 0; i < *backoff; i++)
+    VERLOCK_PAUSE();
+  if (*backoff < VERLOCK_BACKOFF_MAX)
+    *backoff *= 2;
+}
+
+int optimistic_insert(sl_intset_t *set, val_t val) {
+  sl_node_t *node_found, *new_node;
+  sl_node_t **preds = pthread_getspecific(preds_key);
+  sl_node_t **succs = pthread_getspecific(succs_key);
+  verlock_t vers[levelmax];
+  int toplevel, highest_locked, i, found;
+  unsigned int backoff;
+
+  toplevel = get_rand_level();
+  backoff = VERLOCK_BACKOFF_MIN;
+	
+  while (1) {
+    found = optimistic_search_versions(set, val, preds, succs, vers);
+    if (found != -1) {
+      node_found = succs[found];
+      if (!node_found->marked) {
+	while (!node_found->fullylinked) {}
+	return 0;
+      }
+      continue;
+    }
+    highest_locked = lock_versions(preds, vers, toplevel);
+    if (highest_locked < 0) {
+      backoff_wait(&backoff);
+      continue;
+    }
+		
+    ptst_t *ptst = ptst_critical_enter();
+    new_node = sl_new_simple_node(val, toplevel, 2, ptst);
+    ptst_critical_exit(ptst);
+    for (i = 0; i < toplevel; i++) {
+      new_node->next[i] = succs[i];
+      preds[i]->next[i] = new_node;
+    }
+		
+    new_node->fullylinked = 1;
+    unlock_versions(preds, highest_locked, 1);
+    return 1;
+  }
+}
+
+int optimistic_delete(sl_intset_t *set, val_t val) {
+  sl_node_t *node_todel = NULL; 
+  sl_node_t **preds = pthread_getspecific(preds_key);
+  sl_node_t **succs = pthread_getspecific(succs_key);
+  verlock_t vers[levelmax], version;
+  int is_marked, toplevel, highest_locked, i, found;	
+  unsigned int backoff;
+
+  is_marked = 0;
+  toplevel = -1;
+  backoff = VERLOCK_BACKOFF_MIN;
+	
+  while (1) {
+    found = optimistic_search_versions(set, val, preds, succs, vers);
+    if (!is_marked && !(found != -1 && ok_to_delete(succs[found], found)))
+      return 0;
+    if (!is_marked) {
+      /* The lock of a marked node is never released */
+      node_todel = succs[found];
+      do {
+	version = get_version(&node_todel->lock);
+	if (node_todel->marked)
+	  return 0;
+      } while (!try_lock_at_version(&node_todel->lock, version));
+      toplevel = node_todel->toplevel;
+      node_todel->marked = 1;
+      is_marked = 1;
+    }
+    /* Physical deletion */
+    for (i = 0; i < toplevel; i++)
+      if (succs[i] != node_todel)
+	break;
+    highest_locked = (i == toplevel) ? lock_versions(preds, vers, toplevel) : -1;
+    if (highest_locked < 0) {
+      backoff_wait(&backoff);
+      continue;
+    }
+
+    for (i = (toplevel-1); i >= 0; i--) 
+      preds[i]->next[i] = node_todel->next[i];
+    unlock_versions(preds, highest_locked, 1);
+    ptst_t *ptst = ptst_critical_enter();
+    sl_delete_node(node_todel, ptst);
+    ptst_critical_exit(ptst);
+    return 1;
+  }
+}
+
+#endif /* VERSIONED */
+
+int sl_range_linearizable = 0;
+
+/*
+ * Function optimistic_update_begin announces an update in the stripe of 
+ * its key, it waits while a range scan blocks the updates.
+ */
+void optimistic_update_begin(sl_intset_t *set, val_t val) {
+  volatile AO_t *word = &set->stripes[val % SL_STRIPES].word;
+
+  while (1) {
+    AO_fetch_and_add_full(word, SL_STRIPE_PENDING);
+    if (!AO_load_full(&set->range_gate))
+      return;
+    AO_fetch_and_add_full(word, (AO_t) -SL_STRIPE_PENDING);
+    while (AO_load_full(&set->range_gate)) {}
+  }
+}
+
+void optimistic_update_end(sl_intset_t *set, val_t val, int modified) {
+  AO_fetch_and_add_full(&set->stripes[val % SL_STRIPES].word, 
+			modified ? SL_STRIPE_VERSION_INC - SL_STRIPE_PENDING : 
+			(AO_t) -SL_STRIPE_PENDING);
+}
+
+/*
+ * Function optimistic_range walks the bottom level from the first node 
+ * whose key is not lower than lo, as the contains does, and reports the 
+ * fully linked and unmarked nodes. A removed node keeps its next pointers 
+ * and its memory is only reclaimed once the scan left its critical 
+ * section, so the walk can go through it.
+ */
+int optimistic_range(sl_intset_t *set, val_t lo, val_t hi, val_t *keys, int max) {
+  sl_node_t *curr;
+  sl_node_t **succs = pthread_getspecific(succs_key);
+  int n = 0;
+
+  ptst_t *ptst = ptst_critical_enter();
+  optimistic_search(set, lo, NULL, succs, 0);
+  curr = succs[0];
+  while (n < max && curr->next[0] != NULL && curr->val <= hi) {
+    if (curr->fullylinked && !curr->marked)
+      keys[n++] = curr->val;
+    curr = curr->next[0];
+  }
+  ptst_critical_exit(ptst);
+  return n;
+}
+
+/*
+ * Function optimistic_range_snapshot only validates the stripes of the 
+ * keys of the range, so that the updates of other keys do not invalidate 
+ * the scan.
+ */
+int optimistic_range_snapshot(sl_intset_t *set, val_t lo, val_t hi, val_t *keys,
+			      int max, int retries, sl_range_stat_t *stat) {
+  AO_t words[SL_STRIPES];
+  int nb, i, n, attempt, valid;
+
+  assert(sl_range_linearizable);
+
+  if (hi < lo)
+    return 0;
+  nb = (hi - lo < SL_STRIPES) ? (int) (hi - lo) + 1 : SL_STRIPES;
+
+  for (attempt = 0; attempt < retries; attempt++) {
+    valid = 1;
+    for (i = 0; i < nb && valid; i++) {
+      words[i] = AO_load_full(&set->stripes[(lo + i) % SL_STRIPES].word);
+      valid = !(words[i] & SL_STRIPE_MASK);
+    }
+    if (valid) {
+      n = optimistic_range(set, lo, hi, keys, max);
+      for (i = 0; i < nb && valid; i++)
+	valid = (AO_load_full(&set->stripes[(lo + i) % SL_STRIPES].word) == words[i]);
+      if (valid) {
+	stat->keys += n;
+	return n;
+      }
+    }
+    stat->retries++;
+  }
+
+  /* Block the updates and wait for those in progress */
+  AO_fetch_and_add1_full(&set->range_gate);
+  for (i = 0; i < nb; i++)
+    while (AO_load_full(&set->stripes[(lo + i) % SL_STRIPES].word) & SL_STRIPE_MASK) {}
+  n = optimistic_range(set, lo, hi, keys, max);
+  AO_fetch_and_sub1_full(&set->range_gate);
+  stat->keys += n;
+  stat->blocked++;
+  return n;
+}
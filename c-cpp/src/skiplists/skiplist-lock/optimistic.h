@@ -29,3 +29,34 @@
 int optimistic_find(sl_intset_t *set, val_t val);
 int optimistic_insert(sl_intset_t *set, val_t val);
 int optimistic_delete(sl_intset_t *set, val_t val);
+
+/*
+ * optimistic_range writes the keys of the set in [lo, hi] to keys, in 
+ * increasing order and at most max of them, and returns their number. 
+ * The scan is weakly consistent: each key present during the whole scan 
+ * is reported and each reported key was present at some point of the 
+ * scan.
+ */
+int optimistic_range(sl_intset_t *set, val_t lo, val_t hi, val_t *keys, int max);
+
+/*
+ * Set sl_range_linearizable before any update to count the updates in the 
+ * stripes of the set, at the cost of two atomic increments per update. 
+ * optimistic_range_snapshot then validates the weakly consistent scan 
+ * against the stripes of its keys: it is linearized before the validation 
+ * if no update of these keys was in progress or completed during the 
+ * scan. After "retries" unsuccessful scans, it prevents new updates from 
+ * starting and waits for the updates in progress to complete.
+ */
+extern int sl_range_linearizable;
+
+typedef struct sl_range_stat {
+	unsigned long keys;     /* keys reported by the scans */
+	unsigned long retries;  /* unsuccessful validations */
+	unsigned long blocked;  /* scans that blocked the updates */
+} sl_range_stat_t;
+
+void optimistic_update_begin(sl_intset_t *set, val_t val);
+void optimistic_update_end(sl_intset_t *set, val_t val, int modified);
+int optimistic_range_snapshot(sl_intset_t *set, val_t lo, val_t hi, val_t *keys,
+			      int max, int retries, sl_range_stat_t *stat);
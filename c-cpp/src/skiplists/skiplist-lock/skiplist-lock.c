@@ -21,6 +21,8 @@
  * GNU General Public License for more details.
  */
 
+#include <string.h>
+
 #include "skiplist-lock.h"
 
 extern unsigned int levelmax;
@@ -119,6 +121,8 @@ sl_intset_t *sl_set_new(ptst_t *ptst)
 	sl_node_t *min, *max;
 	
 	set = (sl_intset_t *)xmalloc(sizeof(sl_intset_t));
+	memset(set->stripes, 0, sizeof(set->stripes));
+	set->range_gate = 0;
 	max = sl_new_node(VAL_MAX, NULL, levelmax, 0, ptst);
 	min = sl_new_node(VAL_MIN, max, levelmax, 0, ptst);
 	max->fullylinked = 1;
@@ -142,7 +146,7 @@ void sl_set_delete(sl_intset_t *set, ptst_t *ptst)
 
 int sl_set_size(sl_intset_t *set)
 {
-	int size = -1;
+	int size = 0;
 	sl_node_t *node;
 	
 	/* We have at least 2 elements */
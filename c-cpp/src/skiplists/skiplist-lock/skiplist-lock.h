@@ -66,7 +66,16 @@ typedef unsigned long val_t;
 #define VAL_MIN                         (0UL)
 #define VAL_MAX                         (~0UL) /* Key value of last dummy node.  */
 
-#ifdef MUTEX
+#if defined LOCKLIB
+#include "../../utils/locks/locks.h"
+#elif defined VERSIONED
+#include "../../utils/versioned-lock/versioned-lock.h"
+typedef versioned_lock_t ptlock_t;
+#  define INIT_LOCK(lock)		VERLOCK_INIT(lock);
+#  define DESTROY_LOCK(lock)
+#  define LOCK(lock)			(spinlock(lock), 0)
+#  define UNLOCK(lock)			(unlock_and_increment_version(lock), 0)
+#elif defined MUTEX
 typedef pthread_mutex_t ptlock_t;
 #  define INIT_LOCK(lock)		pthread_mutex_init(lock, NULL);
 #  define DESTROY_LOCK(lock)		pthread_mutex_destroy(lock)
@@ -89,8 +98,26 @@ typedef struct sl_node {
 	struct sl_node* next[1];
 } sl_node_t;
 
+/*
+ * The updates are counted in padded stripes of keys when the linearizable
+ * range scans are enabled: the word of a stripe counts the updates in
+ * progress (bits 0-15) and the updates that modified the set (bits 16 and
+ * up).
+ */
+#define SL_STRIPES                      64
+#define SL_STRIPE_PENDING               1UL
+#define SL_STRIPE_VERSION_INC           (1UL << 16)
+#define SL_STRIPE_MASK                  (SL_STRIPE_VERSION_INC - 1)
+
+typedef struct sl_stripe {
+	volatile AO_t word;
+	char pad[CACHE_LINE_SIZE - sizeof(AO_t)];
+} sl_stripe_t;
+
 typedef struct sl_intset {
 	sl_node_t *head;
+	sl_stripe_t stripes[SL_STRIPES];
+	volatile AO_t range_gate;
 } sl_intset_t;
 
 inline void *xmalloc(size_t size);
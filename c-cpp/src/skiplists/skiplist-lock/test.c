@@ -25,6 +25,7 @@
 #include <perfmon/pfmlib.h>
 #include <perfmon/pfmlib_perf_event.h>
 #include <string.h>
+#include <sys/ioctl.h>
 
 pthread_key_t preds_key;
 pthread_key_t succs_key;
@@ -50,6 +51,9 @@ unsigned int levelmax;
 #define DEFAULT_MONITOR                 0
 #define DEFAULT_TEST                    0
 #define DEFAULT_PARALLELISM             1
+#define DEFAULT_SCAN                    0
+#define DEFAULT_RANGE_WIDTH             100
+#define DEFAULT_RANGE_RETRIES           16
 #define NUM_EVENTS                      9
 
 const char *events[NUM_EVENTS] = {
@@ -154,6 +158,9 @@ typedef struct thread_data {
   int unit_tx;
   int alternate;
   int effective;
+  int scan;
+  int width;
+  int linearizable;
   int cache_monitoring;
   int validation_txs;
   unsigned long nb_add;
@@ -162,6 +169,8 @@ typedef struct thread_data {
   unsigned long nb_removed;
   unsigned long nb_contains;
   unsigned long nb_found;
+  unsigned long nb_scan;
+  sl_range_stat_t range_stat;
   unsigned long nb_aborts;
   unsigned long nb_aborts_locked_read;
   unsigned long nb_aborts_locked_write;
@@ -215,13 +224,15 @@ void *test(void *data) {
   int last = -1;
   val_t val = 0;
   int unext;
-  int i;
+  int i, n;
+  val_t *keys;
   sl_node_t **preds = (sl_node_t **)xmalloc(levelmax * sizeof(sl_node_t *));
   sl_node_t **succs = (sl_node_t **)xmalloc(levelmax * sizeof(sl_node_t *));
   pthread_setspecific(preds_key, preds);
   pthread_setspecific(succs_key, succs);
 	
   thread_data_t *d = (thread_data_t *)data;
+  keys = (val_t *)xmalloc(d->width * sizeof(val_t));
 	
 
 	/* set up perf events for cache behavior */
@@ -311,6 +322,17 @@ void *test(void *data) {
         d->nb_remove++;
       } 
       
+    } else if (d->scan && rand_range_re(&d->seed, 100 - d->update) <= d->scan) { // range scan
+      
+      val = rand_range_re(&d->seed, d->range);
+      if (d->linearizable)
+        n = sl_range_snapshot(d->set, val, val + d->width - 1, keys, d->width,
+                              DEFAULT_RANGE_RETRIES, &d->range_stat);
+      else
+        n = sl_range(d->set, val, val + d->width - 1, keys, d->width, TRANSACTIONAL);
+      d->range_stat.keys += d->linearizable ? 0 : n;
+      d->nb_scan++;
+      
     } else { // read
       
       
@@ -347,7 +369,7 @@ void *test(void *data) {
     /* Is the next op an update? */
     if (d->effective) { // a failed remove/add is a read-only tx
       unext = ((100 * (d->nb_added + d->nb_removed))
-        < (d->update * (d->nb_add + d->nb_remove + d->nb_contains)));
+        < (d->update * (d->nb_add + d->nb_remove + d->nb_contains + d->nb_scan)));
     } else { // remove/add (even failed) is considered as an update
       unext = ((rand_range_re(&d->seed, 100) - 1) < d->update);
     }
@@ -371,6 +393,7 @@ void *test(void *data) {
     for (i = 0; i < NUM_EVENTS; i++) close(fds[i]);
   }
 	
+  free(keys);
   free(pthread_getspecific(preds_key));
   free(pthread_getspecific(succs_key));
   return NULL;
@@ -452,6 +475,9 @@ int main(int argc, char **argv)
     {"cache monitoring", 		      required_argument, NULL, 'm'},
     {"test mode",                 required_argument, NULL, 'v'},
     {"population parallelism",    required_argument, NULL, 'p'},
+    {"scan-rate",                 required_argument, NULL, 's'},
+    {"range-width",               required_argument, NULL, 'w'},
+    {"linearizable",              no_argument,       NULL, 'L'},
     {NULL, 0, NULL, 0}
   };
   
@@ -459,7 +485,8 @@ int main(int argc, char **argv)
   int i, c, size;
   val_t last = 0; 
   val_t val = 0;
-  unsigned long reads, effreads, updates, effupds, aborts, aborts_locked_read, 
+  unsigned long reads, effreads, updates, effupds, scans, scanned, scan_retries, 
+    scan_blocked, aborts, aborts_locked_read, 
     aborts_locked_write, aborts_validate_read, aborts_validate_write, 
     aborts_validate_commit, aborts_invalid_memory, max_retries,
     L1_cache_accesses, L1_cache_misses, L3_cache_accesses, L3_cache_misses, total_cache_accesses, total_cache_misses;
@@ -482,12 +509,15 @@ int main(int argc, char **argv)
   int cache_monitoring = DEFAULT_MONITOR;
   int test_mode = DEFAULT_TEST;
   int pop_par = DEFAULT_PARALLELISM;
+  int scan = DEFAULT_SCAN;
+  int width = DEFAULT_RANGE_WIDTH;
+  int linearizable = 0;
   sigset_t block_set;
   struct sl_ptst *ptst;
   
   while(1) {
     i = 0;
-    c = getopt_long(argc, argv, "hAf:d:i:t:r:S:u:x:m:v:p:"
+    c = getopt_long(argc, argv, "hALf:d:i:t:r:S:u:x:m:v:p:s:w:"
         , long_options, &i);
     
     if(c == -1)
@@ -526,6 +556,12 @@ int main(int argc, char **argv)
                 "        RNG seed (0=time-based, default=" XSTR(DEFAULT_SEED) ")\n"
                 "  -u, --update-rate <int>\n"
                 "        Percentage of update transactions (default=" XSTR(DEFAULT_UPDATE) ")\n"
+                "  -s, --scan-rate <int>\n"
+                "        Percentage of range scans, at most 100 - update rate (default=" XSTR(DEFAULT_SCAN) ")\n"
+                "  -w, --range-width <int>\n"
+                "        Number of consecutive keys of a range scan (default=" XSTR(DEFAULT_RANGE_WIDTH) ")\n"
+                "  -L, --linearizable\n"
+                "        Linearizable range scans, updates are counted per stripe of keys\n"
                 "  -x, --unit-tx (default=1)\n"
                 "        Use unit transactions\n"
                 "        0 = non-protected,\n"
@@ -581,6 +617,15 @@ int main(int argc, char **argv)
       case 'p':
         pop_par = atoi(optarg);
         break;
+      case 's':
+        scan = atoi(optarg);
+        break;
+      case 'w':
+        width = atoi(optarg);
+        break;
+      case 'L':
+        linearizable = 1;
+        break;
       case '?':
         printf("Use -h or --help for help\n");
         exit(0);
@@ -594,8 +639,19 @@ int main(int argc, char **argv)
   assert(nb_threads > 0);
   assert(range > 0 && range >= initial);
   assert(update >= 0 && update <= 100);
+  assert(scan >= 0 && scan <= 100 - update);
+  assert(width > 0);
   
   printf("Set type     : skip list\n");
+#if defined LOCKLIB
+  printf("Lock type    : %s\n", LOCK_NAME);
+#elif defined VERSIONED
+  printf("Lock type    : %s\n", VERLOCK_NAME);
+#elif defined MUTEX
+  printf("Lock type    : mutex\n");
+#else
+  printf("Lock type    : spinlock\n");
+#endif
   printf("Duration     : %d\n", duration);
   printf("Initial size : %d\n", initial);
   printf("Nb threads   : %d\n", nb_threads);
@@ -605,11 +661,18 @@ int main(int argc, char **argv)
   printf("Lock alg.    : %d\n", unit_tx);
   printf("Alternate    : %d\n", alternate);
   printf("Effective    : %d\n", effective);
+  printf("Scan rate    : %d\n", scan);
+  printf("Range width  : %d\n", width);
+  printf("Linearizable : %d\n", linearizable);
   printf("Type sizes   : int=%d/long=%d/ptr=%d/word=%d\n",
     (int)sizeof(int),
     (int)sizeof(long),
     (int)sizeof(void *),
     (int)sizeof(uintptr_t));
+  printf("Node size    : %d + %d per level (lock=%d)\n",
+    (int)(sizeof(sl_node_t) - sizeof(sl_node_t *)),
+    (int)sizeof(sl_node_t *),
+    (int)sizeof(ptlock_t));
   
   timeout.tv_sec = duration / 1000;
   timeout.tv_nsec = (duration % 1000) * 1000000;
@@ -628,6 +691,7 @@ int main(int argc, char **argv)
   ptst_subsystem_init();
   gc_subsystem_init();
   set_subsystem_init();
+  sl_range_linearizable = linearizable;
 
 
   ptst = ptst_critical_enter();
@@ -696,8 +760,8 @@ int main(int argc, char **argv)
       }
     }
   }
-  // size = sl_set_size(set);
-  // printf("Set size     : %d\n", size);
+  size = sl_set_size(set);
+  printf("Set size     : %d\n", size);
   printf("Level max    : %d\n", levelmax);
 
   
@@ -716,6 +780,11 @@ int main(int argc, char **argv)
     data[i].unit_tx = unit_tx;
     data[i].alternate = alternate;
     data[i].effective = effective;
+    data[i].scan = scan;
+    data[i].width = width;
+    data[i].linearizable = linearizable;
+    data[i].nb_scan = 0;
+    memset(&data[i].range_stat, 0, sizeof(sl_range_stat_t));
     data[i].nb_add = 0;
     data[i].nb_added = 0;
     data[i].nb_remove = 0;
@@ -817,6 +886,10 @@ exit(1);
       effreads = 0;
       updates = 0;
       effupds = 0;
+      scans = 0;
+      scanned = 0;
+      scan_retries = 0;
+      scan_blocked = 0;
       max_retries = 0;
       L1_cache_misses = 0; 
       L1_cache_accesses = 0;
@@ -860,6 +933,10 @@ exit(1);
                       (data[i].nb_remove - data[i].nb_removed);
           updates += (data[i].nb_add + data[i].nb_remove);
           effupds += data[i].nb_removed + data[i].nb_added;
+          scans += data[i].nb_scan;
+          scanned += data[i].range_stat.keys;
+          scan_retries += data[i].range_stat.retries;
+          scan_blocked += data[i].range_stat.blocked;
           size += data[i].nb_added - data[i].nb_removed;
           L1_cache_misses += data[i].L1_cache_misses;
           L1_cache_accesses += data[i].L1_cache_accesses;
@@ -870,10 +947,10 @@ exit(1);
           if (max_retries < data[i].max_retries)
               max_retries = data[i].max_retries;
       }
-      //printf("Set size      : %d (expected: %d)\n", sl_set_size(set), size);
+      printf("Set size      : %d (expected: %d)\n", sl_set_size(set), size);
       printf("Duration      : %d (ms)\n", duration);
-      printf("#txs          : %lu (%f / s)\n", reads + updates,
-              (reads + updates) * 1000.0 / duration);
+      printf("#txs          : %lu (%f / s)\n", reads + updates + scans,
+              (reads + updates + scans) * 1000.0 / duration);
 
       printf("#read txs     : ");
       if (effective) {
@@ -891,6 +968,15 @@ exit(1);
                                                             duration);
       } else printf("%lu (%f / s)\n", updates, updates * 1000.0 / duration);
 
+      printf("#range scans  : %lu (%f / s)\n", scans, scans * 1000.0 / duration);
+      printf("  #keys       : %lu (%f / scan)\n", scanned,
+              scans ? (double) scanned / scans : 0.0);
+      if (linearizable) {
+          printf("  #retries    : %lu (%f / scan)\n", scan_retries,
+                  scans ? (double) scan_retries / scans : 0.0);
+          printf("  #blocked    : %lu\n", scan_blocked);
+      }
+
       printf("#aborts       : %lu (%f / s)\n", aborts, aborts * 1000.0 /
                                                         duration);
       printf("  #lock-r     : %lu (%f / s)\n", aborts_locked_read,
@@ -906,6 +992,9 @@ exit(1);
       printf("  #inv-mem    : %lu (%f / s)\n", aborts_invalid_memory,
               aborts_invalid_memory * 1000.0 / duration);
       printf("Max retries   : %lu\n", max_retries);
+#ifdef LOCKLIB
+      lock_print_stats();
+#endif
       if (cache_monitoring) {
         printf("#L1 cache misses    : %lu\n", L1_cache_misses);
         printf("#L1 cache accesses  : %lu\n", L1_cache_accesses);
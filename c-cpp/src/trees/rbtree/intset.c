@@ -31,6 +31,37 @@ static long compare(const void *a, const void *b)
   return ((val_t)a - (val_t)b);
 }
 
+#ifdef COMBINING
+/* Operations run by the combiner */
+static intptr_t rbtree_comb_contains(void *set, intptr_t val)
+{
+  return rbtree_contains((rbtree_t *)set, (void *)val);
+}
+
+static intptr_t rbtree_comb_insert(void *set, intptr_t val)
+{
+  return rbtree_insert((rbtree_t *)set, (void *)val, (void *)val);
+}
+
+static intptr_t rbtree_comb_delete(void *set, intptr_t val)
+{
+  return rbtree_delete((rbtree_t *)set, (void *)val);
+}
+
+#ifdef NODEREP
+static void *rbtree_new_replica(void)
+{
+  return rbtree_alloc(&compare);
+}
+
+nr_t *set_replicate(intset_t *set, int nb_zones)
+{
+  nr_init(&coarse_nr, set, rbtree_new_replica, nb_zones);
+  return &coarse_nr;
+}
+#endif
+#endif /* COMBINING */
+
 intset_t *set_new()
 {
   return rbtree_alloc(&compare);
@@ -65,6 +96,12 @@ int set_contains(intset_t *set, val_t val, int transactional)
 
 	v = (void *)val;
 	
+#ifdef COMBINING
+	result = COMBINE_READ(rbtree_comb_contains, set, val);
+#else
+#ifdef SEQUENTIAL
+	COARSE_READ_BEGIN();
+#endif
 	switch(transactional) {
 		case 0:	
 			result = rbtree_contains(set, v);
@@ -89,6 +126,10 @@ int set_contains(intset_t *set, val_t val, int transactional)
 			printf("number %d do not correspond to elasticity.\n", transactional);
 			exit(1);
 	}
+#ifdef SEQUENTIAL
+	COARSE_READ_END();
+#endif
+#endif /* COMBINING */
 	return result;
 }
 
@@ -101,6 +142,12 @@ int set_add(intset_t *set, val_t val, int transactional)
 {
   int result = 0;
 
+#ifdef COMBINING
+  result = COMBINE(rbtree_comb_insert, set, val);
+#else
+#ifdef SEQUENTIAL
+  COARSE_WRITE_BEGIN();
+#endif
   switch(transactional) {
 	  case 0:
 		  result = rbtree_insert(set, (void *)val, (void *)val);
@@ -124,6 +171,10 @@ int set_add(intset_t *set, val_t val, int transactional)
 		  printf("number %d do not correspond to elasticity.\n", transactional);
 		  exit(1);
   }
+#ifdef SEQUENTIAL
+  COARSE_WRITE_END();
+#endif
+#endif /* COMBINING */
 
   return result;
 }
@@ -137,6 +188,12 @@ int set_remove(intset_t *set, val_t val, int transactional)
 	next = NULL;
 	v = (void *) val;
 
+#ifdef COMBINING
+	result = COMBINE(rbtree_comb_delete, set, val);
+#else
+#ifdef SEQUENTIAL
+	COARSE_WRITE_BEGIN();
+#endif
 	switch(transactional) {
 		case 0: /* Unprotected */
 			result = rbtree_delete(set, (void *)val);
@@ -161,5 +218,9 @@ int set_remove(intset_t *set, val_t val, int transactional)
 			printf("number %d do not correspond to elasticity.\n", transactional);
 			exit(1);
 	}
+#ifdef SEQUENTIAL
+	COARSE_WRITE_END();
+#endif
+#endif /* COMBINING */
 	return result;
 }
@@ -38,3 +38,7 @@ int set_contains(intset_t *set, val_t val, int transactional);
  */ 
 int set_add(intset_t *set, val_t val, int transactional);
 int set_remove(intset_t *set, val_t val, int transactional);
+#ifdef NODEREP
+/* Replicates the empty set in nb_zones zones */
+nr_t *set_replicate(intset_t *set, int nb_zones);
+#endif
@@ -1406,9 +1406,11 @@ rbtree_delete (rbtree_t* r, void* key)
     if (node != NULL) {
         node = DELETE(r, node);
     }
+#ifndef SEQLOCK /* optimistic readers may still traverse it */
     if (node != NULL) {
         releaseNode(node);
     }
+#endif
     return ((node != NULL) ? TRUE : FALSE);
 }
 
@@ -1426,9 +1428,11 @@ TMrbtree_delete (TM_ARGDECL  rbtree_t* r, void* key)
     if (node != NULL) {
         node = TX_DELETE(r, node);
     }
+#ifndef SEQLOCK /* optimistic readers may still traverse it */
     if (node != NULL) {
         TMreleaseNode(TM_ARG  node);
     }
+#endif
     return ((node != NULL) ? TRUE : FALSE);
 }
 
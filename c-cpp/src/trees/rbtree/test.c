@@ -126,6 +126,10 @@ typedef struct thread_data {
 	unsigned int seed;
 	intset_t *set;
 	barrier_t *barrier;
+#ifdef NODEREP
+	nr_t *nr;
+	int id;
+#endif
 } thread_data_t;
 
 
@@ -137,6 +141,9 @@ void *test(void *data) {
 
 	/* Create transaction */
 	TM_THREAD_ENTER();
+#ifdef NODEREP
+	nr_thread_zone(d->nr, d->id);
+#endif
 
 	/* Wait on barrier */
 	barrier_cross(d->barrier);
@@ -241,10 +248,14 @@ int main(int argc, char **argv)
 			{"seed",                      required_argument, NULL, 'S'},
 			{"update-rate",               required_argument, NULL, 'u'},
 			{"unit-tx",                   no_argument,       NULL, 'x'},
+			{"numa-zones",                required_argument, NULL, 'n'},
 			{NULL, 0, NULL, 0}
 		};
 		
 		intset_t *set;
+#ifdef NODEREP
+		nr_t *nr;
+#endif
 		int i, c, size;
 		val_t val = 0;
 		val_t last = 0;
@@ -267,11 +278,12 @@ int main(int argc, char **argv)
 		int unit_tx = DEFAULT_ELASTICITY;
 		int alternate = DEFAULT_ALTERNATE;
 		int effective = DEFAULT_EFFECTIVE;
+		int numa_zones = DEFAULT_NUMA_ZONES;
 		sigset_t block_set;
 		
 		while(1) {
 			i = 0;
-			c = getopt_long(argc, argv, "hAf:d:i:t:r:S:u:x:", long_options, &i);
+			c = getopt_long(argc, argv, "hAf:d:i:t:r:S:u:x:n:", long_options, &i);
 			
 			if(c == -1)
 				break;
@@ -316,6 +328,9 @@ int main(int argc, char **argv)
 						   "        2 = read elastic-tx,\n"
 						   "        3 = read/add elastic-tx,\n"
 						   "        4 = read/add/rem elastic-tx,\n"
+						   "  -n, --numa-zones <int>\n"
+						   "        Zones of the replicas (node replication build only)\n"
+						   "        0 = one per NUMA node, more are emulated (default=" XSTR(DEFAULT_NUMA_ZONES) ")\n"
 						   );
 					exit(0);
 				case 'A':
@@ -345,6 +360,9 @@ int main(int argc, char **argv)
 				case 'x':
 					unit_tx = atoi(optarg);
 					break;
+				case 'n':
+					numa_zones = atoi(optarg);
+					break;
 				case '?':
 					printf("Use -h or --help for help\n");
 					exit(0);
@@ -371,6 +389,9 @@ int main(int argc, char **argv)
 		printf("Update rate  : %d\n", update);
 		printf("Elasticity   : %d\n", unit_tx);
 		printf("Alternate    : %d\n", alternate);
+#ifdef COARSE_NAME
+		printf("Lock type    : %s\n", COARSE_NAME);
+#endif
 		printf("Type sizes   : int=%d/long=%d/ptr=%d/word=%d\n",
 			   (int)sizeof(int),
 			   (int)sizeof(long),
@@ -395,6 +416,11 @@ int main(int argc, char **argv)
 			srand(seed);
 		
 		set = set_new(INIT_SET_PARAMETERS);
+#ifdef NODEREP
+		nr = set_replicate(set, numa_zones);
+		printf("NUMA zones   : %d (%s)\n", nr->nb_zones, 
+			   nr->emulated ? "emulated" : "topology");
+#endif
 		stop = 0;
 		
 		/* Init STM */
@@ -449,6 +475,10 @@ int main(int argc, char **argv)
 			data[i].seed = rand();
 			data[i].set = set;
 			data[i].barrier = &barrier;
+#ifdef NODEREP
+			data[i].nr = nr;
+			data[i].id = i;
+#endif
 			if (pthread_create(&threads[i], &attr, test, (void *)(&data[i])) != 0) {
 				fprintf(stderr, "Error creating thread\n");
 				exit(1);
@@ -554,6 +584,9 @@ int main(int argc, char **argv)
 			if (max_retries < data[i].max_retries)
 				max_retries = data[i].max_retries;
 		}
+#ifdef NODEREP
+		nr_sync(nr);
+#endif
 		printf("Set size      : %d (expected: %d)\n", set_size(set), size);
 		printf("Duration      : %d (ms)\n", duration);
 		printf("#txs          : %lu (%f / s)\n", reads + updates, (reads + updates) * 1000.0 / duration);
@@ -590,6 +623,10 @@ int main(int argc, char **argv)
 		rbtree_verify(set, 1);
 #endif /* ! DEBUG */
 
+#ifdef COARSE_NAME
+		COARSE_PRINT_STATS();
+#endif
+		
 		/* Delete set */
 		set_delete(set);
 		
@@ -47,9 +47,13 @@ node newNode(int key){
     new->child[1]=NULL;
     new->tag[0]=0;
     new->tag[1]=0;
+#ifdef LOCKLIB
+    INIT_LOCK(&(new->lock));
+#else
     if (pthread_mutex_init(&(new->lock), NULL) != 0){
         printf("\n mutex init failed\n");
     }
+#endif
     return new;
 }
 
@@ -112,15 +116,15 @@ bool insert(node root, int key, int value){
         tag = prev->tag[direction];
 		urcu_read_unlock();
         if (curr!=NULL) return false;
-        pthread_mutex_lock(&(prev->lock));
+        CITRUS_LOCK(&(prev->lock));
         if( validate(prev,tag,curr,direction) ){
             node new = newNode(key); 
 			prev->child[direction]=new;
 
-            pthread_mutex_unlock(&(prev->lock));
+            CITRUS_UNLOCK(&(prev->lock));
             return true;
         }
-        pthread_mutex_unlock(&(prev->lock));
+        CITRUS_UNLOCK(&(prev->lock));
     }
 }
 
@@ -150,11 +154,11 @@ bool delete(node root, int key){
             return false;
         }         
 		urcu_read_unlock();
-        pthread_mutex_lock(&(prev->lock));
-        pthread_mutex_lock(&(curr->lock));
+        CITRUS_LOCK(&(prev->lock));
+        CITRUS_LOCK(&(curr->lock));
         if( !validate(prev,0,curr,direction) ){
-            pthread_mutex_unlock(&(prev->lock));
-            pthread_mutex_unlock(&(curr->lock));
+            CITRUS_UNLOCK(&(prev->lock));
+            CITRUS_UNLOCK(&(curr->lock));
             continue;
         }
         if (curr->child[0] == NULL) {
@@ -163,8 +167,8 @@ bool delete(node root, int key){
             if(prev->child[direction] == NULL){
                 prev->tag[direction]++;
             }
-            pthread_mutex_unlock(&(prev->lock));
-            pthread_mutex_unlock(&(curr->lock));
+            CITRUS_UNLOCK(&(prev->lock));
+            CITRUS_UNLOCK(&(curr->lock));
             return true;
         }
         if (curr->child[1] == NULL){
@@ -173,8 +177,8 @@ bool delete(node root, int key){
             if(prev->child[direction] == NULL){
                 prev->tag[direction]++;
             }
-            pthread_mutex_unlock(&(prev->lock));
-            pthread_mutex_unlock(&(curr->lock));
+            CITRUS_UNLOCK(&(prev->lock));
+            CITRUS_UNLOCK(&(curr->lock));
             return true;
         }
 		node prevSucc = curr;
@@ -188,16 +192,16 @@ bool delete(node root, int key){
             }		
         int succDirection = 1; 
         if (prevSucc != curr){
-            pthread_mutex_lock(&(prevSucc->lock));
+            CITRUS_LOCK(&(prevSucc->lock));
             succDirection = 0;
         } 		
-        pthread_mutex_lock(&(succ->lock));
+        CITRUS_LOCK(&(succ->lock));
         if (validate(prevSucc,0,succ, succDirection) && validate(succ,succ->tag[0],NULL, 0)){
             curr->marked=true;
             node new = newNode(succ->key);
             new->child[0]=curr->child[0];
             new->child[1]=curr->child[1];
-            pthread_mutex_lock(&(new->lock)); 
+            CITRUS_LOCK(&(new->lock)); 
             prev->child[direction]=new;  
             urcu_synchronize();
             if(prev->child[direction] == NULL){
@@ -216,19 +220,19 @@ bool delete(node root, int key){
                     prevSucc->tag[1]++;
                 }
             }
-			pthread_mutex_unlock(&(prev->lock));
-            pthread_mutex_unlock(&(new->lock));            
-			pthread_mutex_unlock(&(curr->lock));  	
+			CITRUS_UNLOCK(&(prev->lock));
+            CITRUS_UNLOCK(&(new->lock));            
+			CITRUS_UNLOCK(&(curr->lock));  	
             if (prevSucc != curr)
-                pthread_mutex_unlock(&(prevSucc->lock));	
-            pthread_mutex_unlock(&(succ->lock));
+                CITRUS_UNLOCK(&(prevSucc->lock));	
+            CITRUS_UNLOCK(&(succ->lock));
             return true; 
         }
-        pthread_mutex_unlock(&(prev->lock));
-        pthread_mutex_unlock(&(curr->lock));
+        CITRUS_UNLOCK(&(prev->lock));
+        CITRUS_UNLOCK(&(curr->lock));
         if (prevSucc != curr)
-            pthread_mutex_unlock(&(prevSucc->lock));				
-        pthread_mutex_unlock(&(succ->lock));
+            CITRUS_UNLOCK(&(prevSucc->lock));				
+        CITRUS_UNLOCK(&(succ->lock));
     }
 }
 
@@ -26,11 +26,24 @@
 
 #define infinity 2147483647 
 
+/* Node locks: pthread mutexes unless a lock of src/utils/locks is selected */
+#ifdef LOCKLIB
+#include "../../utils/locks/locks.h"
+typedef ptlock_t citrus_lock_t;
+#  define CITRUS_LOCK(lock)             LOCK(lock)
+#  define CITRUS_UNLOCK(lock)           UNLOCK(lock)
+#else
+#include <pthread.h>
+typedef pthread_mutex_t citrus_lock_t;
+#  define CITRUS_LOCK(lock)             pthread_mutex_lock(lock)
+#  define CITRUS_UNLOCK(lock)           pthread_mutex_unlock(lock)
+#endif
+
 
 typedef struct node_t {
   int key;
   struct node_t* child[2];
-  pthread_mutex_t lock;
+  citrus_lock_t lock;
   bool marked;
   int tag[2];
   int value;
@@ -89,7 +89,9 @@ typedef intptr_t val_t;
 #define VAL_MIN                         INT_MIN
 #define VAL_MAX                         INT_MAX
 
-#ifdef MUTEX
+#if defined LOCKLIB
+/* see citrus.h */
+#elif defined MUTEX
 typedef pthread_mutex_t ptlock_t;
 #  define INIT_LOCK(lock)               pthread_mutex_init(lock, NULL);
 #  define DESTROY_LOCK(lock)            pthread_mutex_destroy(lock)
@@ -502,6 +504,9 @@ void *test2(void *data)
     assert(update >= 0 && update <= 100);
 		
     printf("Set type     : skip list\n");
+#ifdef LOCKLIB
+    printf("Lock type    : %s\n", LOCK_NAME);
+#endif
     printf("Duration     : %d\n", duration);
     printf("Initial size : %d\n", initial);
     printf("Nb threads   : %d\n", nb_threads);
@@ -711,6 +716,9 @@ void *test2(void *data)
     printf("  #inv-mem    : %lu (%f / s)\n", aborts_invalid_memory, 
 	   aborts_invalid_memory * 1000.0 / duration);
     printf("Max retries   : %lu\n", max_retries);
+#ifdef LOCKLIB
+    lock_print_stats();
+#endif
 		
     /* Delete set */
     //sl_set_delete(set);
@@ -0,0 +1,205 @@
+/*
+ * File:
+ *   combining.c
+ * Description:
+ *   Flat combining and CC-Synch (see combining.h).
+ *
+ * combining.c is part of Synchrobench
+ *
+ * Synchrobench is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, version 2
+ * of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "combining.h"
+#include "locks.h"
+
+static volatile AO_t comb_total_ops = 0;
+static volatile AO_t comb_total_batches = 0;
+
+/* Called by the combiner at the end of a batch */
+static inline void comb_add_batch(unsigned long ops) {
+	AO_fetch_and_add_full(&comb_total_ops, ops);
+	AO_fetch_and_add_full(&comb_total_batches, 1);
+}
+
+void comb_get_stats(comb_stats_t *stats) {
+	stats->ops = AO_load_full(&comb_total_ops);
+	stats->batches = AO_load_full(&comb_total_batches);
+}
+
+void comb_print_stats(void) {
+	comb_stats_t stats;
+
+	comb_get_stats(&stats);
+	printf("#combined ops : %lu\n", stats.ops);
+	printf("  #batches    : %lu (%f ops / batch)\n", stats.batches,
+		   stats.batches ? (double) stats.ops / stats.batches : 0.0);
+}
+
+/* ################################################################### *
+ * FLAT COMBINING
+ * ################################################################### */
+
+static __thread comb_slot_t *comb_fc_slot = NULL;
+
+void comb_fc_init(comb_fc_t *comb) {
+	int i;
+
+	comb->combiner = 0;
+	comb->nr_slots = 0;
+	for (i = 0; i < COMB_MAX_THREADS; i++)
+		comb->slots[i].pending = 0;
+}
+
+static comb_slot_t *comb_fc_register(comb_fc_t *comb) {
+	AO_t i;
+
+	i = AO_fetch_and_add_full(&comb->nr_slots, 1);
+	if (i >= COMB_MAX_THREADS) {
+		fprintf(stderr, "Too many threads for flat combining (max %d)\n",
+				COMB_MAX_THREADS);
+		exit(1);
+	}
+	return &comb->slots[i];
+}
+
+/* Called with the combiner lock held */
+static void comb_fc_combine(comb_fc_t *comb) {
+	comb_slot_t *slot;
+	AO_t i, n;
+	int pass, served;
+	unsigned long ops = 0;
+
+	n = AO_load_full(&comb->nr_slots);
+	if (n > COMB_MAX_THREADS)
+		n = COMB_MAX_THREADS;
+	for (pass = 0; pass < COMB_FC_PASSES; pass++) {
+		served = 0;
+		for (i = 0; i < n; i++) {
+			slot = &comb->slots[i];
+			if (!AO_load_acquire(&slot->pending))
+				continue;
+			slot->result = slot->fn(slot->obj, slot->arg);
+			AO_store_release(&slot->pending, 0);
+			served++;
+		}
+		if (served == 0)
+			break;
+		ops += served;
+	}
+	/* The requests may all have been served by the previous combiner */
+	if (ops > 0)
+		comb_add_batch(ops);
+}
+
+intptr_t comb_fc_apply(comb_fc_t *comb, comb_fn_t fn, void *obj, intptr_t arg) {
+	comb_slot_t *slot;
+
+	if ((slot = comb_fc_slot) == NULL)
+		slot = comb_fc_slot = comb_fc_register(comb);
+	slot->fn = fn;
+	slot->obj = obj;
+	slot->arg = arg;
+	AO_store_release(&slot->pending, 1);
+	while (1) {
+		if (!AO_load_full(&comb->combiner) &&
+			AO_compare_and_swap_full(&comb->combiner, 0, 1)) {
+			comb_fc_combine(comb);
+			AO_store_release(&comb->combiner, 0);
+		}
+		if (!AO_load_acquire(&slot->pending))
+			return slot->result;
+		LOCK_PAUSE();
+	}
+}
+
+/* ################################################################### *
+ * CC-SYNCH
+ * ################################################################### */
+
+/* Node the thread enqueues next, it gets the node of its predecessor */
+static __thread comb_node_t *comb_cc_node = NULL;
+
+static comb_node_t *comb_cc_new_node(void) {
+	comb_node_t *node;
+
+	if ((node = (comb_node_t *) calloc(1, sizeof(comb_node_t))) == NULL) {
+		perror("malloc");
+		exit(1);
+	}
+	return node;
+}
+
+void comb_cc_init(comb_cc_t *comb) {
+	comb->tail = comb_cc_new_node();
+}
+
+static inline comb_node_t *comb_cc_swap_tail(comb_cc_t *comb,
+											 comb_node_t *node) {
+	comb_node_t *tail;
+
+	do {
+		tail = comb->tail;
+	} while (!AO_compare_and_swap_full((volatile AO_t *) &comb->tail,
+									   (AO_t) tail, (AO_t) node));
+	return tail;
+}
+
+intptr_t comb_cc_apply(comb_cc_t *comb, comb_fn_t fn, void *obj, intptr_t arg) {
+	comb_node_t *next, *curr, *tmp, *tmp_next;
+	unsigned long served;
+
+	if (comb->tail == NULL) {
+		tmp = comb_cc_new_node();
+		if (!AO_compare_and_swap_full((volatile AO_t *) &comb->tail,
+									  0, (AO_t) tmp))
+			free(tmp);
+	}
+	if (comb_cc_node == NULL)
+		comb_cc_node = comb_cc_new_node();
+
+	/* Enqueue an empty node and publish the request in the previous tail */
+	next = comb_cc_node;
+	next->next = NULL;
+	next->wait = 1;
+	next->completed = 0;
+	AO_nop_full();
+	curr = comb_cc_swap_tail(comb, next);
+	curr->fn = fn;
+	curr->obj = obj;
+	curr->arg = arg;
+	AO_nop_write();
+	curr->next = next;
+	comb_cc_node = curr;
+
+	while (AO_load_acquire(&curr->wait))
+		LOCK_PAUSE();
+	if (AO_load_acquire(&curr->completed))
+		return curr->result;
+
+	/* Combiner: serve the requests following our own */
+	tmp = curr;
+	served = 0;
+	while ((tmp_next = tmp->next) != NULL && served < COMB_CC_BATCH) {
+		AO_nop_read();
+		tmp->result = tmp->fn(tmp->obj, tmp->arg);
+		AO_store(&tmp->completed, 1);
+		AO_store_release(&tmp->wait, 0);
+		tmp = tmp_next;
+		served++;
+	}
+	comb_add_batch(served);
+	/* Hand the combiner role over to the next waiting thread */
+	AO_store_release(&tmp->wait, 0);
+	return curr->result;
+}
@@ -0,0 +1,102 @@
+/*
+ * File:
+ *   combining.h
+ * Description:
+ *   Combining layer turning a sequential data structure into a concurrent
+ *   one: threads publish their operation and a single thread, the
+ *   combiner, applies the pending operations of all threads in a batch.
+ *   - FC:     flat combining (Hendler, Incze, Shavit and Tzafrir, SPAA
+ *             2010), each thread publishes its requests in its own padded
+ *             slot, the thread that gets the combiner lock scans the slots
+ *             up to COMB_FC_PASSES times while it finds pending requests,
+ *   - CC:     CC-Synch (Fatourou and Kallimanis, PPoPP 2012), threads
+ *             enqueue their request with a swap on the tail of a list
+ *             and wait on their node, the thread at the head becomes the
+ *             combiner and serves up to COMB_CC_BATCH requests before
+ *             handing the combiner role to the next waiting thread.
+ *   An operation is a function of the data structure and of an argument,
+ *   it is always run by a single thread at a time, as in a sequential
+ *   execution. A thread uses a single combining instance.
+ *
+ * combining.h is part of Synchrobench
+ *
+ * Synchrobench is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, version 2
+ * of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _COMBINING_H
+#define _COMBINING_H
+
+#include <stdint.h>
+#include <atomic_ops.h>
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE                 64
+#endif
+#define COMB_MAX_THREADS                256
+#define COMB_FC_PASSES                  3
+#define COMB_CC_BATCH                   (3 * COMB_MAX_THREADS)
+
+typedef intptr_t (*comb_fn_t)(void *obj, intptr_t arg);
+
+/* Publication slot of a thread, one per cache line */
+typedef struct comb_slot {
+	volatile AO_t pending;
+	comb_fn_t fn;
+	void *obj;
+	intptr_t arg;
+	volatile intptr_t result;
+	char padding[CACHE_LINE_SIZE - 5 * sizeof(AO_t)];
+} comb_slot_t;
+
+typedef struct comb_fc {
+	volatile AO_t combiner;         /* combiner lock */
+	volatile AO_t nr_slots;
+	char padding[CACHE_LINE_SIZE - 2 * sizeof(AO_t)];
+	comb_slot_t slots[COMB_MAX_THREADS];
+} comb_fc_t;
+
+typedef struct comb_node {
+	comb_fn_t fn;
+	void *obj;
+	intptr_t arg;
+	volatile intptr_t result;
+	struct comb_node *volatile next;
+	volatile AO_t wait;
+	volatile AO_t completed;
+	char padding[CACHE_LINE_SIZE - 7 * sizeof(AO_t)];
+} comb_node_t;
+
+/* The tail is allocated by the first operation when it is NULL */
+typedef struct comb_cc {
+	comb_node_t *volatile tail;
+} comb_cc_t;
+
+/* Combining statistics, a batch is the set of requests of one combiner */
+typedef struct comb_stats {
+	unsigned long ops;
+	unsigned long batches;
+} comb_stats_t;
+
+/* Zeroed instances are valid */
+void comb_fc_init(comb_fc_t *comb);
+intptr_t comb_fc_apply(comb_fc_t *comb, comb_fn_t fn, void *obj, intptr_t arg);
+
+void comb_cc_init(comb_cc_t *comb);
+intptr_t comb_cc_apply(comb_cc_t *comb, comb_fn_t fn, void *obj, intptr_t arg);
+
+/*
+ * Statistics of all the instances, comb_get_stats returns them and
+ * comb_print_stats prints them.
+ */
+void comb_get_stats(comb_stats_t *stats);
+void comb_print_stats(void);
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ * File:
+ *   elimination.c
+ * Description:
+ *   Elimination layer for the updates of a set (see elimination.h).
+ *
+ * elimination.c is part of Synchrobench
+ *
+ * Synchrobench is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, version 2
+ * of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "elimination.h"
+#include "locks.h"
+
+__thread elim_stats_t elim_stats;
+static __thread int elim_wait = ELIM_WAIT_MIN;
+
+void elim_init(elim_t *elim, int nb_slots) {
+	int i;
+
+	elim->nb_slots = nb_slots;
+	if ((elim->slots = (elim_slot_t *) malloc(nb_slots * sizeof(elim_slot_t))) == NULL) {
+		perror("malloc");
+		exit(1);
+	}
+	for (i = 0; i < nb_slots; i++)
+		elim->slots[i].word = 0;
+}
+
+void elim_destroy(elim_t *elim) {
+	free(elim->slots);
+}
+
+/* Fibonacci hashing spreads consecutive values over the slots */
+static inline elim_slot_t *elim_slot(elim_t *elim, intptr_t val) {
+	uint64_t h = (uint64_t) val * 0x9E3779B97F4A7C15ULL;
+
+	return &elim->slots[(h >> 32) % elim->nb_slots];
+}
+
+int elim_try(elim_t *elim, int op, intptr_t val) {
+	elim_slot_t *slot = elim_slot(elim, val);
+	AO_t mine = ((AO_t) val << 2) | op;
+	AO_t other = ((AO_t) val << 2) | (op == ELIM_ADD ? ELIM_REMOVE : ELIM_ADD);
+	AO_t word;
+	int i;
+
+	elim_stats.attempts++;
+	word = AO_load_full(&slot->word);
+	if (word == other) {
+		/* The opposite update waits: take it */
+		if (AO_compare_and_swap_full(&slot->word, other, ELIM_TAKEN))
+			goto eliminated;
+		return 0;
+	}
+	if (word != 0 || !AO_compare_and_swap_full(&slot->word, 0, mine))
+		return 0;
+
+	/* Wait for the opposite update */
+	for (i = 0; i < elim_wait; i++) {
+		if (AO_load_acquire(&slot->word) == ELIM_TAKEN)
+			break;
+		LOCK_PAUSE();
+	}
+	if (AO_compare_and_swap_full(&slot->word, mine, 0)) {
+		if (elim_wait > ELIM_WAIT_MIN)
+			elim_wait >>= 1;
+		return 0;
+	}
+	/* Taken meanwhile, free the slot */
+	AO_store_release(&slot->word, 0);
+	if (elim_wait < ELIM_WAIT_MAX)
+		elim_wait <<= 1;
+
+ eliminated:
+	elim_stats.eliminated++;
+	return 1;
+}
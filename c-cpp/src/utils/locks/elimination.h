@@ -0,0 +1,82 @@
+/*
+ * File:
+ *   elimination.h
+ * Description:
+ *   Elimination layer for the add and remove operations of a set
+ *   (after the elimination array of Hendler, Shavit and Yerushalmi, SPAA
+ *   2004): an array of exchanger slots indexed by a hash of the value in
+ *   front of the set. An update first looks for the opposite update on
+ *   the same value in its slot, otherwise it publishes itself there and
+ *   waits a short while. An add(k) and a remove(k) that meet both succeed
+ *   without accessing the set, linearized when the second one takes the
+ *   slot: remove then add if k is present, add then remove otherwise,
+ *   which leaves the set unchanged in both cases. The updates that are not
+ *   eliminated withdraw from their slot and access the set.
+ *
+ * elimination.h is part of Synchrobench
+ *
+ * Synchrobench is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, version 2
+ * of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _ELIMINATION_H
+#define _ELIMINATION_H
+
+#include <stdint.h>
+#include <atomic_ops.h>
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE                 64
+#endif
+/*
+ * Pauses an update waits in its slot for the opposite update, the wait
+ * of a thread doubles when it is eliminated and halves when it times out
+ * (as the adaptive elimination backoff of Hendler, Shavit and Yerushalmi)
+ */
+#define ELIM_WAIT_MIN                   4
+#define ELIM_WAIT_MAX                   1024
+
+#define ELIM_ADD                        1
+#define ELIM_REMOVE                     2
+
+/*
+ * A slot is empty (0), holds a waiting update (the value shifted by 2
+ * with the operation in the low-order bits) or is taken (ELIM_TAKEN)
+ * until the waiting update notices it was eliminated.
+ */
+#define ELIM_TAKEN                      3
+
+typedef struct elim_slot {
+	volatile AO_t word;
+	char padding[CACHE_LINE_SIZE - sizeof(AO_t)];
+} elim_slot_t;
+
+typedef struct elim {
+	int nb_slots;
+	elim_slot_t *slots;
+} elim_t;
+
+/* Per-thread statistics: updates that went through the layer */
+typedef struct elim_stats {
+	unsigned long attempts;
+	unsigned long eliminated;
+} elim_stats_t;
+
+extern __thread elim_stats_t elim_stats;
+
+void elim_init(elim_t *elim, int nb_slots);
+void elim_destroy(elim_t *elim);
+/*
+ * elim_try returns 1 if the update op (ELIM_ADD or ELIM_REMOVE) of val
+ * was eliminated, it then succeeded, and 0 if it must access the set.
+ */
+int elim_try(elim_t *elim, int op, intptr_t val);
+
+#endif
@@ -0,0 +1,547 @@
+/*
+ * File:
+ *   locks.c
+ * Description:
+ *   Lock library for the lock-based benchmarks (see locks.h).
+ *
+ * locks.c is part of Synchrobench
+ *
+ * Synchrobench is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, version 2
+ * of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "locks.h"
+
+/* ################################################################### *
+ * STATISTICS
+ * ################################################################### */
+
+static __thread lock_stats_t lock_local_stats;
+static __thread int lock_registered = 0;
+static pthread_key_t lock_stats_key;
+static pthread_once_t lock_stats_once = PTHREAD_ONCE_INIT;
+static volatile AO_t lock_total_acquires = 0;
+static volatile AO_t lock_total_contended = 0;
+static volatile AO_t lock_total_wait_ns = 0;
+
+static void lock_stats_flush(void *arg) {
+	(void) arg;
+	AO_fetch_and_add_full(&lock_total_acquires, lock_local_stats.acquires);
+	AO_fetch_and_add_full(&lock_total_contended, lock_local_stats.contended);
+	AO_fetch_and_add_full(&lock_total_wait_ns, lock_local_stats.wait_ns);
+	lock_local_stats.acquires = 0;
+	lock_local_stats.contended = 0;
+	lock_local_stats.wait_ns = 0;
+}
+
+static void lock_stats_key_init(void) {
+	pthread_key_create(&lock_stats_key, lock_stats_flush);
+}
+
+static inline void lock_register(void) {
+	if (!lock_registered) {
+		pthread_once(&lock_stats_once, lock_stats_key_init);
+		/* Any non-NULL value triggers the destructor at thread exit */
+		pthread_setspecific(lock_stats_key, (void *) &lock_local_stats);
+		lock_registered = 1;
+	}
+}
+
+static inline unsigned long lock_now_ns(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+/* An acquisition is contended when its fast path failed */
+#define LOCK_ACQUIRED()                                                 \
+	do {                                                                \
+		lock_register();                                                \
+		lock_local_stats.acquires++;                                    \
+	} while (0)
+#define LOCK_WAIT_BEGIN(start)                                          \
+	do {                                                                \
+		lock_local_stats.contended++;                                   \
+		start = lock_now_ns();                                          \
+	} while (0)
+#define LOCK_WAIT_END(start)            (lock_local_stats.wait_ns += lock_now_ns() - (start))
+
+void lock_get_stats(lock_stats_t *stats) {
+	stats->acquires = AO_load_full(&lock_total_acquires);
+	stats->contended = AO_load_full(&lock_total_contended);
+	stats->wait_ns = AO_load_full(&lock_total_wait_ns);
+}
+
+void lock_print_stats(void) {
+	lock_stats_t stats;
+
+	lock_get_stats(&stats);
+	printf("#lock acquires: %lu\n", stats.acquires);
+	printf("  #contended  : %lu (%f %%)\n", stats.contended,
+		   stats.acquires ? 100.0 * stats.contended / stats.acquires : 0.0);
+	printf("  #wait time  : %lu (ms) (%f ns / contended)\n",
+		   stats.wait_ns / 1000000,
+		   stats.contended ? (double) stats.wait_ns / stats.contended : 0.0);
+}
+
+static inline void lock_backoff(unsigned int *backoff) {
+	unsigned int i;
+
+	for (i = 0; i < *backoff; i++)
+		LOCK_PAUSE();
+	if (*backoff < LOCK_BACKOFF_MAX)
+		*backoff <<= 1;
+}
+
+/* ################################################################### *
+ * TICKET LOCK
+ * ################################################################### */
+
+void lock_ticket_init(lock_ticket_t *lock) {
+	lock->next = 0;
+	lock->owner = 0;
+}
+
+/* Waiters pause proportionally to their distance to the owner */
+static inline void lock_ticket_wait(lock_ticket_t *lock, AO_t ticket) {
+	AO_t owner;
+	unsigned int i;
+
+	while ((owner = AO_load_full(&lock->owner)) != ticket)
+		for (i = 0; i < (ticket - owner) * LOCK_BACKOFF_MIN; i++)
+			LOCK_PAUSE();
+}
+
+int lock_ticket_acquire(lock_ticket_t *lock) {
+	AO_t ticket;
+	unsigned long start;
+
+	ticket = AO_fetch_and_add_full(&lock->next, 1);
+	LOCK_ACQUIRED();
+	if (AO_load_full(&lock->owner) == ticket)
+		return 0;
+	LOCK_WAIT_BEGIN(start);
+	lock_ticket_wait(lock, ticket);
+	LOCK_WAIT_END(start);
+	return 0;
+}
+
+int lock_ticket_release(lock_ticket_t *lock) {
+	AO_store_full(&lock->owner, lock->owner + 1);
+	return 0;
+}
+
+/* ################################################################### *
+ * TTAS LOCK
+ * ################################################################### */
+
+void lock_ttas_init(lock_ttas_t *lock) {
+	lock->word = 0;
+}
+
+int lock_ttas_acquire(lock_ttas_t *lock) {
+	unsigned int backoff = LOCK_BACKOFF_MIN;
+	unsigned long start;
+
+	LOCK_ACQUIRED();
+	if (AO_compare_and_swap_full(&lock->word, 0, 1))
+		return 0;
+	LOCK_WAIT_BEGIN(start);
+	while (1) {
+		while (AO_load_full(&lock->word))
+			LOCK_PAUSE();
+		if (AO_compare_and_swap_full(&lock->word, 0, 1))
+			break;
+		lock_backoff(&backoff);
+	}
+	LOCK_WAIT_END(start);
+	return 0;
+}
+
+int lock_ttas_release(lock_ttas_t *lock) {
+	AO_store_full(&lock->word, 0);
+	return 0;
+}
+
+/* ################################################################### *
+ * QUEUE NODES
+ * ################################################################### */
+
+/*
+ * Each thread keeps a free list of queue nodes (a node migrates between
+ * threads with CLH). The node of the holder is stored in the lock once it
+ * is acquired and taken back by the release.
+ */
+static __thread lock_qnode_t *lock_free_nodes = NULL;
+
+static inline lock_qnode_t *lock_node_get(void) {
+	lock_qnode_t *node;
+
+	if ((node = lock_free_nodes) != NULL) {
+		lock_free_nodes = node->free_next;
+		return node;
+	}
+	if ((node = (lock_qnode_t *)malloc(sizeof(lock_qnode_t))) == NULL) {
+		perror("malloc");
+		exit(1);
+	}
+	return node;
+}
+
+static inline void lock_node_put(lock_qnode_t *node) {
+	node->free_next = lock_free_nodes;
+	lock_free_nodes = node;
+}
+
+static inline lock_qnode_t *lock_swap_tail(lock_queue_t *lock,
+										   lock_qnode_t *node) {
+	lock_qnode_t *tail;
+
+	do {
+		tail = lock->tail;
+	} while (!AO_compare_and_swap_full((volatile AO_t *) &lock->tail,
+									   (AO_t) tail, (AO_t) node));
+	return tail;
+}
+
+/* ################################################################### *
+ * MCS LOCK
+ * ################################################################### */
+
+void lock_mcs_init(lock_queue_t *lock) {
+	lock->tail = NULL;
+	lock->holder = NULL;
+}
+
+int lock_mcs_acquire(lock_queue_t *lock) {
+	lock_qnode_t *node, *pred;
+	unsigned long start;
+
+	node = lock_node_get();
+	node->next = NULL;
+	node->locked = 1;
+	LOCK_ACQUIRED();
+	if ((pred = lock_swap_tail(lock, node)) == NULL) {
+		lock->holder = node;
+		return 0;
+	}
+	LOCK_WAIT_BEGIN(start);
+	pred->next = node;
+	while (AO_load_full(&node->locked))
+		LOCK_PAUSE();
+	LOCK_WAIT_END(start);
+	lock->holder = node;
+	return 0;
+}
+
+int lock_mcs_release(lock_queue_t *lock) {
+	lock_qnode_t *node;
+
+	node = lock->holder;
+	if (node->next == NULL) {
+		if (AO_compare_and_swap_full((volatile AO_t *) &lock->tail,
+									 (AO_t) node, (AO_t) NULL)) {
+			lock_node_put(node);
+			return 0;
+		}
+		/* A successor is linking itself */
+		while (node->next == NULL)
+			LOCK_PAUSE();
+	}
+	AO_store_full(&node->next->locked, 0);
+	lock_node_put(node);
+	return 0;
+}
+
+/* ################################################################### *
+ * CLH LOCK
+ * ################################################################### */
+
+/*
+ * The CLH lock has no dummy node: an empty queue means the lock is free.
+ * A waiter spins on the node of its predecessor and recycles it once it
+ * acquired the lock, a releaser with a successor leaves its node to it.
+ */
+void lock_clh_init(lock_queue_t *lock) {
+	lock->tail = NULL;
+	lock->holder = NULL;
+}
+
+int lock_clh_acquire(lock_queue_t *lock) {
+	lock_qnode_t *node, *pred;
+	unsigned long start;
+
+	node = lock_node_get();
+	node->locked = 1;
+	LOCK_ACQUIRED();
+	if ((pred = lock_swap_tail(lock, node)) == NULL) {
+		lock->holder = node;
+		return 0;
+	}
+	LOCK_WAIT_BEGIN(start);
+	while (AO_load_full(&pred->locked))
+		LOCK_PAUSE();
+	LOCK_WAIT_END(start);
+	lock_node_put(pred);
+	lock->holder = node;
+	return 0;
+}
+
+int lock_clh_release(lock_queue_t *lock) {
+	lock_qnode_t *node;
+
+	node = lock->holder;
+	if (AO_compare_and_swap_full((volatile AO_t *) &lock->tail,
+								 (AO_t) node, (AO_t) NULL))
+		lock_node_put(node);
+	else
+		AO_store_full(&node->locked, 0);
+	return 0;
+}
+
+/* ################################################################### *
+ * COHORT LOCK
+ * ################################################################### */
+
+static __thread int lock_zone = -1;
+
+void lock_set_zone(int zone) {
+	lock_zone = zone % LOCK_COHORT_ZONES;
+}
+
+/* The zone is the NUMA node of the CPU, as reported by the kernel */
+static inline int lock_get_zone(void) {
+	unsigned int cpu, node;
+
+	if (lock_zone < 0) {
+		if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0)
+			node = 0;
+		lock_set_zone(node);
+	}
+	return lock_zone;
+}
+
+void lock_cohort_init(lock_cohort_t *lock) {
+	int i;
+
+	lock_ticket_init(&lock->global);
+	for (i = 0; i < LOCK_COHORT_ZONES; i++) {
+		lock_ticket_init(&lock->local[i].ticket);
+		lock->local[i].inherited = 0;
+		lock->local[i].batch = 0;
+	}
+}
+
+int lock_cohort_acquire(lock_cohort_t *lock) {
+	lock_cohort_local_t *local;
+	AO_t ticket;
+	unsigned long start = 0;
+	int contended = 0;
+
+	local = &lock->local[lock_get_zone()];
+	ticket = AO_fetch_and_add_full(&local->ticket.next, 1);
+	LOCK_ACQUIRED();
+	if (AO_load_full(&local->ticket.owner) != ticket) {
+		LOCK_WAIT_BEGIN(start);
+		contended = 1;
+		lock_ticket_wait(&local->ticket, ticket);
+	}
+	if (local->inherited) {
+		/* The global lock was passed within the zone */
+		local->inherited = 0;
+	} else {
+		ticket = AO_fetch_and_add_full(&lock->global.next, 1);
+		if (AO_load_full(&lock->global.owner) != ticket) {
+			if (!contended) {
+				LOCK_WAIT_BEGIN(start);
+				contended = 1;
+			}
+			lock_ticket_wait(&lock->global, ticket);
+		}
+	}
+	if (contended)
+		LOCK_WAIT_END(start);
+	return 0;
+}
+
+int lock_cohort_release(lock_cohort_t *lock) {
+	lock_cohort_local_t *local;
+
+	local = &lock->local[lock_get_zone()];
+	if (AO_load_full(&local->ticket.next) != local->ticket.owner + 1 &&
+		local->batch < LOCK_COHORT_BATCH) {
+		/* A thread of the zone waits: keep the global lock for it */
+		local->batch++;
+		local->inherited = 1;
+	} else {
+		local->batch = 0;
+		lock_ticket_release(&lock->global);
+	}
+	lock_ticket_release(&local->ticket);
+	return 0;
+}
+
+/* ################################################################### *
+ * READER-WRITER LOCK
+ * ################################################################### */
+
+/* Visible readers: each slot holds the address of a lock or 0 */
+static volatile AO_t lock_rw_table[LOCK_RW_SLOTS];
+/* Slot of the read lock the thread holds through the table */
+static __thread volatile AO_t *lock_rw_slot = NULL;
+
+/* The address of a thread-local variable identifies the thread */
+static inline volatile AO_t *lock_rw_hash(lock_rw_t *lock) {
+	uintptr_t h = ((uintptr_t) &lock_rw_slot ^ (uintptr_t) lock) * 2654435761UL;
+
+	return &lock_rw_table[(h >> 16) % LOCK_RW_SLOTS];
+}
+
+void lock_rw_init(lock_rw_t *lock) {
+	lock->word = 0;
+	lock->rbias = 1;
+	lock->inhibit_until = 0;
+}
+
+int lock_rw_read_acquire(lock_rw_t *lock) {
+	volatile AO_t *slot;
+	unsigned int backoff = LOCK_BACKOFF_MIN;
+	unsigned long start;
+	AO_t word;
+
+	LOCK_ACQUIRED();
+	if (AO_load_full(&lock->rbias)) {
+		slot = lock_rw_hash(lock);
+		if (AO_compare_and_swap_full(slot, 0, (AO_t) lock)) {
+			/* The bias may have been revoked before the slot was set */
+			if (AO_load_full(&lock->rbias)) {
+				lock_rw_slot = slot;
+				return 0;
+			}
+			AO_store_full(slot, 0);
+		}
+	}
+	word = AO_load_full(&lock->word);
+	if (!(word & LOCK_RW_WRITER) &&
+		AO_compare_and_swap_full(&lock->word, word, word + LOCK_RW_READER))
+		goto acquired;
+	LOCK_WAIT_BEGIN(start);
+	while (1) {
+		while ((word = AO_load_full(&lock->word)) & LOCK_RW_WRITER)
+			LOCK_PAUSE();
+		if (AO_compare_and_swap_full(&lock->word, word, word + LOCK_RW_READER))
+			break;
+		lock_backoff(&backoff);
+	}
+	LOCK_WAIT_END(start);
+ acquired:
+	/* No writer can revoke the bias while the lock is read */
+	if (!lock->rbias && lock_now_ns() >= lock->inhibit_until)
+		AO_store_full(&lock->rbias, 1);
+	return 0;
+}
+
+int lock_rw_read_release(lock_rw_t *lock) {
+	if (lock_rw_slot != NULL) {
+		AO_store_full(lock_rw_slot, 0);
+		lock_rw_slot = NULL;
+		return 0;
+	}
+	AO_fetch_and_add_full(&lock->word, (AO_t) -LOCK_RW_READER);
+	return 0;
+}
+
+int lock_rw_write_acquire(lock_rw_t *lock) {
+	unsigned int backoff = LOCK_BACKOFF_MIN;
+	unsigned long start, revoke;
+	AO_t word;
+	int i;
+
+	LOCK_ACQUIRED();
+	if (!AO_compare_and_swap_full(&lock->word, 0, LOCK_RW_WRITER)) {
+		LOCK_WAIT_BEGIN(start);
+		/* Set the writer bit first to hold off new readers */
+		while (1) {
+			while ((word = AO_load_full(&lock->word)) & LOCK_RW_WRITER)
+				LOCK_PAUSE();
+			if (AO_compare_and_swap_full(&lock->word, word, word | LOCK_RW_WRITER))
+				break;
+			lock_backoff(&backoff);
+		}
+		while (AO_load_full(&lock->word) != LOCK_RW_WRITER)
+			LOCK_PAUSE();
+		LOCK_WAIT_END(start);
+	}
+	if (AO_load_full(&lock->rbias)) {
+		/* Revoke the bias and wait for the readers of the table */
+		revoke = lock_now_ns();
+		AO_store_full(&lock->rbias, 0);
+		for (i = 0; i < LOCK_RW_SLOTS; i++)
+			while (AO_load_full(&lock_rw_table[i]) == (AO_t) lock)
+				LOCK_PAUSE();
+		start = lock_now_ns();
+		lock->inhibit_until = start + (start - revoke) * LOCK_RW_INHIBIT;
+	}
+	return 0;
+}
+
+int lock_rw_write_release(lock_rw_t *lock) {
+	AO_store_full(&lock->word, 0);
+	return 0;
+}
+
+/* ################################################################### *
+ * SEQUENCE LOCK
+ * ################################################################### */
+
+void lock_seq_init(lock_seq_t *lock) {
+	lock->seq = 0;
+	lock_ttas_init(&lock->writer);
+}
+
+AO_t lock_seq_read_begin(lock_seq_t *lock) {
+	AO_t seq;
+
+	LOCK_ACQUIRED();
+	while ((seq = AO_load_acquire(&lock->seq)) & 1)
+		LOCK_PAUSE();
+	return seq;
+}
+
+/* A retried read counts as contended */
+int lock_seq_read_retry(lock_seq_t *lock, AO_t seq) {
+	AO_nop_read();
+	if (AO_load(&lock->seq) == seq)
+		return 0;
+	lock_local_stats.contended++;
+	return 1;
+}
+
+int lock_seq_write_acquire(lock_seq_t *lock) {
+	lock_ttas_acquire(&lock->writer);
+	AO_store(&lock->seq, lock->seq + 1);
+	AO_nop_write();
+	return 0;
+}
+
+int lock_seq_write_release(lock_seq_t *lock) {
+	AO_store_release(&lock->seq, lock->seq + 1);
+	lock_ttas_release(&lock->writer);
+	return 0;
+}
@@ -0,0 +1,218 @@
+/*
+ * File:
+ *   locks.h
+ * Description:
+ *   Lock library for the lock-based benchmarks, selected at build time
+ *   with LOCK=TICKET|MCS|CLH|TTAS|COHORT (LOCK=MUTEX and LOCK=SPIN keep
+ *   using the pthread locks). It provides the ptlock_t type and the
+ *   INIT_LOCK/DESTROY_LOCK/LOCK/UNLOCK macros of the benchmarks.
+ *   - TICKET: ticket lock with proportional backoff,
+ *   - MCS:    Mellor-Crummey and Scott queue lock,
+ *   - CLH:    Craig, Landin and Hagersten queue lock,
+ *   - TTAS:   test-and-test-and-set lock with exponential backoff,
+ *   - COHORT: NUMA-aware cohort lock (Dice, Marathe, Shavit, PPoPP 2012)
+ *             made of a global ticket lock and one local ticket lock per
+ *             zone (NUMA node), the global lock is passed within a zone up to
+ *             LOCK_COHORT_BATCH times.
+ *   The queue nodes of MCS and CLH come from a per-thread free list and
+ *   the node of the holder is kept in the lock, so that the locks keep
+ *   the LOCK(lock)/UNLOCK(lock) interface whatever the number of locks a
+ *   thread holds. Each thread counts
+ *   its acquisitions and the time it waited for contended locks.
+ *   The library also provides the locks of the coarse-grained builds
+ *   (STM=RWLOCK|SEQLOCK, see include/sequential.h):
+ *   - RW:     reader-writer lock with the reader bias of BRAVO (Dice and
+ *             Kogan, USENIX ATC 2019): while biased, readers only publish
+ *             the lock in a slot of a global table of visible readers, a
+ *             writer revokes the bias and waits for these readers, the
+ *             bias is restored by a reader once LOCK_RW_INHIBIT times the
+ *             revocation time elapsed,
+ *   - SEQ:    sequence lock, writers serialize on a TTAS lock and make
+ *             the sequence odd while they write, readers do not write
+ *             shared memory and retry if the sequence changed.
+ *
+ * locks.h is part of Synchrobench
+ *
+ * Synchrobench is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, version 2
+ * of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _LOCKS_H
+#define _LOCKS_H
+
+#include <stdint.h>
+#include <atomic_ops.h>
+
+#ifndef LOCK_COHORT_ZONES
+#define LOCK_COHORT_ZONES               2
+#endif
+#define LOCK_COHORT_BATCH               64
+#define LOCK_BACKOFF_MIN                4
+#define LOCK_BACKOFF_MAX                1024
+#define LOCK_RW_SLOTS                   4096
+#define LOCK_RW_INHIBIT                 9
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LOCK_PAUSE()                    __asm__ __volatile__("pause" ::: "memory")
+#else
+#define LOCK_PAUSE()                    __asm__ __volatile__("" ::: "memory")
+#endif
+
+typedef struct lock_ticket {
+	volatile AO_t next;
+	volatile AO_t owner;
+} lock_ticket_t;
+
+typedef struct lock_ttas {
+	volatile AO_t word;
+} lock_ttas_t;
+
+typedef struct lock_qnode {
+	struct lock_qnode *volatile next;
+	volatile AO_t locked;
+	struct lock_qnode *free_next;
+} lock_qnode_t;
+
+/*
+ * MCS and CLH locks are a tail pointer, NULL when the lock is free, and
+ * the node of the holder, only accessed by the holder.
+ */
+typedef struct lock_queue {
+	lock_qnode_t *volatile tail;
+	lock_qnode_t *holder;
+} lock_queue_t;
+
+typedef struct lock_cohort_local {
+	lock_ticket_t ticket;
+	volatile AO_t inherited;        /* the global lock is held by the zone */
+	AO_t batch;                     /* consecutive local hand-offs */
+} lock_cohort_local_t;
+
+typedef struct lock_cohort {
+	lock_ticket_t global;
+	lock_cohort_local_t local[LOCK_COHORT_ZONES];
+} lock_cohort_t;
+
+/*
+ * The underlying reader-writer lock word holds the writer bit and the
+ * number of slow-path readers.
+ */
+#define LOCK_RW_WRITER                  1
+#define LOCK_RW_READER                  2
+
+typedef struct lock_rw {
+	volatile AO_t word;
+	volatile AO_t rbias;            /* readers may use the table */
+	volatile AO_t inhibit_until;    /* time the bias stays revoked (ns) */
+} lock_rw_t;
+
+typedef struct lock_seq {
+	volatile AO_t seq;              /* odd while a writer writes */
+	lock_ttas_t writer;
+} lock_seq_t;
+
+/* Acquire statistics, the wait time is only measured when contended */
+typedef struct lock_stats {
+	unsigned long acquires;
+	unsigned long contended;
+	unsigned long wait_ns;
+} lock_stats_t;
+
+/* Acquire and release return 0 as the pthread locks do */
+void lock_ticket_init(lock_ticket_t *lock);
+int lock_ticket_acquire(lock_ticket_t *lock);
+int lock_ticket_release(lock_ticket_t *lock);
+
+void lock_ttas_init(lock_ttas_t *lock);
+int lock_ttas_acquire(lock_ttas_t *lock);
+int lock_ttas_release(lock_ttas_t *lock);
+
+void lock_mcs_init(lock_queue_t *lock);
+int lock_mcs_acquire(lock_queue_t *lock);
+int lock_mcs_release(lock_queue_t *lock);
+
+void lock_clh_init(lock_queue_t *lock);
+int lock_clh_acquire(lock_queue_t *lock);
+int lock_clh_release(lock_queue_t *lock);
+
+void lock_cohort_init(lock_cohort_t *lock);
+int lock_cohort_acquire(lock_cohort_t *lock);
+int lock_cohort_release(lock_cohort_t *lock);
+
+/* A thread holds at most one read lock at a time */
+void lock_rw_init(lock_rw_t *lock);
+int lock_rw_read_acquire(lock_rw_t *lock);
+int lock_rw_read_release(lock_rw_t *lock);
+int lock_rw_write_acquire(lock_rw_t *lock);
+int lock_rw_write_release(lock_rw_t *lock);
+
+/*
+ * lock_seq_read_begin waits for no writer to be writing and returns the
+ * sequence, lock_seq_read_retry tells whether the reads made since must
+ * be retried as a writer wrote meanwhile.
+ */
+void lock_seq_init(lock_seq_t *lock);
+AO_t lock_seq_read_begin(lock_seq_t *lock);
+int lock_seq_read_retry(lock_seq_t *lock, AO_t seq);
+int lock_seq_write_acquire(lock_seq_t *lock);
+int lock_seq_write_release(lock_seq_t *lock);
+
+/*
+ * Zone of the calling thread for cohort locks, it defaults to the NUMA
+ * node of the CPU the thread first runs on modulo LOCK_COHORT_ZONES.
+ */
+void lock_set_zone(int zone);
+
+/*
+ * The statistics of a thread are added to the global ones when it exits,
+ * lock_get_stats returns the global statistics and lock_print_stats
+ * prints them.
+ */
+void lock_get_stats(lock_stats_t *stats);
+void lock_print_stats(void);
+
+#if defined LOCK_TICKET
+typedef lock_ticket_t ptlock_t;
+#  define LOCK_NAME                     "ticket"
+#  define INIT_LOCK(lock)               lock_ticket_init((lock_ticket_t *) (lock));
+#  define DESTROY_LOCK(lock)
+#  define LOCK(lock)                    lock_ticket_acquire((lock_ticket_t *) (lock))
+#  define UNLOCK(lock)                  lock_ticket_release((lock_ticket_t *) (lock))
+#elif defined LOCK_TTAS
+typedef lock_ttas_t ptlock_t;
+#  define LOCK_NAME                     "ttas"
+#  define INIT_LOCK(lock)               lock_ttas_init((lock_ttas_t *) (lock));
+#  define DESTROY_LOCK(lock)
+#  define LOCK(lock)                    lock_ttas_acquire((lock_ttas_t *) (lock))
+#  define UNLOCK(lock)                  lock_ttas_release((lock_ttas_t *) (lock))
+#elif defined LOCK_MCS
+typedef lock_queue_t ptlock_t;
+#  define LOCK_NAME                     "mcs"
+#  define INIT_LOCK(lock)               lock_mcs_init((lock_queue_t *) (lock));
+#  define DESTROY_LOCK(lock)
+#  define LOCK(lock)                    lock_mcs_acquire((lock_queue_t *) (lock))
+#  define UNLOCK(lock)                  lock_mcs_release((lock_queue_t *) (lock))
+#elif defined LOCK_CLH
+typedef lock_queue_t ptlock_t;
+#  define LOCK_NAME                     "clh"
+#  define INIT_LOCK(lock)               lock_clh_init((lock_queue_t *) (lock));
+#  define DESTROY_LOCK(lock)
+#  define LOCK(lock)                    lock_clh_acquire((lock_queue_t *) (lock))
+#  define UNLOCK(lock)                  lock_clh_release((lock_queue_t *) (lock))
+#elif defined LOCK_COHORT
+typedef lock_cohort_t ptlock_t;
+#  define LOCK_NAME                     "cohort"
+#  define INIT_LOCK(lock)               lock_cohort_init((lock_cohort_t *) (lock));
+#  define DESTROY_LOCK(lock)
+#  define LOCK(lock)                    lock_cohort_acquire((lock_cohort_t *) (lock))
+#  define UNLOCK(lock)                  lock_cohort_release((lock_cohort_t *) (lock))
+#endif
+
+#endif
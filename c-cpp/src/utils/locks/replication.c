@@ -0,0 +1,309 @@
+/*
+ * File:
+ *   replication.c
+ * Description:
+ *   Node replication of a sequential data structure (see replication.h).
+ *
+ * replication.c is part of Synchrobench
+ *
+ * Synchrobench is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, version 2
+ * of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "numa_zones.h"
+#include "replication.h"
+
+/* ################################################################### *
+ * STATISTICS
+ * ################################################################### */
+
+static __thread nr_stats_t nr_local_stats;
+static __thread int nr_registered = 0;
+static pthread_key_t nr_stats_key;
+static pthread_once_t nr_stats_once = PTHREAD_ONCE_INIT;
+static volatile AO_t nr_total_updates = 0;
+static volatile AO_t nr_total_batches = 0;
+static volatile AO_t nr_total_reads = 0;
+static volatile AO_t nr_total_read_syncs = 0;
+static volatile AO_t nr_total_helps = 0;
+
+static void nr_stats_flush(void *arg) {
+	(void) arg;
+	AO_fetch_and_add_full(&nr_total_updates, nr_local_stats.updates);
+	AO_fetch_and_add_full(&nr_total_batches, nr_local_stats.batches);
+	AO_fetch_and_add_full(&nr_total_reads, nr_local_stats.reads);
+	AO_fetch_and_add_full(&nr_total_read_syncs, nr_local_stats.read_syncs);
+	AO_fetch_and_add_full(&nr_total_helps, nr_local_stats.helps);
+	memset(&nr_local_stats, 0, sizeof(nr_stats_t));
+}
+
+static void nr_stats_key_init(void) {
+	pthread_key_create(&nr_stats_key, nr_stats_flush);
+}
+
+static inline void nr_register(void) {
+	if (!nr_registered) {
+		pthread_once(&nr_stats_once, nr_stats_key_init);
+		/* Any non-NULL value triggers the destructor at thread exit */
+		pthread_setspecific(nr_stats_key, (void *) &nr_local_stats);
+		nr_registered = 1;
+	}
+}
+
+void nr_get_stats(nr_stats_t *stats) {
+	stats->updates = AO_load_full(&nr_total_updates);
+	stats->batches = AO_load_full(&nr_total_batches);
+	stats->reads = AO_load_full(&nr_total_reads);
+	stats->read_syncs = AO_load_full(&nr_total_read_syncs);
+	stats->helps = AO_load_full(&nr_total_helps);
+}
+
+void nr_print_stats(void) {
+	nr_stats_t stats;
+
+	nr_get_stats(&stats);
+	printf("#logged ops   : %lu\n", stats.updates);
+	printf("  #batches    : %lu (%f ops / batch)\n", stats.batches,
+		   stats.batches ? (double) stats.updates / stats.batches : 0.0);
+	printf("#local reads  : %lu\n", stats.reads);
+	printf("  #log waits  : %lu (%f %%)\n", stats.read_syncs,
+		   stats.reads ? 100.0 * stats.read_syncs / stats.reads : 0.0);
+	printf("#replica helps: %lu\n", stats.helps);
+}
+
+/* ################################################################### *
+ * REPLICAS
+ * ################################################################### */
+
+static __thread int nr_zone = 0;
+/* Publication slot of the thread in the replica of its zone */
+static __thread comb_slot_t *nr_slot = NULL;
+
+void nr_init(nr_t *nr, void *obj, nr_new_t new_replica, int nb_zones) {
+	nr_replica_t *r;
+	int z, nb_nodes;
+
+	nb_nodes = numa_zone_nodes(nr->nodes, NR_MAX_ZONES);
+	if (nb_zones <= 0)
+		nb_zones = nb_nodes;
+	if (nb_zones > NR_MAX_ZONES)
+		nb_zones = NR_MAX_ZONES;
+	nr->nb_zones = nb_zones;
+	nr->emulated = (nb_zones > nb_nodes || nb_nodes == 1);
+	nr->log_tail = 0;
+	nr->completed_tail = 0;
+	if ((nr->log = (nr_entry_t *) calloc(NR_LOG_SIZE, sizeof(nr_entry_t))) == NULL) {
+		perror("malloc");
+		exit(1);
+	}
+
+	for (z = 0; z < nb_zones; z++) {
+		if (nr->emulated) {
+			r = (nr_replica_t *) calloc(1, sizeof(nr_replica_t));
+		} else {
+			/* The replica and its nodes are allocated on its node */
+			numa_run_on_node(nr->nodes[z]);
+			numa_set_preferred(nr->nodes[z]);
+			if ((r = (nr_replica_t *) numa_alloc_onnode(sizeof(nr_replica_t),
+														nr->nodes[z])) != NULL)
+				memset(r, 0, sizeof(nr_replica_t));
+		}
+		if (r == NULL) {
+			perror("malloc");
+			exit(1);
+		}
+		r->obj = (z == 0 ? obj : new_replica());
+		lock_rw_init(&r->lock);
+		nr->replicas[z] = r;
+	}
+	if (!nr->emulated) {
+		numa_run_on_node(-1);
+		numa_set_localalloc();
+	}
+}
+
+void nr_thread_zone(nr_t *nr, int id) {
+	nr_zone = id % nr->nb_zones;
+	nr_slot = NULL;
+	if (!nr->emulated)
+		numa_run_on_node(nr->nodes[nr_zone]);
+}
+
+/*
+ * Applies the log to the replica up to entry upto, with the combiner lock
+ * and the write lock of the replica held. The results of the entries from
+ * start on are returned to the slots of batch. Unless wait is set, it
+ * stops at the first entry that is not written yet.
+ */
+static void nr_apply(nr_t *nr, nr_replica_t *r, AO_t upto, AO_t start,
+					 comb_slot_t **batch, int wait) {
+	nr_entry_t *e;
+	intptr_t result;
+	AO_t i;
+
+	for (i = r->local_tail; i < upto; i++) {
+		e = &nr->log[i % NR_LOG_SIZE];
+		while (AO_load_acquire(&e->seq) != i + 1) {
+			if (!wait)
+				return;
+			LOCK_PAUSE();
+		}
+		result = e->fn(r->obj, e->arg);
+		if (batch != NULL && i >= start)
+			batch[i - start]->result = result;
+		AO_store_release(&r->local_tail, i + 1);
+	}
+}
+
+/*
+ * Waits for all replicas to have applied the entries preceding the end of
+ * the batch by NR_LOG_SIZE, so that the batch does not overwrite them.
+ * Meanwhile, the replica of the combiner applies the entries written
+ * before the batch and the idle lagging replicas are brought up to date.
+ */
+static void nr_wait_log(nr_t *nr, nr_replica_t *own, AO_t start, AO_t end) {
+	nr_replica_t *r;
+	int z, full;
+
+	while (1) {
+		full = 0;
+		for (z = 0; z < nr->nb_zones; z++) {
+			r = nr->replicas[z];
+			if (AO_load_full(&r->local_tail) + NR_LOG_SIZE >= end)
+				continue;
+			full = 1;
+			if (r == own) {
+				lock_rw_write_acquire(&r->lock);
+				nr_apply(nr, r, start, 0, NULL, 0);
+				lock_rw_write_release(&r->lock);
+			} else if (!AO_load_full(&r->combiner) &&
+					   AO_compare_and_swap_full(&r->combiner, 0, 1)) {
+				lock_rw_write_acquire(&r->lock);
+				nr_apply(nr, r, start, 0, NULL, 0);
+				lock_rw_write_release(&r->lock);
+				AO_store_release(&r->combiner, 0);
+				nr_local_stats.helps++;
+			}
+		}
+		if (!full)
+			return;
+		LOCK_PAUSE();
+	}
+}
+
+/* Called with the combiner lock of the replica held */
+static void nr_combine(nr_t *nr, nr_replica_t *r) {
+	comb_slot_t *batch[COMB_MAX_THREADS];
+	nr_entry_t *e;
+	AO_t i, n, k, start, tail;
+
+	n = AO_load_full(&r->nr_slots);
+	if (n > COMB_MAX_THREADS)
+		n = COMB_MAX_THREADS;
+	for (i = 0, k = 0; i < n; i++)
+		if (AO_load_acquire(&r->slots[i].pending))
+			batch[k++] = &r->slots[i];
+	if (k == 0)
+		return;
+
+	/* Append the batch to the log */
+	start = AO_fetch_and_add_full(&nr->log_tail, k);
+	nr_wait_log(nr, r, start, start + k);
+	for (i = 0; i < k; i++) {
+		e = &nr->log[(start + i) % NR_LOG_SIZE];
+		e->fn = batch[i]->fn;
+		e->arg = batch[i]->arg;
+		AO_store_release(&e->seq, start + i + 1);
+	}
+
+	lock_rw_write_acquire(&r->lock);
+	nr_apply(nr, r, start + k, start, batch, 1);
+	lock_rw_write_release(&r->lock);
+	do {
+		tail = AO_load_full(&nr->completed_tail);
+	} while (tail < start + k &&
+			 !AO_compare_and_swap_full(&nr->completed_tail, tail, start + k));
+
+	for (i = 0; i < k; i++)
+		AO_store_release(&batch[i]->pending, 0);
+	nr_local_stats.updates += k;
+	nr_local_stats.batches++;
+}
+
+intptr_t nr_update(nr_t *nr, comb_fn_t fn, intptr_t arg) {
+	nr_replica_t *r = nr->replicas[nr_zone];
+	comb_slot_t *slot;
+	AO_t i;
+
+	nr_register();
+	if ((slot = nr_slot) == NULL) {
+		i = AO_fetch_and_add_full(&r->nr_slots, 1);
+		if (i >= COMB_MAX_THREADS) {
+			fprintf(stderr, "Too many threads per zone (max %d)\n",
+					COMB_MAX_THREADS);
+			exit(1);
+		}
+		slot = nr_slot = &r->slots[i];
+	}
+	slot->fn = fn;
+	slot->arg = arg;
+	AO_store_release(&slot->pending, 1);
+	while (1) {
+		if (!AO_load_full(&r->combiner) &&
+			AO_compare_and_swap_full(&r->combiner, 0, 1)) {
+			nr_combine(nr, r);
+			AO_store_release(&r->combiner, 0);
+		}
+		if (!AO_load_acquire(&slot->pending))
+			return slot->result;
+		LOCK_PAUSE();
+	}
+}
+
+intptr_t nr_read(nr_t *nr, comb_fn_t fn, intptr_t arg) {
+	nr_replica_t *r = nr->replicas[nr_zone];
+	intptr_t result;
+	AO_t tail;
+
+	nr_register();
+	nr_local_stats.reads++;
+	/* The entries before the completed tail are all written */
+	tail = AO_load_full(&nr->completed_tail);
+	if (AO_load_full(&r->local_tail) < tail) {
+		nr_local_stats.read_syncs++;
+		while (AO_load_full(&r->local_tail) < tail) {
+			if (!AO_load_full(&r->combiner) &&
+				AO_compare_and_swap_full(&r->combiner, 0, 1)) {
+				lock_rw_write_acquire(&r->lock);
+				nr_apply(nr, r, tail, 0, NULL, 1);
+				lock_rw_write_release(&r->lock);
+				AO_store_release(&r->combiner, 0);
+			} else {
+				LOCK_PAUSE();
+			}
+		}
+	}
+	lock_rw_read_acquire(&r->lock);
+	result = fn(r->obj, arg);
+	lock_rw_read_release(&r->lock);
+	return result;
+}
+
+void nr_sync(nr_t *nr) {
+	AO_t tail = AO_load_full(&nr->log_tail);
+	int z;
+
+	for (z = 0; z < nr->nb_zones; z++)
+		nr_apply(nr, nr->replicas[z], tail, 0, NULL, 1);
+}
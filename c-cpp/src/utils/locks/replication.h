@@ -0,0 +1,102 @@
+/*
+ * File:
+ *   replication.h
+ * Description:
+ *   Node replication (Calciu, Sen, Balakrishnan and Aguilera, ASPLOS
+ *   2017) of a sequential data structure: each NUMA zone has its own
+ *   replica of the structure, the replicas are kept consistent by a shared
+ *   log of the update operations.
+ *   - the threads of a zone publish their updates in the flat-combining
+ *     slots of their replica, the combiner of the zone reserves entries
+ *     at the tail of the log for the whole batch, writes them, and then
+ *     applies the log to its replica up to the end of its batch,
+ *   - read-only operations run on the local replica under its read lock,
+ *     once the replica applied the log up to the tail completed when the
+ *     read started,
+ *   - the log is circular, a combiner waits for all replicas to have
+ *     applied an entry before reusing it and meanwhile brings the lagging
+ *     replicas up to date if their combiner is not running.
+ *   Zones follow the topology (one per NUMA node) or are emulated on a
+ *   single node, as the zones of the NUMA hash table.
+ *
+ * replication.h is part of Synchrobench
+ *
+ * Synchrobench is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, version 2
+ * of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _REPLICATION_H
+#define _REPLICATION_H
+
+#include "combining.h"
+#include "locks.h"
+
+#define NR_MAX_ZONES                    64
+#define NR_LOG_SIZE                     (1 << 16)
+
+/* Creates an empty replica of the data structure */
+typedef void *(*nr_new_t)(void);
+
+/* An entry of the log is written once its sequence is its index + 1 */
+typedef struct nr_entry {
+	comb_fn_t fn;
+	intptr_t arg;
+	volatile AO_t seq;
+} nr_entry_t;
+
+typedef struct nr_replica {
+	void *obj;
+	volatile AO_t local_tail;       /* log entries applied to obj */
+	volatile AO_t combiner;         /* combiner lock of the zone */
+	lock_rw_t lock;                 /* readers and log application */
+	volatile AO_t nr_slots;
+	char padding[CACHE_LINE_SIZE];
+	comb_slot_t slots[COMB_MAX_THREADS];
+} nr_replica_t;
+
+typedef struct nr {
+	int nb_zones;
+	int emulated;
+	int nodes[NR_MAX_ZONES];        /* memory node of each zone */
+	nr_entry_t *log;
+	char padding1[CACHE_LINE_SIZE];
+	volatile AO_t log_tail;         /* next entry to reserve */
+	char padding2[CACHE_LINE_SIZE];
+	volatile AO_t completed_tail;   /* entries applied to some replica */
+	char padding3[CACHE_LINE_SIZE];
+	nr_replica_t *replicas[NR_MAX_ZONES];
+} nr_t;
+
+typedef struct nr_stats {
+	unsigned long updates;
+	unsigned long batches;
+	unsigned long reads;
+	unsigned long read_syncs;       /* reads that waited for the log */
+	unsigned long helps;            /* replicas updated by another zone */
+} nr_stats_t;
+
+/*
+ * nr_init replicates obj, which must be empty, in nb_zones zones (0 for
+ * one zone per NUMA node, more zones than nodes are emulated).
+ * nr_thread_zone sets the zone of the calling thread to id modulo the
+ * number of zones and binds it to its node, threads default to zone 0.
+ * A thread uses a single instance.
+ */
+void nr_init(nr_t *nr, void *obj, nr_new_t new_replica, int nb_zones);
+void nr_thread_zone(nr_t *nr, int id);
+intptr_t nr_update(nr_t *nr, comb_fn_t fn, intptr_t arg);
+intptr_t nr_read(nr_t *nr, comb_fn_t fn, intptr_t arg);
+/* Applies the whole log to all replicas, without concurrent updates */
+void nr_sync(nr_t *nr);
+
+void nr_get_stats(nr_stats_t *stats);
+void nr_print_stats(void);
+
+#endif
@@ -0,0 +1,337 @@
+/*
+ * File:
+ *   lockbench.c
+ * Description:
+ *   Lock microbenchmark: threads repeatedly acquire a single lock, run a
+ *   critical section of a given length and then wait outside of it. The
+ *   benchmark measures the throughput, the handoff latency (the time from
+ *   a release to the acquisition by another thread) and the fairness of
+ *   the acquisitions among threads (Jain's index, min/max acquisitions).
+ *   It runs the versioned lock (the queue-based one with VERLOCK=QUEUE) or
+ *   one of the locks of src/utils/locks with LOCK=TICKET|MCS|CLH|TTAS|COHORT.
+ *
+ * lockbench.c is part of Synchrobench
+ *
+ * Synchrobench is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation, version 2
+ * of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <getopt.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/time.h>
+#include <time.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#ifdef LOCKLIB
+#include "../locks/locks.h"
+#define BENCH_LOCK_NAME                 LOCK_NAME
+#define BENCH_LOCK(lock)                LOCK(lock)
+#define BENCH_UNLOCK(lock)              UNLOCK(lock)
+typedef ptlock_t bench_lock_t;
+#else
+#include "versioned-lock.h"
+#define BENCH_LOCK_NAME                 VERLOCK_NAME
+#define INIT_LOCK(lock)                 VERLOCK_INIT(lock)
+#define BENCH_LOCK(lock)                spinlock(lock)
+#define BENCH_UNLOCK(lock)              unlock_and_increment_version(lock)
+typedef versioned_lock_t bench_lock_t;
+#endif
+
+#define DEFAULT_DURATION                2000
+#define DEFAULT_NB_THREADS              1
+#define DEFAULT_CS_LENGTH               50
+#define DEFAULT_NCS_LENGTH              200
+#define XSTR(s)                         STR(s)
+#define STR(s)                          #s
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE                 64
+#endif
+
+_Atomic(int) stop;
+
+typedef struct barrier {
+    pthread_cond_t complete;
+    pthread_mutex_t mutex;
+    int count;
+    int crossing;
+} barrier_t;
+
+void barrier_init(barrier_t *b, int n)
+{
+    pthread_cond_init(&b->complete, NULL);
+    pthread_mutex_init(&b->mutex, NULL);
+    b->count = n;
+    b->crossing = 0;
+}
+
+void barrier_cross(barrier_t *b)
+{
+    pthread_mutex_lock(&b->mutex);
+    b->crossing++;
+    if (b->crossing < b->count) {
+        pthread_cond_wait(&b->complete, &b->mutex);
+    } else {
+        pthread_cond_broadcast(&b->complete);
+        b->crossing = 0;
+    }
+    pthread_mutex_unlock(&b->mutex);
+}
+
+/* The lock and the data it protects, on separate cache lines */
+typedef struct shared {
+    bench_lock_t lock;
+    char padding1[CACHE_LINE_SIZE];
+    /* protected by lock */
+    unsigned long counter;
+    int last_owner;
+    uint64_t release_ns;
+    char padding2[CACHE_LINE_SIZE];
+} shared_t;
+
+typedef struct thread_data {
+    int id;
+    int cs_length;
+    int ncs_length;
+    unsigned long nb_acquires;
+    unsigned long nb_handoffs;
+    uint64_t handoff_ns;
+    uint64_t max_handoff_ns;
+    shared_t *shared;
+    barrier_t *barrier;
+    char padding[CACHE_LINE_SIZE];
+} thread_data_t;
+
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* busy loop that the compiler cannot remove */
+static inline void spin_work(int n) {
+    volatile int i;
+
+    for (i = 0; i < n; i++)
+        ;
+}
+
+void *test(void *data) {
+    thread_data_t *d = (thread_data_t *)data;
+    shared_t *s = d->shared;
+    uint64_t t, h;
+
+    barrier_cross(d->barrier);
+
+    while (atomic_load_explicit(&stop, memory_order_relaxed) == 0) {
+        BENCH_LOCK(&s->lock);
+        t = now_ns();
+        if (s->last_owner != d->id && s->last_owner >= 0) {
+            h = t - s->release_ns;
+            d->handoff_ns += h;
+            if (h > d->max_handoff_ns)
+                d->max_handoff_ns = h;
+            d->nb_handoffs++;
+        }
+        s->counter++;
+        spin_work(d->cs_length);
+        s->last_owner = d->id;
+        s->release_ns = now_ns();
+        BENCH_UNLOCK(&s->lock);
+        d->nb_acquires++;
+        spin_work(d->ncs_length);
+    }
+
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    struct option long_options[] = {
+        // These options don't set a flag
+        {"help",                      no_argument,       NULL, 'h'},
+        {"duration",                  required_argument, NULL, 'd'},
+        {"num-threads",               required_argument, NULL, 't'},
+        {"cs-length",                 required_argument, NULL, 'c'},
+        {"ncs-length",                required_argument, NULL, 'n'},
+        {NULL, 0, NULL, 0}
+    };
+
+    shared_t *shared;
+    int i, c;
+    thread_data_t *data;
+    pthread_t *threads;
+    pthread_attr_t attr;
+    barrier_t barrier;
+    struct timeval start, end;
+    struct timespec timeout;
+    int duration = DEFAULT_DURATION;
+    int nb_threads = DEFAULT_NB_THREADS;
+    int cs_length = DEFAULT_CS_LENGTH;
+    int ncs_length = DEFAULT_NCS_LENGTH;
+    unsigned long acquires, handoffs, min_acquires, max_acquires;
+    uint64_t handoff_ns, max_handoff_ns;
+    double sum_sq, jain;
+
+    while(1) {
+        i = 0;
+        c = getopt_long(argc, argv, "hd:t:c:n:", long_options, &i);
+
+        if(c == -1)
+            break;
+
+        if(c == 0 && long_options[i].flag == 0)
+            c = long_options[i].val;
+
+        switch(c) {
+                case 0:
+                    break;
+                case 'h':
+                    printf("lockbench -- lock microbenchmark\n"
+                           "\n"
+                           "Usage:\n"
+                           "  lockbench [options...]\n"
+                           "\n"
+                           "Options:\n"
+                           "  -h, --help\n"
+                           "        Print this message\n"
+                           "  -d, --duration <int>\n"
+                           "        Test duration in milliseconds (default=" XSTR(DEFAULT_DURATION) ")\n"
+                           "  -t, --num-threads <int>\n"
+                           "        Number of threads (default=" XSTR(DEFAULT_NB_THREADS) ")\n"
+                           "  -c, --cs-length <int>\n"
+                           "        Iterations of the critical section (default=" XSTR(DEFAULT_CS_LENGTH) ")\n"
+                           "  -n, --ncs-length <int>\n"
+                           "        Iterations outside of the critical section (default=" XSTR(DEFAULT_NCS_LENGTH) ")\n"
+                           );
+                    exit(0);
+                case 'd':
+                    duration = atoi(optarg);
+                    break;
+                case 't':
+                    nb_threads = atoi(optarg);
+                    break;
+                case 'c':
+                    cs_length = atoi(optarg);
+                    break;
+                case 'n':
+                    ncs_length = atoi(optarg);
+                    break;
+                case '?':
+                    printf("Use -h or --help for help\n");
+                    exit(0);
+                default:
+                    exit(1);
+        }
+    }
+
+    if (duration < 0 || nb_threads <= 0 || cs_length < 0 || ncs_length < 0) {
+        fprintf(stderr, "Invalid parameters\n");
+        exit(1);
+    }
+
+    printf("Lock type    : %s\n", BENCH_LOCK_NAME);
+    printf("Duration     : %d\n", duration);
+    printf("Nb threads   : %d\n", nb_threads);
+    printf("CS length    : %d\n", cs_length);
+    printf("NCS length   : %d\n", ncs_length);
+    printf("Lock size    : %d\n", (int)sizeof(bench_lock_t));
+
+    timeout.tv_sec = duration / 1000;
+    timeout.tv_nsec = (duration % 1000) * 1000000;
+
+    if ((shared = (shared_t *)calloc(1, sizeof(shared_t))) == NULL ||
+        (data = (thread_data_t *)calloc(nb_threads, sizeof(thread_data_t))) == NULL ||
+        (threads = (pthread_t *)malloc(nb_threads * sizeof(pthread_t))) == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    INIT_LOCK(&shared->lock);
+    shared->last_owner = -1;
+
+    atomic_store(&stop, 0);
+    barrier_init(&barrier, nb_threads + 1);
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    for (i = 0; i < nb_threads; i++) {
+        data[i].id = i;
+        data[i].cs_length = cs_length;
+        data[i].ncs_length = ncs_length;
+        data[i].shared = shared;
+        data[i].barrier = &barrier;
+        if (pthread_create(&threads[i], &attr, test, (void *)(&data[i])) != 0) {
+            fprintf(stderr, "Error creating thread\n");
+            exit(1);
+        }
+    }
+    pthread_attr_destroy(&attr);
+
+    barrier_cross(&barrier);
+
+    printf("STARTING...\n");
+    gettimeofday(&start, NULL);
+    nanosleep(&timeout, NULL);
+    atomic_store(&stop, 1);
+    gettimeofday(&end, NULL);
+    printf("STOPPING...\n");
+
+    for (i = 0; i < nb_threads; i++) {
+        if (pthread_join(threads[i], NULL) != 0) {
+            fprintf(stderr, "Error waiting for thread completion\n");
+            exit(1);
+        }
+    }
+
+    duration = (end.tv_sec * 1000 + end.tv_usec / 1000) - (start.tv_sec * 1000 + start.tv_usec / 1000);
+    acquires = handoffs = 0;
+    handoff_ns = max_handoff_ns = 0;
+    min_acquires = (unsigned long) -1;
+    max_acquires = 0;
+    sum_sq = 0;
+    for (i = 0; i < nb_threads; i++) {
+        printf("Thread %d\n", i);
+        printf("  #acquires   : %lu\n", data[i].nb_acquires);
+        printf("  #handoffs   : %lu\n", data[i].nb_handoffs);
+        acquires += data[i].nb_acquires;
+        handoffs += data[i].nb_handoffs;
+        handoff_ns += data[i].handoff_ns;
+        if (data[i].max_handoff_ns > max_handoff_ns)
+            max_handoff_ns = data[i].max_handoff_ns;
+        if (data[i].nb_acquires < min_acquires)
+            min_acquires = data[i].nb_acquires;
+        if (data[i].nb_acquires > max_acquires)
+            max_acquires = data[i].nb_acquires;
+        sum_sq += (double) data[i].nb_acquires * data[i].nb_acquires;
+    }
+    jain = (sum_sq > 0 ? ((double) acquires * acquires) / (nb_threads * sum_sq) : 1.0);
+
+    printf("Duration      : %d (ms)\n", duration);
+    printf("#acquires     : %lu (%f / s)\n", acquires, acquires * 1000.0 / duration);
+    printf("#handoffs     : %lu\n", handoffs);
+    printf("  avg latency : %f (ns)\n", handoffs ? (double) handoff_ns / handoffs : 0.0);
+    printf("  max latency : %lu (ns)\n", (unsigned long) max_handoff_ns);
+    printf("Fairness      : %f (Jain's index)\n", jain);
+    printf("  min/max     : %lu / %lu\n", min_acquires, max_acquires);
+    printf("Counter       : %lu (expected: %lu)\n", shared->counter, acquires);
+
+#ifdef LOCKLIB
+    lock_print_stats();
+#endif
+
+    free(threads);
+    free(data);
+    free(shared);
+
+    return 0;
+}
@@ -21,28 +21,119 @@
 
 #include "versioned-lock.h"
 
-verlock_t get_version(_Atomic(verlock_t)* lock) {
-    return (atomic_load(lock) & ~((verlock_t)1));
+#ifdef VERLOCK_QUEUE
+#define VERLOCK_WORD(lock)              (&(lock)->word)
+#else
+#define VERLOCK_WORD(lock)              (lock)
+#endif
+
+/* 
+ * The version is read with acquire semantics so that the reads of the
+ * node that follow cannot be performed before it.
+ */
+verlock_t get_version(versioned_lock_t* lock) {
+    return (atomic_load_explicit(VERLOCK_WORD(lock), memory_order_acquire) & ~((verlock_t)1));
+}
+
+/* the lock word is read before attempting the CAS to avoid useless RFOs */
+int try_lock_at_version(versioned_lock_t* lock, verlock_t version) {
+    if (atomic_load_explicit(VERLOCK_WORD(lock), memory_order_relaxed) != version)
+        return 0;
+    return atomic_compare_exchange_strong_explicit(VERLOCK_WORD(lock), &version, version+1,
+                                                   memory_order_acq_rel,
+                                                   memory_order_relaxed);
+}
+
+/* test-and-test-and-set with bounded exponential backoff */
+static void ttas_lock(_Atomic(verlock_t)* word) {
+    unsigned int backoff = VERLOCK_BACKOFF_MIN;
+    unsigned int i;
+    verlock_t version;
+
+    while (1) {
+        version = atomic_load_explicit(word, memory_order_relaxed);
+        if (!(version & 1) &&
+            atomic_compare_exchange_weak_explicit(word, &version, version+1,
+                                                  memory_order_acquire,
+                                                  memory_order_relaxed))
+            return;
+        for (i = 0; i < backoff; i++)
+            VERLOCK_PAUSE();
+        if (backoff < VERLOCK_BACKOFF_MAX)
+            backoff <<= 1;
+    }
+}
+
+#ifdef VERLOCK_QUEUE
+
+/* a thread waits for a single lock at a time */
+static __thread verlock_qnode_t verlock_qnode;
+
+static void queue_lock(versioned_lock_t* lock, verlock_qnode_t* node) {
+    verlock_qnode_t* pred;
+
+    atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+    atomic_store_explicit(&node->locked, 1, memory_order_relaxed);
+    pred = atomic_exchange_explicit(&lock->tail, node, memory_order_acq_rel);
+    if (pred == NULL)
+        return;
+    atomic_store_explicit(&pred->next, node, memory_order_release);
+    while (atomic_load_explicit(&node->locked, memory_order_acquire))
+        VERLOCK_PAUSE();
+}
+
+static void queue_unlock(versioned_lock_t* lock, verlock_qnode_t* node) {
+    verlock_qnode_t* succ;
+    verlock_qnode_t* expected = node;
+
+    succ = atomic_load_explicit(&node->next, memory_order_acquire);
+    if (succ == NULL) {
+        if (atomic_compare_exchange_strong_explicit(&lock->tail, &expected, NULL,
+                                                    memory_order_release,
+                                                    memory_order_relaxed))
+            return;
+        while ((succ = atomic_load_explicit(&node->next, memory_order_acquire)) == NULL)
+            VERLOCK_PAUSE();
+    }
+    atomic_store_explicit(&succ->locked, 0, memory_order_release);
 }
 
-int try_lock_at_version(_Atomic(verlock_t)* lock, verlock_t version) {
-    return atomic_compare_exchange_strong(lock, &version, version+1);
+/*
+ * The uncontended case takes the lock directly, otherwise the thread
+ * queues up and only the head of the queue spins on the lock word. The
+ * queue is left as soon as the lock word is acquired.
+ */
+void spinlock(versioned_lock_t* lock) {
+    verlock_t version;
+
+    version = atomic_load_explicit(&lock->word, memory_order_relaxed);
+    if (!(version & 1) &&
+        atomic_compare_exchange_strong_explicit(&lock->word, &version, version+1,
+                                                memory_order_acquire,
+                                                memory_order_relaxed))
+        return;
+    queue_lock(lock, &verlock_qnode);
+    ttas_lock(&lock->word);
+    queue_unlock(lock, &verlock_qnode);
 }
 
-void spinlock(_Atomic(verlock_t)* lock) {
-    while (!try_lock_at_version(lock, get_version(lock))) {};
+#else /* ! VERLOCK_QUEUE */
+
+void spinlock(versioned_lock_t* lock) {
+    ttas_lock(lock);
 }
 
-void unlock_and_increment_version(_Atomic(verlock_t)* lock) {
-    atomic_fetch_add(lock, 1);
+#endif /* ! VERLOCK_QUEUE */
+
+void unlock_and_increment_version(versioned_lock_t* lock) {
+    atomic_fetch_add_explicit(VERLOCK_WORD(lock), 1, memory_order_release);
 }
 
-verlock_t unlock_increment_and_get_version(_Atomic(verlock_t)* lock) {
-    verlock_t next_version = get_version(lock)+2;
-    atomic_fetch_add(lock, 1);
-    return next_version;
+verlock_t unlock_increment_and_get_version(versioned_lock_t* lock) {
+    /* the locked word is the current version plus 1 */
+    return atomic_fetch_add_explicit(VERLOCK_WORD(lock), 1, memory_order_release) + 1;
 }
 
-void unlock_without_increment_version(_Atomic(verlock_t)* lock) {
-    atomic_fetch_sub(lock, 1);
+void unlock_without_increment_version(versioned_lock_t* lock) {
+    atomic_fetch_sub_explicit(VERLOCK_WORD(lock), 1, memory_order_release);
 }
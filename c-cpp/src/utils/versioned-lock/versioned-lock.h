@@ -5,6 +5,13 @@
  *   Implements the versioned try-lock as explained in:
  *   A Concurrency-Optimal List-Based Set. Gramoli, Kuznetsov, Ravi, Shang.
  *   arXiv:1502.01633, February 2015 and DISC 2015
+ *   The lock word holds the version in its high-order bits and the lock
+ *   bit in its low-order bit. spinlock is a test-and-test-and-set lock
+ *   with bounded exponential backoff. When compiled with VERLOCK_QUEUE,
+ *   each versioned lock also has the tail of an MCS queue: the threads
+ *   spinning in spinlock queue up first so that only the head of the
+ *   queue polls the lock word, the try-lock and the versions are
+ *   unchanged.
  *
  * versioned-lock.h is part of Synchrobench
  *
@@ -22,16 +29,53 @@
 #ifndef _VERSIONED_LOCK_H
 #define _VERSIONED_LOCK_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdatomic.h>
 
+#define VERLOCK_BACKOFF_MIN             4
+#define VERLOCK_BACKOFF_MAX             1024
+
+#if defined(__x86_64__) || defined(__i386__)
+#define VERLOCK_PAUSE()                 __asm__ __volatile__("pause" ::: "memory")
+#else
+#define VERLOCK_PAUSE()                 __asm__ __volatile__("" ::: "memory")
+#endif
+
+#ifdef VERLOCK_QUEUE
+#define VERLOCK_NAME                    "versioned (queue)"
+#else
+#define VERLOCK_NAME                    "versioned (ttas)"
+#endif
+
 typedef uint32_t verlock_t;
 
-verlock_t get_version(_Atomic(verlock_t)* lock);
-int try_lock_at_version(_Atomic(verlock_t)* lock, verlock_t version);
-void spinlock(_Atomic(verlock_t)* lock);
-void unlock_and_increment_version(_Atomic(verlock_t)* lock);
-verlock_t unlock_increment_and_get_version(_Atomic(verlock_t)* lock);
-void unlock_without_increment_version(_Atomic(verlock_t)* lock);
+#ifdef VERLOCK_QUEUE
+typedef struct verlock_qnode {
+    struct verlock_qnode* _Atomic next;
+    _Atomic(int) locked;
+} verlock_qnode_t;
+
+typedef struct versioned_lock {
+    _Atomic(verlock_t) word;
+    verlock_qnode_t* _Atomic tail;
+} versioned_lock_t;
+
+#define VERLOCK_INIT(lock)              do { \
+    atomic_init(&(lock)->word, 0);                \
+    atomic_init(&(lock)->tail, NULL);             \
+  } while (0)
+#else
+typedef _Atomic(verlock_t) versioned_lock_t;
+
+#define VERLOCK_INIT(lock)              atomic_init(lock, 0)
+#endif
+
+verlock_t get_version(versioned_lock_t* lock);
+int try_lock_at_version(versioned_lock_t* lock, verlock_t version);
+void spinlock(versioned_lock_t* lock);
+void unlock_and_increment_version(versioned_lock_t* lock);
+verlock_t unlock_increment_and_get_version(versioned_lock_t* lock);
+void unlock_without_increment_version(versioned_lock_t* lock);
 
 #endif